@@ -22,6 +22,7 @@
 #include "OpenKneeboard_CAPI.h"
 
 #include <OpenKneeboard/GameEvent.h>
+#include <OpenKneeboard/Telemetry.h>
 #include <OpenKneeboard/dprint.h>
 #include <OpenKneeboard/tracing.h>
 
@@ -65,6 +66,45 @@ OPENKNEEBOARD_CAPI void OpenKneeboard_send_wchar_ptr(
   ge.Send();
 }
 
+OPENKNEEBOARD_CAPI void OpenKneeboard_send_utf8_async(
+  const char* eventName,
+  size_t eventNameByteCount,
+  const char* eventValue,
+  size_t eventValueByteCount) {
+  init();
+
+  const OpenKneeboard::GameEvent ge {
+    {eventName, eventNameByteCount},
+    {eventValue, eventValueByteCount},
+  };
+  ge.SendAsync();
+}
+
+OPENKNEEBOARD_CAPI void OpenKneeboard_flush() {
+  init();
+  OpenKneeboard::GameEvent::FlushAsyncSends();
+}
+
+OPENKNEEBOARD_CAPI void OpenKneeboard_publish_ownship(
+  double simulationTime,
+  double latitude,
+  double longitude,
+  double altitude,
+  double heading,
+  double groundSpeed) {
+  init();
+
+  static OpenKneeboard::Telemetry::Writer sWriter;
+  sWriter.Publish({
+    .mSimulationTime = simulationTime,
+    .mLatitude = latitude,
+    .mLongitude = longitude,
+    .mAltitude = altitude,
+    .mHeading = heading,
+    .mGroundSpeed = groundSpeed,
+  });
+}
+
 namespace OpenKneeboard {
 
 /* PS >
@@ -50,6 +50,41 @@ OPENKNEEBOARD_CAPI void OpenKneeboard_send_wchar_ptr(
   const wchar_t* messageValue,
   size_t messageValueCharCount);
 
+/* Queue a message to be sent from a background thread, instead of waiting
+ * for it to be sent; call `OpenKneeboard_flush()` before exiting to make
+ * sure queued messages have been sent.
+ */
+OPENKNEEBOARD_CAPI void OpenKneeboard_send_utf8_async(
+  const char* messageName,
+  size_t messageNameByteCount,
+  const char* messageValue,
+  size_t messageValueByteCount);
+
+/* Synchronously send any messages queued by `OpenKneeboard_send_utf8_async()`
+ */
+OPENKNEEBOARD_CAPI void OpenKneeboard_flush(void);
+
+/* Own-ship telemetry, e.g. for moving maps.
+ *
+ * This is written directly to shared memory without blocking, so it is
+ * suitable for calling every simulation frame; only the latest values are
+ * kept, and a value may be dropped rather than wait for a stalled producer.
+ * Use messages for anything that changes less frequently.
+ *
+ * - `simulationTime` is in seconds since the simulation started
+ * - `latitude` and `longitude` are WGS84, in degrees
+ * - `altitude` is in meters above mean sea level
+ * - `heading` is in degrees true
+ * - `groundSpeed` is in meters per second
+ */
+OPENKNEEBOARD_CAPI void OpenKneeboard_publish_ownship(
+  double simulationTime,
+  double latitude,
+  double longitude,
+  double altitude,
+  double heading,
+  double groundSpeed);
+
 #if UINTPTR_MAX == UINT64_MAX
 #define OPENKNEEBOARD_CAPI_DLL_NAME_A "OpenKneeboard_CAPI64.dll"
 #define OPENKNEEBOARD_CAPI_DLL_NAME_W L"OpenKneeboard_CAPI64.dll"
@@ -18,6 +18,8 @@
  * USA.
  */
 #include <OpenKneeboard/GameEvent.h>
+#include <OpenKneeboard/GameEventDeltaEncoder.h>
+#include <OpenKneeboard/Telemetry.h>
 #include <OpenKneeboard/dprint.h>
 #include <OpenKneeboard/tracing.h>
 #include <Windows.h>
@@ -27,6 +29,7 @@
 #include <cstdlib>
 #include <format>
 #include <string>
+#include <vector>
 
 extern "C" {
 #include <lauxlib.h>
@@ -58,11 +61,92 @@ static int SendToOpenKneeboard(lua_State* state) {
     lua_tostring(state, 1),
     lua_tostring(state, 2),
   };
-  ge.Send();
+  // This is usually called from DCS's simulation thread
+  ge.SendAsync();
 
   return 0;
 }
 
+/** `publishStateRaw(events, [forceKeyframe])`
+ *
+ * `events` is the full current state, in the same format as `sendMulti()`:
+ * `{ {name, value}, ... }`. Only values that have changed since they were
+ * last published are sent, other than in periodic keyframes.
+ */
+static int PublishStateToOpenKneeboard(lua_State* state) {
+  // The DCS hook publishes every half-second, so this is a keyframe every
+  // 10 seconds
+  static OpenKneeboard::GameEventDeltaEncoder sEncoder {20};
+
+  const auto argc = lua_gettop(state);
+  if (argc < 1 || argc > 2 || !lua_istable(state, 1)) {
+    lua_pushliteral(state, "A table of {name, value} pairs is required\n");
+    lua_error(state);
+    return 1;
+  }
+  if (argc == 2 && lua_toboolean(state, 2)) {
+    sEncoder.ForceKeyframe();
+  }
+
+  std::vector<OpenKneeboard::GameEvent> events;
+  const auto count = lua_objlen(state, 1);
+  events.reserve(count);
+  for (size_t i = 1; i <= count; ++i) {
+    lua_rawgeti(state, 1, static_cast<int>(i));
+    lua_rawgeti(state, -1, 1);
+    lua_rawgeti(state, -2, 2);
+    if (!(lua_isstring(state, -2) && lua_isstring(state, -1))) {
+      lua_pop(state, 3);
+      push_arg_error(state);
+      return 1;
+    }
+    events.push_back({lua_tostring(state, -2), lua_tostring(state, -1)});
+    lua_pop(state, 3);
+  }
+
+  for (const auto& event: sEncoder.Update(events)) {
+    // Usually called from DCS's simulation thread
+    event.SendAsync();
+  }
+  return 0;
+}
+
+/** `publishOwnship(simulationTime, latitude, longitude, altitude, heading,
+ * groundSpeed)`
+ *
+ * Units are as in `OpenKneeboard::Telemetry::OwnshipRecord`. This writes
+ * directly to shared memory, so is cheap enough to call every frame.
+ */
+static int PublishOwnshipToOpenKneeboard(lua_State* state) {
+  static OpenKneeboard::Telemetry::Writer sWriter;
+
+  constexpr int ArgCount = 6;
+  bool valid = (lua_gettop(state) == ArgCount);
+  for (int i = 1; valid && i <= ArgCount; ++i) {
+    valid = lua_isnumber(state, i);
+  }
+  if (!valid) {
+    lua_pushliteral(state, "6 number arguments are required\n");
+    lua_error(state);
+    return 1;
+  }
+
+  sWriter.Publish({
+    .mSimulationTime = lua_tonumber(state, 1),
+    .mLatitude = lua_tonumber(state, 2),
+    .mLongitude = lua_tonumber(state, 3),
+    .mAltitude = lua_tonumber(state, 4),
+    .mHeading = lua_tonumber(state, 5),
+    .mGroundSpeed = lua_tonumber(state, 6),
+  });
+  return 0;
+}
+
+static int FlushToOpenKneeboard(lua_State*) {
+  OpenKneeboard::GameEvent::FlushAsyncSends();
+  return 0;
+}
+
 extern "C" int __declspec(dllexport)
 #if UINTPTR_MAX == UINT64_MAX
   luaopen_OpenKneeboard_LuaAPI64(lua_State* state) {
@@ -72,9 +156,15 @@ extern "C" int __declspec(dllexport)
   OpenKneeboard::DPrintSettings::Set({
     .prefix = "OpenKneeboard-LuaAPI",
   });
-  lua_createtable(state, 0, 1);
+  lua_createtable(state, 0, 4);
   lua_pushcfunction(state, &SendToOpenKneeboard);
   lua_setfield(state, -2, "sendRaw");
+  lua_pushcfunction(state, &PublishStateToOpenKneeboard);
+  lua_setfield(state, -2, "publishStateRaw");
+  lua_pushcfunction(state, &PublishOwnshipToOpenKneeboard);
+  lua_setfield(state, -2, "publishOwnship");
+  lua_pushcfunction(state, &FlushToOpenKneeboard);
+  lua_setfield(state, -2, "flush");
   return 1;
 }
 
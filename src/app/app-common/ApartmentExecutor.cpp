@@ -0,0 +1,63 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/ApartmentExecutor.h>
+#include <OpenKneeboard/Events.h>
+
+#include <shims/winrt/base.h>
+
+#include <winrt/Windows.System.h>
+
+namespace OpenKneeboard {
+
+static void Drain(const std::weak_ptr<Executor>& weak) {
+  if (auto executor = weak.lock()) {
+    const EventDelay delay;
+    executor->Drain();
+  }
+}
+
+static winrt::fire_and_forget DrainInApartment(
+  winrt::apartment_context apartment,
+  std::weak_ptr<Executor> weak) {
+  // `co_await apartment` resumes inline if we're already in it, so leave
+  // first
+  co_await winrt::resume_background();
+  co_await apartment;
+  Drain(weak);
+}
+
+std::shared_ptr<Executor> CreateApartmentExecutor() {
+  // Tasks must never run inline from `Post()`, even when posted from the
+  // executor's own thread: otherwise, every task would be its own batch,
+  // and e.g. `EventCoalescer` would never merge anything.
+  if (auto queue
+      = winrt::Windows::System::DispatcherQueue::GetForCurrentThread()) {
+    return Executor::Create([queue](std::weak_ptr<Executor> weak) {
+      queue.TryEnqueue([weak = std::move(weak)]() { Drain(weak); });
+    });
+  }
+
+  return Executor::Create(
+    [apartment = winrt::apartment_context()](std::weak_ptr<Executor> weak) {
+      DrainInApartment(apartment, std::move(weak));
+    });
+}
+
+}// namespace OpenKneeboard
@@ -51,6 +51,10 @@ OPENKNEEBOARD_DEFINE_SPARSE_JSON(
   mRed,
   mGreen,
   mBlue)
+OPENKNEEBOARD_DEFINE_SPARSE_JSON(
+  AppSettings::FrameRateSettings,
+  mMaximumFPS,
+  mMinimumFPS)
 
 template <>
 void from_json_postprocess<AppSettings>(
@@ -104,6 +108,7 @@ OPENKNEEBOARD_DEFINE_SPARSE_JSON(
   mBookmarks,
   mInGameUI,
   mTint,
+  mFrameRate,
   mLastRunVersion)
 
 }// namespace OpenKneeboard
@@ -21,12 +21,80 @@
 #include <OpenKneeboard/DXResources.h>
 #include <OpenKneeboard/scope_guard.h>
 
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
 namespace OpenKneeboard {
 
-CachedLayer::CachedLayer(const DXResources& dxr) {
+namespace {
+
+struct CacheKey {
+  uint64_t mLayerID;
+  CachedLayer::Key mKey;
+  uint32_t mWidth;
+  uint32_t mHeight;
+
+  constexpr bool operator==(const CacheKey&) const noexcept = default;
+};
+
+struct CacheKeyHash {
+  size_t operator()(const CacheKey& key) const noexcept {
+    size_t ret = std::hash<uint64_t> {}(key.mLayerID);
+    for (const size_t value: {
+           key.mKey,
+           static_cast<size_t>(key.mWidth),
+           static_cast<size_t>(key.mHeight),
+         }) {
+      ret ^= std::hash<size_t> {}(value) + 0x9e3779b9 + (ret << 6)
+        + (ret >> 2);
+    }
+    return ret;
+  }
+};
+
+struct SharedCache {
+  std::mutex mMutex;
+  LRUCache<CacheKey, winrt::com_ptr<ID2D1Bitmap1>, CacheKeyHash> mBitmaps {
+    CachedLayer::BudgetInBytes};
+  // For `TakeEvictedKeys()`
+  std::unordered_set<CachedLayer::Key> mEvictedKeys;
+
+  // Reused between misses, as creating them is relatively expensive.
+  // There can be more than one as `impl` can render other cached layers.
+  winrt::com_ptr<ID2D1Device> mDevice;
+  std::vector<winrt::com_ptr<ID2D1DeviceContext>> mIdleContexts;
+
+  // Release D2D resources when the last layer goes, rather than at exit
+  size_t mLayerCount {0};
+};
+
+SharedCache& GetSharedCache() {
+  static SharedCache sCache;
+  return sCache;
+}
+
+std::atomic<uint64_t> gNextLayerID {0};
+
+}// namespace
+
+CachedLayer::CachedLayer(const DXResources&) : mID(++gNextLayerID) {
+  auto& shared = GetSharedCache();
+  const std::unique_lock lock(shared.mMutex);
+  ++shared.mLayerCount;
 }
 
 CachedLayer::~CachedLayer() {
+  this->Reset();
+
+  auto& shared = GetSharedCache();
+  const std::unique_lock lock(shared.mMutex);
+  if (--shared.mLayerCount == 0) {
+    shared.mBitmaps.Clear();
+    shared.mIdleContexts.clear();
+    shared.mDevice = nullptr;
+  }
 }
 
 void CachedLayer::Render(
@@ -35,35 +103,53 @@ void CachedLayer::Render(
   Key cacheKey,
   ID2D1DeviceContext* ctx,
   std::function<void(ID2D1DeviceContext*, const D2D1_SIZE_U&)> impl) {
-  std::scoped_lock lock(mCacheMutex);
   ctx->SetTransform(D2D1::Matrix3x2F::Identity());
 
-  if (mCacheSize != nativeSize || !mCache) {
-    mCache = nullptr;
-    mCacheSize = nativeSize;
-    D2D1_BITMAP_PROPERTIES1 props {
-      .pixelFormat
-      = {DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED},
-      .bitmapOptions = D2D1_BITMAP_OPTIONS_TARGET,
-    };
-    winrt::check_hresult(
-      ctx->CreateBitmap(nativeSize, nullptr, 0, &props, mCache.put()));
-  }
+  auto& shared = GetSharedCache();
+  const CacheKey key {mID, cacheKey, nativeSize.width, nativeSize.height};
 
-  if (mKey == cacheKey) {
-    ctx->DrawBitmap(mCache.get(), where);
-    return;
-  }
+  winrt::com_ptr<ID2D1DeviceContext> cacheContext;
+  {
+    const std::unique_lock lock(shared.mMutex);
+    if (auto bitmap = shared.mBitmaps.Find(key)) {
+      ctx->DrawBitmap(bitmap->get(), where);
+      return;
+    }
 
-  winrt::com_ptr<ID2D1Device> device;
-  ctx->GetDevice(device.put());
-  winrt::check_pointer(device.get());
+    winrt::com_ptr<ID2D1Device> device;
+    ctx->GetDevice(device.put());
+    winrt::check_pointer(device.get());
+    if (device != shared.mDevice) {
+      shared.mBitmaps.Clear();
+      shared.mIdleContexts.clear();
+      shared.mDevice = device;
+    }
 
-  winrt::com_ptr<ID2D1DeviceContext> cacheContext;
-  winrt::check_hresult(device->CreateDeviceContext(
-    D2D1_DEVICE_CONTEXT_OPTIONS_NONE, cacheContext.put()));
+    if (shared.mIdleContexts.empty()) {
+      winrt::check_hresult(device->CreateDeviceContext(
+        D2D1_DEVICE_CONTEXT_OPTIONS_NONE, cacheContext.put()));
+    } else {
+      cacheContext = std::move(shared.mIdleContexts.back());
+      shared.mIdleContexts.pop_back();
+    }
+  }
+  // Not holding the lock while rendering, as `impl` may use other
+  // cached layers
+  const scope_guard returnContext([&shared, &cacheContext]() {
+    cacheContext->SetTarget(nullptr);
+    const std::unique_lock lock(shared.mMutex);
+    shared.mIdleContexts.push_back(cacheContext);
+  });
 
-  cacheContext->SetTarget(mCache.get());
+  D2D1_BITMAP_PROPERTIES1 props {
+    .pixelFormat = {DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED},
+    .bitmapOptions = D2D1_BITMAP_OPTIONS_TARGET,
+  };
+  winrt::com_ptr<ID2D1Bitmap1> bitmap;
+  winrt::check_hresult(
+    ctx->CreateBitmap(nativeSize, nullptr, 0, &props, bitmap.put()));
+
+  cacheContext->SetTarget(bitmap.get());
   {
     cacheContext->BeginDraw();
     scope_guard endDraw([cacheContext]() noexcept {
@@ -72,15 +158,39 @@ void CachedLayer::Render(
     cacheContext->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
     impl(cacheContext.get(), nativeSize);
   }
-  ctx->DrawBitmap(mCache.get(), where);
-  mKey = cacheKey;
+  ctx->DrawBitmap(bitmap.get(), where);
+
+  const std::unique_lock lock(shared.mMutex);
+  shared.mEvictedKeys.erase(cacheKey);
+  // BGRA, so 4 bytes per pixel
+  const auto evicted = shared.mBitmaps.Insert(
+    key,
+    std::move(bitmap),
+    static_cast<size_t>(nativeSize.width) * nativeSize.height * 4);
+  for (const auto& it: evicted) {
+    shared.mEvictedKeys.insert(it.mKey);
+  }
 }
 
 void CachedLayer::Reset() {
-  std::scoped_lock lock(mCacheMutex);
+  auto& shared = GetSharedCache();
+  const std::unique_lock lock(shared.mMutex);
+  shared.mBitmaps.EraseIf(
+    [id = mID](const CacheKey& key) { return key.mLayerID == id; });
+}
+
+std::vector<CachedLayer::Key> CachedLayer::TakeEvictedKeys() {
+  auto& shared = GetSharedCache();
+  const std::unique_lock lock(shared.mMutex);
+  std::vector<Key> ret(shared.mEvictedKeys.begin(), shared.mEvictedKeys.end());
+  shared.mEvictedKeys.clear();
+  return ret;
+}
 
-  mKey = ~Key {0};
-  mCache = nullptr;
+CachedLayer::Statistics CachedLayer::GetStatistics() {
+  auto& shared = GetSharedCache();
+  const std::unique_lock lock(shared.mMutex);
+  return shared.mBitmaps.GetStatistics();
 }
 
 }// namespace OpenKneeboard
@@ -43,4 +43,20 @@ void CursorRenderer::Render(
   ctx->DrawEllipse(elipse, mInnerBrush.get(), cursorStroke);
 }
 
+D2D1_RECT_F CursorRenderer::GetBounds(
+  const D2D1_POINT_2F& point,
+  const D2D1_SIZE_F& scaleTo) {
+  const auto cursorRadius = scaleTo.height / CursorRadiusDivisor;
+  const auto cursorStroke = scaleTo.height / CursorStrokeDivisor;
+  // The outer stroke is centered on the ellipse, so extends by half its
+  // width; add a pixel for antialiasing
+  const auto extent = cursorRadius + cursorStroke + 1;
+  return {
+    point.x - extent,
+    point.y - extent,
+    point.x + extent,
+    point.y + extent,
+  };
+}
+
 }// namespace OpenKneeboard
@@ -48,31 +48,22 @@ EventReceiver::~EventReceiver() {
 void EventReceiver::RemoveAllEventListeners() {
   decltype(mSenders) senders;
   {
-    senders = mSenders;
-    mSenders.clear();
+    senders.swap(mSenders);
   }
 
-  for (auto& sender: senders) {
+  for (auto& [token, sender]: senders) {
     sender->Invalidate();
   }
 }
 
 void EventReceiver::RemoveEventListener(EventHandlerToken token) {
-  std::shared_ptr<EventConnectionBase> toInvalidate;
-  {
-    for (auto it = mSenders.begin(); it != mSenders.end(); ++it) {
-      auto& sender = *it;
-      if (sender->mToken != token) {
-        continue;
-      }
-      toInvalidate = sender;
-      mSenders.erase(it);
-      break;
-    }
-  }
-  if (toInvalidate) {
-    toInvalidate->Invalidate();
+  auto it = mSenders.find(token);
+  if (it == mSenders.end()) {
+    return;
   }
+  const auto sender = std::move(it->second);
+  mSenders.erase(it);
+  sender->Invalidate();
 }
 
 namespace {
@@ -93,14 +84,14 @@ static void FlushEmitterQueue() {
   }
 }
 
-void EventBase::InvokeOrEnqueue(
+bool EventBase::IsDelayed() noexcept {
+  return gDelayDepth > 0;
+}
+
+void EventBase::Enqueue(
   std::function<void()> func,
   std::source_location location) {
-  if (gDelayDepth) {
-    gEmitterQueue.push({func, location});
-    return;
-  }
-  func();
+  gEmitterQueue.push({std::move(func), location});
 }
 
 EventDelay::EventDelay(std::source_location source) : mSourceLocation(source) {
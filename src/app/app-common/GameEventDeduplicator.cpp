@@ -0,0 +1,80 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/DCSWorld.h>
+#include <OpenKneeboard/GameEventDeduplicator.h>
+
+#include <algorithm>
+
+namespace OpenKneeboard {
+
+bool GameEventDeduplicator::IsDeduplicated(std::string_view name) {
+  // Events that are actions or notifications rather than state; repeats of
+  // these are meaningful.
+  //
+  // Add new DCS events here if handlers need to see every occurrence.
+  constexpr std::string_view optOuts[] {
+    DCSWorld::EVT_MESSAGE,
+    DCSWorld::EVT_SIMULATION_START,
+  };
+  // API events (e.g. from buttons) are always delivered
+  return name.starts_with("dcs/")
+    && std::ranges::find(optOuts, name) == std::end(optOuts);
+}
+
+bool GameEventDeduplicator::ShouldDeliver(const GameEvent& event) {
+  const std::unique_lock lock(mMutex);
+
+  if (event.name == DCSWorld::EVT_SIMULATION_START) {
+    mLastValues.clear();
+  }
+
+  if (!IsDeduplicated(event.name)) {
+    ++mStatistics.mDelivered;
+    return true;
+  }
+
+  // Comparing the whole value is no more expensive than hashing it, and
+  // can't be fooled by collisions
+  auto it = mLastValues.find(event.name);
+  if (it == mLastValues.end()) {
+    mLastValues.emplace(event.name, event.value);
+  } else if (it->second == event.value) {
+    ++mStatistics.mSuppressed;
+    return false;
+  } else {
+    it->second = event.value;
+  }
+
+  ++mStatistics.mDelivered;
+  return true;
+}
+
+void GameEventDeduplicator::Reset() {
+  const std::unique_lock lock(mMutex);
+  mLastValues.clear();
+}
+
+GameEventDeduplicator::Statistics GameEventDeduplicator::GetStatistics()
+  const {
+  const std::unique_lock lock(mMutex);
+  return mStatistics;
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,100 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventDeduplicator.h>
+#include <OpenKneeboard/GameEventDispatcher.h>
+
+namespace OpenKneeboard {
+
+Event<SharedGameEvent>& GameEventDispatcher::GetOrCreate(
+  std::unique_ptr<Event<SharedGameEvent>>* event) {
+  if (!*event) {
+    *event = std::make_unique<Event<SharedGameEvent>>();
+    // Cached routes don't include the new event
+    mRoutes.clear();
+  }
+  return **event;
+}
+
+Event<SharedGameEvent>& GameEventDispatcher::GetEvent(GameEventID id) {
+  const std::unique_lock lock(mMutex);
+  return GetOrCreate(&mSubscriptions.GetOrCreate(id.GetName()).mExact);
+}
+
+Event<SharedGameEvent>& GameEventDispatcher::GetPrefixEvent(
+  std::string_view prefix) {
+  const std::unique_lock lock(mMutex);
+  return GetOrCreate(&mSubscriptions.GetOrCreate(prefix).mPrefix);
+}
+
+void GameEventDispatcher::Dispatch(const SharedGameEvent& ev) {
+  std::shared_ptr<const Route> route;
+  {
+    const std::unique_lock lock(mMutex);
+    const auto id = ev->GetID();
+    const auto index = id.GetIndex();
+    if (index >= mRoutes.size()) {
+      mRoutes.resize(index + 1);
+    }
+    if (GameEventDeduplicator::IsDeduplicated(id.GetName())) {
+      if (index >= mLastEvents.size()) {
+        mLastEvents.resize(index + 1);
+      }
+      mLastEvents.at(index) = ev;
+    }
+
+    route = mRoutes.at(index);
+    if (!route) {
+      const auto name = id.GetName();
+      Route newRoute;
+      mSubscriptions.ForEachPrefixOf(
+        name, [&](std::string_view prefix, Subscriptions& subscriptions) {
+          if (subscriptions.mPrefix) {
+            newRoute.push_back(subscriptions.mPrefix.get());
+          }
+          if (subscriptions.mExact && prefix.size() == name.size()) {
+            newRoute.push_back(subscriptions.mExact.get());
+          }
+        });
+      route = std::make_shared<const Route>(std::move(newRoute));
+      mRoutes.at(index) = route;
+    }
+  }
+
+  // Not holding the lock, as handlers may subscribe to more events
+  for (const auto event: *route) {
+    event->Emit(ev);
+  }
+}
+
+SharedGameEvent GameEventDispatcher::GetLastEvent(GameEventID id) const {
+  const std::unique_lock lock(mMutex);
+  const auto index = id.GetIndex();
+  if (index >= mLastEvents.size()) {
+    return nullptr;
+  }
+  return mLastEvents.at(index);
+}
+
+void GameEventDispatcher::ForgetLastEvents() {
+  const std::unique_lock lock(mMutex);
+  mLastEvents.clear();
+}
+
+}// namespace OpenKneeboard
@@ -17,8 +17,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
  * USA.
  */
+#include <OpenKneeboard/GameEventMailslot.h>
 #include <OpenKneeboard/GameEventServer.h>
-#include <OpenKneeboard/Win32.h>
 
 #include <OpenKneeboard/config.h>
 #include <OpenKneeboard/dprint.h>
@@ -29,46 +29,88 @@
 
 #include <Windows.h>
 
-#include <thread>
+#include <string_view>
 
 namespace OpenKneeboard {
 
 std::shared_ptr<GameEventServer> GameEventServer::Create() {
-  auto ret = shared_with_final_release(new GameEventServer());
+  std::unique_ptr<IGameEventReceiver> receiver;
+  try {
+    receiver = std::make_unique<MailslotGameEventReceiver>(
+      GameEvent::GetMailslotPath());
+  } catch (const winrt::hresult_error& e) {
+    dprintf(
+      "Failed to create GameEvent mailslot: {}", winrt::to_string(e.message()));
+  }
+  return Create(std::move(receiver));
+}
+
+std::shared_ptr<GameEventServer> GameEventServer::Create(
+  std::unique_ptr<IGameEventReceiver> receiver) {
+  auto ret
+    = shared_with_final_release(new GameEventServer(std::move(receiver)));
   ret->Start();
   return ret;
 }
 
 winrt::fire_and_forget GameEventServer::final_release(
   std::unique_ptr<GameEventServer> self) {
-  self->mRunner.Cancel();
-  co_await winrt::resume_on_signal(self->mCompletionHandle.get());
+  self->mThread.request_stop();
+  // Joining waits for the current `Receive()` to time out, so don't block
+  // whichever thread released the last reference
+  co_await winrt::resume_background();
+  self.reset();
 }
 
-GameEventServer::GameEventServer() {
+GameEventServer::GameEventServer(std::unique_ptr<IGameEventReceiver> receiver)
+  : mReceiver(std::move(receiver)) {
   dprintf("{}", __FUNCTION__);
+  // For reproducing problems without DCS; see `gameevent-replayer`
+  if (const auto path = _wgetenv(L"OPENKNEEBOARD_GAME_EVENT_RECORDING")) {
+    this->StartRecording(path);
+  }
+}
+
+void GameEventServer::StartRecording(const std::filesystem::path& path) {
+  mRecordingFile.open(path, std::ios::binary | std::ios::trunc);
+  if (!mRecordingFile) {
+    dprintf("Failed to open GameEvent recording file {}", path);
+    return;
+  }
+  mRecording.emplace(mRecordingFile);
+  dprintf("Recording GameEvents to {}", path);
 }
 
 void GameEventServer::Start() {
-  mRunner = this->Run();
+  if (!mReceiver) {
+    return;
+  }
+  mThread = std::jthread {[this](std::stop_token stopToken) {
+    SetThreadDescription(GetCurrentThread(), L"GameEventServer");
+    this->Run(stopToken);
+  }};
 }
 
 GameEventServer::~GameEventServer() {
   dprintf("{}", __FUNCTION__);
 }
 
-winrt::Windows::Foundation::IAsyncAction GameEventServer::Run() {
-  const scope_guard markCompletion(
-    [handle = mCompletionHandle.get()]() { SetEvent(handle); });
+namespace {
 
-  auto weak = weak_from_this();
-  const auto handle = Win32::CreateMailslotW(
-    GameEvent::GetMailslotPath(), 0, MAILSLOT_WAIT_FOREVER, nullptr);
-  if (!handle) {
-    dprintf("Failed to create GameEvent mailslot: {}", GetLastError());
-    co_return;
-  }
+/* How often to check if we've been asked to stop.
+ *
+ * This is only the worst case for shutting down; events are delivered as
+ * soon as they arrive.
+ */
+constexpr std::chrono::milliseconds ReceiveTimeout {100};
+
+/* Upper bound on messages handled per wake-up, so that a flood of events
+ * can't delay everything that's already been read indefinitely. */
+constexpr size_t MaxMessagesPerBatch = 256;
 
+}// namespace
+
+void GameEventServer::Run(std::stop_token stopToken) {
   dprint("Started listening for game events");
   const scope_guard logOnExit([]() {
     dprintf(
@@ -76,112 +118,102 @@ winrt::Windows::Foundation::IAsyncAction GameEventServer::Run() {
       std::uncaught_exceptions());
   });
 
-  auto cancelled = co_await winrt::get_cancellation_token();
-  cancelled.enable_propagation();
-
-  const auto event = Win32::CreateEventW(nullptr, FALSE, FALSE, nullptr);
-
-  try {
-    while ((!cancelled()) && co_await RunSingle(weak, event, handle)) {
-      // repeat!
+  std::vector<std::vector<std::byte>> messages;
+  while (!stopToken.stop_requested()) {
+    messages.clear();
+    try {
+      auto message = mReceiver->Receive(ReceiveTimeout);
+      if (!message) {
+        continue;
+      }
+      // Senders usually write several messages in a burst; pick up
+      // everything that's already waiting so that they're delivered together
+      do {
+        messages.push_back(std::move(*message));
+      } while (messages.size() < MaxMessagesPerBatch
+               && (message = mReceiver->Receive({})));
+    } catch (const winrt::hresult_error& e) {
+      dprintf("GameEvent Receive failed: {}", winrt::to_string(e.message()));
+      if (messages.empty()) {
+        // Don't spin if it's going to keep failing
+        std::this_thread::sleep_for(ReceiveTimeout);
+        continue;
+      }
     }
-  } catch (const winrt::hresult_canceled&) {
-    co_return;
-  }
-
-  co_return;
-}
-
-winrt::Windows::Foundation::IAsyncOperation<bool> GameEventServer::RunSingle(
-  const std::weak_ptr<GameEventServer>& instance,
-  const winrt::handle& notifyEvent,
-  const winrt::file_handle& handle) {
-  auto cancelled = co_await winrt::get_cancellation_token();
-  cancelled.enable_propagation();
-
-  OVERLAPPED overlapped {
-    .hEvent = notifyEvent.get(),
-  };
-
-  /* If there's no message yet, use this buffer size.
-   *
-   * If the buffer is too small, we'll have '0 bytes read',
-   * and loop into this function again.
-   *
-   * We'll then get a good result from GetMailslotInfo(),
-   * and allocate a correctly-sized buffer.
-   */
-  const constexpr DWORD DefaultBufferSize = 4096;
-  DWORD bufferSize {DefaultBufferSize};
-  if (
-    (!GetMailslotInfo(handle.get(), nullptr, &bufferSize, nullptr, nullptr))
-    || bufferSize == MAILSLOT_NO_MESSAGE) {
-    bufferSize = DefaultBufferSize;
-  }
 
-  std::vector<char> buffer(bufferSize);
-  DWORD bytesRead {};
-  const auto readFileResult = ReadFile(
-    handle.get(),
-    buffer.data(),
-    static_cast<DWORD>(buffer.size()),
-    &bytesRead,
-    &overlapped);
-  const auto readFileError = GetLastError();
-  if ((!readFileResult) && readFileError != ERROR_IO_PENDING) {
-    dprintf("GameEvent ReadFile failed: {}", GetLastError());
-    co_return true;
+    this->DispatchEvents(messages);
   }
+}
 
-  traceprint("Waiting for GameEvent");
-  co_await winrt::resume_on_signal(notifyEvent.get());
-  GetOverlappedResult(handle.get(), &overlapped, &bytesRead, TRUE);
-
-  if (bytesRead == 0) {
-    dprint("Read 0-byte GameEvent message");
-    co_return true;
+void GameEventServer::Record(std::span<const GameEvent> packet) {
+  const auto now = std::chrono::steady_clock::now();
+  if (!mFirstRecordedEventAt) {
+    mFirstRecordedEventAt = now;
   }
-
-  auto self = instance.lock();
-  if (!self) {
-    dprint("Failed to acquire self");
-    co_return false;
+  try {
+    mRecording->Write({
+      .mTime = now - *mFirstRecordedEventAt,
+      .mEvents = std::vector<GameEvent>(packet.begin(), packet.end()),
+    });
+    mRecordingFile.flush();
+  } catch (const std::runtime_error& e) {
+    dprintf("Stopping GameEvent recording: {}", e.what());
+    mRecording.reset();
   }
-
-  self->DispatchEvent({buffer.data(), bytesRead});
-  co_return true;
 }
 
-winrt::fire_and_forget GameEventServer::DispatchEvent(std::string_view ref) {
-  const std::string buffer(ref);
-
-  const auto stayingAlive = shared_from_this();
-  co_await winrt::resume_background();
+void GameEventServer::ResetDeduplication() {
+  mDeduplicator.Reset();
+}
 
-  traceprint("Handling event");
-  auto event = GameEvent::Unserialize(buffer);
+// Called from the `Run()` loop - so one batch at a time, in order - rather
+// than hopping to another thread; parsing is cheap compared to waiting for
+// the next message.
+void GameEventServer::DispatchEvents(
+  const std::vector<std::vector<std::byte>>& messages) {
   TraceLoggingActivity<gTraceProvider> activity;
   TraceLoggingWriteStart(
-    activity, "GameEvent", TraceLoggingValue(event.name.c_str(), "Name"));
-  const scope_guard stopActivity(
-    [&activity]() { TraceLoggingWriteStop(activity, "GameEvent"); });
-  if (event.name != GameEvent::EVT_MULTI_EVENT) {
-    this->evGameEvent.EnqueueForContext(mUIThread, event);
-    co_return;
+    activity,
+    "GameEventServer::DispatchEvents()",
+    TraceLoggingValue(messages.size(), "MessageCount"));
+
+  std::vector<GameEvent> parsed;
+  for (const auto& message: messages) {
+    if (message.empty()) {
+      dprint("Read 0-byte GameEvent message");
+      continue;
+    }
+    const std::string_view packet {
+      reinterpret_cast<const char*>(message.data()), message.size()};
+    const auto firstInPacket = parsed.size();
+    if (!GameEvent::UnserializeAll(packet, &parsed)) {
+      dprint("Received invalid GameEvent packet");
+    }
+    // Per packet and before deduplication, so that replays have the original
+    // load
+    if (mRecording && parsed.size() > firstInPacket) {
+      this->Record(std::span {parsed}.subspan(firstInPacket));
+    }
   }
 
-  std::vector<std::tuple<std::string, std::string>> events;
-  events = nlohmann::json::parse(event.value);
-  for (const auto& [name, value]: events) {
-    TraceLoggingActivity<gTraceProvider> subActivity;
-    TraceLoggingWriteStart(
-      subActivity, "GameEvent/Multi", TraceLoggingValue(name.c_str(), "Name"));
-    co_await this->evGameEvent.EmitFromContextAsync(mUIThread, {name, value});
-    TraceLoggingWriteStop(
-      subActivity, "GameEvent/Multi", TraceLoggingValue(name.c_str(), "Name"));
+  std::vector<SharedGameEvent> events;
+  events.reserve(parsed.size());
+  for (auto& event: parsed) {
+    if (mDeduplicator.ShouldDeliver(event)) {
+      events.push_back(
+        std::make_shared<const InternedGameEvent>(std::move(event)));
+    }
   }
 
-  co_return;
+  TraceLoggingWriteStop(
+    activity,
+    "GameEventServer::DispatchEvents()",
+    TraceLoggingValue(parsed.size(), "EventCount"),
+    TraceLoggingValue(events.size(), "DeliveredCount"));
+
+  // One task for the whole batch, so the UI thread doesn't render a partial
+  // state update between events
+  this->evGameEvent.EnqueueBatchForExecutor(*mUIThread, std::move(events));
 }
 
 }// namespace OpenKneeboard
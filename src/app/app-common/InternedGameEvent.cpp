@@ -0,0 +1,84 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/InternedGameEvent.h>
+
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+namespace OpenKneeboard {
+
+namespace {
+
+struct NameRegistry {
+  std::shared_mutex mMutex;
+  // A deque so that the keys of `mIDs` stay valid as names are added
+  std::deque<std::string> mNames;
+  std::unordered_map<std::string_view, uint32_t> mIDs;
+
+  static NameRegistry& Get() {
+    static NameRegistry sInstance;
+    return sInstance;
+  }
+};
+
+}// namespace
+
+GameEventID::GameEventID(std::string_view name) {
+  auto& registry = NameRegistry::Get();
+  {
+    const std::shared_lock lock(registry.mMutex);
+    const auto it = registry.mIDs.find(name);
+    if (it != registry.mIDs.end()) {
+      mIndex = it->second;
+      return;
+    }
+  }
+
+  const std::unique_lock lock(registry.mMutex);
+  // Another thread may have added it since we released the shared lock
+  const auto it = registry.mIDs.find(name);
+  if (it != registry.mIDs.end()) {
+    mIndex = it->second;
+    return;
+  }
+  mIndex = static_cast<uint32_t>(registry.mNames.size());
+  registry.mIDs.emplace(registry.mNames.emplace_back(name), mIndex);
+}
+
+std::string_view GameEventID::GetName() const {
+  auto& registry = NameRegistry::Get();
+  const std::shared_lock lock(registry.mMutex);
+  return registry.mNames.at(mIndex);
+}
+
+InternedGameEvent::InternedGameEvent(GameEvent event)
+  : mEvent(std::move(event)), mID(mEvent.name) {
+}
+
+const nlohmann::json& InternedGameEvent::GetJSON() const {
+  return GetCachedValue<nlohmann::json>(
+    [this]() { return nlohmann::json::parse(mEvent.value); });
+}
+
+}// namespace OpenKneeboard
@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
  * USA.
  */
+#include <OpenKneeboard/CachedLayer.h>
 #include <OpenKneeboard/CreateTabActions.h>
 #include <OpenKneeboard/CursorClickableRegions.h>
 #include <OpenKneeboard/CursorEvent.h>
@@ -30,13 +31,18 @@
 #include <OpenKneeboard/KneeboardView.h>
 #include <OpenKneeboard/TabView.h>
 #include <OpenKneeboard/ToolbarAction.h>
+#include <OpenKneeboard/Tracing.h>
 
 #include <OpenKneeboard/dprint.h>
 #include <OpenKneeboard/scope_guard.h>
 #include <OpenKneeboard/weak_wrap.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <mutex>
 #include <ranges>
+#include <span>
 
 #include <d3d11_4.h>
 #include <dwrite.h>
@@ -75,6 +81,33 @@ static SHM::ConsumerPattern GetConsumerPatternForGame(
   }
 }
 
+static SHM::FlatLayerConfig ToFlatLayerConfig(const FlatConfig& config) {
+  using Layer = SHM::FlatLayerConfig;
+  return {
+    .mHeightPercent = config.mHeightPercent,
+    .mPaddingPixels = config.mPaddingPixels,
+    .mOpacity = config.mOpacity,
+    // The enumerators have the same values
+    .mHorizontalAlignment
+    = static_cast<Layer::HorizontalAlignment>(config.mHorizontalAlignment),
+    .mVerticalAlignment
+    = static_cast<Layer::VerticalAlignment>(config.mVerticalAlignment),
+  };
+}
+
+static DamageRect ToDamageRect(const D2D1_RECT_F& rect) {
+  constexpr auto max = std::numeric_limits<uint16_t>::max();
+  const auto clamp = [=](float value) {
+    return static_cast<uint16_t>(std::clamp<float>(value, 0, max));
+  };
+  return {
+    clamp(std::floor(rect.left)),
+    clamp(std::floor(rect.top)),
+    clamp(std::ceil(rect.right)),
+    clamp(std::ceil(rect.bottom)),
+  };
+}
+
 void InterprocessRenderer::Commit(uint8_t layerCount) noexcept {
   if (!mSHM) {
     return;
@@ -87,11 +120,23 @@ void InterprocessRenderer::Commit(uint8_t layerCount) noexcept {
 
   std::vector<SHM::LayerConfig> shmLayers;
 
+  const auto textureIndex = mSHM.GetNextTextureIndex();
   for (uint8_t layerIndex = 0; layerIndex < layerCount; ++layerIndex) {
     auto& layer = mLayers.at(layerIndex);
-    auto& it = layer.mSharedResources.at(mSHM.GetNextTextureIndex());
+    auto& it = layer.mSharedResources.at(textureIndex);
+
+    // The texture was last written `TextureCount` commits ago, so needs
+    // everything that changed since then
+    layer.mCommitDamage.at(textureIndex) = layer.mConfig.mDamage;
+    DamageRegion textureDamage;
+    for (const auto& damage: layer.mCommitDamage) {
+      textureDamage.Add(damage);
+    }
+    textureDamage.ClipTo(layer.mConfig.mImageWidth, layer.mConfig.mImageHeight);
 
-    if (tint.mEnabled) {
+    if (textureDamage.IsEmpty()) {
+      // Already up to date
+    } else if (tint.mEnabled) {
       D3D11::CopyTextureWithTint(
         mDXR.mD3DDevice.get(),
         layer.mCanvasSRV.get(),
@@ -102,7 +147,7 @@ void InterprocessRenderer::Commit(uint8_t layerCount) noexcept {
           tint.mBlue * tint.mBrightness,
           /* alpha = */ 1.0f,
         });
-    } else {
+    } else if (textureDamage.IsFull()) {
       D3D11_BOX box {
         0,
         0,
@@ -113,8 +158,42 @@ void InterprocessRenderer::Commit(uint8_t layerCount) noexcept {
       };
       mD3DContext->CopySubresourceRegion(
         it.mTexture.get(), 0, 0, 0, 0, layer.mCanvasTexture.get(), 0, &box);
+    } else {
+      for (const auto& rect: textureDamage.GetRects()) {
+        D3D11_BOX box {
+          rect.mLeft,
+          rect.mTop,
+          0,
+          rect.mRight,
+          rect.mBottom,
+          1,
+        };
+        mD3DContext->CopySubresourceRegion(
+          it.mTexture.get(),
+          0,
+          rect.mLeft,
+          rect.mTop,
+          0,
+          layer.mCanvasTexture.get(),
+          0,
+          &box);
+      }
     }
     shmLayers.push_back(layer.mConfig);
+    auto& stats = mStatistics.mLayers.at(layerIndex);
+    if (layer.mConfig.mIsDirty) {
+      ++stats.mRenders;
+    } else {
+      ++stats.mSkippedRenders;
+    }
+    layer.mConfig.mIsDirty = false;
+    layer.mConfig.mDamage.Clear();
+  }
+
+  // We're not updating these layers' textures, so we don't know what they
+  // contain next time they're used
+  for (uint8_t layerIndex = layerCount; layerIndex < MaxLayers; ++layerIndex) {
+    mLayers.at(layerIndex).mCommitDamage.fill(DamageRegion::Full());
   }
 
   const auto seq = mSHM.GetNextSequenceNumber();
@@ -125,11 +204,13 @@ void InterprocessRenderer::Commit(uint8_t layerCount) noexcept {
                              ->GetRuntimeID()
                              .GetTemporaryValue(),
     .mVR = mKneeboard->GetVRSettings(),
-    .mFlat = mKneeboard->GetNonVRSettings(),
+    .mFlat = ToFlatLayerConfig(mKneeboard->GetNonVRSettings()),
     .mTarget = GetConsumerPatternForGame(mCurrentGame),
   };
 
   mSHM.Update(config, shmLayers, mFenceHandle.get());
+  mCommittedLayerCount = layerCount;
+  ++mStatistics.mCommits;
 }
 
 std::shared_ptr<InterprocessRenderer> InterprocessRenderer::Create(
@@ -176,6 +257,9 @@ void InterprocessRenderer::Init(
   }
 
   for (auto& layer: mLayers) {
+    // Nothing has been written to the shared textures yet
+    layer.mCommitDamage.fill(DamageRegion::Full());
+
     layer.mCanvasTexture = SHM::CreateCompatibleTexture(dxr.mD3DDevice.get());
 
     winrt::check_hresult(dxr.mD2DDeviceContext->CreateBitmapFromDxgiSurface(
@@ -210,6 +294,8 @@ void InterprocessRenderer::Init(
   }
 
   const auto markDirty = weak_wrap(this)([](auto self) { self->MarkDirty(); });
+  const auto markCursorDirty
+    = weak_wrap(this)([](auto self) { self->mNeedsRepaint = true; });
 
   AddEventListener(kneeboard->evNeedsRepaintEvent, markDirty);
   AddEventListener(
@@ -225,34 +311,148 @@ void InterprocessRenderer::Init(
     auto view = views.at(i);
     mLayers.at(i).mKneeboardView = view;
 
-    AddEventListener(view->evCursorEvent, markDirty);
+    AddEventListener(
+      view->evNeedsRepaintEvent,
+      [weak = weak_from_this(), view = view.get()](const D2D1_RECT_F& area) {
+        if (auto self = weak.lock()) {
+          self->MarkDirty(view, area);
+        }
+      });
+    // `Render()` works out which pixels the cursor touched
+    AddEventListener(view->evCursorEvent, markCursorDirty);
   }
 
+  mStatisticsReportedAt = std::chrono::steady_clock::now();
   this->RenderNow();
 
-  AddEventListener(
-    kneeboard->evFrameTimerEvent, weak_wrap(this)([](auto self) {
-      const auto now = std::chrono::steady_clock::now();
-      if ((now - self->mConsumersClearedAt) > std::chrono::milliseconds(500)) {
-        const std::unique_lock shmLock(self->mSHM);
-        self->mConsumers = self->mSHM.GetConsumers();
-        self->mSHM.ClearConsumers();
-        self->mConsumersClearedAt = now;
-      }
+  const auto onFrame = weak_wrap(this)([](auto self) { self->OnFrame(); });
+  // We may have suspended while `kneeboard` has nothing else to repaint
+  AddEventListener(kneeboard->evFrameTimerEvent, onFrame);
+  AddEventListener(kneeboard->evFrameTimerIdleEvent, onFrame);
+}
 
-      if (self->mNeedsRepaint) {
-        self->RenderNow();
-      }
-    }));
+void InterprocessRenderer::OnFrame() {
+  const auto now = std::chrono::steady_clock::now();
+  if ((now - mConsumersReapedAt) > SHM::ConsumerTimeout) {
+    const std::unique_lock shmLock(mSHM);
+    mSHM.ReapConsumers();
+    mConsumersReapedAt = now;
+  }
+  if ((now - mStatisticsReportedAt) >= std::chrono::seconds(1)) {
+    this->TraceStatistics(now);
+  }
+
+  if (!mNeedsRepaint) {
+    return;
+  }
+  // Leave `mNeedsRepaint` set so that we catch up when a consumer
+  // attaches; until then, nobody would see the result.
+  if (this->GetConsumerInfo().empty()) {
+    evWorkAvailableEvent.Emit();
+    return;
+  }
+  this->RenderNow();
 }
 
 void InterprocessRenderer::MarkDirty() {
   mNeedsRepaint = true;
+  for (auto& layer: mLayers) {
+    this->MarkFull(layer);
+  }
+}
+
+void InterprocessRenderer::MarkDirty(
+  const IKneeboardView* view,
+  const D2D1_RECT_F& area) {
+  for (auto& layer: mLayers) {
+    if (layer.mKneeboardView.get() != view) {
+      continue;
+    }
+    mNeedsRepaint = true;
+
+    const auto width = layer.mConfig.mImageWidth;
+    const auto height = layer.mConfig.mImageHeight;
+    if (width == 0 || height == 0) {
+      this->MarkFull(layer);
+      return;
+    }
+    // If the size changes, `Render()` marks the whole layer as damaged;
+    // otherwise, the size is the same as the last render. Grow by a pixel
+    // to cover antialiasing at the edges.
+    layer.mConfig.mDamage.Add(ToDamageRect({
+      (area.left * width) - 1,
+      (area.top * height) - 1,
+      (area.right * width) + 1,
+      (area.bottom * height) + 1,
+    }));
+    return;
+  }
+}
+
+void InterprocessRenderer::MarkFull(Layer& layer) {
+  layer.mConfig.mIsDirty = true;
+  layer.mConfig.mDamage.MarkFull();
+}
+
+InterprocessRenderer::Statistics InterprocessRenderer::GetStatistics() const {
+  return mStatistics;
+}
+
+void InterprocessRenderer::TraceStatistics(
+  std::chrono::steady_clock::time_point now) {
+  const auto seconds
+    = std::chrono::duration<float>(now - mStatisticsReportedAt).count();
+  const auto& prev = mReportedStatistics;
+  for (uint8_t i = 0; i < mCommittedLayerCount; ++i) {
+    const auto& stats = mStatistics.mLayers.at(i);
+    TraceLoggingWrite(
+      gTraceProvider,
+      "InterprocessRenderer::LayerStatistics",
+      TraceLoggingValue(i, "LayerIndex"),
+      TraceLoggingValue(
+        (stats.mRenders - prev.mLayers.at(i).mRenders) / seconds,
+        "RendersPerSecond"),
+      TraceLoggingValue(
+        (stats.mSkippedRenders - prev.mLayers.at(i).mSkippedRenders) / seconds,
+        "SkippedRendersPerSecond"));
+  }
+  TraceLoggingWrite(
+    gTraceProvider,
+    "InterprocessRenderer::Statistics",
+    TraceLoggingValue(
+      (mStatistics.mCommits - prev.mCommits) / seconds, "CommitsPerSecond"),
+    TraceLoggingValue(
+      (mStatistics.mSkippedCommits - prev.mSkippedCommits) / seconds,
+      "SkippedCommitsPerSecond"));
+
+  // Shared by every `CachedLayer` in the process, so totals
+  const auto cache = CachedLayer::GetStatistics();
+  TraceLoggingWrite(
+    gTraceProvider,
+    "CachedLayer::Statistics",
+    TraceLoggingValue(cache.mHits, "Hits"),
+    TraceLoggingValue(cache.mMisses, "Misses"),
+    TraceLoggingValue(cache.mEvictions, "Evictions"),
+    TraceLoggingValue(cache.mEntryCount, "EntryCount"),
+    TraceLoggingValue(cache.mTotalCost, "TotalBytes"));
+
+  mReportedStatistics = mStatistics;
+  mStatisticsReportedAt = now;
 }
 
 std::underlying_type_t<SHM::ConsumerKind> InterprocessRenderer::GetConsumers()
   const {
-  return mConsumers;
+  if (!mSHM) {
+    return {};
+  }
+  return mSHM.GetConsumers();
+}
+
+std::vector<SHM::ConsumerInfo> InterprocessRenderer::GetConsumerInfo() const {
+  if (!mSHM) {
+    return {};
+  }
+  return mSHM.GetConsumerInfo();
 }
 
 InterprocessRenderer::~InterprocessRenderer() {
@@ -277,18 +477,15 @@ InterprocessRenderer::~InterprocessRenderer() {
 }
 
 void InterprocessRenderer::Render(RenderTargetID rtid, Layer& layer) {
-  auto ctx = mDXR.mD2DDeviceContext;
-  ctx->SetTarget(layer.mCanvasBitmap.get());
-  mDXR.PushD2DDraw();
-  const scope_guard endDraw {
-    [this]() { winrt::check_hresult(this->mDXR.PopD2DDraw()); }};
-
-  ctx->Clear({0.0f, 0.0f, 0.0f, 0.0f});
-  ctx->SetTransform(D2D1::Matrix3x2F::Identity());
-
   const auto view = layer.mKneeboardView;
-  layer.mConfig.mLayerID = view->GetRuntimeID().GetTemporaryValue();
   const auto usedSize = view->GetCanvasSize();
+  if (
+    usedSize.width != layer.mConfig.mImageWidth
+    || usedSize.height != layer.mConfig.mImageHeight) {
+    this->MarkFull(layer);
+  }
+
+  layer.mConfig.mLayerID = view->GetRuntimeID().GetTemporaryValue();
   layer.mConfig.mImageWidth = usedSize.width;
   layer.mConfig.mImageHeight = usedSize.height;
 
@@ -300,16 +497,61 @@ void InterprocessRenderer::Render(RenderTargetID rtid, Layer& layer) {
   layer.mConfig.mVR.mWidth = usedSize.width * scale;
   layer.mConfig.mVR.mHeight = usedSize.height * scale;
 
-  view->RenderWithChrome(
-    rtid,
-    ctx.get(),
-    {
-      0,
-      0,
-      static_cast<FLOAT>(usedSize.width),
-      static_cast<FLOAT>(usedSize.height),
-    },
-    layer.mIsActiveForInput);
+  const D2D1_RECT_F canvasRect {
+    0,
+    0,
+    static_cast<FLOAT>(usedSize.width),
+    static_cast<FLOAT>(usedSize.height),
+  };
+
+  auto& damage = layer.mConfig.mDamage;
+  const auto cursorRect = view->GetCursorCanvasBounds(
+    {canvasRect.right - canvasRect.left, canvasRect.bottom - canvasRect.top});
+  std::optional<DamageRect> cursorBounds;
+  if (cursorRect) {
+    cursorBounds = ToDamageRect(*cursorRect);
+  }
+  if (cursorBounds != layer.mCursorBounds) {
+    if (layer.mCursorBounds) {
+      damage.Add(*layer.mCursorBounds);
+    }
+    if (cursorBounds) {
+      damage.Add(*cursorBounds);
+    }
+    layer.mCursorBounds = cursorBounds;
+  }
+  damage.ClipTo(usedSize.width, usedSize.height);
+
+  if (damage.IsEmpty()) {
+    // Nothing we draw would change the canvas
+    return;
+  }
+  layer.mConfig.mIsDirty = true;
+
+  auto ctx = mDXR.mD2DDeviceContext;
+  ctx->SetTarget(layer.mCanvasBitmap.get());
+  mDXR.PushD2DDraw();
+  const scope_guard endDraw {
+    [this]() { winrt::check_hresult(this->mDXR.PopD2DDraw()); }};
+
+  std::optional<scope_guard> popClip;
+  if (!damage.IsFull()) {
+    const auto bounds = damage.GetBounds();
+    ctx->PushAxisAlignedClip(
+      {
+        static_cast<FLOAT>(bounds.mLeft),
+        static_cast<FLOAT>(bounds.mTop),
+        static_cast<FLOAT>(bounds.mRight),
+        static_cast<FLOAT>(bounds.mBottom),
+      },
+      D2D1_ANTIALIAS_MODE_ALIASED);
+    popClip.emplace([ctx]() { ctx->PopAxisAlignedClip(); });
+  }
+
+  ctx->Clear({0.0f, 0.0f, 0.0f, 0.0f});
+  ctx->SetTransform(D2D1::Matrix3x2F::Identity());
+
+  view->RenderWithChrome(rtid, ctx.get(), canvasRect, layer.mIsActiveForInput);
 }
 
 void InterprocessRenderer::RenderNow() {
@@ -329,14 +571,33 @@ void InterprocessRenderer::RenderNow() {
   for (uint8_t i = 0; i < renderInfos.size(); ++i) {
     auto& layer = mLayers.at(i);
     const auto& info = renderInfos.at(i);
+    if (
+      layer.mKneeboardView != info.mView
+      || layer.mIsActiveForInput != info.mIsActiveForInput) {
+      this->MarkFull(layer);
+    }
     layer.mKneeboardView = info.mView;
     layer.mConfig.mVR = info.mVR;
     layer.mIsActiveForInput = info.mIsActiveForInput;
     this->Render(mRenderTargetIDs.at(i), layer);
   }
 
-  this->Commit(renderInfos.size());
   this->mNeedsRepaint = false;
+
+  // Every `Render()` call found nothing to draw
+  const auto layers = std::span(mLayers).first(renderInfos.size());
+  if (
+    renderInfos.size() == mCommittedLayerCount
+    && std::ranges::none_of(
+      layers, [](const auto& layer) { return layer.mConfig.mIsDirty; })) {
+    for (uint8_t i = 0; i < renderInfos.size(); ++i) {
+      ++mStatistics.mLayers.at(i).mSkippedRenders;
+    }
+    ++mStatistics.mSkippedCommits;
+    return;
+  }
+
+  this->Commit(renderInfos.size());
 }
 
 void InterprocessRenderer::OnGameChanged(
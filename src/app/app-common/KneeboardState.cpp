@@ -27,6 +27,7 @@
 #include <OpenKneeboard/KneeboardState.h>
 #include <OpenKneeboard/KneeboardView.h>
 #include <OpenKneeboard/OpenXRMode.h>
+#include <OpenKneeboard/PagePrefetcher.h>
 #include <OpenKneeboard/SteamVRKneeboard.h>
 #include <OpenKneeboard/TabView.h>
 #include <OpenKneeboard/TabletInputAdapter.h>
@@ -44,6 +45,20 @@
 
 namespace OpenKneeboard {
 
+namespace {
+
+// Interned once, so checking for API events is a few integer comparisons
+const GameEventID SetInputFocusID {GameEvent::EVT_SET_INPUT_FOCUS};
+const GameEventID RemoteUserActionID {GameEvent::EVT_REMOTE_USER_ACTION};
+const GameEventID SetTabByIDID {GameEvent::EVT_SET_TAB_BY_ID};
+const GameEventID SetTabByNameID {GameEvent::EVT_SET_TAB_BY_NAME};
+const GameEventID SetTabByIndexID {GameEvent::EVT_SET_TAB_BY_INDEX};
+const GameEventID SetProfileByIDID {GameEvent::EVT_SET_PROFILE_BY_ID};
+const GameEventID SetProfileByNameID {GameEvent::EVT_SET_PROFILE_BY_NAME};
+const GameEventID SetBrightnessID {GameEvent::EVT_SET_BRIGHTNESS};
+
+}// namespace
+
 std::shared_ptr<KneeboardState> KneeboardState::Create(
   HWND hwnd,
   const DXResources& dxr) {
@@ -54,8 +69,15 @@ KneeboardState::KneeboardState(HWND hwnd, const DXResources& dxr)
   : mHwnd(hwnd), mDXResources(dxr) {
   const scope_guard saveMigratedSettings([this]() { this->SaveSettings(); });
 
+  this->UpdateFrameRates();
   AddEventListener(
-    this->evNeedsRepaintEvent, [this]() { this->mNeedsRepaint = true; });
+    this->evNeedsRepaintEvent,
+    std::bind_front(&KneeboardState::SetRepaintNeeded, this));
+
+  AddEventListener(
+    mGameEventDispatcher.GetPrefixEvent({}), [](const SharedGameEvent& ev) {
+      TroubleshootingStore::Get()->OnGameEvent(ev->GetEvent());
+    });
 
   mGamesList = std::make_unique<GamesList>(this, mSettings.mGames);
   AddEventListener(
@@ -84,10 +106,23 @@ KneeboardState::KneeboardState(HWND hwnd, const DXResources& dxr)
   for (const auto& viewState: mViews) {
     viewState->SetTabs(tabs);
   }
-  AddEventListener(mViews[0]->evNeedsRepaintEvent, this->evNeedsRepaintEvent);
-  AddEventListener(mViews[1]->evNeedsRepaintEvent, [this]() {
+  // Not forwarding to `evNeedsRepaintEvent`, as that would make consumers
+  // repaint every view; they can subscribe to the views they're interested in
+  const auto viewNeedsRepaint = [this]() { this->SetRepaintNeeded(); };
+  AddEventListener(mViews[0]->evNeedsRepaintEvent, viewNeedsRepaint);
+  AddEventListener(mViews[0]->evCursorEvent, viewNeedsRepaint);
+  const auto secondaryViewNeedsRepaint = [this]() {
     if (this->mSettings.mApp.mDualKneeboards.mEnabled) {
-      this->evNeedsRepaintEvent.Emit();
+      this->SetRepaintNeeded();
+    }
+  };
+  AddEventListener(mViews[1]->evNeedsRepaintEvent, secondaryViewNeedsRepaint);
+  AddEventListener(mViews[1]->evCursorEvent, secondaryViewNeedsRepaint);
+
+  mPagePrefetcher = std::make_unique<PagePrefetcher>(dxr, this);
+  AddEventListener(mPagePrefetcher->evWorkAvailableEvent, [this]() {
+    if (mFrameScheduler.MarkDirty(mPrefetchFrameSource)) {
+      evFrameScheduleChangedEvent.Emit();
     }
   });
 
@@ -168,20 +203,19 @@ void KneeboardState::PostUserAction(UserAction action) {
   switch (action) {
     case UserAction::TOGGLE_VISIBILITY:
       if (mInterprocessRenderer) {
-        mInterprocessRenderer.reset();
+        this->StopInterprocessRenderer();
       } else {
-        mInterprocessRenderer
-          = InterprocessRenderer::Create(mDXResources, this);
+        this->StartInterprocessRenderer();
       }
       return;
     case UserAction::HIDE:
-      mInterprocessRenderer.reset();
+      this->StopInterprocessRenderer();
       return;
     case UserAction::SHOW:
       if (mInterprocessRenderer) {
         return;
       }
-      mInterprocessRenderer = InterprocessRenderer::Create(mDXResources, this);
+      this->StartInterprocessRenderer();
       return;
     case UserAction::TOGGLE_FORCE_ZOOM: {
       auto& forceZoom = this->mSettings.mVR.mForceZoom;
@@ -282,20 +316,25 @@ void KneeboardState::OnGameChangedEvent(
   } else {
     mCurrentGame = {};
   }
+  if (mGameEventServer) {
+    mGameEventServer->ResetDeduplication();
+  }
+  mGameEventDispatcher.ForgetLastEvents();
   this->evGameChangedEvent.Emit(processID, game);
 }
 
-void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
+void KneeboardState::OnGameEvent(const SharedGameEvent& ev) noexcept {
   if (winrt::apartment_context() != mUIThread) {
     dprint("Game event in wrong thread!");
     OPENKNEEBOARD_BREAK;
   }
-  TroubleshootingStore::Get()->OnGameEvent(ev);
+  mGameEventDispatcher.Dispatch(ev);
 
   const auto tabs = mTabsList->GetTabs();
+  const auto id = ev->GetID();
 
-  if (ev.name == GameEvent::EVT_SET_INPUT_FOCUS) {
-    const auto viewID = std::stoull(ev.value);
+  if (id == SetInputFocusID) {
+    const auto viewID = std::stoull(ev->GetValue());
     for (int i = 0; i < mViews.size(); ++i) {
       if (mViews.at(i)->GetRuntimeID() != viewID) {
         continue;
@@ -316,9 +355,9 @@ void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
     return;
   }
 
-  if (ev.name == GameEvent::EVT_REMOTE_USER_ACTION) {
+  if (id == RemoteUserActionID) {
 #define IT(ACTION) \
-  if (ev.value == #ACTION) { \
+  if (ev->GetValue() == #ACTION) { \
     PostUserAction(UserAction::ACTION); \
     return; \
   }
@@ -326,8 +365,8 @@ void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
 #undef IT
   }
 
-  if (ev.name == GameEvent::EVT_SET_TAB_BY_ID) {
-    const auto parsed = ev.ParsedValue<SetTabByIDEvent>();
+  if (id == SetTabByIDID) {
+    const auto& parsed = ev->ParsedValue<SetTabByIDEvent>();
     winrt::guid guid;
     try {
       guid = winrt::guid {parsed.mID};
@@ -346,8 +385,8 @@ void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
     return;
   }
 
-  if (ev.name == GameEvent::EVT_SET_TAB_BY_NAME) {
-    const auto parsed = ev.ParsedValue<SetTabByNameEvent>();
+  if (id == SetTabByNameID) {
+    const auto& parsed = ev->ParsedValue<SetTabByNameEvent>();
     const auto tab = std::ranges::find_if(tabs, [parsed](const auto& tab) {
       return parsed.mName == tab->GetTitle();
     });
@@ -361,8 +400,8 @@ void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
     return;
   }
 
-  if (ev.name == GameEvent::EVT_SET_TAB_BY_INDEX) {
-    const auto parsed = ev.ParsedValue<SetTabByIndexEvent>();
+  if (id == SetTabByIndexID) {
+    const auto& parsed = ev->ParsedValue<SetTabByIndexEvent>();
     if (parsed.mIndex >= tabs.size()) {
       dprintf(
         "Asked to switch to tab index {}, but there aren't that many tabs",
@@ -373,8 +412,8 @@ void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
     return;
   }
 
-  if (ev.name == GameEvent::EVT_SET_PROFILE_BY_ID) {
-    const auto parsed = ev.ParsedValue<SetProfileByIDEvent>();
+  if (id == SetProfileByIDID) {
+    const auto& parsed = ev->ParsedValue<SetProfileByIDEvent>();
     if (!mProfiles.mEnabled) {
       dprint("Asked to switch profiles, but profiles are disabled");
     }
@@ -390,8 +429,8 @@ void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
     return;
   }
 
-  if (ev.name == GameEvent::EVT_SET_PROFILE_BY_NAME) {
-    const auto parsed = ev.ParsedValue<SetProfileByNameEvent>();
+  if (id == SetProfileByNameID) {
+    const auto& parsed = ev->ParsedValue<SetProfileByNameEvent>();
     if (!mProfiles.mEnabled) {
       dprint("Asked to switch profiles, but profiles are disabled");
     }
@@ -410,8 +449,8 @@ void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
     return;
   }
 
-  if (ev.name == GameEvent::EVT_SET_BRIGHTNESS) {
-    const auto parsed = ev.ParsedValue<SetBrightnessEvent>();
+  if (id == SetBrightnessID) {
+    const auto& parsed = ev->ParsedValue<SetBrightnessEvent>();
     auto& tint = this->mSettings.mApp.mTint;
     tint.mEnabled = true;
     switch (parsed.mMode) {
@@ -438,8 +477,6 @@ void KneeboardState::OnGameEvent(const GameEvent& ev) noexcept {
     this->SaveSettings();
     return;
   }
-
-  this->evGameEvent.Emit(ev);
 }
 
 void KneeboardState::SetCurrentTab(
@@ -532,11 +569,16 @@ void KneeboardState::SetAppSettings(const AppSettings& value) {
     mSettings.mApp = value;
     this->SaveSettings();
   }
+  this->UpdateFrameRates();
   if (!value.mDualKneeboards.mEnabled) {
     this->SetFirstViewIndex(0);
   }
 }
 
+GameEventDispatcher* KneeboardState::GetGameEventDispatcher() {
+  return &mGameEventDispatcher;
+}
+
 GamesList* KneeboardState::GetGamesList() const {
   return mGamesList.get();
 }
@@ -682,7 +724,7 @@ void KneeboardState::SetTabsSettings(const nlohmann::json& j) {
 winrt::Windows::Foundation::IAsyncAction
 KneeboardState::ReleaseExclusiveResources() {
   mOpenVRThread = {};
-  mInterprocessRenderer = {};
+  this->StopInterprocessRenderer();
   mTabletInput = {};
   mGameEventServer = {};
   co_return;
@@ -707,7 +749,7 @@ bool KneeboardState::IsSteamVRActive() const {
 }
 
 void KneeboardState::AcquireExclusiveResources() {
-  mInterprocessRenderer = InterprocessRenderer::Create(mDXResources, this);
+  this->StartInterprocessRenderer();
   if (IsSteamVRActive()) {
     StartOpenVRThread();
   }
@@ -761,6 +803,55 @@ void KneeboardState::Repainted() {
   mNeedsRepaint = false;
 }
 
+void KneeboardState::SetRepaintNeeded() {
+  mNeedsRepaint = true;
+  if (mFrameScheduler.MarkDirty(mRepaintFrameSource)) {
+    evFrameScheduleChangedEvent.Emit();
+  }
+}
+
+void KneeboardState::StartInterprocessRenderer() {
+  this->StopInterprocessRenderer();
+  mInterprocessRenderer = InterprocessRenderer::Create(mDXResources, this);
+  mInterprocessRendererWorkToken = AddEventListener(
+    mInterprocessRenderer->evWorkAvailableEvent, [this]() {
+      if (mFrameScheduler.MarkDirty(mInterprocessRendererFrameSource)) {
+        evFrameScheduleChangedEvent.Emit();
+      }
+    });
+}
+
+void KneeboardState::StopInterprocessRenderer() {
+  // Otherwise every restart would leave another listener in `mSenders`
+  this->RemoveEventListener(mInterprocessRendererWorkToken);
+  mInterprocessRendererWorkToken = {};
+  mInterprocessRenderer.reset();
+}
+
+std::optional<FrameScheduler::TimePoint> KneeboardState::GetNextFrameTime()
+  const {
+  return mFrameScheduler.GetNextFrameTime();
+}
+
+void KneeboardState::BeginFrame() {
+  mFrameScheduler.BeginFrame(FrameScheduler::Clock::now());
+}
+
+void KneeboardState::SetWindowCaptureFrameAvailable() {
+  if (mFrameScheduler.MarkDirty(mWindowCaptureFrameSource)) {
+    evFrameScheduleChangedEvent.Emit();
+  }
+}
+
+void KneeboardState::UpdateFrameRates() {
+  const auto& settings = mSettings.mApp.mFrameRate;
+  const auto maxFPS = std::max(settings.mMaximumFPS, 1.0f);
+  const auto minFPS = std::clamp(settings.mMinimumFPS, 0.0f, maxFPS);
+  mFrameScheduler.SetFramesPerSecond(minFPS, maxFPS);
+  // If the rates went up, the next frame may be sooner
+  evFrameScheduleChangedEvent.Emit();
+}
+
 void KneeboardState::lock() {
   mMutex.lock();
 }
@@ -57,10 +57,13 @@ KneeboardView::KneeboardView(const DXResources& dxr, KneeboardState* kneeboard)
   this->UpdateUILayers();
 
   for (auto layer: mUILayers) {
-    AddEventListener(layer->evNeedsRepaintEvent, this->evNeedsRepaintEvent);
+    AddEventListener(
+      layer->evNeedsRepaintEvent,
+      std::bind_front(&KneeboardView::OnUILayerNeedsRepaint, this, layer));
   }
-  AddEventListener(this->evCurrentTabChangedEvent, this->evNeedsRepaintEvent);
-  AddEventListener(this->evCursorEvent, this->evNeedsRepaintEvent);
+  AddEventListener(this->evCurrentTabChangedEvent, [this]() {
+    this->evNeedsRepaintEvent.Emit(WholeCanvas);
+  });
   AddEventListener(
     kneeboard->evSettingsChangedEvent,
     std::bind_front(&KneeboardView::UpdateUILayers, this));
@@ -98,6 +101,76 @@ void KneeboardView::UpdateUILayers() {
   mUILayers = layers;
 }
 
+void KneeboardView::OnUILayerNeedsRepaint(IUILayer* layer) {
+  this->evNeedsRepaintEvent.Emit(this->GetUILayerRepaintArea(layer));
+}
+
+D2D1_RECT_F KneeboardView::GetUILayerRepaintArea(
+  const IUILayer* target) const {
+  // The header's menus are drawn over the whole canvas
+  if ((!mCurrentTabView) || target == mHeaderUILayer.get()) {
+    return WholeCanvas;
+  }
+
+  const IUILayer::Context context {
+    .mTabView = mCurrentTabView,
+    .mKneeboardView = std::static_pointer_cast<IKneeboardView>(
+      std::const_pointer_cast<KneeboardView>(this->shared_from_this())),
+    .mIsActiveForInput = false,
+  };
+
+  // Each layer draws in its area, apart from the part it gives to the next
+  // layer; walk down the stack, mapping each area to the canvas
+  std::span<IUILayer*> layers(const_cast<KneeboardView*>(this)->mUILayers);
+  D2D1_RECT_F area {WholeCanvas};
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const auto layer = layers[i];
+    const auto rest = layers.subspan(i + 1);
+    if (rest.empty()) {
+      return (layer == target) ? area : D2D1_RECT_F {};
+    }
+
+    const auto metrics = layer->GetMetrics(rest, context);
+    const auto& canvas = metrics.mCanvasSize;
+    const auto& nextArea = metrics.mNextArea;
+    const D2D1_SIZE_F size {area.right - area.left, area.bottom - area.top};
+    const D2D1_RECT_F next {
+      area.left + (size.width * nextArea.left / canvas.width),
+      area.top + (size.height * nextArea.top / canvas.height),
+      area.left + (size.width * nextArea.right / canvas.width),
+      area.top + (size.height * nextArea.bottom / canvas.height),
+    };
+
+    if (layer != target) {
+      area = next;
+      continue;
+    }
+
+    // If the next layer shares three edges, we only need the strip between
+    // the fourth edges; otherwise, repaint the whole area
+    const bool fullWidth
+      = nextArea.left == 0 && nextArea.right == canvas.width;
+    const bool fullHeight
+      = nextArea.top == 0 && nextArea.bottom == canvas.height;
+    if (fullWidth && nextArea.top == 0) {
+      return {area.left, next.bottom, area.right, area.bottom};
+    }
+    if (fullWidth && nextArea.bottom == canvas.height) {
+      return {area.left, area.top, area.right, next.top};
+    }
+    if (fullHeight && nextArea.left == 0) {
+      return {next.right, area.top, area.right, area.bottom};
+    }
+    if (fullHeight && nextArea.right == canvas.width) {
+      return {area.left, area.top, next.left, area.bottom};
+    }
+    return area;
+  }
+
+  // Not currently shown
+  return {};
+}
+
 KneeboardView::~KneeboardView() {
   this->RemoveAllEventListeners();
 }
@@ -132,14 +205,15 @@ void KneeboardView::SetTabs(const std::vector<std::shared_ptr<ITab>>& tabs) {
           tabView->evNeedsRepaintEvent,
           weak_wrap(tabView, this)([](auto tabView, auto self) {
             if (tabView == self->GetCurrentTabView()) {
-              self->evNeedsRepaintEvent.Emit();
+              self->OnUILayerNeedsRepaint(self->mTabViewUILayer.get());
             }
           })),
         AddEventListener(
           tab->evAvailableFeaturesChangedEvent,
           weak_wrap(tabView, this)([](auto tabView, auto self) {
+            // Toolbar buttons may have changed too
             if (tabView == self->GetCurrentTabView()) {
-              self->evNeedsRepaintEvent.Emit();
+              self->evNeedsRepaintEvent.Emit(WholeCanvas);
             }
           })),
         AddEventListener(
@@ -403,6 +477,19 @@ std::optional<D2D1_POINT_2F> KneeboardView::GetCursorCanvasPoint() const {
   return mCursorCanvasPoint;
 }
 
+std::optional<D2D1_RECT_F> KneeboardView::GetCursorCanvasBounds(
+  const D2D1_SIZE_F& canvasSize) const {
+  if (!(mCurrentTabView && mCursorCanvasPoint)) {
+    return {};
+  }
+  return CursorRenderer::GetBounds(
+    {
+      mCursorCanvasPoint->x * canvasSize.width,
+      mCursorCanvasPoint->y * canvasSize.height,
+    },
+    canvasSize);
+}
+
 std::optional<D2D1_POINT_2F> KneeboardView::GetCursorContentPoint() const {
   return mTabViewUILayer->GetCursorPoint();
 }
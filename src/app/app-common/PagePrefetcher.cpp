@@ -0,0 +1,177 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/CachedLayer.h>
+#include <OpenKneeboard/ITab.h>
+#include <OpenKneeboard/ITabView.h>
+#include <OpenKneeboard/KneeboardState.h>
+#include <OpenKneeboard/PagePrefetcher.h>
+
+#include <OpenKneeboard/scope_guard.h>
+#include <OpenKneeboard/tracing.h>
+
+#include <algorithm>
+
+namespace OpenKneeboard {
+
+PagePrefetcher::PagePrefetcher(
+  const DXResources& dxr,
+  KneeboardState* kneeboard)
+  : mDXR(dxr), mKneeboard(kneeboard) {
+  D2D1_BITMAP_PROPERTIES1 props {
+    .pixelFormat = {DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED},
+    .bitmapOptions = D2D1_BITMAP_OPTIONS_TARGET,
+  };
+  winrt::check_hresult(dxr.mD2DDeviceContext->CreateBitmap(
+    {1, 1}, nullptr, 0, &props, mTarget.put()));
+
+  AddEventListener(
+    kneeboard->evFrameTimerPrepareEvent,
+    std::bind_front(&PagePrefetcher::UpdateQueue, this));
+  AddEventListener(
+    kneeboard->evFrameTimerIdleEvent,
+    std::bind_front(&PagePrefetcher::PrefetchNext, this));
+  // Frames that repaint don't prefetch, so ask for another
+  AddEventListener(
+    kneeboard->evFrameTimerEvent,
+    std::bind_front(&PagePrefetcher::RequestMoreIfNeeded, this));
+}
+
+PagePrefetcher::~PagePrefetcher() {
+  this->RemoveAllEventListeners();
+}
+
+void PagePrefetcher::UpdateQueue() {
+  const std::unique_lock lock(mQueueMutex);
+  for (const auto key: CachedLayer::TakeEvictedKeys()) {
+    mQueue.Forget(key);
+  }
+  for (const auto& view: mKneeboard->GetAllViewsInFixedOrder()) {
+    const auto owner = view->GetRuntimeID().GetTemporaryValue();
+    const auto tabView = view->GetCurrentTabView();
+    this->SetTabView(owner, tabView);
+    if (!tabView) {
+      mQueue.Remove(owner);
+      continue;
+    }
+
+    std::vector<PrefetchQueue::PageID> pages;
+    for (const auto& page: tabView->GetPageIDs()) {
+      pages.push_back(page.GetTemporaryValue());
+    }
+    mQueue.SetCurrentPage(
+      owner, pages, tabView->GetPageID().GetTemporaryValue());
+  }
+
+  if (!mQueue.IsEmpty()) {
+    evWorkAvailableEvent.Emit();
+  }
+}
+
+void PagePrefetcher::RequestMoreIfNeeded() {
+  const std::unique_lock lock(mQueueMutex);
+  if (!mQueue.IsEmpty()) {
+    evWorkAvailableEvent.Emit();
+  }
+}
+
+void PagePrefetcher::SetTabView(
+  PrefetchQueue::OwnerID owner,
+  const std::shared_ptr<ITabView>& tabView) {
+  auto& it = mOwners[owner];
+  if (it.mTabView.lock() == tabView) {
+    return;
+  }
+  this->RemoveEventListener(it.mContentChangedToken);
+  it = {tabView};
+  mQueue.Invalidate(owner);
+  if (!tabView) {
+    return;
+  }
+
+  // Cached pages are replaced when the content changes, so the neighbors
+  // need rendering again
+  it.mContentChangedToken
+    = AddEventListener(tabView->evContentChangedEvent, [this, owner]() {
+        const std::unique_lock lock(mQueueMutex);
+        mQueue.Invalidate(owner);
+      });
+}
+
+void PagePrefetcher::PrefetchNext() {
+  // Anything user-visible takes priority; we'll be called again in the next
+  // idle frame
+  if (mKneeboard->IsRepaintNeeded()) {
+    return;
+  }
+
+  const auto request = [this]() {
+    const std::unique_lock lock(mQueueMutex);
+    return mQueue.Pop();
+  }();
+  if (!request) {
+    return;
+  }
+  const scope_guard requestMore([this]() { this->RequestMoreIfNeeded(); });
+
+  const auto views = mKneeboard->GetAllViewsInFixedOrder();
+  const auto view = std::ranges::find_if(views, [&](const auto& view) {
+    return view->GetRuntimeID().GetTemporaryValue() == request->mOwner;
+  });
+  if (view == views.end()) {
+    return;
+  }
+  const auto tabView = (*view)->GetCurrentTabView();
+  if (!tabView) {
+    return;
+  }
+  const auto tab = tabView->GetTab();
+  const auto pageID = PageID::FromTemporaryValue(request->mPage);
+  const auto pageIDs = tab->GetPageIDs();
+  if (std::ranges::find(pageIDs, pageID) == pageIDs.end()) {
+    // The tab changed since we queued this
+    return;
+  }
+
+  // Don't push pages the user is actually looking at out of the cache
+  const auto size = tab->GetNativeContentSize(pageID);
+  if (!PrefetchQueue::IsWorthPrefetching(
+        static_cast<size_t>(size.width) * size.height * 4,
+        CachedLayer::BudgetInBytes)) {
+    return;
+  }
+
+  TraceLoggingActivity<gTraceProvider> activity;
+  TraceLoggingWriteStart(
+    activity,
+    "PagePrefetcher::PrefetchNext",
+    TraceLoggingValue(request->mPage, "PageID"));
+
+  const std::unique_lock dxLock(mDXR);
+  auto ctx = mDXR.mD2DDeviceContext;
+  ctx->SetTarget(mTarget.get());
+  mDXR.PushD2DDraw();
+  const scope_guard endDraw {
+    [this]() { winrt::check_hresult(this->mDXR.PopD2DDraw()); }};
+  tab->RenderPage(mRenderTargetID, ctx.get(), pageID, {0, 0, 1, 1});
+
+  TraceLoggingWriteStop(activity, "PagePrefetcher::PrefetchNext");
+}
+
+}// namespace OpenKneeboard
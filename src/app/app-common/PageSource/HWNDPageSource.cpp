@@ -197,7 +197,7 @@ HWNDPageSource::HWNDPageSource(
   KneeboardState* kneeboard,
   HWND window,
   const Options& options)
-  : mDXR(dxr), mWindow(window), mOptions(options) {
+  : mDXR(dxr), mKneeboard(kneeboard), mWindow(window), mOptions(options) {
   if (!window) {
     return;
   }
@@ -207,6 +207,12 @@ HWNDPageSource::HWNDPageSource(
 
   mDQC = winrt::Windows::System::DispatcherQueueController::
     CreateOnDedicatedThread();
+
+  AddEventListener(kneeboard->evFrameTimerPrepareEvent, [this]() {
+    if (mHaveNewFrame.exchange(false)) {
+      this->evNeedsRepaintEvent.Emit();
+    }
+  });
 }
 
 bool HWNDPageSource::HaveWindow() const {
@@ -442,8 +448,9 @@ void HWNDPageSource::OnFrame() {
   TraceLoggingWriteTagged(activity, "CopySubresourceRegion");
   ctx->CopySubresourceRegion(
     mTexture.get(), 0, 0, 0, 0, d3dSurface.get(), 0, &box);
-  TraceLoggingWriteTagged(activity, "evNeedsRepaint");
-  this->evNeedsRepaintEvent.Emit();
+  TraceLoggingWriteTagged(activity, "SetWindowCaptureFrameAvailable");
+  mHaveNewFrame = true;
+  mKneeboard->SetWindowCaptureFrameAvailable();
   TraceLoggingWriteStop(
     activity,
     "HWNDPageSource::OnFrame",
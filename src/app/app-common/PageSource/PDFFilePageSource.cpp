@@ -85,7 +85,7 @@ struct PDFFilePageSource::Impl final {
 
   bool mNavigationLoaded = false;
 
-  std::unordered_map<RenderTargetID, std::unique_ptr<CachedLayer>> mCache;
+  std::unique_ptr<CachedLayer> mCache;
   std::unique_ptr<DoodleRenderer> mDoodles;
   std::shared_ptr<FilesystemWatcher> mWatcher;
 
@@ -103,6 +103,7 @@ PDFFilePageSource::PDFFilePageSource(
   p->mBackgroundBrush = dxr.mWhiteBrush;
   p->mHighlightBrush = dxr.mHighlightBrush;
   p->mDoodles = std::make_unique<DoodleRenderer>(dxr, kbs);
+  p->mCache = std::make_unique<CachedLayer>(dxr);
   AddEventListener(
     p->mDoodles->evAddedPageEvent, this->evAvailableFeaturesChangedEvent);
 }
@@ -291,7 +292,7 @@ winrt::fire_and_forget PDFFilePageSource::Reload() {
     p->mBookmarks.clear();
     p->mLinks.clear();
     p->mNavigationLoaded = false;
-    p->mCache.clear();
+    p->mCache->Reset();
     p->mPageIDs.clear();
 
     if (!std::filesystem::is_regular_file(p->mPath)) {
@@ -527,15 +528,12 @@ std::vector<NavigationEntry> PDFFilePageSource::GetNavigationEntries() const {
 }
 
 void PDFFilePageSource::RenderPage(
-  RenderTargetID rtid,
+  RenderTargetID,
   ID2D1DeviceContext* ctx,
   PageID pageID,
   const D2D1_RECT_F& rect) {
   const auto size = this->GetNativeContentSize(pageID);
-  if (!p->mCache.contains(rtid)) {
-    p->mCache[rtid] = std::make_unique<CachedLayer>(p->mDXR);
-  }
-  p->mCache[rtid]->Render(
+  p->mCache->Render(
     rect,
     size,
     pageID.GetTemporaryValue(),
@@ -34,6 +34,7 @@ PageSourceWithDelegates::PageSourceWithDelegates(
   KneeboardState* kbs)
   : mDXResources(dxr) {
   mDoodles = std::make_unique<DoodleRenderer>(dxr, kbs);
+  mContentLayerCache = std::make_unique<CachedLayer>(dxr);
   mFixedEvents = {
     AddEventListener(mDoodles->evNeedsRepaintEvent, this->evNeedsRepaintEvent),
     AddEventListener(
@@ -41,7 +42,7 @@ PageSourceWithDelegates::PageSourceWithDelegates(
     AddEventListener(
       this->evContentChangedEvent,
       [this]() {
-        this->mContentLayerCache.clear();
+        this->mContentLayerCache->Reset();
         std::unordered_set<PageID> keep;
         for (const auto pageID: this->GetPageIDs()) {
           keep.insert(pageID);
@@ -166,12 +167,8 @@ void PageSourceWithDelegates::RenderPage(
 
   // ... otherwise, we'll assume it should be doodleable
 
-  if (!mContentLayerCache.contains(rti)) {
-    mContentLayerCache[rti] = std::make_unique<CachedLayer>(mDXResources);
-  }
-
   const auto nativeSize = delegate->GetNativeContentSize(pageID);
-  mContentLayerCache[rti]->Render(
+  mContentLayerCache->Render(
     rect,
     nativeSize,
     pageID.GetTemporaryValue(),
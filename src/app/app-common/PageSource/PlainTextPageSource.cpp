@@ -271,8 +271,7 @@ void PlainTextPageSource::LayoutMessages() {
     return;
   }
 
-  const scope_guard repaintAtEnd(
-    [this]() { this->evContentChangedEvent.Emit(); });
+  const scope_guard repaintAtEnd([this]() { mLayoutChanged.Emit(); });
 
   for (auto message: mMessages) {
     // tabs are variable width, and everything else here
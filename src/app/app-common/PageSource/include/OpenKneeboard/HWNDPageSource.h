@@ -32,6 +32,7 @@
 #include <winrt/Windows.Graphics.Capture.h>
 #include <winrt/Windows.System.h>
 
+#include <atomic>
 #include <memory>
 
 namespace OpenKneeboard {
@@ -99,6 +100,7 @@ class HWNDPageSource final
 
   winrt::apartment_context mUIThread;
   DXResources mDXR;
+  KneeboardState* mKneeboard {nullptr};
   HWND mWindow {};
   Options mOptions {};
   PageID mPageID {};
@@ -127,6 +129,9 @@ class HWNDPageSource final
   winrt::com_ptr<ID3D11Texture2D> mTexture;
   winrt::com_ptr<ID2D1Bitmap1> mBitmap;
   bool mNeedsRepaint {true};
+  // Set by `OnFrame()`; `evNeedsRepaintEvent` is emitted on the next frame
+  // tick, so that captures are limited to the window capture frame rate
+  std::atomic_bool mHaveNewFrame {false};
   uint32_t mMouseButtons {};
   size_t mRecreations = 0;
 };
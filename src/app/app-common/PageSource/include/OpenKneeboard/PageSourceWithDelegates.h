@@ -78,8 +78,7 @@ class PageSourceWithDelegates : public virtual IPageSource,
   std::shared_ptr<IPageSource> FindDelegate(PageID) const;
   mutable std::unordered_map<PageID, std::weak_ptr<IPageSource>> mPageDelegates;
 
-  std::unordered_map<RenderTargetID, std::unique_ptr<CachedLayer>>
-    mContentLayerCache;
+  std::unique_ptr<CachedLayer> mContentLayerCache;
   std::unique_ptr<DoodleRenderer> mDoodles;
 };
 
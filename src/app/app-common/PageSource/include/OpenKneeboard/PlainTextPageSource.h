@@ -21,6 +21,7 @@
 
 #include "IPageSource.h"
 
+#include <OpenKneeboard/ApartmentExecutor.h>
 #include <OpenKneeboard/DXResources.h>
 
 #include <OpenKneeboard/utf8.h>
@@ -78,6 +79,11 @@ class PlainTextPageSource final : public IPageSource {
   winrt::com_ptr<IDWriteTextFormat> mTextFormat;
   std::string mPlaceholderText;
 
+  // Bursts of messages - e.g. a DCS radio log - re-layout every time
+  EventCoalescer<> mLayoutChanged {
+    this->evContentChangedEvent,
+    CreateApartmentExecutor()};
+
   void LayoutMessages();
   void PushPage();
 };
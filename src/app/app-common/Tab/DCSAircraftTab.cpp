@@ -20,7 +20,6 @@
 #include <OpenKneeboard/DCSAircraftTab.h>
 #include <OpenKneeboard/DCSWorld.h>
 #include <OpenKneeboard/FolderPageSource.h>
-#include <OpenKneeboard/GameEvent.h>
 
 #include <OpenKneeboard/dprint.h>
 
@@ -43,6 +42,8 @@ DCSAircraftTab::DCSAircraftTab(
     mDXR(dxr),
     mKneeboard(kbs),
     mDebugInformation(_("No data from DCS.")) {
+  AddGameEventHandler(
+    DCS::EVT_AIRCRAFT, std::bind_front(&DCSAircraftTab::OnAircraftEvent, this));
 }
 
 DCSAircraftTab::~DCSAircraftTab() {
@@ -67,18 +68,15 @@ std::string DCSAircraftTab::GetDebugInformation() const {
   return mDebugInformation;
 }
 
-void DCSAircraftTab::OnGameEvent(
-  const GameEvent& event,
+void DCSAircraftTab::OnAircraftEvent(
+  const SharedGameEvent& event,
   const std::filesystem::path& installPath,
   const std::filesystem::path& savedGamesPath) {
-  if (event.name != DCS::EVT_AIRCRAFT) {
-    return;
-  }
-  if (event.value == mAircraft) {
+  if (event->GetValue() == mAircraft) {
     return;
   }
 
-  mAircraft = event.value;
+  mAircraft = event->GetValue();
   auto moduleName = mAircraft;
   if (mAircraft == "FA-18C_hornet") {
     moduleName = "FA-18C";
@@ -21,7 +21,6 @@
 #include <OpenKneeboard/DCSBriefingTab.h>
 #include <OpenKneeboard/DCSExtractedMission.h>
 #include <OpenKneeboard/DCSWorld.h>
-#include <OpenKneeboard/GameEvent.h>
 #include <OpenKneeboard/ImageFilePageSource.h>
 #include <OpenKneeboard/Lua.h>
 #include <OpenKneeboard/NavigationTab.h>
@@ -52,6 +51,13 @@ DCSBriefingTab::DCSBriefingTab(
     std::static_pointer_cast<IPageSource>(mTextPages),
     std::static_pointer_cast<IPageSource>(mImagePages),
   });
+  AddGameEventHandler(
+    DCS::EVT_MISSION, std::bind_front(&DCSBriefingTab::OnMissionEvent, this));
+  AddGameEventHandler(
+    DCS::EVT_SELF_DATA,
+    std::bind_front(&DCSBriefingTab::OnSelfDataEvent, this));
+  AddGameEventHandler(
+    DCS::EVT_ORIGIN, std::bind_front(&DCSBriefingTab::OnOriginEvent, this));
 }
 
 DCSBriefingTab::~DCSBriefingTab() {
@@ -109,44 +115,55 @@ void DCSBriefingTab::Reload() noexcept {
   this->evContentChangedEvent.Emit();
 }
 
-void DCSBriefingTab::OnGameEvent(
-  const GameEvent& event,
+void DCSBriefingTab::OnMissionEvent(
+  const SharedGameEvent& event,
   const std::filesystem::path& installPath,
   const std::filesystem::path&) {
   mInstallationPath = installPath;
-  if (event.name == DCS::EVT_MISSION) {
-    const auto missionZip = this->ToAbsolutePath(event.value);
-    if (missionZip.empty() || !std::filesystem::exists(missionZip)) {
-      dprintf("Briefing tab: mission '{}' does not exist", event.value);
-      return;
-    }
-
-    if (mMission && mMission->GetZipPath() == missionZip) {
-      return;
-    }
-
-    mMission = DCSExtractedMission::Get(missionZip);
-    dprintf("Briefing tab: loading {}", missionZip);
-    this->Reload();
+  const auto missionZip = this->ToAbsolutePath(event->GetValue());
+  if (missionZip.empty() || !std::filesystem::exists(missionZip)) {
+    dprintf("Briefing tab: mission '{}' does not exist", event->GetValue());
     return;
   }
 
-  auto state = mDCSState;
-  if (event.name == DCS::EVT_SELF_DATA) {
-    auto raw = nlohmann::json::parse(event.value);
-    state.mCoalition = raw.at("CoalitionID"),
-    state.mCountry = raw.at("Country");
-    state.mAircraft = raw.at("Name");
-  } else if (event.name == DCS::EVT_ORIGIN) {
-    auto raw = nlohmann::json::parse(event.value);
-    state.mOrigin = LatLong {
-      .mLat = raw["latitude"],
-      .mLong = raw["longitude"],
-    };
-  } else {
+  if (mMission && mMission->GetZipPath() == missionZip) {
     return;
   }
 
+  mMission = DCSExtractedMission::Get(missionZip);
+  dprintf("Briefing tab: loading {}", missionZip);
+  this->Reload();
+}
+
+void DCSBriefingTab::OnSelfDataEvent(
+  const SharedGameEvent& event,
+  const std::filesystem::path& installPath,
+  const std::filesystem::path&) {
+  const auto& raw = event->GetJSON();
+  auto state = mDCSState;
+  state.mCoalition = raw.at("CoalitionID");
+  state.mCountry = raw.at("Country");
+  state.mAircraft = raw.at("Name");
+  this->SetDCSState(state, installPath);
+}
+
+void DCSBriefingTab::OnOriginEvent(
+  const SharedGameEvent& event,
+  const std::filesystem::path& installPath,
+  const std::filesystem::path&) {
+  const auto& raw = event->GetJSON();
+  auto state = mDCSState;
+  state.mOrigin = LatLong {
+    .mLat = raw.at("latitude"),
+    .mLong = raw.at("longitude"),
+  };
+  this->SetDCSState(state, installPath);
+}
+
+void DCSBriefingTab::SetDCSState(
+  const DCSState& state,
+  const std::filesystem::path& installPath) {
+  mInstallationPath = installPath;
   if (state != mDCSState) {
     mDCSState = state;
     this->Reload();
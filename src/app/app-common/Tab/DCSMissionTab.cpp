@@ -21,7 +21,6 @@
 #include <OpenKneeboard/DCSMissionTab.h>
 #include <OpenKneeboard/DCSWorld.h>
 #include <OpenKneeboard/FolderPageSource.h>
-#include <OpenKneeboard/GameEvent.h>
 
 #include <OpenKneeboard/dprint.h>
 
@@ -44,6 +43,10 @@ DCSMissionTab::DCSMissionTab(
     mDXR(dxr),
     mKneeboard(kbs),
     mDebugInformation(_("No data from DCS.")) {
+  AddGameEventHandler(
+    DCS::EVT_MISSION, std::bind_front(&DCSMissionTab::OnMissionEvent, this));
+  AddGameEventHandler(
+    DCS::EVT_AIRCRAFT, std::bind_front(&DCSMissionTab::OnAircraftEvent, this));
 }
 
 DCSMissionTab::~DCSMissionTab() {
@@ -104,34 +107,33 @@ std::string DCSMissionTab::GetDebugInformation() const {
   return mDebugInformation;
 }
 
-void DCSMissionTab::OnGameEvent(
-  const GameEvent& event,
+void DCSMissionTab::OnMissionEvent(
+  const SharedGameEvent& event,
   const std::filesystem::path& _installPath,
   const std::filesystem::path& _savedGamePath) {
-  if (event.name == DCS::EVT_MISSION) {
-    const auto missionZip = this->ToAbsolutePath(event.value);
-    if (missionZip.empty() || !std::filesystem::exists(missionZip)) {
-      dprintf("MissionTab: mission '{}' does not exist", event.value);
-      return;
-    }
-
-    if (missionZip == mMission) {
-      return;
-    }
+  const auto missionZip = this->ToAbsolutePath(event->GetValue());
+  if (missionZip.empty() || !std::filesystem::exists(missionZip)) {
+    dprintf("MissionTab: mission '{}' does not exist", event->GetValue());
+    return;
+  }
 
-    mMission = missionZip;
-    this->Reload();
+  if (missionZip == mMission) {
     return;
   }
 
-  if (event.name == DCS::EVT_AIRCRAFT) {
-    if (event.value == mAircraft) {
-      return;
-    }
-    mAircraft = event.value;
-    this->Reload();
+  mMission = missionZip;
+  this->Reload();
+}
+
+void DCSMissionTab::OnAircraftEvent(
+  const SharedGameEvent& event,
+  const std::filesystem::path& _installPath,
+  const std::filesystem::path& _savedGamePath) {
+  if (event->GetValue() == mAircraft) {
     return;
   }
+  mAircraft = event->GetValue();
+  this->Reload();
 }
 
 }// namespace OpenKneeboard
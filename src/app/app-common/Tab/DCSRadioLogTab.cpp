@@ -19,7 +19,6 @@
  */
 #include <OpenKneeboard/DCSRadioLogTab.h>
 #include <OpenKneeboard/DCSWorld.h>
-#include <OpenKneeboard/GameEvent.h>
 #include <OpenKneeboard/PlainTextPageSource.h>
 
 #include <chrono>
@@ -54,6 +53,16 @@ DCSRadioLogTab::DCSRadioLogTab(
       _("[waiting for radio messages]"))) {
   this->SetDelegates({mPageSource});
   AddEventListener(mPageSource->evPageAppendedEvent, this->evPageAppendedEvent);
+  AddGameEventHandler(
+    DCS::EVT_SIMULATION_START,
+    [this](const SharedGameEvent& ev, const auto&, const auto&) {
+      this->OnSimulationStartEvent(ev);
+    });
+  AddGameEventHandler(
+    DCS::EVT_MESSAGE,
+    [this](const SharedGameEvent& ev, const auto&, const auto&) {
+      this->OnMessageEvent(ev);
+    });
   LoadSettings(config);
 }
 
@@ -113,45 +122,29 @@ PageIndex DCSRadioLogTab::GetPageCount() const {
   return count == 0 ? 1 : count;
 }
 
-void DCSRadioLogTab::OnGameEvent(
-  const GameEvent& event,
-  const std::filesystem::path& installPath,
-  const std::filesystem::path& savedGamesPath) {
-  this->OnGameEventImpl(event, installPath, savedGamesPath);
-}
-
-winrt::fire_and_forget DCSRadioLogTab::OnGameEventImpl(
-  const GameEvent& event,
-  const std::filesystem::path& installPath,
-  const std::filesystem::path& savedGamesPath) {
-  if (event.name == DCS::EVT_SIMULATION_START) {
-    co_await mUIThread;
-    {
-      const EventDelay eventDelay;
-      switch (mMissionStartBehavior) {
-        case MissionStartBehavior::DrawHorizontalLine:
-          mPageSource->PushFullWidthSeparator();
-          break;
-        case MissionStartBehavior::ClearHistory:
-          mPageSource->ClearText();
-          break;
-      }
-      const auto parsed = event.ParsedValue<DCS::SimulationStartEvent>();
-      mPageSource->PushMessage(std::format(
-        _(">> Mission started at {:%T}"),
-        std::chrono::utc_seconds {
-          std::chrono::seconds {parsed.missionStartTime}}));
-
-      this->evNeedsRepaintEvent.Emit();
-    }
-    co_return;
+// Taking the event by value, as it's used after `co_await`
+winrt::fire_and_forget DCSRadioLogTab::OnSimulationStartEvent(
+  SharedGameEvent event) {
+  co_await mUIThread;
+  const EventDelay eventDelay;
+  switch (mMissionStartBehavior) {
+    case MissionStartBehavior::DrawHorizontalLine:
+      mPageSource->PushFullWidthSeparator();
+      break;
+    case MissionStartBehavior::ClearHistory:
+      mPageSource->ClearText();
+      break;
   }
+  const auto& parsed = event->ParsedValue<DCS::SimulationStartEvent>();
+  mPageSource->PushMessage(std::format(
+    _(">> Mission started at {:%T}"),
+    std::chrono::utc_seconds {std::chrono::seconds {parsed.missionStartTime}}));
 
-  if (event.name != DCS::EVT_MESSAGE) {
-    co_return;
-  }
+  this->evNeedsRepaintEvent.Emit();
+}
 
-  const auto parsed = event.ParsedValue<DCS::MessageEvent>();
+winrt::fire_and_forget DCSRadioLogTab::OnMessageEvent(SharedGameEvent event) {
+  const auto& parsed = event->ParsedValue<DCS::MessageEvent>();
 
   co_await mUIThread;
 
@@ -19,35 +19,63 @@
  */
 #include <OpenKneeboard/DCSTab.h>
 #include <OpenKneeboard/DCSWorld.h>
-#include <OpenKneeboard/GameEvent.h>
 #include <OpenKneeboard/KneeboardState.h>
 #include <OpenKneeboard/dprint.h>
+#include <OpenKneeboard/tracing.h>
 
 using DCS = OpenKneeboard::DCSWorld;
 
 namespace OpenKneeboard {
 
-DCSTab::DCSTab(KneeboardState* kbs) {
-  mGameEventToken = AddEventListener(
-    kbs->evGameEvent, [this](const GameEvent& ev) { this->OnGameEvent(ev); });
+DCSTab::DCSTab(KneeboardState* kbs) : mKneeboard(kbs) {
+  AddGameEventListener(
+    DCS::EVT_INSTALL_PATH, [this](const SharedGameEvent& ev) {
+      mInstallPath = std::filesystem::canonical(ev->GetValue());
+    });
+  AddGameEventListener(
+    DCS::EVT_SAVED_GAMES_PATH, [this](const SharedGameEvent& ev) {
+      mSavedGamesPath = std::filesystem::canonical(ev->GetValue());
+    });
 }
 
 DCSTab::~DCSTab() {
-  this->RemoveEventListener(mGameEventToken);
-}
-
-void DCSTab::OnGameEvent(const GameEvent& event) {
-  if (event.name == DCS::EVT_INSTALL_PATH) {
-    mInstallPath = std::filesystem::canonical(event.value);
+  for (const auto& token: mGameEventTokens) {
+    this->RemoveEventListener(token);
   }
+}
 
-  if (event.name == DCS::EVT_SAVED_GAMES_PATH) {
-    mSavedGamesPath = std::filesystem::canonical(event.value);
+void DCSTab::AddGameEventListener(
+  std::string_view eventName,
+  std::function<void(const SharedGameEvent&)> listener) {
+  auto dispatcher = mKneeboard->GetGameEventDispatcher();
+  mGameEventTokens.push_back(
+    AddEventListener(dispatcher->GetEvent(eventName), listener));
+  // Repeats of the current state aren't dispatched again, so catch up if
+  // DCS is already running, e.g. if this tab was just added
+  if (const auto last = dispatcher->GetLastEvent(eventName)) {
+    listener(last);
   }
+}
 
-  if (!(mInstallPath.empty() || mSavedGamesPath.empty())) {
-    OnGameEvent(event, mInstallPath, mSavedGamesPath);
-  }
+void DCSTab::AddGameEventHandler(
+  std::string_view eventName,
+  GameEventHandler handler) {
+  AddGameEventListener(
+    eventName,
+    [this, handler = std::move(handler)](const SharedGameEvent& ev) {
+      if (mInstallPath.empty() || mSavedGamesPath.empty()) {
+        return;
+      }
+      // Per-tab timings, e.g. when replaying with `gameevent-replayer`
+      TraceLoggingActivity<gTraceProvider> activity;
+      TraceLoggingWriteStart(
+        activity,
+        "DCSTab::OnGameEvent",
+        TraceLoggingValue(this->GetTitle().c_str(), "Tab"),
+        TraceLoggingValue(ev->GetEvent().name.c_str(), "Event"));
+      handler(ev, mInstallPath, mSavedGamesPath);
+      TraceLoggingWriteStop(activity, "DCSTab::OnGameEvent");
+    });
 }
 
 std::filesystem::path DCSTab::ToAbsolutePath(
@@ -20,7 +20,6 @@
 #include <OpenKneeboard/DCSTerrainTab.h>
 #include <OpenKneeboard/DCSWorld.h>
 #include <OpenKneeboard/FolderPageSource.h>
-#include <OpenKneeboard/GameEvent.h>
 
 #include <OpenKneeboard/dprint.h>
 
@@ -43,6 +42,8 @@ DCSTerrainTab::DCSTerrainTab(
     mDXR(dxr),
     mKneeboard(kbs),
     mDebugInformation(_("No data from DCS.")) {
+  AddGameEventHandler(
+    DCS::EVT_TERRAIN, std::bind_front(&DCSTerrainTab::OnTerrainEvent, this));
 }
 
 DCSTerrainTab::~DCSTerrainTab() {
@@ -79,18 +80,15 @@ static std::string_view NormalizeTerrain(std::string_view terrain) {
   return terrain;
 }
 
-void DCSTerrainTab::OnGameEvent(
-  const GameEvent& event,
+void DCSTerrainTab::OnTerrainEvent(
+  const SharedGameEvent& event,
   const std::filesystem::path& installPath,
   const std::filesystem::path& savedGamesPath) {
-  if (event.name != DCS::EVT_TERRAIN) {
+  if (event->GetValue() == mTerrain) {
     return;
   }
-  if (event.value == mTerrain) {
-    return;
-  }
-  mTerrain = event.value;
-  const auto normalized = NormalizeTerrain(event.value);
+  mTerrain = event->GetValue();
+  const auto normalized = NormalizeTerrain(mTerrain);
 
   mDebugInformation.clear();
 
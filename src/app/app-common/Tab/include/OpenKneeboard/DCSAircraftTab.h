@@ -63,10 +63,10 @@ class DCSAircraftTab final : public TabBase,
   std::string mAircraft;
   std::vector<std::filesystem::path> mPaths;
 
-  virtual void OnGameEvent(
-    const GameEvent&,
-    const std::filesystem::path&,
-    const std::filesystem::path&) override;
+  void OnAircraftEvent(
+    const SharedGameEvent&,
+    const std::filesystem::path& installPath,
+    const std::filesystem::path& savedGamesPath);
 };
 
 }// namespace OpenKneeboard
@@ -53,12 +53,6 @@ class DCSBriefingTab final : public TabBase,
   bool IsNavigationAvailable() const override;
   std::vector<NavigationEntry> GetNavigationEntries() const override;
 
- protected:
-  virtual void OnGameEvent(
-    const GameEvent&,
-    const std::filesystem::path&,
-    const std::filesystem::path&) override;
-
  private:
   std::shared_ptr<DCSExtractedMission> mMission;
   std::shared_ptr<ImageFilePageSource> mImagePages;
@@ -82,6 +76,20 @@ class DCSBriefingTab final : public TabBase,
   };
   DCSState mDCSState;
 
+  void OnMissionEvent(
+    const SharedGameEvent&,
+    const std::filesystem::path& installPath,
+    const std::filesystem::path& savedGamesPath);
+  void OnSelfDataEvent(
+    const SharedGameEvent&,
+    const std::filesystem::path& installPath,
+    const std::filesystem::path& savedGamesPath);
+  void OnOriginEvent(
+    const SharedGameEvent&,
+    const std::filesystem::path& installPath,
+    const std::filesystem::path& savedGamesPath);
+  void SetDCSState(const DCSState&, const std::filesystem::path& installPath);
+
   constexpr const char* CoalitionKey(
     const char* neutralKey,
     const char* redforKey,
@@ -49,12 +49,6 @@ class DCSMissionTab final : public TabBase,
 
   virtual std::string GetDebugInformation() const override;
 
- protected:
-  virtual void OnGameEvent(
-    const GameEvent&,
-    const std::filesystem::path&,
-    const std::filesystem::path&) override;
-
  private:
   DXResources mDXR {};
   KneeboardState* mKneeboard {nullptr};
@@ -62,6 +56,15 @@ class DCSMissionTab final : public TabBase,
   std::string mAircraft;
   std::shared_ptr<DCSExtractedMission> mExtracted;
   std::string mDebugInformation;
+
+  void OnMissionEvent(
+    const SharedGameEvent&,
+    const std::filesystem::path& installPath,
+    const std::filesystem::path& savedGamesPath);
+  void OnAircraftEvent(
+    const SharedGameEvent&,
+    const std::filesystem::path& installPath,
+    const std::filesystem::path& savedGamesPath);
 };
 
 }// namespace OpenKneeboard
@@ -66,12 +66,6 @@ class DCSRadioLogTab final : public TabBase,
   bool GetTimestampsEnabled() const;
   void SetTimestampsEnabled(bool);
 
- protected:
-  virtual void OnGameEvent(
-    const GameEvent&,
-    const std::filesystem::path& installPath,
-    const std::filesystem::path& savedGamesPath) override;
-
  private:
   struct Settings;
   winrt::apartment_context mUIThread;
@@ -80,10 +74,8 @@ class DCSRadioLogTab final : public TabBase,
     MissionStartBehavior::DrawHorizontalLine};
   bool mShowTimestamps = false;
 
-  winrt::fire_and_forget OnGameEventImpl(
-    const GameEvent&,
-    const std::filesystem::path& installPath,
-    const std::filesystem::path& savedGamesPath);
+  winrt::fire_and_forget OnSimulationStartEvent(SharedGameEvent);
+  winrt::fire_and_forget OnMessageEvent(SharedGameEvent);
 
   void LoadSettings(const nlohmann::json&);
 };
@@ -21,16 +21,19 @@
 
 #include <OpenKneeboard/DCSWorld.h>
 #include <OpenKneeboard/Events.h>
+#include <OpenKneeboard/GameEventDispatcher.h>
 #include <OpenKneeboard/ITab.h>
 
 #include <shims/filesystem>
 
+#include <functional>
+#include <string_view>
+#include <vector>
+
 namespace OpenKneeboard {
 
 class KneeboardState;
 
-struct GameEvent;
-
 class DCSTab : public virtual ITab, public virtual EventReceiver {
  public:
   DCSTab(KneeboardState*);
@@ -39,20 +42,30 @@ class DCSTab : public virtual ITab, public virtual EventReceiver {
   DCSTab() = delete;
 
  protected:
-  virtual void OnGameEvent(
-    const GameEvent&,
+  using GameEventHandler = std::function<void(
+    const SharedGameEvent&,
     const std::filesystem::path& installPath,
-    const std::filesystem::path& savedGamesPath)
-    = 0;
+    const std::filesystem::path& savedGamesPath)>;
+
+  /** Call `handler` for every event with this name.
+   *
+   * If DCS has already sent its current state, `handler` is called with it
+   * immediately. Events are dropped until DCS has sent its install and saved
+   * games paths.
+   */
+  void AddGameEventHandler(std::string_view eventName, GameEventHandler);
 
   std::filesystem::path ToAbsolutePath(const std::filesystem::path&);
 
  private:
+  KneeboardState* mKneeboard {nullptr};
   std::filesystem::path mInstallPath;
   std::filesystem::path mSavedGamesPath;
-  EventHandlerToken mGameEventToken;
+  std::vector<EventHandlerToken> mGameEventTokens;
 
-  void OnGameEvent(const GameEvent&);
+  void AddGameEventListener(
+    std::string_view eventName,
+    std::function<void(const SharedGameEvent&)>);
 };
 
 }// namespace OpenKneeboard
@@ -59,10 +59,10 @@ class DCSTerrainTab final : public TabBase,
   std::string mTerrain;
   std::vector<std::filesystem::path> mPaths;
 
-  virtual void OnGameEvent(
-    const GameEvent&,
-    const std::filesystem::path&,
-    const std::filesystem::path&) override;
+  void OnTerrainEvent(
+    const SharedGameEvent&,
+    const std::filesystem::path& installPath,
+    const std::filesystem::path& savedGamesPath);
 };
 
 }// namespace OpenKneeboard
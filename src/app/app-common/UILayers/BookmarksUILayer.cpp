@@ -268,6 +268,8 @@ BookmarksUILayer::Buttons BookmarksUILayer::LayoutButtons() {
         strong->OnClick(button);
       }
     });
+  AddEventListener(
+    clickableButtons->evHoverButtonChangedEvent, this->evNeedsRepaintEvent);
   return clickableButtons;
 }
 
@@ -336,6 +336,7 @@ void ConfirmationUILayer::UpdateLayout(
       }
       self->evClosedEvent.Emit();
     });
+  AddEventListener(buttons->evHoverButtonChangedEvent, evNeedsRepaintEvent);
 
   mDialog = Dialog {
     .mMargin = margin,
@@ -21,7 +21,6 @@
 #include <OpenKneeboard/DCSWorld.h>
 #include <OpenKneeboard/DXResources.h>
 #include <OpenKneeboard/FooterUILayer.h>
-#include <OpenKneeboard/GameEvent.h>
 #include <OpenKneeboard/KneeboardState.h>
 #include <OpenKneeboard/Tracing.h>
 
@@ -36,8 +35,13 @@ FooterUILayer::FooterUILayer(const DXResources& dxr, KneeboardState* kneeboard)
   AddEventListener(
     kneeboard->evFrameTimerPrepareEvent,
     std::bind_front(&FooterUILayer::Tick, this));
+  auto gameEvents = kneeboard->GetGameEventDispatcher();
   AddEventListener(
-    kneeboard->evGameEvent, std::bind_front(&FooterUILayer::OnGameEvent, this));
+    gameEvents->GetEvent(DCSWorld::EVT_SIMULATION_START),
+    std::bind_front(&FooterUILayer::OnSimulationStartEvent, this));
+  AddEventListener(
+    gameEvents->GetEvent(DCSWorld::EVT_MISSION_TIME),
+    std::bind_front(&FooterUILayer::OnMissionTimeEvent, this));
   AddEventListener(
     kneeboard->evGameChangedEvent,
     std::bind_front(&FooterUILayer::OnGameChanged, this));
@@ -232,32 +236,28 @@ void FooterUILayer::Render(
     DWRITE_TEXT_ALIGNMENT_TRAILING);
 }
 
-void FooterUILayer::OnGameEvent(const GameEvent& ev) {
-  if (ev.name == DCSWorld::EVT_SIMULATION_START) {
-    const auto mission = ev.ParsedValue<DCSWorld::SimulationStartEvent>();
+void FooterUILayer::OnSimulationStartEvent(const SharedGameEvent& ev) {
+  const auto& mission = ev->ParsedValue<DCSWorld::SimulationStartEvent>();
 
-    const auto startTime = std::chrono::seconds(mission.missionStartTime);
+  const auto startTime = std::chrono::seconds(mission.missionStartTime);
 
-    mMissionTime = startTime;
-    return;
-  }
+  mMissionTime = startTime;
+}
 
-  if (ev.name == DCSWorld::EVT_MISSION_TIME) {
-    const auto times = ev.TryParsedValue<DCSWorld::MissionTimeEvent>();
-    if (!times) {
-      return;
-    }
-    const auto currentTime
-      = std::chrono::seconds(static_cast<uint64_t>(times->currentTime));
-
-    if ((!mMissionTime) || mMissionTime != currentTime) {
-      mMissionTime = currentTime;
-      mUTCOffset = std::chrono::hours(times->utcOffset);
-      evNeedsRepaintEvent.Emit();
-      mRenderState = RenderState::Stale;
-    }
+void FooterUILayer::OnMissionTimeEvent(const SharedGameEvent& ev) {
+  const auto times = ev->TryParsedValue<DCSWorld::MissionTimeEvent>();
+  if (!times) {
     return;
   }
+  const auto currentTime
+    = std::chrono::seconds(static_cast<uint64_t>(times->currentTime));
+
+  if ((!mMissionTime) || mMissionTime != currentTime) {
+    mMissionTime = currentTime;
+    mUTCOffset = std::chrono::hours(times->utcOffset);
+    evNeedsRepaintEvent.Emit();
+    mRenderState = RenderState::Stale;
+  }
 }
 
 void FooterUILayer::OnGameChanged(
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <OpenKneeboard/DXResources.h>
+#include <OpenKneeboard/GameEventDispatcher.h>
 #include <OpenKneeboard/SHM.h>
 #include <OpenKneeboard/UILayerBase.h>
 #include <shims/winrt/base.h>
@@ -30,7 +31,6 @@
 namespace OpenKneeboard {
 
 class KneeboardState;
-struct GameEvent;
 struct GameInstance;
 
 class FooterUILayer final : public UILayerBase, private EventReceiver {
@@ -53,7 +53,8 @@ class FooterUILayer final : public UILayerBase, private EventReceiver {
 
  private:
   void Tick();
-  void OnGameEvent(const GameEvent&);
+  void OnSimulationStartEvent(const SharedGameEvent&);
+  void OnMissionTimeEvent(const SharedGameEvent&);
   void OnGameChanged(DWORD processID, const std::shared_ptr<GameInstance>&);
 
   DXResources mDXResources;
@@ -76,6 +76,8 @@ class CursorClickableRegions final
 
   Event<EventContext, const Button&> evClicked;
   Event<EventContext> evClickedWithoutButton;
+  // Owners that draw hover effects should repaint
+  Event<> evHoverButtonChangedEvent;
 
   void PostCursorEvent(EventContext ec, const CursorEvent& ev) {
     const auto keepAlive = this->shared_from_this();
@@ -92,11 +94,16 @@ class CursorClickableRegions final
       }
     }
 
+    const auto previousHoverButton = mHoverButton;
     if (ev.mTouchState == CursorTouchState::NEAR_SURFACE) {
       mHoverButton = buttonUnderCursor;
     } else if (ev.mTouchState == CursorTouchState::NOT_NEAR_SURFACE) {
       mHoverButton.reset();
     }
+    if (mHoverButton != previousHoverButton) {
+      // Delayed until `delay` is destroyed, after we release the lock
+      evHoverButtonChangedEvent.Emit();
+    }
 
     if (
       mCursorTouching && ev.mTouchState == CursorTouchState::TOUCHING_SURFACE) {
@@ -0,0 +1,40 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/Executor.h>
+
+#include <memory>
+
+namespace OpenKneeboard {
+
+/** An `Executor` for the calling thread's COM apartment - usually the UI
+ * thread.
+ *
+ * Each batch of tasks costs one dispatch to the thread - via its
+ * `DispatcherQueue` if it has one - instead of one per task; event handlers
+ * invoked by a batch are delayed until the whole batch has run, as with
+ * `EventDelay`.
+ *
+ * Tasks always run later, even if posted from the same thread.
+ */
+std::shared_ptr<Executor> CreateApartmentExecutor();
+
+}// namespace OpenKneeboard
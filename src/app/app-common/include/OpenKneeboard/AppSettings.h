@@ -88,6 +88,17 @@ struct AppSettings final {
     constexpr auto operator<=>(const TintSettings&) const noexcept = default;
   };
 
+  struct FrameRateSettings final {
+    // Frames are only rendered when something changed, at most this often
+    float mMaximumFPS = 90.0f;
+    // Check at least this often, even if nothing changed, e.g. for clocks.
+    // 0 means never.
+    float mMinimumFPS = 1.0f;
+
+    constexpr auto operator<=>(const FrameRateSettings&) const noexcept
+      = default;
+  };
+
   std::optional<RECT> mWindowRect;
   bool mLoopPages {false};
   bool mLoopTabs {false};
@@ -96,6 +107,7 @@ struct AppSettings final {
   BookmarkSettings mBookmarks {};
   InGameUISettings mInGameUI {};
   TintSettings mTint {};
+  FrameRateSettings mFrameRate {};
   std::string mLastRunVersion;
 
   constexpr auto operator<=>(const AppSettings&) const noexcept = default;
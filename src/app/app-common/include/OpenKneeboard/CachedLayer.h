@@ -19,19 +19,30 @@
  */
 #pragma once
 
+#include <OpenKneeboard/LRUCache.h>
+
 #include <d2d1_2.h>
 #include <shims/winrt/base.h>
 
 #include <functional>
-#include <mutex>
+#include <vector>
 
 namespace OpenKneeboard {
 
 struct DXResources;
 
+/** Caches the output of a render function in bitmaps.
+ *
+ * All instances share one budgeted LRU cache, so each instance can keep
+ * several keys - e.g. pages - as long as there's room.
+ */
 class CachedLayer final {
  public:
   using Key = size_t;
+  using Statistics = LRUCacheStatistics;
+
+  static constexpr size_t BudgetInBytes = 256 * 1024 * 1024;
+
   CachedLayer(const DXResources&);
   ~CachedLayer();
 
@@ -41,14 +52,20 @@ class CachedLayer final {
     Key cacheKey,
     ID2D1DeviceContext* ctx,
     std::function<void(ID2D1DeviceContext*, const D2D1_SIZE_U&)> impl);
+  /// Forget everything cached by this instance
   void Reset();
 
- private:
-  Key mKey = ~Key {0};
+  /// For all instances combined; traced by `InterprocessRenderer`
+  static Statistics GetStatistics();
+  /** Keys of any instance whose bitmaps were evicted to stay within the
+   * budget since the last call, and haven't been cached again since.
+   *
+   * For example, prefetchers can use this to know to render a page again.
+   */
+  static std::vector<Key> TakeEvictedKeys();
 
-  D2D1_SIZE_U mCacheSize;
-  winrt::com_ptr<ID2D1Bitmap1> mCache;
-  std::mutex mCacheMutex;
+ private:
+  uint64_t mID;
 };
 
 }// namespace OpenKneeboard
@@ -37,6 +37,11 @@ class CursorRenderer final {
     const D2D1_POINT_2F& point,
     const D2D1_SIZE_F& scaleTo);
 
+  /// Everything that `Render()` with the same parameters might touch
+  static D2D1_RECT_F GetBounds(
+    const D2D1_POINT_2F& point,
+    const D2D1_SIZE_F& scaleTo);
+
  private:
   winrt::com_ptr<ID2D1SolidColorBrush> mInnerBrush;
   winrt::com_ptr<ID2D1SolidColorBrush> mOuterBrush;
@@ -21,6 +21,8 @@
 
 #include "UniqueID.h"
 
+#include <OpenKneeboard/Coalescer.h>
+#include <OpenKneeboard/Executor.h>
 #include <OpenKneeboard/dprint.h>
 #include <OpenKneeboard/tracing.h>
 
@@ -28,13 +30,20 @@
 
 #include <winrt/Windows.Foundation.h>
 
+#include <algorithm>
+#include <atomic>
+#include <concepts>
 #include <cstdint>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <source_location>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace OpenKneeboard {
@@ -53,6 +62,8 @@ class Event;
 class EventConnectionBase;
 template <class... Args>
 class EventConnection;
+template <class... Args>
+class EventCoalescer;
 
 class EventBase {
   friend class EventConnectionBase;
@@ -77,9 +88,21 @@ class EventBase {
    * To similarly buffer events in a non-handler context, use the `EventDelay`
    * class.
    */
-  static void InvokeOrEnqueue(std::function<void()>, std::source_location);
+  template <std::invocable Func>
+  static void InvokeOrEnqueue(Func&& func, std::source_location location) {
+    // Checking first so that the common case doesn't need an std::function
+    if (IsDelayed()) {
+      Enqueue(std::forward<Func>(func), location);
+      return;
+    }
+    func();
+  }
 
   virtual void RemoveHandler(EventHandlerToken) = 0;
+
+ private:
+  static bool IsDelayed() noexcept;
+  static void Enqueue(std::function<void()>, std::source_location);
 };
 
 /** Delay any event handling in the current thread for the lifetime of this
@@ -101,45 +124,62 @@ class EventDelay final {
   TraceLoggingThreadActivity<gTraceProvider> mActivity;
 };
 
+/// The part of an event that outlives it while handlers are running
+class EventImplBase {
+ public:
+  virtual ~EventImplBase() = default;
+  virtual void RemoveHandler(EventHandlerToken) = 0;
+};
+
 class EventConnectionBase {
  public:
   EventHandlerToken mToken;
+  /// Stop calling the handler, and detach from the event
   virtual void Invalidate() = 0;
 };
 
 template <class... Args>
-class EventConnection final
-  : public EventConnectionBase,
-    public std::enable_shared_from_this<EventConnection<Args...>> {
+class EventConnection final : public EventConnectionBase {
  private:
-  EventConnection(EventHandler<Args...> handler, std::source_location location)
-    : mHandler(handler), mSourceLocation(location) {
-  }
+  // Only for `Create()`, which needs a public constructor for `make_shared`
+  struct Key {};
 
  public:
   EventConnection() = delete;
+  EventConnection(
+    Key,
+    std::weak_ptr<EventImplBase> event,
+    EventHandler<Args...>&& handler,
+    std::source_location location)
+    : mEvent(std::move(event)),
+      mHandler(std::move(handler)),
+      mSourceLocation(location) {
+  }
 
+  /** The connection and the handler share a single allocation, as long as
+   * the handler fits in `std::function`'s small buffer.
+   */
   static std::shared_ptr<EventConnection<Args...>> Create(
+    std::weak_ptr<EventImplBase> event,
     EventHandler<Args...> handler,
     std::source_location location) {
-    return std::shared_ptr<EventConnection<Args...>>(
-      new EventConnection(handler, location));
+    return std::make_shared<EventConnection<Args...>>(
+      Key {}, std::move(event), std::move(handler), location);
   }
 
-  constexpr operator bool() const noexcept {
-    // not bothering with the lock, as it's checked with lock in Call() and
-    // Invalidate() anyway
-    return static_cast<bool>(mHandler);
+  operator bool() const noexcept {
+    return mIsValid.load(std::memory_order_acquire);
   }
 
   void Call(Args... args) {
-    auto stayingAlive = this->shared_from_this();
-    auto handler = mHandler;
-    if (handler) {
+    // The handler isn't destroyed until the last reference to this
+    // connection is, so it's safe to call even if we're invalidated while
+    // it's running
+    if (*this) {
       // In release builds, ignore but drop unhandled exceptions from handlers.
       // In debug builds, break (or crash)
       try {
-        handler(args...);
+        mHandler(args...);
       } catch (const std::exception& e) {
         dprintf("Uncaught std::exception from event handler: {}", e.what());
         OPENKNEEBOARD_BREAK;
@@ -157,11 +197,18 @@ class EventConnection final
   }
 
   virtual void Invalidate() override {
-    mHandler = {};
+    if (!mIsValid.exchange(false)) {
+      return;
+    }
+    if (auto event = mEvent.lock()) {
+      event->RemoveHandler(mToken);
+    }
   }
 
  private:
-  EventHandler<Args...> mHandler;
+  std::atomic<bool> mIsValid {true};
+  std::weak_ptr<EventImplBase> mEvent;
+  const EventHandler<Args...> mHandler;
   std::source_location mSourceLocation;
 };
 
@@ -169,6 +216,7 @@ class EventConnection final
 template <class... Args>
 class Event final : public EventBase {
   friend class EventReceiver;
+  friend class EventCoalescer<Args...>;
 
  public:
   using Hook = std::function<HookResult(Args...)>;
@@ -184,6 +232,61 @@ class Event final : public EventBase {
     mImpl->Emit(args..., location);
   }
 
+  /** Emit on the executor's thread.
+   *
+   * Prefer this to `EnqueueForContext()` for frequent events: emits share a
+   * context switch until the executor catches up.
+   */
+  void EnqueueForExecutor(
+    Executor& executor,
+    Args... args,
+    std::source_location location = std::source_location::current()) {
+    executor.Post([weakImpl = std::weak_ptr(mImpl), args..., location]() {
+      if (auto impl = weakImpl.lock()) {
+        impl->Emit(args..., location);
+      }
+    });
+  }
+
+  /** Emit once per element on the executor's thread, in one `EventDelay`.
+   *
+   * Elements are either a tuple of the arguments, or the argument for
+   * single-argument events. The batch is emitted by a single task, so nothing
+   * else - e.g. a repaint - runs on the executor's thread part-way through.
+   */
+  template <class T>
+    requires std::same_as<T, std::tuple<Args...>>
+    || (sizeof...(Args) == 1
+        && std::convertible_to<
+          const T&,
+          std::tuple_element_t<0, std::tuple<Args...>>>)
+  void EnqueueBatchForExecutor(
+    Executor& executor,
+    std::vector<T> batch,
+    std::source_location location = std::source_location::current()) {
+    if (batch.empty()) {
+      return;
+    }
+    executor.Post([weakImpl = std::weak_ptr(mImpl),
+                   batch = std::move(batch),
+                   location]() {
+      auto impl = weakImpl.lock();
+      if (!impl) {
+        return;
+      }
+      const EventDelay delay(location);
+      for (const auto& item: batch) {
+        if constexpr (std::same_as<T, std::tuple<Args...>>) {
+          std::apply(
+            [&](const auto&... args) { impl->Emit(args..., location); },
+            item);
+        } else {
+          impl->Emit(item, location);
+        }
+      }
+    });
+  }
+
   template <class Awaitable>
   winrt::fire_and_forget EnqueueForContext(
     Awaitable context,
@@ -215,23 +318,57 @@ class Event final : public EventBase {
 
  protected:
   std::shared_ptr<EventConnectionBase> AddHandler(
-    const EventHandler<Args...>&,
+    EventHandler<Args...>,
     std::source_location current);
   virtual void RemoveHandler(EventHandlerToken token) override;
 
  private:
-  struct Impl {
+  /** What `Emit()` needs; this is never modified once it's published.
+   *
+   * Adding a handler or adding/removing a hook publishes a new copy, so
+   * emitting doesn't need to copy anything, or to take a lock.
+   *
+   * Removing a handler just invalidates it, leaving a tombstone that
+   * `Emit()` skips; tombstones are dropped by the next copy, or once they're
+   * half of the receivers. This keeps removal amortized O(1), e.g. when a
+   * view with hundreds of listeners goes away.
+   */
+  struct Snapshot {
+    std::vector<std::shared_ptr<EventConnection<Args...>>> mReceivers;
+    std::vector<std::pair<EventHookToken, Hook>> mHooks;
+  };
+
+  struct Impl final : public EventImplBase {
     ~Impl();
 
+    // Only needed for modifications
+    std::mutex mMutex;
+    std::atomic<std::shared_ptr<const Snapshot>> mSnapshot {
+      std::make_shared<const Snapshot>()};
+    // Receivers that haven't been removed; anything else in the snapshot is
+    // a tombstone
     std::unordered_map<
       EventHandlerToken,
       std::shared_ptr<EventConnection<Args...>>>
       mReceivers;
-    std::unordered_map<EventHookToken, Hook> mHooks;
+    size_t mTombstoneCount {0};
 
     void Emit(
       Args... args,
       std::source_location location = std::source_location::current());
+
+    void AddHandler(std::shared_ptr<EventConnection<Args...>>);
+    virtual void RemoveHandler(EventHandlerToken) override;
+
+    template <std::invocable<Snapshot&> Func>
+    void Update(Func&& func);
+    /** Also drops tombstones.
+     *
+     * Returns the previous snapshot, which must be released after unlocking:
+     * destroying handlers can call back into us.
+     */
+    template <std::invocable<Snapshot&> Func>
+    [[nodiscard]] std::shared_ptr<const Snapshot> UpdateLocked(Func&& func);
   };
   std::shared_ptr<Impl> mImpl;
 };
@@ -253,7 +390,10 @@ class EventReceiver {
   EventReceiver& operator=(const EventReceiver&) = delete;
 
  protected:
-  std::vector<std::shared_ptr<EventConnectionBase>> mSenders;
+  // Indexed so that removing a listener is O(1), even if we're listening
+  // to thousands of events
+  std::unordered_map<EventHandlerToken, std::shared_ptr<EventConnectionBase>>
+    mSenders;
 
   // `std::type_identity_t` makes the compiler infer `Args` from the event,
   // then match the handler, instead of attempting to infer `Args from both.
@@ -289,25 +429,81 @@ class EventReceiver {
 
 template <class... Args>
 std::shared_ptr<EventConnectionBase> Event<Args...>::AddHandler(
-  const EventHandler<Args...>& handler,
+  EventHandler<Args...> handler,
   std::source_location location) {
-  auto connection = EventConnection<Args...>::Create(handler, location);
-  auto token = connection->mToken;
-  mImpl->mReceivers.emplace(token, connection);
+  auto connection
+    = EventConnection<Args...>::Create(mImpl, std::move(handler), location);
+  mImpl->AddHandler(connection);
   return std::move(connection);
 }
 
 template <class... Args>
 void Event<Args...>::RemoveHandler(EventHandlerToken token) {
+  mImpl->RemoveHandler(token);
+}
+
+template <class... Args>
+void Event<Args...>::Impl::AddHandler(
+  std::shared_ptr<EventConnection<Args...>> connection) {
+  std::shared_ptr<const Snapshot> previous;
+  std::unique_lock lock(mMutex);
+  mReceivers.emplace(connection->mToken, connection);
+  previous = this->UpdateLocked([&connection](Snapshot& snapshot) {
+    snapshot.mReceivers.push_back(std::move(connection));
+  });
+}
+
+template <class... Args>
+void Event<Args...>::Impl::RemoveHandler(EventHandlerToken token) {
   std::shared_ptr<EventConnectionBase> receiver;
-  if (!mImpl->mReceivers.contains(token)) {
-    return;
+  std::shared_ptr<const Snapshot> previous;
+  {
+    std::unique_lock lock(mMutex);
+    const auto it = mReceivers.find(token);
+    if (it == mReceivers.end()) {
+      return;
+    }
+    receiver = std::move(it->second);
+    mReceivers.erase(it);
+
+    ++mTombstoneCount;
+    if (mTombstoneCount * 2 > mSnapshot.load()->mReceivers.size()) {
+      previous = this->UpdateLocked([](Snapshot&) {});
+    }
   }
-  receiver = mImpl->mReceivers.at(token);
-  mImpl->mReceivers.erase(token);
+  // Outside of the lock, as this calls back into us
   receiver->Invalidate();
 }
 
+template <class... Args>
+template <std::invocable<typename Event<Args...>::Snapshot&> Func>
+void Event<Args...>::Impl::Update(Func&& func) {
+  std::shared_ptr<const Snapshot> previous;
+  std::unique_lock lock(mMutex);
+  previous = this->UpdateLocked(std::forward<Func>(func));
+}
+
+template <class... Args>
+template <std::invocable<typename Event<Args...>::Snapshot&> Func>
+std::shared_ptr<const typename Event<Args...>::Snapshot>
+Event<Args...>::Impl::UpdateLocked(Func&& func) {
+  auto previous = mSnapshot.load();
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->mHooks = previous->mHooks;
+  snapshot->mReceivers.reserve(
+    previous->mReceivers.size() - mTombstoneCount + 1);
+  for (const auto& receiver: previous->mReceivers) {
+    if (mReceivers.contains(receiver->mToken)) {
+      snapshot->mReceivers.push_back(receiver);
+    }
+  }
+  mTombstoneCount = 0;
+
+  func(*snapshot);
+  mSnapshot.store(std::move(snapshot));
+  return previous;
+}
+
 template <class... Args>
 void Event<Args...>::Impl::Emit(Args... args, std::source_location location) {
   TraceLoggingThreadActivity<gTraceProvider> activity;
@@ -315,11 +511,10 @@ void Event<Args...>::Impl::Emit(Args... args, std::source_location location) {
     activity,
     "Event::Emit()",
     OPENKNEEBOARD_TraceLoggingSourceLocation(location));
-  //  Copy in case one is erased while we're running
-  auto receivers = mReceivers;
-  auto hooks = mHooks;
+  // Unaffected by handlers being added or removed while we're running
+  const auto snapshot = mSnapshot.load();
 
-  for (const auto& [_, hook]: hooks) {
+  for (const auto& [_, hook]: snapshot->mHooks) {
     if (hook(args...) == HookResult::STOP_PROPAGATION) {
       TraceLoggingWriteStop(
         activity,
@@ -332,11 +527,9 @@ void Event<Args...>::Impl::Emit(Args... args, std::source_location location) {
 
   TraceLoggingWriteTagged(activity, "Invoking or enqueuing");
   InvokeOrEnqueue(
-    [=]() {
-      for (const auto& [token, receiver]: receivers) {
-        if (receiver) {
-          receiver->Call(args...);
-        }
+    [snapshot, args...]() {
+      for (const auto& receiver: snapshot->mReceivers) {
+        receiver->Call(args...);
       }
     },
     location);
@@ -353,7 +546,7 @@ Event<Args...>::~Event() {
 
 template <class... Args>
 Event<Args...>::Impl::~Impl() {
-  for (const auto& [token, receiver]: mReceivers) {
+  for (const auto& receiver: mSnapshot.load()->mReceivers) {
     receiver->Invalidate();
   }
 }
@@ -362,16 +555,25 @@ template <class... Args>
 EventHookToken Event<Args...>::AddHook(
   Hook hook,
   EventHookToken token) noexcept {
-  mImpl->mHooks.insert_or_assign(token, hook);
+  mImpl->Update([&](Snapshot& snapshot) {
+    auto it = std::ranges::find(
+      snapshot.mHooks, token, &std::pair<EventHookToken, Hook>::first);
+    if (it == snapshot.mHooks.end()) {
+      snapshot.mHooks.emplace_back(token, hook);
+    } else {
+      it->second = hook;
+    }
+  });
   return token;
 }
 
 template <class... Args>
 void Event<Args...>::RemoveHook(EventHookToken token) noexcept {
-  auto it = mImpl->mHooks.find(token);
-  if (it != mImpl->mHooks.end()) {
-    mImpl->mHooks.erase(it);
-  }
+  mImpl->Update([token](Snapshot& snapshot) {
+    std::erase_if(snapshot.mHooks, [token](const auto& it) {
+      return it.first == token;
+    });
+  });
 }
 
 template <class... Args>
@@ -379,8 +581,10 @@ EventHandlerToken EventReceiver::AddEventListener(
   Event<Args...>& event,
   const std::type_identity_t<EventHandler<Args...>>& handler,
   std::source_location location) {
-  mSenders.push_back(event.AddHandler(handler, location));
-  return mSenders.back()->mToken;
+  auto connection = event.AddHandler(handler, location);
+  const auto token = connection->mToken;
+  mSenders.emplace(token, std::move(connection));
+  return token;
 }
 
 template <class... Args>
@@ -424,4 +628,76 @@ EventHandlerToken EventReceiver::AddEventListener(
     location);
 }
 
+/** Merges bursts of emissions of an event into one.
+ *
+ * Emissions are collected until the executor runs - e.g. the next time the
+ * UI thread is idle - then the target event is emitted once.
+ *
+ * This is for notifications like 'content changed' that are often sent many
+ * times for one logical change; handlers must not depend on being invoked
+ * before `Emit()` returns.
+ */
+template <class... Args>
+class EventCoalescer final {
+ public:
+  using Values = std::tuple<Args...>;
+  /// Combine a pending emission with a new one
+  using Merge = std::function<Values(Values pending, Values next)>;
+
+  /// Keep the most recent arguments
+  static Values LastValue(Values, Values next) {
+    return next;
+  }
+
+  EventCoalescer() = delete;
+  EventCoalescer(
+    Event<Args...>& target,
+    std::shared_ptr<Executor> executor,
+    Merge merge = &LastValue)
+    : mImpl(
+      [weak = std::weak_ptr(target.mImpl)](Pending pending) {
+        if (auto target = weak.lock()) {
+          std::apply(
+            [&](auto&&... args) { target->Emit(args..., pending.mLocation); },
+            pending.mValues);
+        }
+      },
+      std::move(executor),
+      [merge = std::move(merge)](Pending pending, Pending next) {
+        // Keep the location of the first emission in the burst
+        return Pending {
+          merge(std::move(pending.mValues), std::move(next.mValues)),
+          pending.mLocation,
+        };
+      }) {
+  }
+
+  EventCoalescer(const EventCoalescer&) = delete;
+  EventCoalescer& operator=(const EventCoalescer&) = delete;
+
+  /// Thread-safe
+  void Emit(
+    Args... args,
+    std::source_location location = std::source_location::current()) {
+    mImpl.Push({{args...}, location});
+  }
+
+  /// Emit now if anything is pending; must be called on the executor's thread
+  void Flush() {
+    mImpl.Flush();
+  }
+
+  /// How many emissions were merged into another
+  uint64_t GetSuppressedCount() const {
+    return mImpl.GetSuppressedCount();
+  }
+
+ private:
+  struct Pending {
+    Values mValues;
+    std::source_location mLocation;
+  };
+  Coalescer<Pending> mImpl;
+};
+
 }// namespace OpenKneeboard
@@ -0,0 +1,65 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/GameEvent.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace OpenKneeboard {
+
+/** Drops DCS state events that are byte-identical to the previous value.
+ *
+ * The DCS hook resends its whole state every half-second; without this,
+ * tabs would redo work such as filesystem checks and reloads for every
+ * repeat.
+ *
+ * Only events that describe current state are deduplicated; see
+ * `IsDeduplicated()` for the opt-outs. The cache is reset by
+ * `DCSWorld::EVT_SIMULATION_START`, and when `Reset()` is called.
+ *
+ * Thread-safe.
+ */
+class GameEventDeduplicator final {
+ public:
+  struct Statistics {
+    uint64_t mDelivered {};
+    uint64_t mSuppressed {};
+  };
+
+  /// Returns false if the event is an unchanged repeat, and should be dropped
+  bool ShouldDeliver(const GameEvent&);
+  void Reset();
+
+  Statistics GetStatistics() const;
+
+  static bool IsDeduplicated(std::string_view eventName);
+
+ private:
+  mutable std::mutex mMutex;
+  std::unordered_map<std::string, std::string> mLastValues;
+  Statistics mStatistics;
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,106 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/Events.h>
+#include <OpenKneeboard/InternedGameEvent.h>
+#include <OpenKneeboard/PrefixTrie.h>
+
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Routes each event only to the listeners for its name.
+ *
+ * Listeners subscribe with `EventReceiver::AddEventListener()`:
+ *
+ * ```
+ * AddEventListener(
+ *   dispatcher->GetEvent(DCSWorld::EVT_AIRCRAFT),
+ *   [this](const SharedGameEvent& ev) { ... });
+ * ```
+ *
+ * Subscriptions are stored in a prefix trie; the listeners for each name are
+ * looked up on the first event with that name, then cached until another
+ * subscription is added. Dispatching is usually a vector lookup, instead of
+ * every listener comparing the name against every event it's interested in.
+ *
+ * Unchanged repeats of state events are dropped before they get here (see
+ * `GameEventDeduplicator`), so listeners added later - e.g. tabs created by
+ * switching profiles - won't see the current state unless they ask for it
+ * with `GetLastEvent()`.
+ */
+class GameEventDispatcher final {
+ public:
+  /// Events with exactly this name; valid for the dispatcher's lifetime
+  Event<SharedGameEvent>& GetEvent(GameEventID);
+  Event<SharedGameEvent>& GetEvent(std::string_view name) {
+    return GetEvent(GameEventID {name});
+  }
+
+  /** Events with names starting with `prefix`, e.g. "dcs/".
+   *
+   * An empty prefix receives every event. The reference is valid for the
+   * dispatcher's lifetime.
+   */
+  Event<SharedGameEvent>& GetPrefixEvent(std::string_view prefix);
+
+  /** Emit in the current thread, if there are any listeners for the name.
+   *
+   * Prefix listeners are called before exact listeners, and shorter prefixes
+   * before longer ones.
+   */
+  void Dispatch(const SharedGameEvent&);
+
+  /** The latest dispatched event with this name, if it describes state.
+   *
+   * This is for the names that `GameEventDeduplicator` deduplicates; nullptr
+   * for other names, or if there hasn't been one since
+   * `ForgetLastEvents()`.
+   */
+  SharedGameEvent GetLastEvent(GameEventID) const;
+  SharedGameEvent GetLastEvent(std::string_view name) const {
+    return GetLastEvent(GameEventID {name});
+  }
+  /// e.g. when the game changes, as its state no longer applies
+  void ForgetLastEvents();
+
+ private:
+  struct Subscriptions {
+    std::unique_ptr<Event<SharedGameEvent>> mExact;
+    std::unique_ptr<Event<SharedGameEvent>> mPrefix;
+  };
+  using Route = std::vector<Event<SharedGameEvent>*>;
+
+  mutable std::mutex mMutex;
+  PrefixTrie<Subscriptions> mSubscriptions;
+  // Indexed by `GameEventID::GetIndex()`; null if not yet looked up
+  std::vector<std::shared_ptr<const Route>> mRoutes;
+  // Indexed by `GameEventID::GetIndex()`; null if not state, or none yet
+  std::vector<SharedGameEvent> mLastEvents;
+
+  Event<SharedGameEvent>& GetOrCreate(
+    std::unique_ptr<Event<SharedGameEvent>>* event);
+};
+
+}// namespace OpenKneeboard
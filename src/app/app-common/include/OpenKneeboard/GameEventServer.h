@@ -19,42 +19,66 @@
  */
 #pragma once
 
+#include <OpenKneeboard/ApartmentExecutor.h>
 #include <OpenKneeboard/Events.h>
 #include <OpenKneeboard/GameEvent.h>
-#include <OpenKneeboard/Win32.h>
+#include <OpenKneeboard/GameEventDeduplicator.h>
+#include <OpenKneeboard/GameEventDispatcher.h>
+#include <OpenKneeboard/GameEventRecording.h>
+#include <OpenKneeboard/GameEventTransport.h>
 
+#include <shims/filesystem>
 #include <shims/winrt/base.h>
 
-#include <winrt/Windows.Foundation.h>
-
+#include <chrono>
+#include <cstddef>
+#include <fstream>
 #include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
 
 namespace OpenKneeboard {
 
 class GameEventServer final
   : public std::enable_shared_from_this<GameEventServer> {
  public:
+  /// Listens on the mailslot at `GameEvent::GetMailslotPath()`
   static std::shared_ptr<GameEventServer> Create();
+  /// Listens with another transport, e.g. for testing; may be null
+  static std::shared_ptr<GameEventServer> Create(
+    std::unique_ptr<IGameEventReceiver>);
   static winrt::fire_and_forget final_release(std::unique_ptr<GameEventServer>);
   ~GameEventServer();
 
-  Event<GameEvent> evGameEvent;
+  /// Names are interned here, once per event, rather than by each listener
+  Event<SharedGameEvent> evGameEvent;
+
+  /// Deliver the next value of each state event, even if it's unchanged
+  void ResetDeduplication();
 
  private:
-  GameEventServer();
-  winrt::Windows::Foundation::IAsyncAction mRunner;
-  winrt::apartment_context mUIThread;
-  winrt::handle mCompletionHandle {
-    Win32::CreateEventW(nullptr, TRUE, FALSE, nullptr)};
+  GameEventServer(std::unique_ptr<IGameEventReceiver>);
+  std::unique_ptr<IGameEventReceiver> mReceiver;
+  std::shared_ptr<Executor> mUIThread {CreateApartmentExecutor()};
+  GameEventDeduplicator mDeduplicator;
+
+  // Only if OPENKNEEBOARD_GAME_EVENT_RECORDING is set to a file path
+  std::ofstream mRecordingFile;
+  std::optional<GameEventRecordingWriter> mRecording;
+  std::optional<std::chrono::steady_clock::time_point> mFirstRecordedEventAt;
+
+  // Last, so that it's joined before anything it uses is destroyed
+  std::jthread mThread;
 
   void Start();
 
-  winrt::Windows::Foundation::IAsyncAction Run();
-  static winrt::Windows::Foundation::IAsyncOperation<bool> RunSingle(
-    const std::weak_ptr<GameEventServer>&,
-    const winrt::handle& event,
-    const winrt::file_handle&);
-  winrt::fire_and_forget DispatchEvent(std::string_view);
+  void Run(std::stop_token);
+  void StartRecording(const std::filesystem::path&);
+  void Record(std::span<const GameEvent> packet);
+  void DispatchEvents(const std::vector<std::vector<std::byte>>&);
 };
 
 }// namespace OpenKneeboard
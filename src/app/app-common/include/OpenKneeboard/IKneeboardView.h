@@ -76,8 +76,15 @@ class IKneeboardView {
   virtual D2D1_SIZE_U GetContentNativeSize() const = 0;
 
   Event<TabIndex> evCurrentTabChangedEvent;
-  // TODO - cursor and repaint?
-  Event<> evNeedsRepaintEvent;
+  /// For `evNeedsRepaintEvent`
+  static constexpr D2D1_RECT_F WholeCanvas {0.0f, 0.0f, 1.0f, 1.0f};
+
+  // Something other than the cursor changed; cursor movement is only
+  // reported via `evCursorEvent`, so that it can be repainted on its own.
+  //
+  // The argument is the part of the canvas that needs repainting, with
+  // coordinates normalized to 0..1
+  Event<D2D1_RECT_F> evNeedsRepaintEvent;
   Event<CursorEvent> evCursorEvent;
   Event<> evLayoutChangedEvent;
   Event<> evBookmarksChangedEvent;
@@ -94,6 +101,10 @@ class IKneeboardView {
   virtual D2D1_POINT_2F GetCursorCanvasPoint(
     const D2D1_POINT_2F& contentPoint) const
     = 0;
+  /// The area `RenderWithChrome()` draws the cursor to, if any
+  virtual std::optional<D2D1_RECT_F> GetCursorCanvasBounds(
+    const D2D1_SIZE_F& canvasSize) const
+    = 0;
 
   virtual void PostCursorEvent(const CursorEvent& ev) = 0;
 };
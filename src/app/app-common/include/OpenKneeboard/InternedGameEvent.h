@@ -0,0 +1,154 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// Received game events, as shared by `GameEventDispatcher`'s listeners; this
+// has no OS dependencies.
+
+#include <OpenKneeboard/GameEvent.h>
+
+#include <concepts>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** A small integer standing in for a `GameEvent` name.
+ *
+ * Names are interned process-wide the first time they're seen, so the same
+ * name always has the same ID; comparing IDs is an integer comparison, and
+ * IDs are dense so they can be used as vector indices.
+ *
+ * Thread-safe.
+ */
+class GameEventID final {
+ public:
+  GameEventID() = delete;
+  explicit GameEventID(std::string_view name);
+
+  constexpr uint32_t GetIndex() const noexcept {
+    return mIndex;
+  }
+
+  /// Valid for the lifetime of the process
+  std::string_view GetName() const;
+
+  constexpr bool operator==(const GameEventID&) const noexcept = default;
+
+ private:
+  uint32_t mIndex;
+};
+
+/** A received event, shared by every listener.
+ *
+ * The name is interned once on receipt, and each parse of the value is done
+ * at most once, then shared; handlers should use `ParsedValue()` instead of
+ * `GetEvent().ParsedValue()` so that they don't each re-parse the JSON.
+ *
+ * Immutable apart from the parse cache, which is thread-safe.
+ */
+class InternedGameEvent final {
+ public:
+  InternedGameEvent() = delete;
+  explicit InternedGameEvent(GameEvent);
+
+  InternedGameEvent(const InternedGameEvent&) = delete;
+  InternedGameEvent& operator=(const InternedGameEvent&) = delete;
+
+  GameEventID GetID() const noexcept {
+    return mID;
+  }
+
+  const GameEvent& GetEvent() const noexcept {
+    return mEvent;
+  }
+
+  const std::string& GetValue() const noexcept {
+    return mEvent.value;
+  }
+
+  /// Throws like `GameEvent::ParsedValue()`
+  template <class T>
+  const T& ParsedValue() const {
+    return GetCachedValue<T>([this]() { return mEvent.ParsedValue<T>(); });
+  }
+
+  /// Returns nullptr if the value isn't valid JSON for T
+  template <class T>
+  const T* TryParsedValue() const {
+    // Intentionally not propagating the std::logic_error
+    try {
+      return &ParsedValue<T>();
+    } catch (const nlohmann::json::exception&) {
+      return nullptr;
+    }
+  }
+
+  /// For events that don't have a struct; throws if the value is invalid
+  const nlohmann::json& GetJSON() const;
+
+ private:
+  struct CachedValue {
+    std::type_index mType;
+    std::shared_ptr<const void> mValue;
+    // Failures are cached too
+    std::exception_ptr mError;
+  };
+
+  GameEvent mEvent;
+  GameEventID mID;
+
+  mutable std::mutex mMutex;
+  // Usually zero or one entries, so a map isn't worth it
+  mutable std::vector<CachedValue> mCachedValues;
+
+  template <class T, std::invocable F>
+  const T& GetCachedValue(F&& parse) const {
+    const std::unique_lock lock(mMutex);
+    for (const auto& it: mCachedValues) {
+      if (it.mType != typeid(T)) {
+        continue;
+      }
+      if (it.mError) {
+        std::rethrow_exception(it.mError);
+      }
+      return *static_cast<const T*>(it.mValue.get());
+    }
+
+    try {
+      auto value = std::make_shared<const T>(parse());
+      mCachedValues.push_back({typeid(T), value, {}});
+      return *value;
+    } catch (const nlohmann::json::exception&) {
+      mCachedValues.push_back({typeid(T), nullptr, std::current_exception()});
+      throw;
+    }
+  }
+};
+
+using SharedGameEvent = std::shared_ptr<const InternedGameEvent>;
+
+}// namespace OpenKneeboard
@@ -60,6 +60,26 @@ class InterprocessRenderer final
     KneeboardState*);
 
   std::underlying_type_t<SHM::ConsumerKind> GetConsumers() const;
+  std::vector<SHM::ConsumerInfo> GetConsumerInfo() const;
+
+  // We have changes, but no consumers to render them for; we need another
+  // frame, repainting or idle, to check if one has attached
+  Event<> evWorkAvailableEvent;
+
+  struct LayerStatistics {
+    uint64_t mRenders {};
+    // Renders that were requested, but nothing in the layer had changed
+    uint64_t mSkippedRenders {};
+  };
+  struct Statistics {
+    std::array<LayerStatistics, MaxLayers> mLayers {};
+    uint64_t mCommits {};
+    // Nothing in any layer had changed
+    uint64_t mSkippedCommits {};
+  };
+  /// Totals since the renderer was created; rates are also traced every
+  /// second.
+  Statistics GetStatistics() const;
 
  private:
   InterprocessRenderer();
@@ -101,6 +121,12 @@ class InterprocessRenderer final
     winrt::com_ptr<ID3D11ShaderResourceView> mCanvasSRV;
 
     std::array<SharedTextureResources, TextureCount> mSharedResources;
+    // What changed in each of the last `TextureCount` commits, indexed by
+    // texture index; a shared texture needs the union of these to catch up
+    // with the canvas
+    std::array<DamageRegion, TextureCount> mCommitDamage;
+    // Where the cursor was when we last rendered the canvas
+    std::optional<DamageRect> mCursorBounds;
 
     bool mIsActiveForInput = false;
   };
@@ -108,10 +134,21 @@ class InterprocessRenderer final
 
   std::shared_ptr<GameInstance> mCurrentGame;
 
-  std::chrono::steady_clock::time_point mConsumersClearedAt;
-  std::underlying_type_t<SHM::ConsumerKind> mConsumers {};
+  std::chrono::steady_clock::time_point mConsumersReapedAt;
+
+  uint8_t mCommittedLayerCount {0};
+  Statistics mStatistics;
+  Statistics mReportedStatistics;
+  std::chrono::steady_clock::time_point mStatisticsReportedAt;
+  void TraceStatistics(std::chrono::steady_clock::time_point now);
+
+  void OnFrame();
 
   void MarkDirty();
+  // Only mark part of the layer containing the view as changed; `area` is
+  // normalized to 0..1
+  void MarkDirty(const IKneeboardView*, const D2D1_RECT_F& area);
+  void MarkFull(Layer&);
   void RenderNow();
   void Render(RenderTargetID, Layer&);
 
@@ -21,6 +21,8 @@
 
 #include <OpenKneeboard/DXResources.h>
 #include <OpenKneeboard/Events.h>
+#include <OpenKneeboard/FrameScheduler.h>
+#include <OpenKneeboard/GameEventDispatcher.h>
 #include <OpenKneeboard/ProfileSettings.h>
 #include <OpenKneeboard/SHM.h>
 #include <OpenKneeboard/Settings.h>
@@ -44,11 +46,11 @@ class IKneeboardView;
 class InterprocessRenderer;
 class KneeboardView;
 class ITab;
+class PagePrefetcher;
 class TabletInputAdapter;
 class TabsList;
 class UserInputDevice;
 struct BaseSetTabEvent;
-struct GameEvent;
 struct GameInstance;
 class GameEventServer;
 
@@ -80,18 +82,25 @@ class KneeboardState final
 
   Event<> evFrameTimerPrepareEvent;
   Event<> evFrameTimerEvent;
+  // A frame is due, but there's nothing to repaint
+  Event<> evFrameTimerIdleEvent;
+  // `GetNextFrameTime()` is now earlier than it was
+  Event<> evFrameScheduleChangedEvent;
+  // Everything needs repainting; changes to a single view are only
+  // reported by that view's events
   Event<> evNeedsRepaintEvent;
   Event<> evSettingsChangedEvent;
   Event<> evProfileSettingsChangedEvent;
   Event<> evCurrentProfileChangedEvent;
   Event<> evViewOrderChangedEvent;
   Event<> evInputDevicesChangedEvent;
-  Event<GameEvent> evGameEvent;
   Event<DWORD, std::shared_ptr<GameInstance>> evGameChangedEvent;
 
   std::vector<std::shared_ptr<UserInputDevice>> GetInputDevices() const;
 
   GamesList* GetGamesList() const;
+  /// All game events, including those handled by `KneeboardState`
+  GameEventDispatcher* GetGameEventDispatcher();
   std::optional<RunningGame> GetCurrentGame() const;
 
   std::shared_ptr<TabletInputAdapter> GetTabletInputAdapter() const;
@@ -117,6 +126,18 @@ class KneeboardState final
   bool IsRepaintNeeded() const;
   void Repainted();
 
+  /// When to next emit the frame timer events; nullopt if idle
+  std::optional<FrameScheduler::TimePoint> GetNextFrameTime() const;
+  /// Call after `evFrameTimerPrepareEvent`
+  void BeginFrame();
+  /** A captured window has a new frame; thread-safe.
+   *
+   * This is rate-limited separately from other repaints, so the capture
+   * should emit its repaint events from `evFrameTimerPrepareEvent` rather
+   * than immediately.
+   */
+  void SetWindowCaptureFrameAvailable();
+
   /** Implement `Lockable`; use `std::unique_lock`.
    *
    * This:
@@ -140,12 +161,31 @@ class KneeboardState final
   std::shared_mutex mMutex;
   bool mHaveUniqueLock = false;
   bool mNeedsRepaint = false;
+  FrameScheduler mFrameScheduler {
+    AppSettings::FrameRateSettings {}.mMinimumFPS,
+    AppSettings::FrameRateSettings {}.mMaximumFPS,
+  };
+  FrameScheduler::SourceID mRepaintFrameSource {
+    mFrameScheduler.AddSource()};
+  // Capped, as prefetching isn't urgent
+  FrameScheduler::SourceID mPrefetchFrameSource {
+    mFrameScheduler.AddSource(30)};
+  // Capped, as this only polls for SHM consumers attaching
+  FrameScheduler::SourceID mInterprocessRendererFrameSource {
+    mFrameScheduler.AddSource(10)};
+  // Capped, as captured windows update at their own refresh rate
+  FrameScheduler::SourceID mWindowCaptureFrameSource {
+    mFrameScheduler.AddSource(30)};
   winrt::apartment_context mUIThread;
   HWND mHwnd;
   DXResources mDXResources;
   ProfileSettings mProfiles {ProfileSettings::Load()};
   Settings mSettings {Settings::Load(mProfiles.mActiveProfile)};
 
+  // Before the views and tabs, so that it outlives their listeners, such as
+  // the views' FooterUILayer
+  GameEventDispatcher mGameEventDispatcher;
+
   uint8_t mFirstViewIndex = 0;
   uint8_t mInputViewIndex = 0;
   std::array<std::shared_ptr<KneeboardView>, 2> mViews;
@@ -153,6 +193,8 @@ class KneeboardState final
   std::unique_ptr<GamesList> mGamesList;
   std::unique_ptr<TabsList> mTabsList;
   std::shared_ptr<InterprocessRenderer> mInterprocessRenderer;
+  EventHandlerToken mInterprocessRendererWorkToken {};
+  std::unique_ptr<PagePrefetcher> mPagePrefetcher;
   // Initalization and destruction order must match as they both use
   // SetWindowLongPtr
   std::shared_ptr<DirectInputAdapter> mDirectInput;
@@ -165,7 +207,11 @@ class KneeboardState final
   bool mSaveSettingsEnabled = true;
 
   void OnGameChangedEvent(DWORD processID, std::shared_ptr<GameInstance> game);
-  void OnGameEvent(const GameEvent& ev) noexcept;
+  void SetRepaintNeeded();
+  void StartInterprocessRenderer();
+  void StopInterprocessRenderer();
+  void UpdateFrameRates();
+  void OnGameEvent(const SharedGameEvent& ev) noexcept;
 
   void StartOpenVRThread();
   void StartTabletInput();
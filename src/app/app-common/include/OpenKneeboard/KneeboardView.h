@@ -76,6 +76,8 @@ class KneeboardView final : public IKneeboardView,
   virtual std::optional<D2D1_POINT_2F> GetCursorContentPoint() const override;
   virtual D2D1_POINT_2F GetCursorCanvasPoint(
     const D2D1_POINT_2F& contentPoint) const override;
+  virtual std::optional<D2D1_RECT_F> GetCursorCanvasBounds(
+    const D2D1_SIZE_F& canvasSize) const override;
   virtual void PostCursorEvent(const CursorEvent& ev) override;
 
   virtual std::vector<Bookmark> GetBookmarks() const override;
@@ -91,6 +93,9 @@ class KneeboardView final : public IKneeboardView,
 
  private:
   void UpdateUILayers();
+  void OnUILayerNeedsRepaint(IUILayer*);
+  /// What to repaint when the layer changes, normalized to 0..1
+  D2D1_RECT_F GetUILayerRepaintArea(const IUILayer*) const;
   enum class RelativePosition {
     Previous,
     Next,
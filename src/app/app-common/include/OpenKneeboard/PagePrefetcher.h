@@ -0,0 +1,78 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/DXResources.h>
+#include <OpenKneeboard/Events.h>
+#include <OpenKneeboard/PrefetchQueue.h>
+#include <OpenKneeboard/RenderTargetID.h>
+
+#include <shims/winrt/base.h>
+
+#include <d2d1_1.h>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace OpenKneeboard {
+
+class ITabView;
+class KneeboardState;
+
+/** Renders pages next to the ones each view is showing, so that they're
+ * already in the page cache when the user turns the page.
+ *
+ * Work is only done in `evFrameTimerIdleEvent`, one page at a time, so it
+ * never delays a frame that has something to show.
+ */
+class PagePrefetcher final : private EventReceiver {
+ public:
+  PagePrefetcher() = delete;
+  PagePrefetcher(const DXResources&, KneeboardState*);
+  ~PagePrefetcher();
+
+  // There's work to do in the next idle frame
+  Event<> evWorkAvailableEvent;
+
+ private:
+  DXResources mDXR;
+  KneeboardState* mKneeboard {nullptr};
+  std::mutex mQueueMutex;
+  PrefetchQueue mQueue {1};
+
+  struct Owner {
+    std::weak_ptr<ITabView> mTabView;
+    EventHandlerToken mContentChangedToken;
+  };
+  std::unordered_map<PrefetchQueue::OwnerID, Owner> mOwners;
+
+  RenderTargetID mRenderTargetID;
+  // `RenderPage()` needs somewhere to draw, but we only want the side effect
+  // of filling the cache
+  winrt::com_ptr<ID2D1Bitmap1> mTarget;
+
+  void UpdateQueue();
+  void SetTabView(PrefetchQueue::OwnerID, const std::shared_ptr<ITabView>&);
+  void PrefetchNext();
+  void RequestMoreIfNeeded();
+};
+
+}// namespace OpenKneeboard
@@ -31,6 +31,7 @@
 
 #include <OpenKneeboard/DXResources.h>
 #include <OpenKneeboard/Elevation.h>
+#include <OpenKneeboard/FrameScheduler.h>
 #include <OpenKneeboard/GameEvent.h>
 #include <OpenKneeboard/GamesList.h>
 #include <OpenKneeboard/GetMainHWND.h>
@@ -195,16 +196,31 @@ MainWindow::MainWindow() {
 }
 
 winrt::Windows::Foundation::IAsyncAction MainWindow::FrameLoop() {
-  const auto fps = 90;
-  const auto interval = std::chrono::milliseconds(1000 / fps);
-
   const auto cancellationToken = co_await winrt::get_cancellation_token();
   cancellationToken.enable_propagation();
   while (!cancellationToken()) {
     try {
-      co_await winrt::resume_after(interval);
+      const auto next = gKneeboard->GetNextFrameTime();
+      const auto now = FrameScheduler::Clock::now();
+      if (!next) {
+        // Idle until something changes
+        co_await winrt::resume_on_signal(mFrameScheduleChangedEvent.get());
+      } else if (*next > now) {
+        co_await winrt::resume_on_signal(
+          mFrameScheduleChangedEvent.get(),
+          std::chrono::duration_cast<winrt::Windows::Foundation::TimeSpan>(
+            *next - now));
+      } else {
+        // Overdue; still yield, so that the UI stays responsive
+        co_await winrt::resume_background();
+      }
       co_await mUIThread;
-      if (!cancellationToken()) {
+      if (cancellationToken()) {
+        break;
+      }
+      // We might have been woken because the schedule changed
+      const auto due = gKneeboard->GetNextFrameTime();
+      if (due && *due <= FrameScheduler::Clock::now()) {
         this->FrameTick();
       }
     } catch (const winrt::hresult_canceled&) {
@@ -222,9 +238,15 @@ void MainWindow::FrameTick() {
     std::shared_lock kbLock(*gKneeboard);
     TraceLoggingWriteTagged(activity, "Kneeboard locked");
     gKneeboard->evFrameTimerPrepareEvent.Emit();
+    gKneeboard->BeginFrame();
   }
   TraceLoggingWriteTagged(activity, "Prepared to render");
   if (!gKneeboard->IsRepaintNeeded()) {
+    {
+      std::shared_lock kbLock(*gKneeboard);
+      const std::unique_lock dxLock(gDXResources);
+      gKneeboard->evFrameTimerIdleEvent.Emit();
+    }
     TraceLoggingWriteStop(
       activity, "FrameTick", TraceLoggingValue("No repaint needed", "Result"));
     return;
@@ -245,6 +267,11 @@ winrt::fire_and_forget MainWindow::OnLoaded() {
   SetCursor(LoadCursorW(NULL, IDC_ARROW));
   mFrameLoopCompletionEvent
     = Win32::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+  mFrameScheduleChangedEvent
+    = Win32::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+  AddEventListener(gKneeboard->evFrameScheduleChangedEvent, [this]() {
+    SetEvent(mFrameScheduleChangedEvent.get());
+  });
   mFrameLoop = this->FrameLoop();
 
   this->Show();
@@ -500,6 +527,8 @@ winrt::fire_and_forget MainWindow::CleanupAndClose() {
 
   dprint("Stopping frame loop...");
   mFrameLoop.Cancel();
+  // Wake it up if it's idle
+  SetEvent(mFrameScheduleChangedEvent.get());
   co_await winrt::resume_on_signal(mFrameLoopCompletionEvent.get());
   co_await mUIThread;
 
@@ -85,13 +85,14 @@ struct MainWindow : MainWindowT<MainWindow>,
 
   void Show();
 
-  // Used instead of a timer so there is always a positive amount
-  // of time between iterations; this keeps the UI responsive, and
-  // avoids building up a massive backlog of overdue scheduled
-  // events.
+  // Used instead of a timer so that we only wake up when
+  // `KneeboardState`'s frame scheduler wants a frame; this also means we
+  // don't build up a massive backlog of overdue scheduled events.
   winrt::Windows::Foundation::IAsyncAction FrameLoop();
   void FrameTick();
   winrt::handle mFrameLoopCompletionEvent;
+  // Set when the loop needs to re-check the schedule
+  winrt::handle mFrameScheduleChangedEvent;
 
   winrt::fire_and_forget LaunchOpenKneeboardURI(std::string_view);
   winrt::fire_and_forget OnViewOrderChanged();
@@ -37,15 +37,26 @@ OpenKneeboard.EventPrefix = "dcs/"
 function OpenKneeboard.send(name, value)
   OpenKneeboard.sendRaw(OpenKneeboard.EventPrefix..name, value)
 end
-function OpenKneeboard.sendMulti(events)
+function OpenKneeboard.prefixEvents(events)
   local prefixed = {}
   for k,event in ipairs(events) do
     local name, value = unpack(event)
     table.insert(prefixed, { OpenKneeboard.EventPrefix..name, value })
   end
+  return prefixed
+end
+function OpenKneeboard.sendMulti(events)
   OpenKneeboard.sendRaw(
     "MultiEvent",
-    net.lua2json(prefixed)
+    net.lua2json(OpenKneeboard.prefixEvents(events))
+  )
+end
+-- Only sends the values that have changed since the last call, other than
+-- for periodic keyframes, or if `forceKeyframe` is true
+function OpenKneeboard.publishState(events, forceKeyframe)
+  OpenKneeboard.publishStateRaw(
+    OpenKneeboard.prefixEvents(events),
+    forceKeyframe
   )
 end
 
@@ -93,8 +104,8 @@ function updateGeo()
   state.bullseye = Export.LoLoCoordinatesToGeoCoordinates(bullseye.x, bullseye.y)
 end
 
-function sendState()
-  -- Batch up and use sendMulti to reduce the amount of IPC operations
+-- Sends everything unless `changesOnly` is true
+function sendState(changesOnly)
   local events = {
     {"InstallPath", lfs.currentdir()},
     {"SavedGamesPath", lfs.writedir()},
@@ -129,7 +140,8 @@ function sendState()
     events[#events+1] = {"MissionTime", net.lua2json(missionTime)}
   end
 
-  OpenKneeboard.sendMulti(events)
+  -- The native side batches these up to reduce the amount of IPC operations
+  OpenKneeboard.publishState(events, not changesOnly)
 end
 
 --[[
@@ -245,7 +257,7 @@ function callbacks.onSimulationFrame()
     state.aircraft = state.selfData.Name
   end
 
-  sendState()
+  sendState(true)
 end
 
 function sendMessage(message, messageType)
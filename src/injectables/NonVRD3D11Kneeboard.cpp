@@ -84,24 +84,24 @@ HRESULT NonVRD3D11Kneeboard::OnIDXGISwapChain_Present(
 
   LONG left = padding;
   switch (flatConfig.mHorizontalAlignment) {
-    case FlatConfig::HorizontalAlignment::Left:
+    case SHM::FlatLayerConfig::HorizontalAlignment::Left:
       break;
-    case FlatConfig::HorizontalAlignment::Center:
+    case SHM::FlatLayerConfig::HorizontalAlignment::Center:
       left = (canvasWidth - renderWidth) / 2;
       break;
-    case FlatConfig::HorizontalAlignment::Right:
+    case SHM::FlatLayerConfig::HorizontalAlignment::Right:
       left = canvasWidth - (renderWidth + padding);
       break;
   }
 
   LONG top = padding;
   switch (flatConfig.mVerticalAlignment) {
-    case FlatConfig::VerticalAlignment::Top:
+    case SHM::FlatLayerConfig::VerticalAlignment::Top:
       break;
-    case FlatConfig::VerticalAlignment::Middle:
+    case SHM::FlatLayerConfig::VerticalAlignment::Middle:
       top = (canvasHeight - renderHeight) / 2;
       break;
-    case FlatConfig::VerticalAlignment::Bottom:
+    case SHM::FlatLayerConfig::VerticalAlignment::Bottom:
       top = canvasHeight - (renderHeight + padding);
       break;
   }
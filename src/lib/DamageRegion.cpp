@@ -0,0 +1,154 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/DamageRegion.h>
+
+#include <algorithm>
+
+namespace OpenKneeboard {
+
+bool DamageRect::Touches(const DamageRect& other) const noexcept {
+  return mLeft <= other.mRight && other.mLeft <= mRight
+    && mTop <= other.mBottom && other.mTop <= mBottom;
+}
+
+bool DamageRect::Contains(const DamageRect& other) const noexcept {
+  return mLeft <= other.mLeft && mTop <= other.mTop
+    && mRight >= other.mRight && mBottom >= other.mBottom;
+}
+
+DamageRect DamageRect::Union(const DamageRect& other) const noexcept {
+  if (this->IsEmpty()) {
+    return other;
+  }
+  if (other.IsEmpty()) {
+    return *this;
+  }
+  return {
+    std::min(mLeft, other.mLeft),
+    std::min(mTop, other.mTop),
+    std::max(mRight, other.mRight),
+    std::max(mBottom, other.mBottom),
+  };
+}
+
+DamageRect DamageRect::Intersection(const DamageRect& other) const noexcept {
+  DamageRect ret {
+    std::max(mLeft, other.mLeft),
+    std::max(mTop, other.mTop),
+    std::min(mRight, other.mRight),
+    std::min(mBottom, other.mBottom),
+  };
+  if (ret.IsEmpty()) {
+    return {};
+  }
+  return ret;
+}
+
+void DamageRegion::Add(const DamageRect& rect) noexcept {
+  if (mIsFull || rect.IsEmpty()) {
+    return;
+  }
+
+  auto merged = rect;
+  // Merging two rects can make the result touch a rect we've already
+  // checked, so start again whenever we merge
+  for (uint8_t i = 0; i < mRectCount;) {
+    const auto& existing = mRects[i];
+    if (existing.Contains(merged)) {
+      return;
+    }
+    if (existing.Touches(merged)) {
+      merged = merged.Union(existing);
+      this->Remove(i);
+      i = 0;
+      continue;
+    }
+    ++i;
+  }
+
+  if (mRectCount == MaxRects) {
+    this->MarkFull();
+    return;
+  }
+  mRects[mRectCount++] = merged;
+}
+
+void DamageRegion::Add(const DamageRegion& other) noexcept {
+  if (other.mIsFull) {
+    this->MarkFull();
+    return;
+  }
+  for (const auto& rect: other.GetRects()) {
+    this->Add(rect);
+  }
+}
+
+void DamageRegion::MarkFull() noexcept {
+  *this = Full();
+}
+
+void DamageRegion::Clear() noexcept {
+  *this = {};
+}
+
+void DamageRegion::ClipTo(uint16_t width, uint16_t height) noexcept {
+  if (mIsFull) {
+    return;
+  }
+
+  const DamageRect bounds {0, 0, width, height};
+  for (uint8_t i = 0; i < mRectCount;) {
+    auto& rect = mRects[i];
+    rect = rect.Intersection(bounds);
+    if (rect.IsEmpty()) {
+      this->Remove(i);
+      continue;
+    }
+    ++i;
+  }
+}
+
+bool DamageRegion::IsEmpty() const noexcept {
+  return (!mIsFull) && mRectCount == 0;
+}
+
+bool DamageRegion::IsFull() const noexcept {
+  return mIsFull;
+}
+
+std::span<const DamageRect> DamageRegion::GetRects() const noexcept {
+  return {mRects, mRectCount};
+}
+
+DamageRect DamageRegion::GetBounds() const noexcept {
+  DamageRect ret {};
+  for (const auto& rect: this->GetRects()) {
+    ret = ret.Union(rect);
+  }
+  return ret;
+}
+
+void DamageRegion::Remove(uint8_t index) noexcept {
+  // Order doesn't matter, so just swap in the last one
+  mRects[index] = mRects[mRectCount - 1];
+  mRects[--mRectCount] = {};
+}
+
+}// namespace OpenKneeboard
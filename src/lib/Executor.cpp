@@ -0,0 +1,66 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/Executor.h>
+
+namespace OpenKneeboard {
+
+std::shared_ptr<Executor> Executor::Create(WakeCallback wake) {
+  return std::shared_ptr<Executor>(new Executor(std::move(wake)));
+}
+
+Executor::Executor(WakeCallback wake) : mWake(std::move(wake)) {
+}
+
+Executor::~Executor() = default;
+
+void Executor::Post(Task task) {
+  mTasks.Push(std::move(task));
+  mPostCount.fetch_add(1, std::memory_order_release);
+  // This must be after the push: if `Drain()` has already cleared the flag,
+  // we need to wake it again so it sees our task
+  if (!mWakePending.exchange(true)) {
+    mWake(weak_from_this());
+  }
+}
+
+size_t Executor::Drain() {
+  // Clear before popping: anything pushed after this will wake us again
+  mWakePending.store(false);
+
+  // Only run tasks whose `Post()` had pushed them before we started; they're
+  // the oldest in the queue, so this is a prefix of it. Later tasks set
+  // `mWakePending` again, so they'll be run after the next wake-up.
+  const auto pending = mPostCount.load(std::memory_order_acquire) - mRunCount;
+
+  size_t count = 0;
+  while (count < pending) {
+    auto task = mTasks.TryPop();
+    if (!task) {
+      // Hidden behind a push that's in progress; that `Post()` will wake us
+      break;
+    }
+    ++mRunCount;
+    ++count;
+    (*task)();
+  }
+  return count;
+}
+
+}// namespace OpenKneeboard
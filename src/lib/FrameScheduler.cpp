@@ -0,0 +1,118 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/FrameScheduler.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace OpenKneeboard {
+
+static FrameScheduler::Duration ToInterval(float fps) {
+  return std::chrono::duration_cast<FrameScheduler::Duration>(
+    std::chrono::duration<float>(1.0f / fps));
+}
+
+FrameScheduler::FrameScheduler(float minFPS, float maxFPS) {
+  this->SetFramesPerSecond(minFPS, maxFPS);
+}
+
+void FrameScheduler::SetFramesPerSecond(float minFPS, float maxFPS) {
+  if (maxFPS <= 0 || minFPS < 0 || minFPS > maxFPS) {
+    throw std::logic_error("Frame rates must be 0 <= min <= max, and max > 0");
+  }
+
+  const std::unique_lock lock(mMutex);
+  mMinInterval = ToInterval(maxFPS);
+  if (minFPS > 0) {
+    mMaxInterval = ToInterval(minFPS);
+  } else {
+    mMaxInterval = {};
+  }
+}
+
+FrameScheduler::SourceID FrameScheduler::AddSource(float maxFPS) {
+  const std::unique_lock lock(mMutex);
+  mSources.push_back({
+    .mMinInterval = (maxFPS > 0) ? ToInterval(maxFPS) : Duration::zero(),
+  });
+  return mSources.size() - 1;
+}
+
+bool FrameScheduler::MarkDirty(SourceID id) {
+  const std::unique_lock lock(mMutex);
+  auto& source = mSources.at(id);
+  if (source.mIsDirty) {
+    return false;
+  }
+
+  const auto before = this->GetNextFrameTimeLocked();
+  source.mIsDirty = true;
+  const auto after = this->GetNextFrameTimeLocked();
+  return after && ((!before) || *after < *before);
+}
+
+std::optional<FrameScheduler::TimePoint> FrameScheduler::GetNextFrameTime()
+  const {
+  const std::unique_lock lock(mMutex);
+  return this->GetNextFrameTimeLocked();
+}
+
+std::optional<FrameScheduler::TimePoint>
+FrameScheduler::GetNextFrameTimeLocked() const {
+  std::optional<TimePoint> ret;
+  for (const auto& source: mSources) {
+    if (!source.mIsDirty) {
+      continue;
+    }
+    const auto readyAt = source.mServicedAt + source.mMinInterval;
+    if ((!ret) || readyAt < *ret) {
+      ret = readyAt;
+    }
+  }
+
+  if (ret) {
+    return std::max(*ret, mLastFrameAt + mMinInterval);
+  }
+  if (mMaxInterval) {
+    return mLastFrameAt + *mMaxInterval;
+  }
+  return {};
+}
+
+bool FrameScheduler::BeginFrame(TimePoint now) {
+  const std::unique_lock lock(mMutex);
+  mLastFrameAt = now;
+
+  bool ret = false;
+  for (auto& source: mSources) {
+    if (!source.mIsDirty) {
+      continue;
+    }
+    if (source.mServicedAt + source.mMinInterval > now) {
+      continue;
+    }
+    source.mIsDirty = false;
+    source.mServicedAt = now;
+    ret = true;
+  }
+  return ret;
+}
+
+}// namespace OpenKneeboard
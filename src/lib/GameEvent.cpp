@@ -18,7 +18,8 @@
  * USA.
  */
 #include <OpenKneeboard/GameEvent.h>
-#include <OpenKneeboard/Win32.h>
+#include <OpenKneeboard/GameEventMailslot.h>
+#include <OpenKneeboard/GameEventSendQueue.h>
 
 #include <OpenKneeboard/config.h>
 #include <OpenKneeboard/dprint.h>
@@ -29,85 +30,92 @@
 
 #include <Windows.h>
 
-#include <charconv>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <mutex>
 #include <string_view>
 
-static uint32_t hex_to_ui32(const std::string_view& sv) {
-  if (sv.empty()) {
-    return 0;
-  }
+namespace OpenKneeboard {
 
-  uint32_t value = 0;
-  std::from_chars(&sv.front(), &sv.front() + sv.length(), value, 16);
-  return value;
-}
+namespace {
 
-static winrt::file_handle gMailslotHandle;
+/// Null until first use, then defaults to the mailslot
+std::atomic<std::shared_ptr<IGameEventSender>> gSender;
 
-static bool OpenMailslotHandle() {
-  if (gMailslotHandle) {
-    return true;
+std::shared_ptr<IGameEventSender> GetSender() {
+  if (auto sender = gSender.load()) {
+    return sender;
   }
-
-  static std::chrono::steady_clock::time_point sLastAttempt {};
-  const auto now = std::chrono::steady_clock::now();
-  if (now - sLastAttempt < std::chrono::seconds(1)) {
-    return false;
+  std::shared_ptr<IGameEventSender> expected;
+  std::shared_ptr<IGameEventSender> sender
+    = std::make_shared<MailslotGameEventSender>();
+  if (gSender.compare_exchange_strong(expected, sender)) {
+    return sender;
   }
-  sLastAttempt = now;
-
-  gMailslotHandle = OpenKneeboard::Win32::CreateFileW(
-    OpenKneeboard::GameEvent::GetMailslotPath(),
-    GENERIC_WRITE,
-    FILE_SHARE_READ,
-    nullptr,
-    OPEN_EXISTING,
-    0,
-    NULL);
-
-  return static_cast<bool>(gMailslotHandle);
+  // Another thread got there first
+  return expected;
 }
 
-namespace OpenKneeboard {
-
-#define CHECK_PACKET(condition) \
-  if (!(condition)) { \
-    dprintf("Check failed at {}:{}: {}", __FILE__, __LINE__, #condition); \
-    return {}; \
-  }
-
-GameEvent::operator bool() const {
-  return !(name.empty() || value.empty());
+/// Returns a description of the result, for tracing
+const char* SendPacket(std::span<const std::byte> packet) {
+  return GetSender()->Send(packet) ? "Success" : "Error";
 }
 
-GameEvent GameEvent::Unserialize(std::string_view packet) {
-  // "{:08x}!{}!{:08x}!{}!", name size, name, value size, value
-  CHECK_PACKET(packet.ends_with("!"));
-  CHECK_PACKET(packet.size() >= sizeof("12345678!!12345678!!") - 1);
+// Only the latest value matters, so these can be merged if the async send
+// queue is backed up
+bool IsStateEvent(std::string_view name) {
+  constexpr std::string_view stateEvents[] {
+    "dcs/Aircraft",
+    "dcs/InstallPath",
+    "dcs/Mission",
+    "dcs/MissionTime",
+    "dcs/Origin",
+    "dcs/SelfData",
+    "dcs/SavedGamesPath",
+    "dcs/Terrain",
+  };
+  return std::ranges::find(stateEvents, name) != std::end(stateEvents);
+}
 
-  const auto nameLen = hex_to_ui32(packet.substr(0, 8));
-  CHECK_PACKET(packet.size() >= 8 + nameLen + 8 + 4);
-  const uint32_t nameOffset = 9;
-  const std::string name(packet.substr(nameOffset, nameLen));
+GameEventSendQueue& GetAsyncSendQueue() {
+  static GameEventSendQueue sQueue {
+    /* capacity = */ 1024,
+    /* maxEventsPerPacket = */ 64,
+    &IsStateEvent,
+  };
+  return sQueue;
+}
 
-  const uint32_t valueLenOffset = nameOffset + nameLen + 1;
-  CHECK_PACKET(packet.size() >= valueLenOffset + 10);
-  const auto valueLen = hex_to_ui32(packet.substr(valueLenOffset, 8));
-  const uint32_t valueOffset = valueLenOffset + 8 + 1;
-  CHECK_PACKET(packet.size() == valueOffset + valueLen + 1);
-  const std::string value(packet.substr(valueOffset, valueLen));
+std::atomic_flag gAsyncFlushPending;
 
-  return {name, value};
+void CALLBACK AsyncFlushCallback(PTP_CALLBACK_INSTANCE, void*) {
+  // Clear before flushing: anything queued after this needs another flush.
+  // That flush may overlap with this one, but the queue serializes them.
+  gAsyncFlushPending.clear();
+  GameEvent::FlushAsyncSends();
 }
 
-std::vector<std::byte> GameEvent::Serialize() const {
-  const auto str = std::format(
-    "{:08x}!{}!{:08x}!{}!", name.size(), name, value.size(), value);
-  const auto first = reinterpret_cast<const std::byte*>(str.data());
-  return {first, first + str.size()};
+PTP_CALLBACK_ENVIRON GetAsyncFlushCallbackEnvironment() {
+  static TP_CALLBACK_ENVIRON sEnvironment {};
+  static std::once_flag sOnce;
+  std::call_once(sOnce, []() {
+    InitializeThreadpoolEnvironment(&sEnvironment);
+    // Keep this module loaded until pending callbacks have finished, even
+    // if whoever loaded us - e.g. Lua - unloads it
+    HMODULE thisModule {};
+    GetModuleHandleExW(
+      GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+        | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+      reinterpret_cast<LPCWSTR>(&AsyncFlushCallback),
+      &thisModule);
+    SetThreadpoolCallbackLibrary(&sEnvironment, thisModule);
+  });
+  return &sEnvironment;
 }
 
+}// namespace
+
 void GameEvent::Send() const {
   TraceLoggingThreadActivity<gTraceProvider> activity;
   TraceLoggingWriteStart(
@@ -115,61 +123,54 @@ void GameEvent::Send() const {
     "GameEvent::Send()",
     TraceLoggingValue(this->name.c_str(), "Name"),
     TraceLoggingBinary(this->value.c_str(), this->value.size(), "Value"));
+  const auto result = SendPacket(this->Serialize());
+  TraceLoggingWriteStop(
+    activity, "GameEvent::Send()", TraceLoggingValue(result, "Result"));
+}
 
-  if (!OpenMailslotHandle()) {
-    TraceLoggingWriteStop(
-      activity,
-      "GameEvent::Send()",
-      TraceLoggingValue("Couldn't open mailslot", "Result"));
-    return;
+void GameEvent::SendAsync() const {
+  if (!GetAsyncSendQueue().Push(*this)) {
+    TraceLoggingWrite(
+      gTraceProvider,
+      "GameEvent::SendAsync()/Dropped",
+      TraceLoggingValue(this->name.c_str(), "Name"));
   }
-  const auto packet = this->Serialize();
-
-  if (WriteFile(
-        gMailslotHandle.get(),
-        packet.data(),
-        static_cast<DWORD>(packet.size()),
-        nullptr,
-        nullptr)) {
-    TraceLoggingWriteStop(
-      activity, "GameEvent::Send()", TraceLoggingValue("Success", "Result"));
+  if (gAsyncFlushPending.test_and_set()) {
     return;
   }
+  if (!TrySubmitThreadpoolCallback(
+        &AsyncFlushCallback, nullptr, GetAsyncFlushCallbackEnvironment())) {
+    gAsyncFlushPending.clear();
+    dprintf("Failed to submit GameEvent flush: {}", GetLastError());
+  }
+}
 
-  gMailslotHandle.close();
-  gMailslotHandle = {};
-  TraceLoggingWriteTagged(activity, "Closed handle");
-
-  if (!OpenMailslotHandle()) {
-    TraceLoggingWriteStop(
+void GameEvent::FlushAsyncSends() {
+  GetAsyncSendQueue().Flush([](std::span<const std::byte> packet) {
+    TraceLoggingThreadActivity<gTraceProvider> activity;
+    TraceLoggingWriteStart(
       activity,
-      "GameEvent::Send()",
-      TraceLoggingValue("Couldn't reopen handle", "Result"));
-    return;
-  }
-  TraceLoggingWriteTagged(activity, "Reopened handle");
-  if (WriteFile(
-        gMailslotHandle.get(),
-        packet.data(),
-        static_cast<DWORD>(packet.size()),
-        nullptr,
-        nullptr)) {
-    TraceLoggingWriteStop(
-      activity, "GameEvent::Send()", TraceLoggingValue("Success", "Result"));
-  } else {
+      "GameEvent::FlushAsyncSends()",
+      TraceLoggingValue(packet.size(), "Bytes"));
+    const auto result = SendPacket(packet);
     TraceLoggingWriteStop(
       activity,
-      "GameEvent::Send()",
-      TraceLoggingValue("Error", "Result"),
-      TraceLoggingValue(GetLastError(), "Error"));
-  }
+      "GameEvent::FlushAsyncSends()",
+      TraceLoggingValue(result, "Result"));
+  });
+}
+
+void GameEvent::SetSender(std::shared_ptr<IGameEventSender> sender) {
+  gSender.store(std::move(sender));
 }
 
 const wchar_t* GameEvent::GetMailslotPath() {
   static std::wstring sPath;
   if (sPath.empty()) {
+    // Bumped whenever the wire format changes, so that old senders and
+    // receivers don't see packets they can't parse
     sPath = std::format(
-      L"\\\\.\\mailslot\\{}.events.v1.3", OpenKneeboard::ProjectNameW);
+      L"\\\\.\\mailslot\\{}.events.v2", OpenKneeboard::ProjectNameW);
   }
   return sPath.c_str();
 }
@@ -0,0 +1,77 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventDeltaEncoder.h>
+
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+namespace OpenKneeboard {
+
+GameEventDeltaEncoder::GameEventDeltaEncoder(size_t keyframeInterval)
+  : mKeyframeInterval(keyframeInterval) {
+  if (keyframeInterval == 0) {
+    throw std::logic_error("GameEventDeltaEncoder interval must be non-zero");
+  }
+}
+
+std::vector<GameEvent> GameEventDeltaEncoder::Update(
+  std::span<const GameEvent> state) {
+  ++mStatistics.mUpdates;
+  const auto isKeyframe = (mUpdatesUntilKeyframe == 0);
+  if (isKeyframe) {
+    ++mStatistics.mKeyframes;
+    mUpdatesUntilKeyframe = mKeyframeInterval;
+  }
+  --mUpdatesUntilKeyframe;
+
+  std::vector<GameEvent> ret;
+  std::unordered_set<std::string_view> seen;
+  for (const auto& event: state) {
+    seen.insert(event.name);
+    auto it = mLastSent.find(event.name);
+    if (it == mLastSent.end()) {
+      mLastSent.emplace(event.name, event.value);
+    } else if (isKeyframe || it->second != event.value) {
+      it->second = event.value;
+    } else {
+      ++mStatistics.mSkipped;
+      continue;
+    }
+    ret.push_back(event);
+  }
+
+  std::erase_if(
+    mLastSent, [&seen](const auto& it) { return !seen.contains(it.first); });
+
+  mStatistics.mSent += ret.size();
+  return ret;
+}
+
+void GameEventDeltaEncoder::ForceKeyframe() {
+  mUpdatesUntilKeyframe = 0;
+}
+
+GameEventDeltaEncoder::Statistics GameEventDeltaEncoder::GetStatistics()
+  const {
+  return mStatistics;
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,163 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventLoadGenerator.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <string_view>
+
+namespace OpenKneeboard {
+
+GameEventLoadGenerator::GameEventLoadGenerator(
+  const GameEventLoadProfile& profile,
+  uint32_t seed)
+  : mProfile(profile), mRandom(seed) {
+  if (!(profile.mEventsPerSecond > 0)) {
+    throw std::logic_error("Load profile rate must be positive");
+  }
+  if (profile.mBurstSize == 0) {
+    throw std::logic_error("Load profile burst size must be non-zero");
+  }
+  if (profile.mMinPayloadBytes > profile.mMaxPayloadBytes) {
+    throw std::logic_error("Load profile payload sizes are reversed");
+  }
+}
+
+std::optional<GameEventLoadGenerator::Burst>
+GameEventLoadGenerator::NextBurst() {
+  const std::chrono::duration<double> interval {
+    mProfile.mBurstSize / mProfile.mEventsPerSecond};
+  const auto dueAt
+    = std::chrono::duration_cast<Clock::duration>(interval * mBurstCount);
+  if (dueAt >= mProfile.mDuration) {
+    return std::nullopt;
+  }
+  ++mBurstCount;
+  return Burst {dueAt, mProfile.mBurstSize};
+}
+
+size_t GameEventLoadGenerator::GetNextPayloadSize() {
+  const auto min = mProfile.mMinPayloadBytes;
+  const auto max = mProfile.mMaxPayloadBytes;
+  if (min == max) {
+    return min;
+  }
+  switch (mProfile.mPayloadDistribution) {
+    case GameEventLoadProfile::PayloadDistribution::Uniform:
+      return std::uniform_int_distribution<size_t>(min, max)(mRandom);
+    case GameEventLoadProfile::PayloadDistribution::LogUniform: {
+      std::uniform_real_distribution<double> exponent(
+        std::log(static_cast<double>(std::max<size_t>(min, 1))),
+        std::log(static_cast<double>(max)));
+      return std::clamp<size_t>(
+        static_cast<size_t>(std::exp(exponent(mRandom))), min, max);
+    }
+  }
+  return min;
+}
+
+GameEvent GameEventLoadGenerator::CreateEvent(Clock::time_point sentAt) {
+  // "<sequence> <sentAt> " then padding; the numbers take at most 42 bytes
+  std::string value(std::max<size_t>(GetNextPayloadSize(), 48), '.');
+  const auto last = value.data() + value.size();
+  auto end = std::to_chars(value.data(), last, mCreatedCount++).ptr;
+  *end++ = ' ';
+  end = std::to_chars(end, last, sentAt.time_since_epoch().count()).ptr;
+  *end = ' ';
+  return {EventName, std::move(value)};
+}
+
+uint64_t GameEventLoadGenerator::GetCreatedCount() const {
+  return mCreatedCount;
+}
+
+bool GameEventDeliveryStats::Record(
+  const GameEvent& event,
+  Clock::time_point receivedAt) {
+  if (event.name != GameEventLoadGenerator::EventName) {
+    return false;
+  }
+
+  const auto begin = event.value.data();
+  const auto end = begin + event.value.size();
+  uint64_t sequence {};
+  Clock::rep sentAt {};
+  auto result = std::from_chars(begin, end, sequence);
+  if (result.ec != std::errc {} || result.ptr == end || *result.ptr != ' ') {
+    return false;
+  }
+  result = std::from_chars(result.ptr + 1, end, sentAt);
+  if (result.ec != std::errc {}) {
+    return false;
+  }
+
+  if (sequence >= mSeen.size()) {
+    mSeen.resize(sequence + 1);
+  }
+  if (mSeen[sequence]) {
+    ++mDuplicates;
+    return true;
+  }
+  mSeen[sequence] = true;
+  if (mLastSequence && sequence < *mLastSequence) {
+    ++mOutOfOrder;
+  }
+  mLastSequence = sequence;
+
+  mLatencies.push_back(
+    receivedAt - Clock::time_point {Clock::duration {sentAt}});
+  return true;
+}
+
+uint64_t GameEventDeliveryStats::GetReceivedCount() const {
+  return mLatencies.size();
+}
+
+GameEventDeliveryStats::Summary GameEventDeliveryStats::Summarize(
+  uint64_t sentCount) const {
+  Summary ret {
+    .mSent = sentCount,
+    .mReceived = mLatencies.size(),
+    .mDropped = sentCount - std::min<uint64_t>(sentCount, mLatencies.size()),
+    .mDuplicates = mDuplicates,
+    .mOutOfOrder = mOutOfOrder,
+  };
+  if (mLatencies.empty()) {
+    return ret;
+  }
+
+  auto latencies = mLatencies;
+  const auto percentile = [&latencies](double p) {
+    const auto index = std::min(
+      latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+    std::ranges::nth_element(latencies, latencies.begin() + index);
+    return latencies.at(index);
+  };
+  ret.mP50 = percentile(0.5);
+  ret.mP90 = percentile(0.9);
+  ret.mP99 = percentile(0.99);
+  ret.mP999 = percentile(0.999);
+  ret.mMax = std::ranges::max(latencies);
+  return ret;
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,141 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEvent.h>
+#include <OpenKneeboard/GameEventMailslot.h>
+#include <OpenKneeboard/Win32.h>
+
+#include <Windows.h>
+
+namespace OpenKneeboard {
+
+MailslotGameEventSender::MailslotGameEventSender()
+  : MailslotGameEventSender(GameEvent::GetMailslotPath()) {
+}
+
+MailslotGameEventSender::MailslotGameEventSender(std::wstring path)
+  : mPath(std::move(path)) {
+}
+
+MailslotGameEventSender::~MailslotGameEventSender() = default;
+
+bool MailslotGameEventSender::OpenHandle() {
+  if (mHandle) {
+    return true;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - mLastOpenAttempt < std::chrono::seconds(1)) {
+    return false;
+  }
+  mLastOpenAttempt = now;
+
+  mHandle = Win32::CreateFileW(
+    mPath.c_str(),
+    GENERIC_WRITE,
+    FILE_SHARE_READ,
+    nullptr,
+    OPEN_EXISTING,
+    0,
+    NULL);
+
+  return static_cast<bool>(mHandle);
+}
+
+bool MailslotGameEventSender::Send(std::span<const std::byte> packet) {
+  const std::unique_lock lock(mMutex);
+  if (!OpenHandle()) {
+    return false;
+  }
+
+  if (WriteFile(
+        mHandle.get(),
+        packet.data(),
+        static_cast<DWORD>(packet.size()),
+        nullptr,
+        nullptr)) {
+    return true;
+  }
+
+  // The receiver may have restarted, so try again with a new handle
+  mHandle.close();
+  mHandle = {};
+  if (!OpenHandle()) {
+    return false;
+  }
+  return WriteFile(
+    mHandle.get(),
+    packet.data(),
+    static_cast<DWORD>(packet.size()),
+    nullptr,
+    nullptr);
+}
+
+MailslotGameEventReceiver::MailslotGameEventReceiver(std::wstring path) {
+  mHandle
+    = Win32::CreateMailslotW(path.c_str(), 0, MAILSLOT_WAIT_FOREVER, nullptr);
+  if (!mHandle) {
+    winrt::throw_last_error();
+  }
+}
+
+MailslotGameEventReceiver::~MailslotGameEventReceiver() = default;
+
+std::optional<std::vector<std::byte>> MailslotGameEventReceiver::Receive(
+  std::chrono::milliseconds timeout) {
+  winrt::check_bool(
+    SetMailslotInfo(mHandle.get(), static_cast<DWORD>(timeout.count())));
+
+  // If there's no message yet, guess; if the buffer is too small, the
+  // message stays queued and we retry with the right size
+  DWORD bufferSize {MAILSLOT_NO_MESSAGE};
+  if (
+    (!GetMailslotInfo(mHandle.get(), nullptr, &bufferSize, nullptr, nullptr))
+    || bufferSize == MAILSLOT_NO_MESSAGE || bufferSize == 0) {
+    bufferSize = 4096;
+  }
+  std::vector<std::byte> buffer(bufferSize);
+  while (true) {
+    DWORD bytesRead {};
+    if (ReadFile(
+          mHandle.get(),
+          buffer.data(),
+          static_cast<DWORD>(buffer.size()),
+          &bytesRead,
+          nullptr)) {
+      buffer.resize(bytesRead);
+      return buffer;
+    }
+
+    const auto error = GetLastError();
+    if (error == ERROR_SEM_TIMEOUT) {
+      return std::nullopt;
+    }
+    DWORD nextSize {};
+    if (
+      error != ERROR_INSUFFICIENT_BUFFER
+      || !GetMailslotInfo(mHandle.get(), nullptr, &nextSize, nullptr, nullptr)
+      || nextSize == MAILSLOT_NO_MESSAGE) {
+      winrt::throw_hresult(HRESULT_FROM_WIN32(error));
+    }
+    buffer.resize(nextSize);
+  }
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,382 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2022 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEvent.h>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+static std::optional<uint32_t> hex_to_ui32(const std::string_view& sv) {
+  if (sv.empty()) {
+    return {};
+  }
+
+  uint32_t value = 0;
+  const auto end = &sv.front() + sv.length();
+  const auto [ptr, ec] = std::from_chars(&sv.front(), end, value, 16);
+  if (ec != std::errc {} || ptr != end) {
+    return {};
+  }
+  return value;
+}
+
+namespace OpenKneeboard {
+
+// Callers report invalid packets; this is also used where there's no
+// `dprint()`
+#define CHECK_PACKET(condition) \
+  if (!(condition)) { \
+    return {}; \
+  }
+
+GameEvent::operator bool() const {
+  return !(name.empty() || value.empty());
+}
+
+/* v2 wire format: a `PacketHeader`, the name (unless it's interned), then
+ * the value.
+ *
+ * The header is in native byte order; it's only sent between processes on
+ * the same machine.
+ */
+namespace {
+
+constexpr uint8_t WireFormatVersion = 2;
+// Can't be the start of a v1 packet, which starts with hex digits
+constexpr char PacketMagic[4] {'\0', 'O', 'K', 'E'};
+
+enum PacketFlags : uint8_t {
+  PACKET_FLAG_INTERNED_NAME = 1 << 0,
+  PACKET_FLAG_PACKED_VALUE = 1 << 1,
+};
+
+struct PacketHeader final {
+  char mMagic[4];
+  uint8_t mVersion;
+  uint8_t mFlags;
+  // Index in `InternedNames` if PACKET_FLAG_INTERNED_NAME is set
+  uint16_t mNameID;
+  uint32_t mNameSize;
+  uint32_t mValueSize;
+};
+static_assert(sizeof(PacketHeader) == 16);
+
+// The index is part of the wire format: only ever append to this list.
+// The DCS names are duplicated here to avoid depending on the games library.
+constexpr std::string_view InternedNames[] {
+  GameEvent::EVT_MULTI_EVENT,
+  GameEvent::EVT_REMOTE_USER_ACTION,
+  GameEvent::EVT_SET_INPUT_FOCUS,
+  GameEvent::EVT_SET_TAB_BY_ID,
+  GameEvent::EVT_SET_TAB_BY_NAME,
+  GameEvent::EVT_SET_TAB_BY_INDEX,
+  GameEvent::EVT_SET_PROFILE_BY_ID,
+  GameEvent::EVT_SET_PROFILE_BY_NAME,
+  GameEvent::EVT_SET_BRIGHTNESS,
+  "dcs/Aircraft",
+  "dcs/InstallPath",
+  "dcs/Mission",
+  "dcs/MissionTime",
+  "dcs/Origin",
+  "dcs/SelfData",
+  "dcs/Message",
+  "dcs/SavedGamesPath",
+  "dcs/SimulationStart",
+  "dcs/Terrain",
+};
+
+std::optional<uint16_t> GetInternedNameID(std::string_view name) {
+  for (uint16_t i = 0; i < std::size(InternedNames); ++i) {
+    if (InternedNames[i] == name) {
+      return i;
+    }
+  }
+  return {};
+}
+
+void AppendPacket(
+  std::vector<std::byte>* out,
+  std::string_view name,
+  std::span<const std::byte> value,
+  uint8_t flags) {
+  PacketHeader header {
+    .mVersion = WireFormatVersion,
+    .mFlags = flags,
+    .mValueSize = static_cast<uint32_t>(value.size()),
+  };
+  std::ranges::copy(PacketMagic, header.mMagic);
+  const auto nameID = GetInternedNameID(name);
+  if (nameID) {
+    header.mFlags |= PACKET_FLAG_INTERNED_NAME;
+    header.mNameID = *nameID;
+    name = {};
+  }
+  header.mNameSize = static_cast<uint32_t>(name.size());
+
+  const auto headerBytes = reinterpret_cast<const std::byte*>(&header);
+  const auto nameBytes = reinterpret_cast<const std::byte*>(name.data());
+  out->reserve(out->size() + sizeof(header) + name.size() + value.size());
+  out->insert(out->end(), headerBytes, headerBytes + sizeof(header));
+  out->insert(out->end(), nameBytes, nameBytes + name.size());
+  out->insert(out->end(), value.begin(), value.end());
+}
+
+std::span<const std::byte> AsBytes(std::string_view str) {
+  return std::as_bytes(std::span {str.data(), str.size()});
+}
+
+}// namespace
+
+std::optional<GameEventView> GameEventView::ParseNext(
+  std::string_view* packed) {
+  PacketHeader header;
+  if (packed->size() < sizeof(header)) {
+    return {};
+  }
+  memcpy(&header, packed->data(), sizeof(header));
+  CHECK_PACKET(std::ranges::equal(header.mMagic, PacketMagic));
+  CHECK_PACKET(header.mVersion == WireFormatVersion);
+
+  auto remaining = packed->substr(sizeof(header));
+  CHECK_PACKET(header.mNameSize <= remaining.size());
+  GameEventView ret {
+    .name = remaining.substr(0, header.mNameSize),
+    .isPacked = static_cast<bool>(header.mFlags & PACKET_FLAG_PACKED_VALUE),
+  };
+  remaining.remove_prefix(header.mNameSize);
+  CHECK_PACKET(header.mValueSize <= remaining.size());
+  ret.value = remaining.substr(0, header.mValueSize);
+  remaining.remove_prefix(header.mValueSize);
+
+  if (header.mFlags & PACKET_FLAG_INTERNED_NAME) {
+    CHECK_PACKET(header.mNameSize == 0);
+    CHECK_PACKET(header.mNameID < std::size(InternedNames));
+    ret.name = InternedNames[header.mNameID];
+  }
+  CHECK_PACKET(!ret.name.empty());
+
+  *packed = remaining;
+  return ret;
+}
+
+std::optional<GameEventView> GameEventView::Parse(std::string_view packet) {
+  if (packet.starts_with(std::string_view {PacketMagic, 1})) {
+    const auto ret = ParseNext(&packet);
+    CHECK_PACKET(packet.empty());
+    return ret;
+  }
+
+  // v1: "{:08x}!{}!{:08x}!{}!", name size, name, value size, value
+  CHECK_PACKET(packet.ends_with("!"));
+  CHECK_PACKET(packet.size() >= sizeof("12345678!!12345678!!") - 1);
+
+  const auto nameLen = hex_to_ui32(packet.substr(0, 8));
+  CHECK_PACKET(nameLen && *nameLen > 0);
+  CHECK_PACKET(packet.size() >= size_t {8} + *nameLen + 8 + 4);
+  const uint32_t nameOffset = 9;
+  const auto name = packet.substr(nameOffset, *nameLen);
+
+  const uint32_t valueLenOffset = nameOffset + *nameLen + 1;
+  CHECK_PACKET(packet.size() >= valueLenOffset + 10);
+  const auto valueLen = hex_to_ui32(packet.substr(valueLenOffset, 8));
+  CHECK_PACKET(valueLen);
+  const uint32_t valueOffset = valueLenOffset + 8 + 1;
+  CHECK_PACKET(packet.size() == size_t {valueOffset} + *valueLen + 1);
+  const auto value = packet.substr(valueOffset, *valueLen);
+
+  return GameEventView {name, value};
+}
+
+GameEvent GameEventView::ToGameEvent() const {
+  if (!isPacked) {
+    return {std::string {name}, std::string {value}};
+  }
+
+  auto events = nlohmann::json::array();
+  auto remaining = value;
+  while (const auto event = ParseNext(&remaining)) {
+    // Nested packing isn't produced by `SerializePacked()`
+    CHECK_PACKET(!event->isPacked);
+    events.push_back({event->name, event->value});
+  }
+  // Trailing bytes that aren't a valid packet
+  CHECK_PACKET(remaining.empty());
+  // Names and values are meant to be UTF-8, but aren't validated, so don't
+  // let `dump()` throw
+  return {
+    std::string {name},
+    events.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace)};
+}
+
+GameEvent GameEvent::Unserialize(std::string_view packet) {
+  const auto view = GameEventView::Parse(packet);
+  if (!view) {
+    return {};
+  }
+  return view->ToGameEvent();
+}
+
+namespace {
+
+/** Streams a JSON `EVT_MULTI_EVENT` value straight into `GameEvent`s.
+ *
+ * This avoids building a DOM, and the copies from the DOM into the events.
+ * Anything other than an array of `[name, value]` string pairs is rejected.
+ */
+class MultiEventSAXHandler final
+  : public nlohmann::json_sax<nlohmann::json> {
+ public:
+  MultiEventSAXHandler(std::vector<GameEvent>* events) : mEvents(events) {
+  }
+
+  bool string(string_t& value) override {
+    if (mDepth != 2 || mFieldCount >= 2) {
+      return false;
+    }
+    // Names are required, as in single events
+    if (mFieldCount == 0 && value.empty()) {
+      return false;
+    }
+    auto& event = mEvents->back();
+    (mFieldCount++ == 0 ? event.name : event.value) = std::move(value);
+    return true;
+  }
+
+  bool start_array(std::size_t) override {
+    if (mDepth == 1) {
+      mEvents->emplace_back();
+      mFieldCount = 0;
+    }
+    return ++mDepth <= 2;
+  }
+
+  bool end_array() override {
+    if (mDepth-- == 2) {
+      return mFieldCount == 2;
+    }
+    return true;
+  }
+
+  bool null() override {
+    return false;
+  }
+  bool boolean(bool) override {
+    return false;
+  }
+  bool number_integer(number_integer_t) override {
+    return false;
+  }
+  bool number_unsigned(number_unsigned_t) override {
+    return false;
+  }
+  bool number_float(number_float_t, const string_t&) override {
+    return false;
+  }
+  bool binary(binary_t&) override {
+    return false;
+  }
+  bool start_object(std::size_t) override {
+    return false;
+  }
+  bool key(string_t&) override {
+    return false;
+  }
+  bool end_object() override {
+    return false;
+  }
+  bool parse_error(
+    std::size_t,
+    const std::string&,
+    const nlohmann::json::exception&) override {
+    return false;
+  }
+
+ private:
+  std::vector<GameEvent>* mEvents {nullptr};
+  std::size_t mDepth {0};
+  std::size_t mFieldCount {0};
+};
+
+}// namespace
+
+bool GameEvent::UnserializeAll(
+  std::string_view packet,
+  std::vector<GameEvent>* events) {
+  const auto view = GameEventView::Parse(packet);
+  if (!view) {
+    return false;
+  }
+
+  const auto previousSize = events->size();
+  if (view->isPacked) {
+    auto remaining = view->value;
+    bool valid = true;
+    while (const auto inner = GameEventView::ParseNext(&remaining)) {
+      // Nested packing isn't produced by `SerializePacked()`
+      if (inner->isPacked) {
+        valid = false;
+        break;
+      }
+      events->push_back(inner->ToGameEvent());
+    }
+    if (valid && remaining.empty()) {
+      return true;
+    }
+    // Like invalid JSON multi-events, don't deliver half of it
+    events->resize(previousSize);
+    return false;
+  }
+
+  if (view->name != EVT_MULTI_EVENT) {
+    events->push_back(view->ToGameEvent());
+    return true;
+  }
+
+  MultiEventSAXHandler handler(events);
+  if (nlohmann::json::sax_parse(view->value, &handler)) {
+    return true;
+  }
+  // Don't deliver half of an invalid multi-event
+  events->resize(previousSize);
+  return false;
+}
+
+std::vector<std::byte> GameEvent::Serialize() const {
+  std::vector<std::byte> ret;
+  AppendPacket(&ret, name, AsBytes(value), 0);
+  return ret;
+}
+
+std::vector<std::byte> GameEvent::SerializePacked(
+  std::span<const GameEvent> events) {
+  std::vector<std::byte> value;
+  for (const auto& event: events) {
+    AppendPacket(&value, event.name, AsBytes(event.value), 0);
+  }
+  std::vector<std::byte> ret;
+  AppendPacket(&ret, EVT_MULTI_EVENT, value, PACKET_FLAG_PACKED_VALUE);
+  return ret;
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,192 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventRecording.h>
+
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace OpenKneeboard {
+
+namespace {
+
+constexpr std::string_view FileMagic {"OKBGEVR\0", 8};
+// v1 had one record per event, without packet boundaries
+constexpr uint32_t FileVersion = 2;
+
+// Anything bigger is corruption rather than a real packet
+constexpr uint32_t MaxFieldSize = 64 * 1024 * 1024;
+constexpr uint32_t MaxBatchSize = 1024 * 1024;
+
+struct FileHeader final {
+  char mMagic[8];
+  uint32_t mVersion;
+};
+
+struct BatchHeader final {
+  uint64_t mTimeNS;
+  uint32_t mEventCount;
+  uint32_t mReserved;
+};
+
+struct EventHeader final {
+  uint32_t mNameSize;
+  uint32_t mValueSize;
+};
+
+template <class T>
+  requires std::is_trivially_copyable_v<T>
+void WriteValue(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/// Returns false if there was nothing to read
+template <class T>
+  requires std::is_trivially_copyable_v<T>
+bool ReadValue(std::istream& in, T* value) {
+  in.read(reinterpret_cast<char*>(value), sizeof(T));
+  if (in.gcount() == 0 && in.eof()) {
+    return false;
+  }
+  if (in.gcount() != sizeof(T)) {
+    throw std::runtime_error("GameEvent recording is truncated");
+  }
+  return true;
+}
+
+void ReadString(std::istream& in, uint32_t size, std::string* out) {
+  if (size > MaxFieldSize) {
+    throw std::runtime_error(
+      std::format("GameEvent recording has a {}-byte field", size));
+  }
+  out->resize(size);
+  in.read(out->data(), size);
+  if (in.gcount() != static_cast<std::streamsize>(size)) {
+    throw std::runtime_error("GameEvent recording is truncated");
+  }
+}
+
+}// namespace
+
+GameEventRecordingWriter::GameEventRecordingWriter(std::ostream& out)
+  : mOut(out) {
+  FileHeader header {.mVersion = FileVersion};
+  FileMagic.copy(header.mMagic, sizeof(header.mMagic));
+  WriteValue(mOut, header);
+}
+
+void GameEventRecordingWriter::Write(const RecordedGameEventBatch& batch) {
+  if (batch.mEvents.size() > MaxBatchSize) {
+    throw std::logic_error("GameEvent batch is too large to record");
+  }
+  for (const auto& event: batch.mEvents) {
+    if (
+      event.name.size() > MaxFieldSize || event.value.size() > MaxFieldSize) {
+      throw std::logic_error("GameEvent is too large to record");
+    }
+  }
+
+  WriteValue(
+    mOut,
+    BatchHeader {
+      .mTimeNS = static_cast<uint64_t>(batch.mTime.count()),
+      .mEventCount = static_cast<uint32_t>(batch.mEvents.size()),
+    });
+  for (const auto& event: batch.mEvents) {
+    WriteValue(
+      mOut,
+      EventHeader {
+        .mNameSize = static_cast<uint32_t>(event.name.size()),
+        .mValueSize = static_cast<uint32_t>(event.value.size()),
+      });
+    mOut.write(event.name.data(), event.name.size());
+    mOut.write(event.value.data(), event.value.size());
+  }
+
+  if (!mOut) {
+    throw std::runtime_error("Failed to write GameEvent recording");
+  }
+}
+
+GameEventRecordingReader::GameEventRecordingReader(std::istream& in)
+  : mIn(in) {
+  FileHeader header {};
+  if (!ReadValue(mIn, &header)) {
+    throw std::runtime_error("GameEvent recording is empty");
+  }
+  if (std::string_view {header.mMagic, sizeof(header.mMagic)} != FileMagic) {
+    throw std::runtime_error("Not an OpenKneeboard GameEvent recording");
+  }
+  if (header.mVersion != FileVersion) {
+    throw std::runtime_error(std::format(
+      "Unsupported GameEvent recording version {}, expected {}",
+      header.mVersion,
+      FileVersion));
+  }
+}
+
+std::optional<RecordedGameEventBatch> GameEventRecordingReader::Next() {
+  BatchHeader header {};
+  if (!ReadValue(mIn, &header)) {
+    return {};
+  }
+  if (header.mEventCount > MaxBatchSize) {
+    throw std::runtime_error(std::format(
+      "GameEvent recording has a {}-event batch", header.mEventCount));
+  }
+
+  RecordedGameEventBatch batch {
+    .mTime = std::chrono::nanoseconds(header.mTimeNS),
+  };
+  batch.mEvents.resize(header.mEventCount);
+  for (auto& event: batch.mEvents) {
+    EventHeader eventHeader {};
+    if (!ReadValue(mIn, &eventHeader)) {
+      throw std::runtime_error("GameEvent recording is truncated");
+    }
+    ReadString(mIn, eventHeader.mNameSize, &event.name);
+    ReadString(mIn, eventHeader.mValueSize, &event.value);
+  }
+  return batch;
+}
+
+GameEventReplayScheduler::GameEventReplayScheduler(
+  Clock::time_point start,
+  double speed)
+  : mStart(start), mSpeed(speed) {
+  if (speed < 0) {
+    throw std::logic_error("Replay speed can not be negative");
+  }
+}
+
+GameEventReplayScheduler::Clock::time_point GameEventReplayScheduler::
+  GetDueTime(const RecordedGameEventBatch& batch) const {
+  if (mSpeed == 0) {
+    return mStart;
+  }
+  return mStart
+    + std::chrono::duration_cast<Clock::duration>(
+           std::chrono::duration<double, std::nano>(
+             batch.mTime.count() / mSpeed));
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,105 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventSendQueue.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace OpenKneeboard {
+
+GameEventSendQueue::GameEventSendQueue(
+  size_t capacity,
+  size_t maxEventsPerPacket,
+  IsStateEvent isStateEvent)
+  : mCapacity(capacity),
+    mMaxEventsPerPacket(maxEventsPerPacket),
+    mIsStateEvent(std::move(isStateEvent)) {
+  if (capacity == 0 || maxEventsPerPacket == 0) {
+    throw std::logic_error("GameEventSendQueue sizes must be non-zero");
+  }
+}
+
+bool GameEventSendQueue::Push(GameEvent event) {
+  std::unique_lock lock(mMutex);
+  if (mEvents.size() < mCapacity) {
+    mEvents.push_back(std::move(event));
+    ++mStatistics.mQueued;
+    return true;
+  }
+
+  if (mIsStateEvent(event.name)) {
+    // Search backwards, as the newest is the one that'll be superseded
+    auto it = std::ranges::find(
+      mEvents.rbegin(), mEvents.rend(), event.name, &GameEvent::name);
+    if (it != mEvents.rend()) {
+      it->value = std::move(event.value);
+      ++mStatistics.mMerged;
+      return true;
+    }
+  }
+
+  ++mStatistics.mDropped;
+  return false;
+}
+
+std::vector<std::byte> GameEventSendQueue::PopPacket() {
+  std::vector<GameEvent> events;
+  {
+    std::unique_lock lock(mMutex);
+    const auto count = std::min(mEvents.size(), mMaxEventsPerPacket);
+    if (count == 0) {
+      return {};
+    }
+    ++mStatistics.mPackets;
+    events.reserve(count);
+    std::move(
+      mEvents.begin(), mEvents.begin() + count, std::back_inserter(events));
+    mEvents.erase(mEvents.begin(), mEvents.begin() + count);
+  }
+
+  // Serializing outside of the lock, so that `Push()` doesn't wait for it
+  if (events.size() == 1) {
+    return events.front().Serialize();
+  }
+  return GameEvent::SerializePacked(events);
+}
+
+void GameEventSendQueue::Flush(const SendPacket& send) {
+  while (true) {
+    std::unique_lock lock(mFlushMutex);
+    const auto packet = PopPacket();
+    if (packet.empty()) {
+      return;
+    }
+    send(packet);
+  }
+}
+
+bool GameEventSendQueue::IsEmpty() const {
+  std::unique_lock lock(mMutex);
+  return mEvents.empty();
+}
+
+GameEventSendQueue::Statistics GameEventSendQueue::GetStatistics() const {
+  std::unique_lock lock(mMutex);
+  return mStatistics;
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,333 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventUnixSocket.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <afunix.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace OpenKneeboard {
+
+namespace {
+
+#ifdef _WIN32
+using native_socket_t = SOCKET;
+constexpr auto InvalidSocket = INVALID_SOCKET;
+
+int GetLastSocketError() {
+  return WSAGetLastError();
+}
+
+void CloseSocket(native_socket_t socket) {
+  closesocket(socket);
+}
+
+int Poll(pollfd* fds, size_t count, int timeoutMS) {
+  return WSAPoll(fds, static_cast<ULONG>(count), timeoutMS);
+}
+
+void EnsureSocketsInitialized() {
+  static std::once_flag sOnce;
+  std::call_once(sOnce, []() {
+    WSADATA data {};
+    WSAStartup(MAKEWORD(2, 2), &data);
+  });
+}
+
+constexpr int SendFlags = 0;
+#else
+using native_socket_t = int;
+constexpr native_socket_t InvalidSocket = -1;
+
+int GetLastSocketError() {
+  return errno;
+}
+
+void CloseSocket(native_socket_t socket) {
+  close(socket);
+}
+
+int Poll(pollfd* fds, size_t count, int timeoutMS) {
+  return poll(fds, static_cast<nfds_t>(count), timeoutMS);
+}
+
+void EnsureSocketsInitialized() {
+}
+
+// Return an error instead of raising SIGPIPE if the receiver has gone
+constexpr int SendFlags = MSG_NOSIGNAL;
+#endif
+
+native_socket_t ToNative(std::intptr_t socket) {
+  return static_cast<native_socket_t>(socket);
+}
+
+std::intptr_t FromNative(native_socket_t socket) {
+  return (socket == InvalidSocket) ? -1 : static_cast<std::intptr_t>(socket);
+}
+
+[[noreturn]] void ThrowLastSocketError(const char* what) {
+  throw std::system_error(GetLastSocketError(), std::system_category(), what);
+}
+
+sockaddr_un MakeAddress(const std::string& path) {
+  sockaddr_un address {.sun_family = AF_UNIX};
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::system_error(
+      std::make_error_code(std::errc::filename_too_long),
+      "Unix socket path is too long");
+  }
+  std::ranges::copy(path, address.sun_path);
+  return address;
+}
+
+// Frames are a little-endian uint32 length, followed by the packet
+constexpr size_t FrameHeaderSize = sizeof(uint32_t);
+// Much larger than any real event; anything bigger is a corrupt stream
+constexpr uint32_t MaxPacketSize = 16 * 1024 * 1024;
+
+}// namespace
+
+UnixSocketGameEventSender::UnixSocketGameEventSender(std::string path)
+  : mPath(std::move(path)) {
+  EnsureSocketsInitialized();
+}
+
+UnixSocketGameEventSender::~UnixSocketGameEventSender() {
+  this->Disconnect();
+}
+
+bool UnixSocketGameEventSender::Connect() {
+  if (mSocket != -1) {
+    return true;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - mLastConnectAttempt < std::chrono::seconds(1)) {
+    return false;
+  }
+  mLastConnectAttempt = now;
+
+  const auto socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (socket == InvalidSocket) {
+    return false;
+  }
+  const auto address = MakeAddress(mPath);
+  if (
+    connect(
+      socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address))
+    != 0) {
+    CloseSocket(socket);
+    return false;
+  }
+  mSocket = FromNative(socket);
+  return true;
+}
+
+void UnixSocketGameEventSender::Disconnect() {
+  if (mSocket == -1) {
+    return;
+  }
+  CloseSocket(ToNative(mSocket));
+  mSocket = -1;
+}
+
+bool UnixSocketGameEventSender::SendFrame(std::span<const std::byte> packet) {
+  const auto size = static_cast<uint32_t>(packet.size());
+  const std::byte header[FrameHeaderSize] {
+    static_cast<std::byte>(size & 0xff),
+    static_cast<std::byte>((size >> 8) & 0xff),
+    static_cast<std::byte>((size >> 16) & 0xff),
+    static_cast<std::byte>((size >> 24) & 0xff),
+  };
+
+  for (auto remaining: {std::span<const std::byte> {header}, packet}) {
+    while (!remaining.empty()) {
+      const auto sent = ::send(
+        ToNative(mSocket),
+        reinterpret_cast<const char*>(remaining.data()),
+        static_cast<int>(remaining.size()),
+        SendFlags);
+      if (sent <= 0) {
+        return false;
+      }
+      remaining = remaining.subspan(static_cast<size_t>(sent));
+    }
+  }
+  return true;
+}
+
+bool UnixSocketGameEventSender::Send(std::span<const std::byte> packet) {
+  if (packet.size() > MaxPacketSize) {
+    return false;
+  }
+
+  const std::unique_lock lock(mMutex);
+  if (!this->Connect()) {
+    return false;
+  }
+  if (this->SendFrame(packet)) {
+    return true;
+  }
+
+  // The receiver may have restarted, so try again with a new connection.
+  // If the first attempt sent part of a frame, that connection is gone, so
+  // the receiver never sees the partial frame.
+  this->Disconnect();
+  mLastConnectAttempt = {};
+  return this->Connect() && this->SendFrame(packet);
+}
+
+UnixSocketGameEventReceiver::UnixSocketGameEventReceiver(std::string path)
+  : mPath(std::move(path)) {
+  EnsureSocketsInitialized();
+
+  const auto address = MakeAddress(mPath);
+  const auto socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (socket == InvalidSocket) {
+    ThrowLastSocketError("Failed to create Unix socket");
+  }
+  // Remove a socket left over by a previous process
+  std::remove(mPath.c_str());
+  if (
+    bind(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address))
+      != 0
+    || listen(socket, SOMAXCONN) != 0) {
+    const auto error = GetLastSocketError();
+    CloseSocket(socket);
+    throw std::system_error(
+      error, std::system_category(), "Failed to listen on Unix socket");
+  }
+  mListener = FromNative(socket);
+}
+
+UnixSocketGameEventReceiver::~UnixSocketGameEventReceiver() {
+  for (const auto& connection: mConnections) {
+    CloseSocket(ToNative(connection.mSocket));
+  }
+  CloseSocket(ToNative(mListener));
+  std::remove(mPath.c_str());
+}
+
+bool UnixSocketGameEventReceiver::ReadFrom(Connection& connection) {
+  std::byte buffer[64 * 1024];
+  const auto received = ::recv(
+    ToNative(connection.mSocket),
+    reinterpret_cast<char*>(buffer),
+    static_cast<int>(sizeof(buffer)),
+    0);
+  if (received <= 0) {
+    return false;
+  }
+  connection.mBuffer.insert(
+    connection.mBuffer.end(), buffer, buffer + received);
+
+  std::span<const std::byte> unread {connection.mBuffer};
+  while (unread.size() >= FrameHeaderSize) {
+    uint32_t size {};
+    for (size_t i = 0; i < FrameHeaderSize; ++i) {
+      size |= std::to_integer<uint32_t>(unread[i]) << (8 * i);
+    }
+    if (size > MaxPacketSize) {
+      return false;
+    }
+    if (unread.size() < FrameHeaderSize + size) {
+      break;
+    }
+    const auto packet = unread.subspan(FrameHeaderSize, size);
+    mPackets.emplace_back(packet.begin(), packet.end());
+    unread = unread.subspan(FrameHeaderSize + size);
+  }
+  connection.mBuffer.erase(
+    connection.mBuffer.begin(),
+    connection.mBuffer.end() - static_cast<std::ptrdiff_t>(unread.size()));
+  return true;
+}
+
+std::optional<std::vector<std::byte>> UnixSocketGameEventReceiver::Receive(
+  std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::vector<pollfd> fds;
+  while (mPackets.empty()) {
+    const auto remaining
+      = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() < 0) {
+      return std::nullopt;
+    }
+
+    fds.clear();
+    fds.push_back({.fd = ToNative(mListener), .events = POLLIN});
+    for (const auto& connection: mConnections) {
+      fds.push_back({.fd = ToNative(connection.mSocket), .events = POLLIN});
+    }
+    const auto ready
+      = Poll(fds.data(), fds.size(), static_cast<int>(remaining.count()));
+    if (ready < 0) {
+      ThrowLastSocketError("Failed to poll Unix sockets");
+    }
+    if (ready == 0) {
+      return std::nullopt;
+    }
+
+    // Newly-accepted connections are polled next time round
+    const auto connectionCount = mConnections.size();
+    if (fds.front().revents & POLLIN) {
+      const auto socket = accept(ToNative(mListener), nullptr, nullptr);
+      if (socket != InvalidSocket) {
+        mConnections.push_back({.mSocket = FromNative(socket)});
+      }
+    }
+
+    std::vector<std::intptr_t> closed;
+    for (size_t i = 0; i < connectionCount; ++i) {
+      if (!fds.at(i + 1).revents) {
+        continue;
+      }
+      auto& connection = mConnections.at(i);
+      if (!this->ReadFrom(connection)) {
+        CloseSocket(ToNative(connection.mSocket));
+        closed.push_back(connection.mSocket);
+      }
+    }
+    std::erase_if(mConnections, [&closed](const auto& connection) {
+      return std::ranges::find(closed, connection.mSocket) != closed.end();
+    });
+  }
+
+  auto ret = std::move(mPackets.front());
+  mPackets.pop_front();
+  return ret;
+}
+
+}// namespace OpenKneeboard
@@ -0,0 +1,110 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PrefetchQueue.h>
+
+#include <algorithm>
+
+namespace OpenKneeboard {
+
+PrefetchQueue::PrefetchQueue(size_t radius) : mRadius(radius) {
+}
+
+PrefetchQueue::Owner& PrefetchQueue::GetOwner(OwnerID id) {
+  auto it = std::ranges::find(mOwners, id, &Owner::mID);
+  if (it != mOwners.end()) {
+    return *it;
+  }
+  mOwners.push_back({.mID = id});
+  return mOwners.back();
+}
+
+void PrefetchQueue::SetCurrentPage(
+  OwnerID id,
+  std::span<const PageID> pages,
+  PageID current) {
+  auto& owner = this->GetOwner(id);
+  if (owner.mCurrent == current) {
+    return;
+  }
+  owner.mCurrent = current;
+  owner.mPending.clear();
+  owner.mDone.insert(current);
+
+  const auto it = std::ranges::find(pages, current);
+  if (it == pages.end()) {
+    return;
+  }
+  const auto index = static_cast<size_t>(it - pages.begin());
+
+  const auto maybeQueue = [&owner](PageID page) {
+    if (owner.mDone.insert(page).second) {
+      owner.mPending.push_back(page);
+    }
+  };
+  for (size_t distance = 1; distance <= mRadius; ++distance) {
+    if (index + distance < pages.size()) {
+      maybeQueue(pages[index + distance]);
+    }
+    if (index >= distance) {
+      maybeQueue(pages[index - distance]);
+    }
+  }
+}
+
+void PrefetchQueue::Invalidate(OwnerID id) {
+  auto& owner = this->GetOwner(id);
+  owner.mCurrent = {};
+  owner.mPending.clear();
+  owner.mDone.clear();
+}
+
+void PrefetchQueue::Forget(PageID page) {
+  for (auto& owner: mOwners) {
+    // The current page is being shown, so it'll be cached again anyway
+    if (owner.mCurrent != page) {
+      owner.mDone.erase(page);
+    }
+  }
+}
+
+void PrefetchQueue::Remove(OwnerID id) {
+  std::erase_if(mOwners, [id](const Owner& owner) { return owner.mID == id; });
+}
+
+std::optional<PrefetchQueue::Request> PrefetchQueue::Pop() {
+  for (size_t i = 0; i < mOwners.size(); ++i) {
+    auto& owner = mOwners.at((mNextOwner + i) % mOwners.size());
+    if (owner.mPending.empty()) {
+      continue;
+    }
+    mNextOwner = (mNextOwner + i + 1) % mOwners.size();
+    const Request ret {owner.mID, owner.mPending.front()};
+    owner.mPending.pop_front();
+    return ret;
+  }
+  return {};
+}
+
+bool PrefetchQueue::IsEmpty() const {
+  return std::ranges::all_of(
+    mOwners, [](const Owner& owner) { return owner.mPending.empty(); });
+}
+
+}// namespace OpenKneeboard
@@ -20,20 +20,16 @@
 #include <OpenKneeboard/SHM.h>
 #include <OpenKneeboard/Win32.h>
 
-#include <OpenKneeboard/bitflags.h>
 #include <OpenKneeboard/config.h>
 #include <OpenKneeboard/dprint.h>
 #include <OpenKneeboard/scope_guard.h>
 #include <OpenKneeboard/tracing.h>
 #include <OpenKneeboard/version.h>
 
-#include <shims/utility>
-
 #include <Windows.h>
 
 #include <bit>
 #include <format>
-#include <random>
 
 #include <d3d11_2.h>
 #include <d3d11_3.h>
@@ -43,54 +39,8 @@
 
 namespace OpenKneeboard::SHM {
 
-static uint64_t CreateSessionID() {
-  std::random_device randDevice;
-  std::uniform_int_distribution<uint32_t> randDist;
-  return (static_cast<uint64_t>(GetCurrentProcessId()) << 32)
-    | randDist(randDevice);
-}
-
-enum class HeaderFlags : ULONG {
-  FEEDER_ATTACHED = 1 << 0,
-};
-
-struct Header final {
-  // Use the magic string to make sure we don't have
-  // uninitialized memory that happens to have the
-  // feeder-attached bit set
-  static constexpr std::string_view Magic {"OKBMagic"};
-  static_assert(Magic.size() == sizeof(uint64_t));
-  uint64_t mMagic = *reinterpret_cast<const uint64_t*>(Magic.data());
-
-  uint32_t mSequenceNumber = 0;
-  uint64_t mSessionID = CreateSessionID();
-  HeaderFlags mFlags;
-  Config mConfig;
-
-  DWORD mFeederProcessID {};
-  HANDLE mFence {};
-
-  uint8_t mLayerCount = 0;
-  LayerConfig mLayers[MaxLayers];
-
-  size_t GetRenderCacheKey() const;
-  bool HaveFeeder() const;
-
-  std::underlying_type_t<ConsumerKind> mActiveConsumers {};
-};
-static_assert(std::is_standard_layout_v<Header>);
-
-}// namespace OpenKneeboard::SHM
-
-namespace OpenKneeboard {
-template <>
-constexpr bool is_bitflags_v<SHM::HeaderFlags> = true;
-}// namespace OpenKneeboard
-
-namespace OpenKneeboard::SHM {
-
 static constexpr DWORD MAX_IMAGE_PX(1024 * 1024 * 8);
-static constexpr DWORD SHM_SIZE = sizeof(Header);
+static constexpr DWORD SHM_SIZE = sizeof(Segment);
 
 static auto SHMPath() {
   static std::wstring sCache;
@@ -108,6 +58,17 @@ static auto SHMPath() {
   return sCache;
 }
 
+static std::wstring FrameEventName(uint8_t consumerSlot) {
+  return std::format(
+    L"Local\\{}-{}.{}.{}.{}--frame-event-c{}",
+    ProjectNameW,
+    Version::Major,
+    Version::Minor,
+    Version::Patch,
+    Version::Build,
+    consumerSlot);
+}
+
 static auto MutexPath() {
   static std::wstring sCache;
   if (sCache.empty()) [[unlikely]] {
@@ -145,7 +106,7 @@ bool TextureReadResources::Populate(
     dprintf(
       "Replacing OpenKneeboard TextureReadResources: {:0x}/{}",
       sessionID,
-      sequenceNumber % TextureCount);
+      GetTextureIndex(sequenceNumber));
     *this = {.mSessionID = sessionID};
   }
 
@@ -208,7 +169,7 @@ std::wstring SharedTextureName(
     Version::Build,
     sessionID,
     layerIndex,
-    sequenceNumber % TextureCount);
+    GetTextureIndex(sequenceNumber));
 }
 
 winrt::com_ptr<ID3D11Texture2D>
@@ -240,7 +201,8 @@ Snapshot::Snapshot(
   ID3D11DeviceContext4* ctx,
   ID3D11Fence* fence,
   const LayerTextures& textures,
-  TextureReadResources* r)
+  TextureReadResources* r,
+  const LayerDamage& damage)
   : mLayerTextures(textures), mState(State::Empty) {
   mHeader = std::make_shared<Header>(header);
 
@@ -253,19 +215,40 @@ Snapshot::Snapshot(
   TraceLoggingWriteTagged(activity, "WaitForFence");
   winrt::check_hresult(ctx->Wait(fence, header.mSequenceNumber));
 
-  const D3D11_BOX box {0, 0, 0, TextureWidth, TextureHeight, 1};
   for (uint8_t i = 0; i < header.mLayerCount; ++i) {
+    const auto& layerDamage = damage.at(i);
+    if (layerDamage.IsEmpty()) {
+      // Our texture already contains this generation of the layer
+      TraceLoggingWriteTagged(
+        activity, "SkippedCleanLayer", TraceLoggingValue(i, "Layer"));
+      continue;
+    }
+    mDirtyLayers.set(i);
+
     TraceLoggingWriteTagged(
-      activity, "StartCopyTexture", TraceLoggingValue(i, "Layer"));
-    ctx->CopySubresourceRegion(
-      mLayerTextures.at(i).get(),
-      /* subresource = */ 0,
-      /* x = */ 0,
-      /* y = */ 0,
-      /* z = */ 0,
-      r->mLayers.at(i).mTexture.get(),
-      /* subresource = */ 0,
-      &box);
+      activity,
+      "StartCopyTexture",
+      TraceLoggingValue(i, "Layer"),
+      TraceLoggingValue(layerDamage.IsFull(), "Full"),
+      TraceLoggingValue(layerDamage.GetRects().size(), "RectCount"));
+    const auto copy = [&](const D3D11_BOX& box) {
+      ctx->CopySubresourceRegion(
+        mLayerTextures.at(i).get(),
+        /* subresource = */ 0,
+        /* x = */ box.left,
+        /* y = */ box.top,
+        /* z = */ 0,
+        r->mLayers.at(i).mTexture.get(),
+        /* subresource = */ 0,
+        &box);
+    };
+    if (layerDamage.IsFull()) {
+      copy({0, 0, 0, TextureWidth, TextureHeight, 1});
+    } else {
+      for (const auto& rect: layerDamage.GetRects()) {
+        copy({rect.mLeft, rect.mTop, 0, rect.mRight, rect.mBottom, 1});
+      }
+    }
     TraceLoggingWriteTagged(activity, "CopiedResource");
     TraceLoggingWriteTagged(
       activity, "CopiedTexture", TraceLoggingValue(i, "Layer"));
@@ -296,8 +279,18 @@ size_t Snapshot::GetRenderCacheKey() const {
   return mHeader->GetRenderCacheKey();
 }
 
-bool LayerConfig::IsValid() const {
-  return mImageWidth > 0 && mImageHeight > 0;
+size_t Snapshot::GetRenderCacheKey(const LayerConfig& layer) const {
+  // As with Header::GetRenderCacheKey(), this relies on the session ID
+  // containing random data
+  std::hash<uint64_t> HashUI64;
+  return HashUI64(mHeader->mSessionID) ^ HashUI64(layer.mGeneration);
+}
+
+bool Snapshot::IsLayerDirty(uint8_t layerIndex) const {
+  if (layerIndex >= this->GetLayerCount()) {
+    return false;
+  }
+  return mDirtyLayers.test(layerIndex);
 }
 
 uint64_t Snapshot::GetSequenceNumberForDebuggingOnly() const {
@@ -386,6 +379,7 @@ class Impl {
   winrt::handle mFileHandle;
   winrt::handle mMutexHandle;
   std::byte* mMapping = nullptr;
+  Segment* mSegment = nullptr;
   Header* mHeader = nullptr;
 
   Impl() {
@@ -419,7 +413,8 @@ class Impl {
 
     mFileHandle = std::move(fileHandle);
     mMutexHandle = std::move(mutexHandle);
-    mHeader = reinterpret_cast<Header*>(mMapping);
+    mSegment = reinterpret_cast<Segment*>(mMapping);
+    mHeader = &mSegment->mHeader;
   }
 
   ~Impl() {
@@ -454,7 +449,7 @@ class Impl {
         // success
         break;
       case WAIT_ABANDONED:
-        *mHeader = {};
+        ResetHeader(mSegment, CreateSessionID(GetCurrentProcessId()));
         break;
       default:
         TraceLoggingWriteStop(
@@ -525,6 +520,29 @@ class Writer::Impl : public SHM::Impl {
   using SHM::Impl::Impl;
   bool mHaveFed = false;
   DWORD mProcessID = GetCurrentProcessId();
+
+  // Opened on demand; kept open, as the slot's next consumer will
+  // reuse the same named event
+  std::array<winrt::handle, MaxConsumers> mFrameEvents;
+
+  void SignalFrameEvents() {
+    const auto consumers
+      = GetFrameEventConsumers(*mSegment, ConsumerClock::now());
+    for (uint8_t i = 0; i < MaxConsumers; ++i) {
+      if (!consumers.test(i)) {
+        continue;
+      }
+      auto& event = mFrameEvents.at(i);
+      if (!event) {
+        event = Win32::OpenEventW(
+          EVENT_MODIFY_STATE, FALSE, FrameEventName(i).c_str());
+        if (!event) {
+          continue;
+        }
+      }
+      SetEvent(event.get());
+    }
+  }
 };
 
 Writer::Writer() {
@@ -537,7 +555,7 @@ Writer::Writer() {
     return;
   }
 
-  *p->mHeader = Header {};
+  ResetHeader(p->mSegment, CreateSessionID(p->mProcessID));
   dprint("Writer initialized.");
 }
 
@@ -547,8 +565,10 @@ void Writer::Detach() {
     throw std::logic_error("Need lock to detach");
   }
 
-  p->mHeader->mFlags &= ~HeaderFlags::FEEDER_ATTACHED;
+  DetachFeeder(p->mSegment);
   FlushViewOfFile(p->mMapping, NULL);
+  // Let waiting consumers notice that the feeder went away
+  p->SignalFrameEvents();
 }
 
 Writer::~Writer() {
@@ -569,7 +589,7 @@ bool Writer::try_lock() {
 }
 
 UINT Writer::GetNextTextureIndex() const {
-  return (p->mHeader->mSequenceNumber + 1) % TextureCount;
+  return GetTextureIndex(p->mHeader->mSequenceNumber + 1);
 }
 
 uint64_t Writer::GetSessionID() const {
@@ -583,6 +603,53 @@ uint32_t Writer::GetNextSequenceNumber() const {
 class Reader::Impl : public SHM::Impl {
  public:
   std::array<TextureReadResources, TextureCount> mResources;
+
+  uint8_t mConsumerSlot {MaxConsumers};
+  ConsumerKind mConsumerKind {};
+
+  bool mWantsFrameEvents {false};
+  winrt::handle mFrameEvent;
+  uint8_t mFrameEventSlot {MaxConsumers};
+
+  ~Impl() {
+    if (this->IsValid()) {
+      DetachConsumer(
+        mSegment, mConsumerSlot, mConsumerKind, GetCurrentProcessId());
+    }
+  }
+
+  void Heartbeat(ConsumerKind kind, uint32_t lastSequenceNumber) {
+    if (kind != mConsumerKind) {
+      DetachConsumer(
+        mSegment, mConsumerSlot, mConsumerKind, GetCurrentProcessId());
+      mConsumerSlot = MaxConsumers;
+      mConsumerKind = kind;
+    }
+    mConsumerSlot = ConsumerHeartbeat(
+      mSegment,
+      mConsumerSlot,
+      kind,
+      GetCurrentProcessId(),
+      lastSequenceNumber,
+      ConsumerClock::now());
+
+    if (!mWantsFrameEvents) {
+      return;
+    }
+    if (mConsumerSlot != mFrameEventSlot) {
+      mFrameEventSlot = mConsumerSlot;
+      mFrameEvent = {};
+      if (mConsumerSlot < MaxConsumers) {
+        // Opens the existing event if a previous consumer in this slot
+        // created it
+        mFrameEvent = Win32::CreateEventW(
+          nullptr, FALSE, FALSE, FrameEventName(mConsumerSlot).c_str());
+      }
+    }
+    if (mFrameEvent) {
+      RequestFrameEvents(mSegment, mConsumerSlot);
+    }
+  }
 };
 
 uint64_t Reader::GetSessionID() const {
@@ -631,10 +698,7 @@ Snapshot Reader::MaybeGet(
     return {nullptr};
   }
 
-  if (kind != ConsumerKind::Test) {
-    p->mHeader->mActiveConsumers
-      |= static_cast<std::underlying_type_t<ConsumerKind>>(kind);
-  }
+  p->Heartbeat(kind, static_cast<uint32_t>(mCachedSequenceNumber));
 
   if (
     mCache.IsValid() && this->GetRenderCacheKey() == mCache.GetRenderCacheKey()
@@ -648,17 +712,17 @@ Snapshot Reader::MaybeGet(
     return mCache;
   }
 
-  TraceLoggingWriteTagged(activity, "Waiting for SHM lock");
-  const std::unique_lock shmLock(*p, std::try_to_lock);
-  if (!shmLock.owns_lock()) {
+  Header header;
+  if (!TryReadHeader(*p->mSegment, &header)) {
     TraceLoggingWriteStop(
       activity,
       "SHM::MaybeGet",
-      TraceLoggingValue("try_to_lock failed", "Result"));
+      TraceLoggingValue("Inconsistent header", "Result"));
     return mCache;
   }
-  TraceLoggingWriteTagged(activity, "Acquired SHM lock");
-  const auto newSnapshot = this->MaybeGetUncached(ctx, fence, textures, kind);
+  TraceLoggingWriteTagged(activity, "Read SHM header");
+  const auto newSnapshot
+    = this->MaybeGetUncached(header, ctx, fence, textures, kind);
 
   using State = Snapshot::State;
   const auto state = newSnapshot.GetState();
@@ -704,30 +768,51 @@ Snapshot Reader::MaybeGet(
 }
 
 Snapshot Reader::MaybeGetUncached(
+  const Header& header,
   ID3D11DeviceContext4* ctx,
   ID3D11Fence* fence,
   const LayerTextures& textures,
   ConsumerKind kind) const {
-  if (!p->HaveLock()) {
-    dprint("Can't get without lock");
-    throw std::logic_error("Reader::MaybeGet() without lock");
-  }
-
-  if (!p->mHeader->mConfig.mTarget.Matches(kind)) {
+  if (!header.mConfig.mTarget.Matches(kind)) {
     traceprint(
       "Kind mismatch, not returning new snapshot; reader kind is {:#08x}, "
       "target kind is {:#08x}",
       static_cast<std::underlying_type_t<ConsumerKind>>(kind),
-      p->mHeader->mConfig.mTarget.GetRawMaskForDebugging());
+      header.mConfig.mTarget.GetRawMaskForDebugging());
     return {Snapshot::incorrect_kind};
   }
 
-  auto& r = p->mResources.at(p->mHeader->mSequenceNumber % TextureCount);
-  if (!r.Populate(ctx, p->mHeader->mSessionID, p->mHeader->mSequenceNumber)) {
+  // We don't hold a lock, so the feeder may have moved on since we copied
+  // the header; if it has started writing to the texture we'd copy from,
+  // we'd get a torn frame.
+  //
+  // This must be checked before copying: `textures` are also referenced by
+  // `mCache`, so a torn copy can't be undone by discarding the snapshot.
+  // Checking afterwards wouldn't help anyway, as the copy is queued on the
+  // GPU rather than executed here.
+  if (FeederOvertookReader(*p->mSegment, header.mSequenceNumber)) {
+    traceprint("Feeder overtook reader at {}", header.mSequenceNumber);
     return {nullptr};
   }
 
-  return Snapshot(*p->mHeader, ctx, fence, textures, &r);
+  auto& r = p->mResources.at(GetTextureIndex(header.mSequenceNumber));
+  if (!r.Populate(ctx, header.mSessionID, header.mSequenceNumber)) {
+    return {nullptr};
+  }
+
+  // Only copy layers - or parts of layers - that our texture doesn't already
+  // contain
+  LayerDamage damage;
+  damage.fill(DamageRegion::Full());
+  if (mCache.IsValid()) {
+    for (uint8_t i = 0; i < header.mLayerCount; ++i) {
+      if (mCache.mLayerTextures.at(i) == textures.at(i)) {
+        damage.at(i) = GetLayerDamage(*mCache.mHeader, header, i);
+      }
+    }
+  }
+
+  return Snapshot(header, ctx, fence, textures, &r, damage);
 }
 
 size_t Reader::GetRenderCacheKey() const {
@@ -737,21 +822,28 @@ size_t Reader::GetRenderCacheKey() const {
   return p->mHeader->GetRenderCacheKey();
 }
 
-void Writer::ClearConsumers() {
+void Writer::ReapConsumers() {
   if (!p) {
     throw std::logic_error("Attempted to update invalid SHM");
   }
   if (!p->HaveLock()) {
     throw std::logic_error("Attempted to update SHM without a lock");
   }
-  p->mHeader->mActiveConsumers = {};
+  SHM::ReapConsumers(p->mSegment, ConsumerClock::now());
 }
 
 std::underlying_type_t<ConsumerKind> Writer::GetConsumers() const {
   if (!p) {
     throw std::logic_error("Attempted to update invalid SHM");
   }
-  return p->mHeader->mActiveConsumers;
+  return GetActiveConsumers(*p->mSegment, ConsumerClock::now());
+}
+
+std::vector<ConsumerInfo> Writer::GetConsumerInfo() const {
+  if (!p) {
+    throw std::logic_error("Attempted to update invalid SHM");
+  }
+  return SHM::GetConsumers(*p->mSegment, ConsumerClock::now());
 }
 
 void Writer::Update(
@@ -765,41 +857,13 @@ void Writer::Update(
     throw std::logic_error("Attempted to update SHM without a lock");
   }
 
-  if (layers.size() > MaxLayers) {
-    throw std::logic_error(std::format(
-      "Asked to publish {} layers, but max is {}", layers.size(), MaxLayers));
-  }
-
-  for (auto layer: layers) {
-    if (layer.mImageWidth == 0 || layer.mImageHeight == 0) {
-      throw std::logic_error("Not feeding a 0-size image");
-    }
-  }
-
-  p->mHeader->mConfig = config;
-  p->mHeader->mSequenceNumber++;
-  p->mHeader->mFlags |= HeaderFlags::FEEDER_ATTACHED;
-  p->mHeader->mLayerCount = static_cast<uint8_t>(layers.size());
-  p->mHeader->mFeederProcessID = p->mProcessID;
-  p->mHeader->mFence = fence;
-  memcpy(
-    p->mHeader->mLayers, layers.data(), sizeof(LayerConfig) * layers.size());
-}
-
-bool Header::HaveFeeder() const {
-  return (mMagic == *reinterpret_cast<const uint64_t*>(Magic.data()))
-    && ((mFlags & HeaderFlags::FEEDER_ATTACHED)
-        == HeaderFlags::FEEDER_ATTACHED);
-}
-
-size_t Header::GetRenderCacheKey() const {
-  // This is lazy, and only works because:
-  // - session ID already contains random data
-  // - we're only combining *one* other value which isn't
-  // If adding more data, it either needs to be random,
-  // or need something like boost::hash_combine()
-  std::hash<uint64_t> HashUI64;
-  return HashUI64(mSessionID) ^ HashUI64(mSequenceNumber);
+  PublishHeader(
+    p->mSegment,
+    config,
+    layers,
+    p->mProcessID,
+    static_cast<uint64_t>(reinterpret_cast<uintptr_t>(fence)));
+  p->SignalFrameEvents();
 }
 
 uint32_t Reader::GetFrameCountForMetricsOnly() const {
@@ -809,19 +873,27 @@ uint32_t Reader::GetFrameCountForMetricsOnly() const {
   return p->mHeader->mSequenceNumber;
 }
 
-ConsumerPattern::ConsumerPattern() = default;
-ConsumerPattern::ConsumerPattern(
-  std::underlying_type_t<ConsumerKind> consumerKindMask)
-  : mKindMask(consumerKindMask) {
+bool Reader::TryGetHeader(Header* header) const {
+  if (!p) {
+    return false;
+  }
+  return TryReadHeader(*p->mSegment, header);
 }
 
-std::underlying_type_t<ConsumerKind> ConsumerPattern::GetRawMaskForDebugging()
-  const {
-  return mKindMask;
+std::underlying_type_t<ConsumerKind> Reader::GetActiveConsumers() const {
+  if (!p) {
+    return {};
+  }
+  return SHM::GetActiveConsumers(*p->mSegment, ConsumerClock::now());
 }
 
-bool ConsumerPattern::Matches(ConsumerKind kind) const {
-  return (mKindMask & std23::to_underlying(kind)) == mKindMask;
+HANDLE Reader::GetNewFrameEvent(ConsumerKind kind) {
+  if (!p) {
+    return {};
+  }
+  p->mWantsFrameEvents = true;
+  p->Heartbeat(kind, static_cast<uint32_t>(mCachedSequenceNumber));
+  return p->mFrameEvent.get();
 }
 
 void SingleBufferedReader::InitDXResources(ID3D11Device* device) {
@@ -852,16 +924,16 @@ void SingleBufferedReader::InitDXResources(ID3D11Device* device) {
   }
 
   // Make sure we get a consistent view
-  std::unique_lock lock(*p, std::try_to_lock);
-  if (!lock.owns_lock()) {
-    dprint("Failed to acquire SHM lock in InitDXResources");
+  Header header;
+  if (!TryReadHeader(*p->mSegment, &header)) {
+    dprint("Failed to get a consistent SHM header in InitDXResources");
     return;
   }
 
   mDevice = device;
-  mSessionID = sessionID;
+  mSessionID = header.mSessionID;
 
-  if (!sessionID) {
+  if (!mSessionID) {
     return;
   }
 
@@ -874,7 +946,7 @@ void SingleBufferedReader::InitDXResources(ID3D11Device* device) {
   mContext = ctx.as<ID3D11DeviceContext4>();
 
   winrt::handle feeder {
-    OpenProcess(PROCESS_DUP_HANDLE, FALSE, p->mHeader->mFeederProcessID)};
+    OpenProcess(PROCESS_DUP_HANDLE, FALSE, header.mFeederProcessID)};
   if (!feeder) {
     return;
   }
@@ -882,7 +954,7 @@ void SingleBufferedReader::InitDXResources(ID3D11Device* device) {
   mFenceHandle = {};
   DuplicateHandle(
     feeder.get(),
-    p->mHeader->mFence,
+    reinterpret_cast<HANDLE>(static_cast<uintptr_t>(header.mFence)),
     GetCurrentProcess(),
     mFenceHandle.put(),
     0,
@@ -0,0 +1,390 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/SHMPOSIX.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <format>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace OpenKneeboard::SHM::POSIX {
+
+namespace {
+
+constexpr size_t PixelsPerTexture = TextureWidth * TextureHeight;
+
+struct Storage final {
+  Segment mSegment;
+  Pixel mPixels[TextureCount][MaxLayers][PixelsPerTexture];
+};
+
+[[noreturn]] void ThrowErrno(const char* what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::string SemaphoreName(const std::string& name) {
+  return name + "-writer";
+}
+
+std::string FrameEventName(const std::string& name, uint8_t consumerSlot) {
+  return std::format("{}-frame-c{}", name, consumerSlot);
+}
+
+/* Semaphores count, but Win32 auto-reset events don't; only post if the
+ * consumer hasn't already been woken. This can race with another writer, but
+ * the only effect is an extra wake-up.
+ */
+void SignalFrameEvent(sem_t* event) {
+  int value {};
+  if (sem_getvalue(event, &value) == 0 && value > 0) {
+    return;
+  }
+  sem_post(event);
+}
+
+// Writers and readers both create the objects if needed, so they can be
+// started in any order. Pages are only allocated when they're touched, so
+// the unused parts of the pixel buffers don't cost anything.
+class Mapping final {
+ public:
+  Mapping(const std::string& name) {
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd == -1) {
+      ThrowErrno("shm_open");
+    }
+    const auto closeAndThrow = [fd](const char* what) {
+      const auto error = errno;
+      close(fd);
+      errno = error;
+      ThrowErrno(what);
+    };
+
+    struct stat info {};
+    if (fstat(fd, &info) == -1) {
+      closeAndThrow("fstat");
+    }
+    if (
+      info.st_size < static_cast<off_t>(sizeof(Storage))
+      && ftruncate(fd, sizeof(Storage)) == -1) {
+      closeAndThrow("ftruncate");
+    }
+    void* mapping = mmap(
+      nullptr, sizeof(Storage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      ThrowErrno("mmap");
+    }
+    mStorage = reinterpret_cast<Storage*>(mapping);
+  }
+
+  ~Mapping() {
+    munmap(mStorage, sizeof(Storage));
+  }
+
+  Mapping(const Mapping&) = delete;
+  Mapping& operator=(const Mapping&) = delete;
+
+  Storage* Get() const {
+    return mStorage;
+  }
+
+ private:
+  Storage* mStorage = nullptr;
+};
+
+}// namespace
+
+class Writer::Impl final {
+ public:
+  Impl(const std::string& name) : mName(name), mMapping(name) {
+    mSemaphore = sem_open(SemaphoreName(name).c_str(), O_CREAT, 0600, 1);
+    if (mSemaphore == SEM_FAILED) {
+      ThrowErrno("sem_open");
+    }
+  }
+
+  ~Impl() {
+    sem_close(mSemaphore);
+    for (auto event: mFrameEvents) {
+      if (event) {
+        sem_close(event);
+      }
+    }
+  }
+
+  std::string mName;
+  Mapping mMapping;
+  sem_t* mSemaphore {};
+  bool mHaveLock = false;
+  uint64_t mSessionID {};
+  // Opened on first use; consumers create them
+  std::array<sem_t*, MaxConsumers> mFrameEvents {};
+
+  void SignalFrameEvents() {
+    // `GetFrameEventConsumers()` and the sequence number are both
+    // sequentially consistent, so a reader that registers concurrently will
+    // either be signalled, or see the new sequence number.
+    const auto consumers = GetFrameEventConsumers(
+      mMapping.Get()->mSegment, ConsumerClock::now());
+    for (uint8_t i = 0; i < MaxConsumers; ++i) {
+      if (!consumers.test(i)) {
+        continue;
+      }
+      auto& event = mFrameEvents.at(i);
+      if (!event) {
+        auto opened = sem_open(FrameEventName(mName, i).c_str(), 0);
+        if (opened == SEM_FAILED) {
+          continue;
+        }
+        event = opened;
+      }
+      SignalFrameEvent(event);
+    }
+  }
+};
+
+Writer::Writer(const std::string& name) : p(std::make_unique<Impl>(name)) {
+  p->mSessionID = CreateSessionID(static_cast<uint32_t>(getpid()));
+  std::unique_lock lock(*this);
+  ResetHeader(&p->mMapping.Get()->mSegment, p->mSessionID);
+}
+
+Writer::~Writer() = default;
+
+std::span<Pixel> Writer::GetNextPixels(uint8_t layerIndex) {
+  if (!p->mHaveLock) {
+    throw std::logic_error("Attempted to render without a lock");
+  }
+  if (layerIndex >= MaxLayers) {
+    throw std::logic_error("Layer index out of range");
+  }
+  auto storage = p->mMapping.Get();
+  const auto slot = GetTextureIndex(GetSequenceNumber(storage->mSegment) + 1);
+  return storage->mPixels[slot][layerIndex];
+}
+
+void Writer::Update(
+  const Config& config,
+  std::span<const LayerConfig> layers) {
+  if (!p->mHaveLock) {
+    throw std::logic_error("Attempted to update SHM without a lock");
+  }
+  PublishHeader(
+    &p->mMapping.Get()->mSegment,
+    config,
+    layers,
+    static_cast<uint32_t>(getpid()),
+    /* fence = */ 0);
+  p->SignalFrameEvents();
+}
+
+void Writer::Detach() {
+  if (!p->mHaveLock) {
+    throw std::logic_error("Attempted to detach without a lock");
+  }
+  DetachFeeder(&p->mMapping.Get()->mSegment);
+}
+
+uint64_t Writer::GetSessionID() const {
+  return p->mSessionID;
+}
+
+void Writer::lock() {
+  if (p->mHaveLock) {
+    throw std::logic_error("Acquiring a lock we already hold");
+  }
+  while (sem_wait(p->mSemaphore) == -1) {
+    if (errno != EINTR) {
+      ThrowErrno("sem_wait");
+    }
+  }
+  p->mHaveLock = true;
+}
+
+bool Writer::try_lock() {
+  if (p->mHaveLock) {
+    throw std::logic_error("Acquiring a lock we already hold");
+  }
+  if (sem_trywait(p->mSemaphore) == -1) {
+    return false;
+  }
+  p->mHaveLock = true;
+  return true;
+}
+
+void Writer::unlock() {
+  if (!p->mHaveLock) {
+    throw std::logic_error("Releasing a lock we don't hold");
+  }
+  p->mHaveLock = false;
+  sem_post(p->mSemaphore);
+}
+
+class Reader::Impl final {
+ public:
+  Impl(const std::string& name) : mName(name), mMapping(name) {
+  }
+
+  ~Impl() {
+    if (mFrameEvent) {
+      sem_close(mFrameEvent);
+    }
+    if (mConsumerSlot < MaxConsumers) {
+      DetachConsumer(
+        &mMapping.Get()->mSegment,
+        mConsumerSlot,
+        mConsumerKind,
+        static_cast<uint32_t>(getpid()));
+    }
+  }
+
+  std::string mName;
+  Mapping mMapping;
+  ConsumerKind mConsumerKind {};
+  uint8_t mConsumerSlot {MaxConsumers};
+  sem_t* mFrameEvent {};
+  uint8_t mFrameEventSlot {MaxConsumers};
+
+  void RegisterForFrameEvents(ConsumerKind kind, uint32_t sequenceNumber) {
+    auto segment = &mMapping.Get()->mSegment;
+    mConsumerKind = kind;
+    mConsumerSlot = ConsumerHeartbeat(
+      segment,
+      mConsumerSlot,
+      kind,
+      static_cast<uint32_t>(getpid()),
+      sequenceNumber,
+      ConsumerClock::now());
+    if (mConsumerSlot != mFrameEventSlot) {
+      mFrameEventSlot = mConsumerSlot;
+      if (mFrameEvent) {
+        sem_close(mFrameEvent);
+        mFrameEvent = {};
+      }
+      if (mConsumerSlot < MaxConsumers) {
+        // Opens the existing semaphore if a previous consumer in this slot
+        // created it
+        auto event = sem_open(
+          FrameEventName(mName, mConsumerSlot).c_str(), O_CREAT, 0600, 0);
+        if (event == SEM_FAILED) {
+          ThrowErrno("sem_open");
+        }
+        mFrameEvent = event;
+      }
+    }
+    if (mFrameEvent) {
+      RequestFrameEvents(segment, mConsumerSlot);
+    }
+  }
+};
+
+Reader::Reader(const std::string& name) : p(std::make_unique<Impl>(name)) {
+}
+
+Reader::~Reader() = default;
+
+uint32_t Reader::GetSequenceNumber() const {
+  return SHM::GetSequenceNumber(p->mMapping.Get()->mSegment);
+}
+
+bool Reader::TryCopyLatest(Frame* frame) const {
+  const auto storage = p->mMapping.Get();
+  const auto& segment = storage->mSegment;
+
+  auto& header = frame->mHeader;
+  if (!(TryReadHeader(segment, &header) && header.HaveFeeder())) {
+    return false;
+  }
+  if (FeederOvertookReader(segment, header.mSequenceNumber)) {
+    return false;
+  }
+
+  const auto slot = GetTextureIndex(header.mSequenceNumber);
+  for (uint8_t i = 0; i < header.mLayerCount; ++i) {
+    const auto& layer = header.mLayers[i];
+    auto& pixels = frame->mLayers.at(i);
+    pixels.resize(layer.mImageWidth * layer.mImageHeight);
+    for (uint16_t row = 0; row < layer.mImageHeight; ++row) {
+      std::memcpy(
+        pixels.data() + (row * layer.mImageWidth),
+        &storage->mPixels[slot][i][row * TextureWidth],
+        layer.mImageWidth * sizeof(Pixel));
+    }
+  }
+
+  // Unlike with GPU textures, the copy has finished by now, so we can tell
+  // if it might be torn
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return !FeederOvertookReader(segment, header.mSequenceNumber);
+}
+
+bool Reader::WaitForNewFrame(
+  ConsumerKind kind,
+  uint32_t sequenceNumber,
+  std::chrono::milliseconds timeout) {
+  p->RegisterForFrameEvents(kind, sequenceNumber);
+  if (!p->mFrameEvent) {
+    // No free consumer slots
+    return this->GetSequenceNumber() != sequenceNumber;
+  }
+
+  timespec deadline {};
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  const auto timeoutNS = deadline.tv_nsec
+    + std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+  deadline.tv_sec += timeoutNS / 1'000'000'000;
+  deadline.tv_nsec = timeoutNS % 1'000'000'000;
+
+  // Checked after registering, so a frame published before we registered
+  // isn't missed. The semaphore may also still be signalled for a frame we
+  // already saw, so keep waiting until the frame really is new.
+  while (this->GetSequenceNumber() == sequenceNumber) {
+    if (sem_timedwait(p->mFrameEvent, &deadline) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == ETIMEDOUT) {
+        return this->GetSequenceNumber() != sequenceNumber;
+      }
+      ThrowErrno("sem_timedwait");
+    }
+  }
+  return true;
+}
+
+void Unlink(const std::string& name) {
+  shm_unlink(name.c_str());
+  sem_unlink(SemaphoreName(name).c_str());
+  for (uint8_t i = 0; i < MaxConsumers; ++i) {
+    sem_unlink(FrameEventName(name, i).c_str());
+  }
+}
+
+}// namespace OpenKneeboard::SHM::POSIX
@@ -0,0 +1,348 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/SHMProtocol.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <random>
+#include <stdexcept>
+
+namespace OpenKneeboard::SHM {
+
+// If we fail this many times in a row, the writer is updating faster than
+// we can copy a few hundred bytes; give up and use the cached snapshot.
+static constexpr uint32_t MaxSeqLockReadAttempts = 16;
+
+uint64_t CreateSessionID(uint32_t processID) {
+  std::random_device randDevice;
+  std::uniform_int_distribution<uint32_t> randDist;
+  return (static_cast<uint64_t>(processID) << 32) | randDist(randDevice);
+}
+
+template <class F>
+static void WriteHeader(Segment* segment, F&& f) {
+  segment->mSeqLock.BeginWrite();
+  f(segment->mHeader);
+  segment->mSeqLock.EndWrite();
+}
+
+template <class T>
+static auto AtomicRef(const T& value) {
+  return std::atomic_ref(const_cast<T&>(value));
+}
+
+static constexpr uint64_t ConsumerOwner(ConsumerKind kind, uint32_t processID) {
+  return (static_cast<uint64_t>(processID) << 32)
+    | static_cast<std::underlying_type_t<ConsumerKind>>(kind);
+}
+
+static uint64_t ConsumerTimestamp(ConsumerClock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           time.time_since_epoch())
+    .count();
+}
+
+static bool IsConsumerExpired(uint64_t heartbeat, uint64_t now) {
+  // Heartbeats may be slightly newer than `now` if another process
+  // wrote one after we fetched the time
+  return (now > heartbeat)
+    && std::chrono::nanoseconds(now - heartbeat) > ConsumerTimeout;
+}
+
+void ResetHeader(Segment* segment, uint64_t sessionID) {
+  WriteHeader(
+    segment, [=](Header& header) { header = {.mSessionID = sessionID}; });
+}
+
+void PublishHeader(
+  Segment* segment,
+  const Config& config,
+  std::span<const LayerConfig> layers,
+  uint32_t feederProcessID,
+  uint64_t fence) {
+  if (layers.size() > MaxLayers) {
+    throw std::logic_error(std::format(
+      "Asked to publish {} layers, but max is {}", layers.size(), MaxLayers));
+  }
+
+  for (const auto& layer: layers) {
+    if (layer.mImageWidth == 0 || layer.mImageHeight == 0) {
+      throw std::logic_error("Not feeding a 0-size image");
+    }
+  }
+
+  WriteHeader(segment, [&](Header& header) {
+    const auto configChanged = !(header.mConfig == config);
+    for (uint8_t i = 0; i < layers.size(); ++i) {
+      const auto& previous = header.mLayers[i];
+      auto next = layers[i];
+      const auto forceFullRepaint = configChanged
+        || (i >= header.mLayerCount) || (next.mLayerID != previous.mLayerID)
+        || (next.mImageWidth != previous.mImageWidth)
+        || (next.mImageHeight != previous.mImageHeight)
+        || (next.mVR != previous.mVR);
+      if (forceFullRepaint) {
+        next.mIsDirty = true;
+        next.mDamage.MarkFull();
+      } else if (!next.mIsDirty) {
+        next.mDamage.Clear();
+      }
+      next.mDamage.ClipTo(next.mImageWidth, next.mImageHeight);
+      next.mGeneration = previous.mGeneration + (next.mIsDirty ? 1 : 0);
+      header.mLayers[i] = next;
+    }
+
+    header.mConfig = config;
+    header.mFlags |= HeaderFlags::FEEDER_ATTACHED;
+    header.mLayerCount = static_cast<uint8_t>(layers.size());
+    header.mFeederProcessID = feederProcessID;
+    header.mFence = fence;
+    std::atomic_ref(header.mSequenceNumber).store(header.mSequenceNumber + 1);
+  });
+}
+
+void DetachFeeder(Segment* segment) {
+  WriteHeader(segment, [](Header& header) {
+    header.mFlags &= ~HeaderFlags::FEEDER_ATTACHED;
+  });
+}
+
+std::vector<ConsumerInfo> GetConsumers(
+  const Segment& segment,
+  ConsumerClock::time_point now) {
+  const auto nowNS = ConsumerTimestamp(now);
+  const auto sequenceNumber
+    = AtomicRef(segment.mHeader.mSequenceNumber).load();
+
+  std::vector<ConsumerInfo> ret;
+  for (const auto& slot: segment.mConsumers) {
+    const auto owner = AtomicRef(slot.mOwner).load();
+    if (!owner) {
+      continue;
+    }
+    const auto heartbeat = AtomicRef(slot.mHeartbeat).load();
+    if (IsConsumerExpired(heartbeat, nowNS)) {
+      continue;
+    }
+    const auto lastSequenceNumber
+      = AtomicRef(slot.mLastSequenceNumber).load();
+    ret.push_back({
+      .mKind = static_cast<ConsumerKind>(owner & 0xffffffff),
+      .mProcessID = static_cast<uint32_t>(owner >> 32),
+      .mLastSequenceNumber = lastSequenceNumber,
+      .mFramesBehind = sequenceNumber - lastSequenceNumber,
+      .mAge = std::chrono::nanoseconds(
+        nowNS > heartbeat ? (nowNS - heartbeat) : 0),
+    });
+  }
+  return ret;
+}
+
+std::underlying_type_t<ConsumerKind> GetActiveConsumers(
+  const Segment& segment,
+  ConsumerClock::time_point now) {
+  std::underlying_type_t<ConsumerKind> ret {};
+  for (const auto& consumer: GetConsumers(segment, now)) {
+    // Test consumers match every kind, so would make it look like everything
+    // is attached
+    if (consumer.mKind == ConsumerKind::Test) {
+      continue;
+    }
+    ret |= static_cast<std::underlying_type_t<ConsumerKind>>(consumer.mKind);
+  }
+  return ret;
+}
+
+void ReapConsumers(Segment* segment, ConsumerClock::time_point now) {
+  const auto nowNS = ConsumerTimestamp(now);
+  for (auto& slot: segment->mConsumers) {
+    auto owner = AtomicRef(slot.mOwner).load();
+    if (owner && IsConsumerExpired(AtomicRef(slot.mHeartbeat).load(), nowNS)) {
+      // If this fails, the slot was taken over by a live consumer
+      AtomicRef(slot.mOwner).compare_exchange_strong(owner, 0);
+    }
+  }
+}
+
+ConsumerBits GetFrameEventConsumers(
+  const Segment& segment,
+  ConsumerClock::time_point now) {
+  const auto nowNS = ConsumerTimestamp(now);
+  ConsumerBits ret;
+  for (uint8_t i = 0; i < MaxConsumers; ++i) {
+    const auto& slot = segment.mConsumers[i];
+    if (
+      AtomicRef(slot.mOwner).load() && AtomicRef(slot.mWantsFrameEvents).load()
+      && !IsConsumerExpired(AtomicRef(slot.mHeartbeat).load(), nowNS)) {
+      ret.set(i);
+    }
+  }
+  return ret;
+}
+
+bool TryReadHeader(const Segment& segment, Header* header) {
+  return segment.mSeqLock.Read(
+    segment.mHeader, header, MaxSeqLockReadAttempts);
+}
+
+uint8_t ConsumerHeartbeat(
+  Segment* segment,
+  uint8_t slotHint,
+  ConsumerKind kind,
+  uint32_t processID,
+  uint32_t lastSequenceNumber,
+  ConsumerClock::time_point now) {
+  const auto owner = ConsumerOwner(kind, processID);
+  const auto nowNS = ConsumerTimestamp(now);
+  auto& slots = segment->mConsumers;
+
+  const auto update = [&](uint8_t index) {
+    auto& slot = slots[index];
+    AtomicRef(slot.mLastSequenceNumber).store(lastSequenceNumber);
+    AtomicRef(slot.mHeartbeat).store(nowNS);
+    return index;
+  };
+
+  // Fast path: we still own the slot we used last time
+  if (
+    slotHint < MaxConsumers
+    && AtomicRef(slots[slotHint].mOwner).load() == owner) {
+    return update(slotHint);
+  }
+
+  for (uint8_t i = 0; i < MaxConsumers; ++i) {
+    if (AtomicRef(slots[i].mOwner).load() == owner) {
+      return update(i);
+    }
+  }
+
+  // Claim a free slot, or one whose consumer went away without detaching
+  for (uint8_t i = 0; i < MaxConsumers; ++i) {
+    auto& slot = slots[i];
+    auto previous = AtomicRef(slot.mOwner).load();
+    if (
+      previous
+      && !IsConsumerExpired(AtomicRef(slot.mHeartbeat).load(), nowNS)) {
+      continue;
+    }
+    // Before taking ownership: otherwise, a reaper or another claimant could
+    // see our newly-claimed slot with the old, expired heartbeat, and take
+    // it from us. If we lose the race, the heartbeat is still fresh for
+    // whoever wins.
+    AtomicRef(slot.mHeartbeat).store(nowNS);
+    if (AtomicRef(slot.mOwner).compare_exchange_strong(previous, owner)) {
+      AtomicRef(slot.mWantsFrameEvents).store(0);
+      return update(i);
+    }
+  }
+
+  return MaxConsumers;
+}
+
+void RequestFrameEvents(Segment* segment, uint8_t slot) {
+  if (slot >= MaxConsumers) {
+    return;
+  }
+  AtomicRef(segment->mConsumers[slot].mWantsFrameEvents).store(1);
+}
+
+void DetachConsumer(
+  Segment* segment,
+  uint8_t slot,
+  ConsumerKind kind,
+  uint32_t processID) {
+  if (slot >= MaxConsumers) {
+    return;
+  }
+  auto owner = ConsumerOwner(kind, processID);
+  // If this fails, we already lost the slot
+  AtomicRef(segment->mConsumers[slot].mOwner).compare_exchange_strong(owner, 0);
+}
+
+DamageRegion
+GetLayerDamage(const Header& previous, const Header& next, uint8_t layerIndex) {
+  if (
+    previous.mSessionID != next.mSessionID
+    || layerIndex >= previous.mLayerCount) {
+    return DamageRegion::Full();
+  }
+  const auto& before = previous.mLayers[layerIndex];
+  const auto& after = next.mLayers[layerIndex];
+  if (before.mGeneration == after.mGeneration) {
+    return {};
+  }
+  if (after.mGeneration != before.mGeneration + 1) {
+    return DamageRegion::Full();
+  }
+  return after.mDamage;
+}
+
+bool FeederOvertookReader(const Segment& segment, uint32_t sequenceNumber) {
+  // The feeder writes sequence number N to the texture slot for N, so it
+  // starts overwriting our slot after it has published
+  // `sequenceNumber + TextureCount - 1`
+  const auto current = AtomicRef(segment.mHeader.mSequenceNumber).load();
+  return (current - sequenceNumber) >= TextureCount - 1;
+}
+
+uint32_t GetSequenceNumber(const Segment& segment) {
+  return AtomicRef(segment.mHeader.mSequenceNumber).load();
+}
+
+bool Header::HaveFeeder() const {
+  return (mMagic == *reinterpret_cast<const uint64_t*>(Magic.data()))
+    && ((mFlags & HeaderFlags::FEEDER_ATTACHED)
+        == HeaderFlags::FEEDER_ATTACHED);
+}
+
+size_t Header::GetRenderCacheKey() const {
+  // This is lazy, and only works because:
+  // - session ID already contains random data
+  // - we're only combining *one* other value which isn't
+  // If adding more data, it either needs to be random,
+  // or need something like boost::hash_combine()
+  std::hash<uint64_t> HashUI64;
+  return HashUI64(mSessionID) ^ HashUI64(mSequenceNumber);
+}
+
+bool LayerConfig::IsValid() const {
+  return mImageWidth > 0 && mImageHeight > 0;
+}
+
+ConsumerPattern::ConsumerPattern() = default;
+ConsumerPattern::ConsumerPattern(
+  std::underlying_type_t<ConsumerKind> consumerKindMask)
+  : mKindMask(consumerKindMask) {
+}
+
+std::underlying_type_t<ConsumerKind> ConsumerPattern::GetRawMaskForDebugging()
+  const {
+  return mKindMask;
+}
+
+bool ConsumerPattern::Matches(ConsumerKind kind) const {
+  return (mKindMask & static_cast<std::underlying_type_t<ConsumerKind>>(kind))
+    == mKindMask;
+}
+
+}// namespace OpenKneeboard::SHM
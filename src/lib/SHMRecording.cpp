@@ -0,0 +1,219 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/SHMRecording.h>
+
+#include <format>
+#include <stdexcept>
+#include <string_view>
+
+namespace OpenKneeboard::SHM {
+
+namespace {
+
+constexpr std::string_view FileMagic {"OKBSHMR\0", 8};
+constexpr uint32_t FileVersion = 1;
+
+struct FileHeader final {
+  char mMagic[8];
+  uint32_t mVersion;
+  // Recordings can only be replayed by builds with the same layouts
+  uint32_t mConfigSize;
+  uint32_t mLayerConfigSize;
+  uint32_t mMaxLayers;
+};
+
+enum class RecordFlags : uint8_t {
+  HAVE_CONFIG = 1 << 0,
+  HAVE_PIXEL_HASHES = 1 << 1,
+};
+
+struct RecordHeader final {
+  uint64_t mTimeNS;
+  uint64_t mSessionID;
+  uint32_t mSequenceNumber;
+  std::underlying_type_t<ConsumerKind> mActiveConsumers;
+  uint8_t mFlags;
+  uint8_t mLayerCount;
+};
+
+template <class T>
+  requires std::is_trivially_copyable_v<T>
+void WriteValue(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/// Returns false if there was nothing to read
+template <class T>
+  requires std::is_trivially_copyable_v<T>
+bool ReadValue(std::istream& in, T* value) {
+  in.read(reinterpret_cast<char*>(value), sizeof(T));
+  if (in.gcount() == 0 && in.eof()) {
+    return false;
+  }
+  if (in.gcount() != sizeof(T)) {
+    throw std::runtime_error("SHM recording is truncated");
+  }
+  return true;
+}
+
+template <class T>
+void ReadRequiredValue(std::istream& in, T* value) {
+  if (!ReadValue(in, value)) {
+    throw std::runtime_error("SHM recording is truncated");
+  }
+}
+
+}// namespace
+
+RecordingWriter::RecordingWriter(std::ostream& out) : mOut(out) {
+  FileHeader header {
+    .mVersion = FileVersion,
+    .mConfigSize = sizeof(Config),
+    .mLayerConfigSize = sizeof(LayerConfig),
+    .mMaxLayers = MaxLayers,
+  };
+  FileMagic.copy(header.mMagic, sizeof(header.mMagic));
+  WriteValue(mOut, header);
+}
+
+void RecordingWriter::Write(const RecordedFrame& frame) {
+  if (frame.mLayers.size() > MaxLayers) {
+    throw std::logic_error(std::format(
+      "Can't record {} layers, max is {}", frame.mLayers.size(), MaxLayers));
+  }
+  if (
+    (!frame.mPixelHashes.empty())
+    && frame.mPixelHashes.size() != frame.mLayers.size()) {
+    throw std::logic_error("Need exactly one pixel hash per layer, or none");
+  }
+
+  const auto haveConfig = mPreviousConfig != frame.mConfig;
+  uint8_t flags {};
+  if (haveConfig) {
+    flags |= static_cast<uint8_t>(RecordFlags::HAVE_CONFIG);
+  }
+  if (!frame.mPixelHashes.empty()) {
+    flags |= static_cast<uint8_t>(RecordFlags::HAVE_PIXEL_HASHES);
+  }
+
+  WriteValue(
+    mOut,
+    RecordHeader {
+      .mTimeNS = static_cast<uint64_t>(frame.mTime.count()),
+      .mSessionID = frame.mSessionID,
+      .mSequenceNumber = frame.mSequenceNumber,
+      .mActiveConsumers = frame.mActiveConsumers,
+      .mFlags = flags,
+      .mLayerCount = static_cast<uint8_t>(frame.mLayers.size()),
+    });
+  if (haveConfig) {
+    WriteValue(mOut, frame.mConfig);
+    mPreviousConfig = frame.mConfig;
+  }
+  for (const auto& layer: frame.mLayers) {
+    WriteValue(mOut, layer);
+  }
+  for (const auto hash: frame.mPixelHashes) {
+    WriteValue(mOut, hash);
+  }
+
+  if (!mOut) {
+    throw std::runtime_error("Failed to write SHM recording");
+  }
+}
+
+RecordingReader::RecordingReader(std::istream& in) : mIn(in) {
+  FileHeader header {};
+  if (!ReadValue(mIn, &header)) {
+    throw std::runtime_error("SHM recording is empty");
+  }
+  if (std::string_view {header.mMagic, sizeof(header.mMagic)} != FileMagic) {
+    throw std::runtime_error("Not an OpenKneeboard SHM recording");
+  }
+  if (header.mVersion != FileVersion) {
+    throw std::runtime_error(std::format(
+      "Unsupported SHM recording version {}, expected {}",
+      header.mVersion,
+      FileVersion));
+  }
+  if (
+    header.mConfigSize != sizeof(Config)
+    || header.mLayerConfigSize != sizeof(LayerConfig)
+    || header.mMaxLayers != MaxLayers) {
+    throw std::runtime_error(
+      "SHM recording was made by an incompatible version of OpenKneeboard");
+  }
+}
+
+std::optional<RecordedFrame> RecordingReader::Next() {
+  RecordHeader record {};
+  if (!ReadValue(mIn, &record)) {
+    return {};
+  }
+  if (record.mLayerCount > MaxLayers) {
+    throw std::runtime_error(std::format(
+      "SHM recording has {} layers in a frame, max is {}",
+      record.mLayerCount,
+      MaxLayers));
+  }
+
+  if (record.mFlags & static_cast<uint8_t>(RecordFlags::HAVE_CONFIG)) {
+    ReadRequiredValue(mIn, &mConfig);
+  }
+
+  RecordedFrame frame {
+    .mTime = std::chrono::nanoseconds(record.mTimeNS),
+    .mSessionID = record.mSessionID,
+    .mSequenceNumber = record.mSequenceNumber,
+    .mActiveConsumers = record.mActiveConsumers,
+    .mConfig = mConfig,
+  };
+  frame.mLayers.resize(record.mLayerCount);
+  for (auto& layer: frame.mLayers) {
+    ReadRequiredValue(mIn, &layer);
+  }
+  if (record.mFlags & static_cast<uint8_t>(RecordFlags::HAVE_PIXEL_HASHES)) {
+    frame.mPixelHashes.resize(record.mLayerCount);
+    for (auto& hash: frame.mPixelHashes) {
+      ReadRequiredValue(mIn, &hash);
+    }
+  }
+  return frame;
+}
+
+ReplayScheduler::ReplayScheduler(Clock::time_point start, double speed)
+  : mStart(start), mSpeed(speed) {
+  if (speed < 0) {
+    throw std::logic_error("Replay speed can not be negative");
+  }
+}
+
+ReplayScheduler::Clock::time_point ReplayScheduler::GetDueTime(
+  const RecordedFrame& frame) const {
+  if (mSpeed == 0) {
+    return mStart;
+  }
+  return mStart
+    + std::chrono::duration_cast<Clock::duration>(
+           std::chrono::duration<double, std::nano>(
+             frame.mTime.count() / mSpeed));
+}
+
+}// namespace OpenKneeboard::SHM
@@ -0,0 +1,155 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/Telemetry.h>
+#include <OpenKneeboard/Win32.h>
+
+#include <OpenKneeboard/config.h>
+#include <OpenKneeboard/dprint.h>
+
+#include <Windows.h>
+
+#include <bit>
+#include <format>
+
+namespace OpenKneeboard::Telemetry {
+
+static constexpr DWORD SEGMENT_SIZE = sizeof(Segment);
+
+static auto MappingPath() {
+  static std::wstring sCache;
+  if (!sCache.empty()) [[likely]] {
+    return sCache;
+  }
+  // Unlike the SHM path, this doesn't include the OpenKneeboard version:
+  // producers such as the C API can be from other releases.
+  sCache = std::format(
+    L"{}/Telemetry-v{}-s{:x}", ProjectNameW, ProtocolVersion, SEGMENT_SIZE);
+  return sCache;
+}
+
+namespace {
+// Writers and readers both create the mapping if needed, so they can be
+// started in any order
+class Mapping final {
+ public:
+  Mapping() {
+    auto fileHandle = Win32::CreateFileMappingW(
+      INVALID_HANDLE_VALUE,
+      NULL,
+      PAGE_READWRITE,
+      0,
+      DWORD {SEGMENT_SIZE},// Perfect forwarding fails with static constexpr
+                           // integer values
+      MappingPath().c_str());
+    if (!fileHandle) {
+      dprintf(
+        "Telemetry CreateFileMappingW failed: {}",
+        static_cast<int>(GetLastError()));
+      return;
+    }
+
+    mSegment = reinterpret_cast<Segment*>(
+      MapViewOfFile(fileHandle.get(), FILE_MAP_WRITE, 0, 0, SEGMENT_SIZE));
+    if (!mSegment) {
+      dprintf(
+        "Telemetry MapViewOfFile failed: {:#x}",
+        std::bit_cast<uint32_t>(GetLastError()));
+      return;
+    }
+    mFileHandle = std::move(fileHandle);
+  }
+
+  ~Mapping() {
+    if (mSegment) {
+      UnmapViewOfFile(mSegment);
+    }
+  }
+
+  Mapping(const Mapping&) = delete;
+  Mapping& operator=(const Mapping&) = delete;
+
+  Segment* Get() const {
+    return mSegment;
+  }
+
+ private:
+  winrt::handle mFileHandle;
+  Segment* mSegment = nullptr;
+};
+}// namespace
+
+class Writer::Impl final {
+ public:
+  Mapping mMapping;
+};
+
+Writer::Writer() : p(std::make_unique<Impl>()) {
+  if (!p->mMapping.Get()) {
+    p.reset();
+    return;
+  }
+  InitializeSegment(p->mMapping.Get());
+}
+
+Writer::~Writer() = default;
+
+Writer::operator bool() const {
+  return static_cast<bool>(p);
+}
+
+bool Writer::Publish(const OwnshipRecord& record) {
+  if (!p) {
+    return false;
+  }
+  return Telemetry::Publish(p->mMapping.Get(), record, Clock::now());
+}
+
+class Reader::Impl final {
+ public:
+  Mapping mMapping;
+};
+
+Reader::Reader() : p(std::make_unique<Impl>()) {
+  if (!p->mMapping.Get()) {
+    p.reset();
+  }
+}
+
+Reader::~Reader() = default;
+
+Reader::operator bool() const {
+  return static_cast<bool>(p);
+}
+
+std::optional<Sample> Reader::MaybeGetLatest() const {
+  if (!p) {
+    return {};
+  }
+  Sample sample;
+  if (!TryReadLatest(*p->mMapping.Get(), &sample)) {
+    return {};
+  }
+  if (Clock::now() - sample.mPublishedAt > MaxSampleAge) {
+    return {};
+  }
+  return sample;
+}
+
+}// namespace OpenKneeboard::Telemetry
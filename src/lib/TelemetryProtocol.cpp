@@ -0,0 +1,110 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TelemetryProtocol.h>
+
+#include <atomic>
+
+namespace OpenKneeboard::Telemetry {
+
+template <class T>
+static auto AtomicRef(const T& value) {
+  return std::atomic_ref(const_cast<T&>(value));
+}
+
+static uint64_t MagicValue() {
+  return *reinterpret_cast<const uint64_t*>(Segment::Magic.data());
+}
+
+void InitializeSegment(Segment* segment) {
+  // Every producer writes the same values, so racing is harmless
+  AtomicRef(segment->mVersion).store(ProtocolVersion);
+  AtomicRef(segment->mRecordSize).store(sizeof(OwnshipRecord));
+  AtomicRef(segment->mMagic).store(MagicValue(), std::memory_order_release);
+}
+
+bool Publish(
+  Segment* segment,
+  const OwnshipRecord& record,
+  Clock::time_point now) {
+  const uint64_t publishedAt
+    = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        now.time_since_epoch())
+        .count();
+  // Bounded, as a crashed producer can leave a slot locked forever; if it
+  // left them all locked, a `while (true)` would spin forever in the game
+  for (uint8_t attempt = 0; attempt < RingSize; ++attempt) {
+    const auto sequenceNumber
+      = AtomicRef(segment->mLastSequenceNumber).fetch_add(1) + 1;
+    auto& slot = segment->mSlots[sequenceNumber % RingSize];
+    if (!slot.mSeqLock.TryBeginWrite()) {
+      // Another producer is still writing a previous lap; never wait for it
+      continue;
+    }
+    slot.mContents = {
+      .mSequenceNumber = sequenceNumber,
+      .mPublishedAt = publishedAt,
+      .mOwnship = record,
+    };
+    slot.mSeqLock.EndWrite();
+    return true;
+  }
+  return false;
+}
+
+bool IsCompatible(const Segment& segment) {
+  return AtomicRef(segment.mMagic).load(std::memory_order_acquire)
+    == MagicValue()
+    && AtomicRef(segment.mVersion).load() == ProtocolVersion
+    && AtomicRef(segment.mRecordSize).load() == sizeof(OwnshipRecord);
+}
+
+bool TryReadLatest(const Segment& segment, Sample* sample) {
+  if (!IsCompatible(segment)) {
+    return false;
+  }
+
+  const auto newest = AtomicRef(segment.mLastSequenceNumber).load();
+  // Slots older than the ring may have been overwritten by now
+  for (uint64_t sequenceNumber = newest;
+       sequenceNumber > 0 && (newest - sequenceNumber) < RingSize;
+       --sequenceNumber) {
+    const auto& slot = segment.mSlots[sequenceNumber % RingSize];
+    SlotContents contents;
+    if (!slot.mSeqLock.TryRead(slot.mContents, &contents)) {
+      continue;
+    }
+    // If it's older, the producer that claimed this sequence number hasn't
+    // written it yet, so try the previous one. If it's newer, producers
+    // lapped us after we read `mLastSequenceNumber`, which is fine.
+    if (contents.mSequenceNumber < sequenceNumber) {
+      continue;
+    }
+    *sample = {
+      .mSequenceNumber = contents.mSequenceNumber,
+      .mPublishedAt = Clock::time_point {std::chrono::duration_cast<
+        Clock::duration>(std::chrono::nanoseconds(contents.mPublishedAt))},
+      .mOwnship = contents.mOwnship,
+    };
+    return true;
+  }
+  return false;
+}
+
+}// namespace OpenKneeboard::Telemetry
@@ -114,7 +114,7 @@ VRKneeboard::RenderParameters VRKneeboard::GetRenderParameters(
   const auto isLookingAtKneeboard
     = this->IsLookingAtKneeboard(config, layer, hmdPose, kneeboardPose);
 
-  auto cacheKey = snapshot.GetRenderCacheKey();
+  auto cacheKey = snapshot.GetRenderCacheKey(layer);
   if (isLookingAtKneeboard) {
     cacheKey |= 1;
   } else {
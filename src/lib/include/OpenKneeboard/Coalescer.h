@@ -0,0 +1,116 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include "Executor.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace OpenKneeboard {
+
+/** Merges values pushed before the executor next runs, then passes the
+ * result to a sink on the executor's thread.
+ *
+ * This has no OS dependencies; see `EventCoalescer` for merging event
+ * emissions.
+ */
+template <class T>
+class Coalescer final {
+ public:
+  /// Combine a pending value with a new one
+  using Merge = std::function<T(T pending, T next)>;
+  using Sink = std::function<void(T)>;
+
+  /// Keep the most recent value
+  static T LastValue(T, T next) {
+    return next;
+  }
+
+  Coalescer() = delete;
+  Coalescer(Sink sink, std::shared_ptr<Executor> executor, Merge merge)
+    : mState(std::make_shared<State>()), mExecutor(std::move(executor)) {
+    mState->mSink = std::move(sink);
+    mState->mMerge = std::move(merge);
+  }
+
+  Coalescer(const Coalescer&) = delete;
+  Coalescer& operator=(const Coalescer&) = delete;
+
+  /// Thread-safe
+  void Push(T value) {
+    {
+      std::unique_lock lock(mState->mMutex);
+      if (mState->mPending) {
+        mState->mPending
+          = mState->mMerge(std::move(*mState->mPending), std::move(value));
+        ++mState->mSuppressedCount;
+        return;
+      }
+      mState->mPending = std::move(value);
+    }
+    mExecutor->Post(
+      [weak = std::weak_ptr(mState)]() { FlushState(weak.lock()); });
+  }
+
+  /// Pass on the value now if one is pending; must be called on the
+  /// executor's thread
+  void Flush() {
+    FlushState(mState);
+  }
+
+  /// How many values were merged into another
+  uint64_t GetSuppressedCount() const {
+    std::unique_lock lock(mState->mMutex);
+    return mState->mSuppressedCount;
+  }
+
+ private:
+  // Shared with pending flushes, which may outlive us
+  struct State {
+    std::mutex mMutex;
+    Sink mSink;
+    Merge mMerge;
+    std::optional<T> mPending;
+    uint64_t mSuppressedCount {0};
+  };
+  std::shared_ptr<State> mState;
+  std::shared_ptr<Executor> mExecutor;
+
+  static void FlushState(const std::shared_ptr<State>& state) {
+    if (!state) {
+      return;
+    }
+    std::optional<T> value;
+    {
+      std::unique_lock lock(state->mMutex);
+      value = std::exchange(state->mPending, std::nullopt);
+    }
+    if (value) {
+      state->mSink(std::move(*value));
+    }
+  }
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,95 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace OpenKneeboard {
+
+/// Pixel rectangle; `mRight` and `mBottom` are exclusive, like D3D11_BOX
+struct DamageRect final {
+  uint16_t mLeft {};
+  uint16_t mTop {};
+  uint16_t mRight {};
+  uint16_t mBottom {};
+
+  constexpr bool IsEmpty() const noexcept {
+    return mRight <= mLeft || mBottom <= mTop;
+  }
+
+  /// Overlapping or sharing an edge
+  bool Touches(const DamageRect&) const noexcept;
+  bool Contains(const DamageRect&) const noexcept;
+  DamageRect Union(const DamageRect&) const noexcept;
+  DamageRect Intersection(const DamageRect&) const noexcept;
+
+  bool operator==(const DamageRect&) const noexcept = default;
+};
+
+/** The pixels in a layer that changed since some earlier frame.
+ *
+ * This is a fixed-size, trivially-copyable type so that it can be placed in
+ * shared memory as part of `SHM::LayerConfig`.
+ *
+ * Overlapping or touching rectangles are merged; if that still leaves more
+ * than `MaxRects` rectangles, the region becomes 'full', i.e. the entire
+ * layer should be treated as changed.
+ */
+class DamageRegion final {
+ public:
+  static constexpr uint8_t MaxRects = 8;
+
+  static constexpr DamageRegion Full() noexcept {
+    DamageRegion ret;
+    ret.mIsFull = true;
+    return ret;
+  }
+
+  void Add(const DamageRect&) noexcept;
+  void Add(const DamageRegion&) noexcept;
+  void MarkFull() noexcept;
+  void Clear() noexcept;
+
+  /// Drop anything outside of the image; full regions remain full.
+  void ClipTo(uint16_t width, uint16_t height) noexcept;
+
+  bool IsEmpty() const noexcept;
+  bool IsFull() const noexcept;
+
+  /// Empty if `IsFull()`
+  std::span<const DamageRect> GetRects() const noexcept;
+  /// Empty if `IsFull()`
+  DamageRect GetBounds() const noexcept;
+
+  bool operator==(const DamageRegion&) const noexcept = default;
+
+ private:
+  bool mIsFull {false};
+  uint8_t mRectCount {0};
+  DamageRect mRects[MaxRects] {};
+
+  void Remove(uint8_t index) noexcept;
+};
+static_assert(std::is_standard_layout_v<DamageRegion>);
+static_assert(std::is_trivially_copyable_v<DamageRegion>);
+
+}// namespace OpenKneeboard
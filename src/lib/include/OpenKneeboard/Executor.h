@@ -0,0 +1,83 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include "MPSCQueue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace OpenKneeboard {
+
+/** Runs tasks on a single thread, in the order they were posted.
+ *
+ * Tasks can be posted from any thread without taking a lock. The owner is
+ * told that there's work to do at most once per batch: tasks posted before
+ * the next `Drain()` share a wake-up, rather than each needing a context
+ * switch.
+ *
+ * This has no OS dependencies; the wake callback decides how to get back
+ * to the executor's thread.
+ */
+class Executor final : public std::enable_shared_from_this<Executor> {
+ public:
+  using Task = std::function<void()>;
+  /** Arrange for `Drain()` to be called on the executor's thread.
+   *
+   * Called from the thread that posted the task; the executor may be
+   * destroyed before the callback gets anywhere, hence the weak_ptr.
+   */
+  using WakeCallback = std::function<void(std::weak_ptr<Executor>)>;
+
+  Executor() = delete;
+  static std::shared_ptr<Executor> Create(WakeCallback);
+  ~Executor();
+
+  /// Thread-safe and lock-free, other than allocating
+  void Post(Task);
+
+  /** Run everything that's been posted so far.
+   *
+   * Tasks posted while draining - including by the tasks themselves - are
+   * left for the next wake-up, so a task that re-posts itself can't keep
+   * this from returning.
+   *
+   * Must only be called from the executor's thread. Returns the number of
+   * tasks that were run.
+   */
+  size_t Drain();
+
+ private:
+  Executor(WakeCallback);
+
+  WakeCallback mWake;
+  MPSCQueue<Task> mTasks;
+  std::atomic<bool> mWakePending {false};
+  // Incremented after a task is pushed; compared to `mRunCount` to find how
+  // many tasks `Drain()` is responsible for
+  std::atomic<uint64_t> mPostCount {0};
+  // Only used on the executor's thread
+  uint64_t mRunCount {0};
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,93 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// Decides when to render, based on what has changed; this has no OS
+// dependencies, and doesn't wait itself - the caller waits until
+// `GetNextFrameTime()`, and is woken early when `MarkDirty()` says so.
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace OpenKneeboard {
+
+class FrameScheduler final {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = Clock::duration;
+  using TimePoint = Clock::time_point;
+  using SourceID = size_t;
+
+  FrameScheduler() = delete;
+  /** Frames are never closer together than `maxFPS` allows.
+   *
+   * If `minFPS` is non-zero, frames are scheduled at least that often even
+   * if nothing is dirty, e.g. for clocks; if it's zero, nothing is scheduled
+   * until something is dirty.
+   */
+  FrameScheduler(float minFPS, float maxFPS);
+
+  void SetFramesPerSecond(float minFPS, float maxFPS);
+
+  /** Add something that can request frames.
+   *
+   * If `maxFPS` is non-zero, requests from this source are delayed so that
+   * they're serviced no more often than that.
+   */
+  SourceID AddSource(float maxFPS = 0);
+
+  /** Request a frame.
+   *
+   * Returns true if this moves the next frame earlier; if so, anything
+   * waiting for `GetNextFrameTime()` needs to be woken up.
+   */
+  bool MarkDirty(SourceID);
+
+  /// Returns nullopt if there's nothing to do until `MarkDirty()`
+  std::optional<TimePoint> GetNextFrameTime() const;
+
+  /** Call when starting a frame.
+   *
+   * Returns true if a source was dirty and allowed to be serviced; those
+   * sources are now clean. Returns false for frames that only exist to
+   * maintain the minimum rate.
+   */
+  bool BeginFrame(TimePoint now);
+
+ private:
+  struct Source {
+    Duration mMinInterval {};
+    TimePoint mServicedAt {};
+    bool mIsDirty {false};
+  };
+
+  mutable std::mutex mMutex;
+  Duration mMinInterval {};
+  std::optional<Duration> mMaxInterval;
+  TimePoint mLastFrameAt {};
+  std::vector<Source> mSources;
+
+  std::optional<TimePoint> GetNextFrameTimeLocked() const;
+};
+
+}// namespace OpenKneeboard
@@ -19,15 +19,21 @@
  */
 #pragma once
 
+#include <OpenKneeboard/GameEventTransport.h>
 #include <OpenKneeboard/json_fwd.h>
 #include <OpenKneeboard/utf8.h>
 
 #include <cstddef>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace OpenKneeboard {
+struct GameEventView;
+
 struct GameEvent final {
   // These are both required to be UTF-8
   std::string name;
@@ -61,9 +67,47 @@ struct GameEvent final {
 
   operator bool() const;
 
+  /** Parse and copy a packet.
+   *
+   * Both the current and legacy (v1) wire formats are accepted. Returns an
+   * empty event if the packet is invalid.
+   *
+   * Prefer `GameEventView::Parse()` unless you need to keep the event.
+   */
   static GameEvent Unserialize(std::string_view packet);
+  /** Parse a packet, expanding multi-events, and append to `events`.
+   *
+   * Both packed and JSON multi-events are expanded; JSON multi-events are
+   * streamed rather than parsed into a temporary document. Returns false
+   * and leaves `events` unchanged if the packet is invalid.
+   */
+  static bool UnserializeAll(
+    std::string_view packet,
+    std::vector<GameEvent>* events);
   std::vector<std::byte> Serialize() const;
+  /** Serialize several events as one `EVT_MULTI_EVENT` packet.
+   *
+   * Unlike a JSON multi-event, the events can be parsed in-place with
+   * `GameEventView::ParseNext()`.
+   */
+  static std::vector<std::byte> SerializePacked(std::span<const GameEvent>);
   void Send() const;
+  /** Queue the event to be sent from a thread pool thread.
+   *
+   * This doesn't wait for the mailslot, so it's suitable for game threads.
+   * Events queued close together are combined into one packet; if the queue
+   * is full, newer values of state events replace queued ones, and other
+   * events are dropped.
+   */
+  void SendAsync() const;
+  /// Synchronously send anything queued by `SendAsync()`
+  static void FlushAsyncSends();
+
+  /** Change where `Send()` and `SendAsync()` deliver events.
+   *
+   * Defaults to the mailslot; pass nullptr to restore the default.
+   */
+  static void SetSender(std::shared_ptr<IGameEventSender>);
 
   static const wchar_t* GetMailslotPath();
 
@@ -91,6 +135,25 @@ struct GameEvent final {
   static constexpr char EVT_MULTI_EVENT[] = "MultiEvent";
 };
 
+/// A parsed event that refers to the packet, rather than copying it
+struct GameEventView final {
+  std::string_view name;
+  std::string_view value;
+  /// `value` is a sequence of serialized events, rather than UTF-8
+  bool isPacked {false};
+
+  /// Accepts both wire formats; returns nullopt if the packet is invalid
+  static std::optional<GameEventView> Parse(std::string_view packet);
+  /** Parse the first event in a packed value, and remove it from `packed`.
+   *
+   * Returns nullopt at the end, or if the rest of the value is invalid.
+   */
+  static std::optional<GameEventView> ParseNext(std::string_view* packed);
+
+  /// Packed events are converted to the JSON `EVT_MULTI_EVENT` format
+  GameEvent ToGameEvent() const;
+};
+
 struct BaseSetTabEvent {
   // 0 = no change
   uint64_t mPageNumber {0};
@@ -0,0 +1,70 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/GameEvent.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Decides which state events need sending, given the full current state.
+ *
+ * Only events whose values have changed since they were last sent are
+ * returned, except for periodic keyframes which include everything, so that
+ * an app that starts after the game still gets the whole state.
+ *
+ * Events that are missing from a state are forgotten, so they're sent again
+ * when they come back.
+ *
+ * This has no OS dependencies, and isn't thread-safe.
+ */
+class GameEventDeltaEncoder final {
+ public:
+  struct Statistics {
+    uint64_t mUpdates {};
+    uint64_t mKeyframes {};
+    uint64_t mSent {};
+    uint64_t mSkipped {};
+  };
+
+  GameEventDeltaEncoder() = delete;
+  /// Every `keyframeInterval`th update is a keyframe; it must not be 0
+  GameEventDeltaEncoder(size_t keyframeInterval);
+
+  std::vector<GameEvent> Update(std::span<const GameEvent> state);
+  /// Make the next update a keyframe
+  void ForceKeyframe();
+
+  Statistics GetStatistics() const;
+
+ private:
+  const size_t mKeyframeInterval;
+  size_t mUpdatesUntilKeyframe {0};
+  std::unordered_map<std::string, std::string> mLastSent;
+  Statistics mStatistics;
+};
+
+}// namespace OpenKneeboard
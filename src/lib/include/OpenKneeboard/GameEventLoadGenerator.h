@@ -0,0 +1,115 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// Synthetic GameEvent traffic, and measuring its delivery, for load testing
+// transports and the event pipeline. This has no OS dependencies.
+
+#include <OpenKneeboard/GameEvent.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace OpenKneeboard {
+
+struct GameEventLoadProfile {
+  enum class PayloadDistribution {
+    Uniform,
+    // Mostly small events, with occasional large ones - similar to DCS
+    LogUniform,
+  };
+
+  double mEventsPerSecond {1000};
+  /// Events are sent back-to-back in bursts of this size
+  size_t mBurstSize {1};
+  size_t mMinPayloadBytes {64};
+  size_t mMaxPayloadBytes {64};
+  PayloadDistribution mPayloadDistribution {PayloadDistribution::Uniform};
+  std::chrono::nanoseconds mDuration {std::chrono::seconds(10)};
+};
+
+class GameEventLoadGenerator final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr char EventName[] = "OpenKneeboard/LoadTest";
+
+  GameEventLoadGenerator() = delete;
+  /// Throws std::logic_error if the profile is invalid
+  GameEventLoadGenerator(const GameEventLoadProfile&, uint32_t seed = 0);
+
+  struct Burst {
+    /// Since the start of the run
+    Clock::duration mDueAt {};
+    size_t mSize {};
+  };
+  /// Returns nullopt once the profile's duration has passed
+  std::optional<Burst> NextBurst();
+
+  /// The payload includes a sequence number, and `sentAt`
+  GameEvent CreateEvent(Clock::time_point sentAt);
+
+  uint64_t GetCreatedCount() const;
+
+ private:
+  GameEventLoadProfile mProfile;
+  std::mt19937 mRandom;
+  uint64_t mBurstCount {0};
+  uint64_t mCreatedCount {0};
+
+  size_t GetNextPayloadSize();
+};
+
+class GameEventDeliveryStats final {
+ public:
+  using Clock = GameEventLoadGenerator::Clock;
+
+  /// Returns false if the event isn't from a `GameEventLoadGenerator`
+  bool Record(const GameEvent&, Clock::time_point receivedAt);
+
+  uint64_t GetReceivedCount() const;
+
+  struct Summary {
+    uint64_t mSent {};
+    uint64_t mReceived {};
+    uint64_t mDropped {};
+    uint64_t mDuplicates {};
+    uint64_t mOutOfOrder {};
+    Clock::duration mP50 {};
+    Clock::duration mP90 {};
+    Clock::duration mP99 {};
+    Clock::duration mP999 {};
+    Clock::duration mMax {};
+  };
+  Summary Summarize(uint64_t sentCount) const;
+
+ private:
+  std::vector<bool> mSeen;
+  std::vector<Clock::duration> mLatencies;
+  uint64_t mDuplicates {0};
+  uint64_t mOutOfOrder {0};
+  std::optional<uint64_t> mLastSequence;
+};
+
+}// namespace OpenKneeboard
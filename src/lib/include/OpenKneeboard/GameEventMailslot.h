@@ -0,0 +1,70 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/GameEventTransport.h>
+
+#include <shims/winrt/base.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace OpenKneeboard {
+
+/// The default transport, to `GameEventServer`
+class MailslotGameEventSender final : public IGameEventSender {
+ public:
+  /// Defaults to `GameEvent::GetMailslotPath()`
+  MailslotGameEventSender();
+  MailslotGameEventSender(std::wstring path);
+  ~MailslotGameEventSender();
+
+  bool Send(std::span<const std::byte> packet) override;
+
+ private:
+  std::mutex mMutex;
+  std::wstring mPath;
+  winrt::file_handle mHandle;
+  std::chrono::steady_clock::time_point mLastOpenAttempt {};
+
+  bool OpenHandle();
+};
+
+/** Creates and reads a mailslot.
+ *
+ * `GameEventServer` uses this with `GameEvent::GetMailslotPath()`; tools can
+ * create their own, for example to measure delivery without the app.
+ */
+class MailslotGameEventReceiver final : public IGameEventReceiver {
+ public:
+  MailslotGameEventReceiver() = delete;
+  /// Throws `winrt::hresult_error` if the mailslot can't be created
+  MailslotGameEventReceiver(std::wstring path);
+  ~MailslotGameEventReceiver();
+
+  std::optional<std::vector<std::byte>> Receive(
+    std::chrono::milliseconds timeout) override;
+
+ private:
+  winrt::file_handle mHandle;
+};
+
+}// namespace OpenKneeboard
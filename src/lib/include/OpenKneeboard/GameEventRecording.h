@@ -0,0 +1,97 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// Recording and replaying received GameEvents, without any OS dependencies.
+//
+// The file is a header followed by one record per received packet: the time
+// since the first packet, the event count, then each event's name and value.
+// Events are recorded as received - before deduplication, and keeping packet
+// boundaries - so a replay reproduces the original load.
+
+#include <OpenKneeboard/GameEvent.h>
+
+#include <chrono>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/// The events from a single packet
+struct RecordedGameEventBatch final {
+  // Since the first batch in the recording
+  std::chrono::nanoseconds mTime {};
+  std::vector<GameEvent> mEvents;
+};
+
+class GameEventRecordingWriter final {
+ public:
+  GameEventRecordingWriter() = delete;
+  /// `out` must be opened in binary mode, and outlive the writer
+  GameEventRecordingWriter(std::ostream& out);
+
+  /// Throws std::runtime_error if writing fails
+  void Write(const RecordedGameEventBatch&);
+
+ private:
+  std::ostream& mOut;
+};
+
+class GameEventRecordingReader final {
+ public:
+  GameEventRecordingReader() = delete;
+  /** `in` must be opened in binary mode, and outlive the reader.
+   *
+   * Throws std::runtime_error if this isn't a recording, or it's from an
+   * incompatible version.
+   */
+  GameEventRecordingReader(std::istream& in);
+
+  /** Returns nullopt at the end of the recording.
+   *
+   * Throws std::runtime_error if the recording is truncated or corrupt.
+   */
+  std::optional<RecordedGameEventBatch> Next();
+
+ private:
+  std::istream& mIn;
+};
+
+/// When to deliver each batch of a replay
+class GameEventReplayScheduler final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  GameEventReplayScheduler() = delete;
+  /** `speed` is a multiplier, e.g. 2.0 replays at double speed; 0 replays
+   * as fast as possible.
+   */
+  GameEventReplayScheduler(Clock::time_point start, double speed);
+
+  Clock::time_point GetDueTime(const RecordedGameEventBatch&) const;
+
+ private:
+  Clock::time_point mStart;
+  double mSpeed;
+};
+
+}// namespace OpenKneeboard
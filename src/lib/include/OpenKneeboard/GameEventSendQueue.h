@@ -0,0 +1,98 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/GameEvent.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Events waiting to be sent, and how to batch them.
+ *
+ * This has no OS dependencies: it doesn't send anything, it just decides
+ * what the next packet should be. It's thread-safe, and never waits for
+ * anything other than its own short-lived lock.
+ */
+class GameEventSendQueue final {
+ public:
+  /// Only the latest value of these events matters
+  using IsStateEvent = std::function<bool(std::string_view name)>;
+  using SendPacket = std::function<void(std::span<const std::byte>)>;
+
+  struct Statistics {
+    uint64_t mQueued {};
+    // Replaced by a newer value of the same state event while queued
+    uint64_t mMerged {};
+    // The queue was full, and it wasn't a state event we could merge
+    uint64_t mDropped {};
+    uint64_t mPackets {};
+  };
+
+  GameEventSendQueue() = delete;
+  GameEventSendQueue(
+    size_t capacity,
+    size_t maxEventsPerPacket,
+    IsStateEvent isStateEvent);
+
+  /** Returns false if the event was dropped.
+   *
+   * If the queue is full, a new value for a state event replaces the queued
+   * one; anything else is dropped.
+   */
+  bool Push(GameEvent);
+
+  /** Remove the next batch of events, serialized.
+   *
+   * Returns an empty vector if there's nothing to send; several events are
+   * combined with `GameEvent::SerializePacked()`.
+   */
+  std::vector<std::byte> PopPacket();
+
+  /** Send packets until the queue is empty.
+   *
+   * Concurrent flushes are serialized, so packets are sent in the order they
+   * were popped; `Push()` doesn't wait for them.
+   */
+  void Flush(const SendPacket&);
+
+  bool IsEmpty() const;
+  Statistics GetStatistics() const;
+
+ private:
+  const size_t mCapacity;
+  const size_t mMaxEventsPerPacket;
+  const IsStateEvent mIsStateEvent;
+
+  // Held across each `PopPacket()` and send; always taken before `mMutex`
+  std::mutex mFlushMutex;
+  mutable std::mutex mMutex;
+  std::deque<GameEvent> mEvents;
+  Statistics mStatistics;
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,55 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// How serialized GameEvent packets get from a sender to a receiver.
+//
+// `GameEventServer` listens on the mailslot by default; other transports are
+// for measuring and testing the event pipeline, e.g. on machines without
+// mailslots.
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/// Implementations must be thread-safe
+class IGameEventSender {
+ public:
+  virtual ~IGameEventSender() = default;
+
+  /// Returns false if the packet wasn't sent, e.g. if nothing's listening
+  virtual bool Send(std::span<const std::byte> packet) = 0;
+};
+
+class IGameEventReceiver {
+ public:
+  virtual ~IGameEventReceiver() = default;
+
+  /// Returns nullopt if there's no packet before the timeout
+  virtual std::optional<std::vector<std::byte>> Receive(
+    std::chrono::milliseconds timeout)
+    = 0;
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,85 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <OpenKneeboard/GameEventTransport.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace OpenKneeboard {
+
+/* A Unix domain socket transport.
+ *
+ * Unlike mailslots, this is also available on Linux, so the event pipeline
+ * can be measured there. Windows only supports stream sockets in the Unix
+ * domain, so packets are length-prefixed rather than sent as datagrams.
+ *
+ * Paths are UTF-8, and limited to ~100 bytes by the OS.
+ */
+
+class UnixSocketGameEventSender final : public IGameEventSender {
+ public:
+  UnixSocketGameEventSender() = delete;
+  UnixSocketGameEventSender(std::string path);
+  ~UnixSocketGameEventSender();
+
+  bool Send(std::span<const std::byte> packet) override;
+
+ private:
+  std::mutex mMutex;
+  std::string mPath;
+  std::intptr_t mSocket {-1};
+  std::chrono::steady_clock::time_point mLastConnectAttempt {};
+
+  bool Connect();
+  void Disconnect();
+  bool SendFrame(std::span<const std::byte> packet);
+};
+
+class UnixSocketGameEventReceiver final : public IGameEventReceiver {
+ public:
+  UnixSocketGameEventReceiver() = delete;
+  /// Throws `std::system_error` if the socket can't be created
+  UnixSocketGameEventReceiver(std::string path);
+  ~UnixSocketGameEventReceiver();
+
+  /// Not thread-safe
+  std::optional<std::vector<std::byte>> Receive(
+    std::chrono::milliseconds timeout) override;
+
+ private:
+  struct Connection {
+    std::intptr_t mSocket {-1};
+    std::vector<std::byte> mBuffer;
+  };
+
+  std::string mPath;
+  std::intptr_t mListener {-1};
+  std::vector<Connection> mConnections;
+  std::deque<std::vector<std::byte>> mPackets;
+
+  /// Returns false if the connection should be closed
+  bool ReadFrom(Connection&);
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,159 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace OpenKneeboard {
+
+struct LRUCacheStatistics {
+  uint64_t mHits {};
+  uint64_t mMisses {};
+  // Entries removed to stay within the budget
+  uint64_t mEvictions {};
+  size_t mEntryCount {};
+  size_t mTotalCost {};
+};
+
+/** A least-recently-used cache with a total cost budget.
+ *
+ * Each entry has a cost - e.g. its size in bytes - and inserting evicts the
+ * least recently used entries until the total cost fits in the budget. An
+ * entry that costs more than the whole budget is not stored.
+ *
+ * This is not thread-safe; `Find()` is a write, as it updates the order.
+ */
+template <class TKey, class TValue, class THash = std::hash<TKey>>
+class LRUCache final {
+ public:
+  using Statistics = LRUCacheStatistics;
+
+  LRUCache() = delete;
+  explicit LRUCache(size_t budget) : mBudget(budget) {
+  }
+
+  /// Returns nullptr if not found; the pointer is valid until the entry is
+  /// removed
+  TValue* Find(const TKey& key) {
+    const auto it = mIndex.find(key);
+    if (it == mIndex.end()) {
+      ++mStatistics.mMisses;
+      return nullptr;
+    }
+    ++mStatistics.mHits;
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return &it->second->mValue;
+  }
+
+  /** Replaces any existing entry with the same key.
+   *
+   * Returns the keys of any entries evicted to stay within the budget.
+   */
+  std::vector<TKey> Insert(const TKey& key, TValue value, size_t cost) {
+    this->Erase(key);
+    if (cost > mBudget) {
+      return {};
+    }
+    mEntries.push_front({key, std::move(value), cost});
+    mIndex.emplace(key, mEntries.begin());
+    mStatistics.mTotalCost += cost;
+    return this->EvictToBudget();
+  }
+
+  void Erase(const TKey& key) {
+    const auto it = mIndex.find(key);
+    if (it != mIndex.end()) {
+      this->Erase(it->second);
+    }
+  }
+
+  /// Remove entries without counting them as evictions, e.g. when stale
+  template <std::predicate<const TKey&> TPred>
+  void EraseIf(TPred pred) {
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+      if (pred(it->mKey)) {
+        it = this->Erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void Clear() {
+    mEntries.clear();
+    mIndex.clear();
+    mStatistics.mTotalCost = 0;
+  }
+
+  size_t GetBudget() const {
+    return mBudget;
+  }
+
+  /// Returns the keys of any entries evicted to stay within the budget
+  std::vector<TKey> SetBudget(size_t budget) {
+    mBudget = budget;
+    return this->EvictToBudget();
+  }
+
+  Statistics GetStatistics() const {
+    auto ret = mStatistics;
+    ret.mEntryCount = mEntries.size();
+    return ret;
+  }
+
+ private:
+  struct Entry {
+    TKey mKey;
+    TValue mValue;
+    size_t mCost;
+  };
+  // Most recently used first
+  using EntryList = std::list<Entry>;
+
+  size_t mBudget;
+  EntryList mEntries;
+  std::unordered_map<TKey, typename EntryList::iterator, THash> mIndex;
+  Statistics mStatistics;
+
+  typename EntryList::iterator Erase(typename EntryList::iterator it) {
+    mStatistics.mTotalCost -= it->mCost;
+    mIndex.erase(it->mKey);
+    return mEntries.erase(it);
+  }
+
+  std::vector<TKey> EvictToBudget() {
+    std::vector<TKey> evicted;
+    while (mStatistics.mTotalCost > mBudget) {
+      const auto it = std::prev(mEntries.end());
+      evicted.push_back(it->mKey);
+      this->Erase(it);
+      ++mStatistics.mEvictions;
+    }
+    return evicted;
+  }
+};
+
+}// namespace OpenKneeboard
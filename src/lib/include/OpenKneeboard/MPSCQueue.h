@@ -0,0 +1,89 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <atomic>
+#include <optional>
+
+namespace OpenKneeboard {
+
+/** Unbounded multi-producer, single-consumer queue.
+ *
+ * `Push()` is lock-free and may be called from any thread; `TryPop()` must
+ * only be called from one thread at a time.
+ *
+ * This is Dmitry Vyukov's intrusive MPSC queue: a push is a single atomic
+ * exchange. A push that's in progress can briefly hide later pushes from the
+ * consumer, so `TryPop()` returning nullopt doesn't mean that no push has
+ * finished - producers need some other way to tell the consumer to try again.
+ */
+template <class T>
+class MPSCQueue final {
+ public:
+  MPSCQueue() {
+    auto stub = new Node();
+    mHead.store(stub);
+    mTail = stub;
+  }
+
+  ~MPSCQueue() {
+    while (TryPop()) {
+    }
+    delete mTail;
+  }
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue(MPSCQueue&&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(MPSCQueue&&) = delete;
+
+  void Push(T value) {
+    auto node = new Node {.mValue = std::move(value)};
+    auto previous = mHead.exchange(node, std::memory_order_acq_rel);
+    previous->mNext.store(node, std::memory_order_release);
+  }
+
+  std::optional<T> TryPop() {
+    auto tail = mTail;
+    auto next = tail->mNext.load(std::memory_order_acquire);
+    if (!next) {
+      return {};
+    }
+    // `next` becomes the new stub
+    std::optional<T> ret {std::move(next->mValue)};
+    next->mValue.reset();
+    mTail = next;
+    delete tail;
+    return ret;
+  }
+
+ private:
+  struct Node {
+    std::atomic<Node*> mNext {nullptr};
+    std::optional<T> mValue;
+  };
+
+  // Producers
+  std::atomic<Node*> mHead;
+  // Consumer
+  Node* mTail {nullptr};
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,107 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// Decides which pages to render ahead of time; this has no OS or GPU
+// dependencies; the caller does the rendering.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Queue of pages near the ones that are being shown.
+ *
+ * Each owner - e.g. a view - has a current page; its neighbors are queued,
+ * next pages first, as reading forwards is most common. When the current
+ * page changes, anything still queued for the old one is cancelled.
+ *
+ * Not thread-safe.
+ */
+class PrefetchQueue final {
+ public:
+  using OwnerID = uint64_t;
+  using PageID = uint64_t;
+
+  struct Request {
+    OwnerID mOwner {};
+    PageID mPage {};
+  };
+
+  PrefetchQueue() = delete;
+  /// `radius` is how many pages to queue on each side of the current page
+  explicit PrefetchQueue(size_t radius);
+
+  /** Update what an owner is showing.
+   *
+   * Pages that have already been queued or shown since the last
+   * `Invalidate()` aren't queued again.
+   */
+  void SetCurrentPage(
+    OwnerID,
+    std::span<const PageID> pages,
+    PageID current);
+  /// Forget what's been prefetched, e.g. because the content changed
+  void Invalidate(OwnerID);
+  /** Allow a page to be queued again, e.g. because it was evicted from a
+   * cache.
+   *
+   * It's queued by the next `SetCurrentPage()` that changes the owner's
+   * current page to one near it.
+   */
+  void Forget(PageID);
+  void Remove(OwnerID);
+
+  /// Take the next request; this alternates between owners
+  std::optional<Request> Pop();
+  bool IsEmpty() const;
+
+  /** Whether a page is small enough to prefetch into a cache.
+   *
+   * Large pages would push the pages the user is actually looking at out of
+   * the cache.
+   */
+  static constexpr bool IsWorthPrefetching(
+    size_t pageCost,
+    size_t cacheBudget) {
+    return pageCost <= cacheBudget / 8;
+  }
+
+ private:
+  struct Owner {
+    OwnerID mID {};
+    std::optional<PageID> mCurrent {};
+    std::deque<PageID> mPending {};
+    std::unordered_set<PageID> mDone {};
+  };
+
+  size_t mRadius;
+  std::vector<Owner> mOwners;
+  size_t mNextOwner {0};
+
+  Owner& GetOwner(OwnerID);
+};
+
+}// namespace OpenKneeboard
@@ -0,0 +1,165 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace OpenKneeboard {
+
+/** Maps strings to values, and finds the values for every prefix of a key.
+ *
+ * For example, with values for "", "dcs/", and "dcs/Aircraft", visiting the
+ * prefixes of "dcs/Aircraft" finds all three, but "dcs/Terrain" only finds
+ * the first two.
+ *
+ * Matching walks the key once, no matter how many entries there are.
+ *
+ * This is not thread-safe.
+ */
+template <class TValue>
+class PrefixTrie final {
+ public:
+  /// Returns the existing value, or inserts a default-constructed one
+  TValue& GetOrCreate(std::string_view key) {
+    auto node = &mRoot;
+    for (const auto c: key) {
+      node = &node->GetOrCreateChild(c);
+    }
+    if (!node->mValue) {
+      node->mValue.emplace();
+      ++mSize;
+    }
+    return *node->mValue;
+  }
+
+  /// Exact match only; returns nullptr if not found
+  TValue* Find(std::string_view key) {
+    auto node = &mRoot;
+    for (const auto c: key) {
+      node = node->FindChild(c);
+      if (!node) {
+        return nullptr;
+      }
+    }
+    return node->mValue ? &*node->mValue : nullptr;
+  }
+
+  /// Returns false if there was no value for exactly this key
+  bool Erase(std::string_view key) {
+    if (!EraseFrom(&mRoot, key)) {
+      return false;
+    }
+    --mSize;
+    return true;
+  }
+
+  /** Call `func(prefix, value)` for every entry that is a prefix of `key`.
+   *
+   * This includes an entry for `key` itself, and is shortest-first.
+   */
+  template <std::invocable<std::string_view, TValue&> F>
+  void ForEachPrefixOf(std::string_view key, F&& func) {
+    auto node = &mRoot;
+    for (size_t i = 0;; ++i) {
+      if (node->mValue) {
+        func(key.substr(0, i), *node->mValue);
+      }
+      if (i == key.size()) {
+        return;
+      }
+      node = node->FindChild(key[i]);
+      if (!node) {
+        return;
+      }
+    }
+  }
+
+  size_t GetSize() const noexcept {
+    return mSize;
+  }
+
+ private:
+  struct Node {
+    std::optional<TValue> mValue;
+    // Sorted by character; most nodes only have one or two children, so
+    // this is smaller and faster than a map
+    std::vector<std::pair<char, std::unique_ptr<Node>>> mChildren;
+
+    auto LowerBound(char c) {
+      return std::ranges::lower_bound(
+        mChildren, c, {}, [](const auto& child) { return child.first; });
+    }
+
+    Node* FindChild(char c) {
+      const auto it = LowerBound(c);
+      if (it == mChildren.end() || it->first != c) {
+        return nullptr;
+      }
+      return it->second.get();
+    }
+
+    Node& GetOrCreateChild(char c) {
+      auto it = LowerBound(c);
+      if (it == mChildren.end() || it->first != c) {
+        it = mChildren.emplace(it, c, std::make_unique<Node>());
+      }
+      return *it->second;
+    }
+
+    bool IsEmpty() const {
+      return mChildren.empty() && !mValue;
+    }
+  };
+
+  Node mRoot;
+  size_t mSize {};
+
+  // Removes nodes that no longer lead to a value
+  static bool EraseFrom(Node* node, std::string_view key) {
+    if (key.empty()) {
+      if (!node->mValue) {
+        return false;
+      }
+      node->mValue.reset();
+      return true;
+    }
+
+    const auto it = node->LowerBound(key.front());
+    if (it == node->mChildren.end() || it->first != key.front()) {
+      return false;
+    }
+    if (!EraseFrom(it->second.get(), key.substr(1))) {
+      return false;
+    }
+    if (it->second->IsEmpty()) {
+      node->mChildren.erase(it);
+    }
+    return true;
+  }
+};
+
+}// namespace OpenKneeboard
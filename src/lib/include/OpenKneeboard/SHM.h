@@ -19,8 +19,7 @@
  */
 #pragma once
 
-#include "FlatConfig.h"
-#include "VRConfig.h"
+#include "SHMProtocol.h"
 
 #include <OpenKneeboard/config.h>
 
@@ -41,14 +40,14 @@
 
 namespace OpenKneeboard::SHM {
 
-struct Header;
-
 static constexpr DXGI_FORMAT SHARED_TEXTURE_PIXEL_FORMAT
   = DXGI_FORMAT_B8G8R8A8_UNORM;
 static constexpr bool SHARED_TEXTURE_IS_PREMULTIPLIED_B8G8R8A8 = true;
 static constexpr bool SHARED_TEXTURE_IS_PREMULTIPLIED = true;
 
 using LayerTextures = std::array<winrt::com_ptr<ID3D11Texture2D>, MaxLayers>;
+// What needs copying for each layer; empty if the layer is unchanged
+using LayerDamage = std::array<DamageRegion, MaxLayers>;
 
 std::wstring SharedTextureName(
   uint64_t sessionID,
@@ -64,47 +63,6 @@ winrt::com_ptr<ID3D11Texture2D> CreateCompatibleTexture(
   UINT bindFlags = DEFAULT_D3D11_BIND_FLAGS,
   UINT miscFlags = DEFAULT_D3D11_MISC_FLAGS);
 
-enum class ConsumerKind : uint32_t {
-  SteamVR = 1 << 0,
-  OpenXR = 1 << 1,
-  OculusD3D11 = 1 << 2,
-  OculusD3D12 = 1 << 3,
-  NonVRD3D11 = 1 << 4,
-  Test = ~(0ui32),
-};
-
-class ConsumerPattern final {
- public:
-  ConsumerPattern();
-  ConsumerPattern(std::underlying_type_t<ConsumerKind>(consumerKindMask));
-  ConsumerPattern(ConsumerKind kind)
-    : mKindMask(std::underlying_type_t<ConsumerKind>(kind)) {
-  }
-
-  bool Matches(ConsumerKind) const;
-
-  std::underlying_type_t<ConsumerKind> GetRawMaskForDebugging() const;
-
- private:
-  std::underlying_type_t<ConsumerKind> mKindMask {0};
-};
-
-struct Config final {
-  uint64_t mGlobalInputLayerID {};
-  VRRenderConfig mVR {};
-  FlatConfig mFlat {};
-  ConsumerPattern mTarget {};
-};
-static_assert(std::is_standard_layout_v<Config>);
-struct LayerConfig final {
-  uint64_t mLayerID;
-  uint16_t mImageWidth, mImageHeight;// Pixels
-  VRLayerConfig mVR;
-
-  bool IsValid() const;
-};
-static_assert(std::is_standard_layout_v<LayerConfig>);
-
 class Impl;
 
 class Writer final {
@@ -123,8 +81,11 @@ class Writer final {
 
   UINT GetNextTextureIndex() const;
 
+  /// Kinds of all attached consumers, except for `ConsumerKind::Test`
   std::underlying_type_t<ConsumerKind> GetConsumers() const;
-  void ClearConsumers();
+  std::vector<ConsumerInfo> GetConsumerInfo() const;
+  /// Free registry slots used by consumers that went away without detaching
+  void ReapConsumers();
   uint64_t GetSessionID() const;
   uint32_t GetNextSequenceNumber() const;
 
@@ -160,11 +121,20 @@ class Snapshot final {
     ID3D11DeviceContext4*,
     ID3D11Fence*,
     const LayerTextures&,
-    TextureReadResources*);
+    TextureReadResources*,
+    const LayerDamage&);
   ~Snapshot();
 
   /// Changes even if the feeder restarts with frame ID 0
   size_t GetRenderCacheKey() const;
+  /// Like GetRenderCacheKey(), but only changes if this layer changes
+  size_t GetRenderCacheKey(const LayerConfig&) const;
+  /** Whether the layer changed between the previous snapshot from the same
+   * reader, and this one.
+   *
+   * If not, the texture was not copied again, but still contains the same
+   * content. */
+  bool IsLayerDirty(uint8_t layerIndex) const;
   Config GetConfig() const;
   uint8_t GetLayerCount() const;
   const LayerConfig* GetLayerConfig(uint8_t layerIndex) const;
@@ -183,8 +153,11 @@ class Snapshot final {
   Snapshot() = delete;
 
  private:
+  friend class Reader;
+
   std::shared_ptr<Header> mHeader;
   LayerTextures mLayerTextures;
+  LayerBits mDirtyLayers;
 
   using LayerSRVArray
     = std::array<winrt::com_ptr<ID3D11ShaderResourceView>, MaxLayers>;
@@ -207,6 +180,24 @@ class Reader {
   /// Do not use for caching - use GetRenderCacheKey instead
   uint32_t GetFrameCountForMetricsOnly() const;
 
+  /** Copy the header without registering as a consumer or touching any
+   * textures, e.g. for recording.
+   *
+   * Returns false if the feeder kept updating while we tried to copy.
+   */
+  bool TryGetHeader(Header*) const;
+  /// Kinds of all attached consumers, except for `ConsumerKind::Test`
+  std::underlying_type_t<ConsumerKind> GetActiveConsumers() const;
+
+  /** An auto-reset event that the feeder signals after publishing a frame.
+   *
+   * This registers the reader as a consumer if needed. The handle may change
+   * if the reader has to re-register, so call this again before each wait.
+   *
+   * Returns NULL if the consumer registry is full.
+   */
+  HANDLE GetNewFrameEvent(ConsumerKind);
+
   /// Changes even if the feeder restarts with frame ID 0
   size_t GetRenderCacheKey() const;
 
@@ -214,6 +205,7 @@ class Reader {
   uint64_t GetSessionID() const;
 
   Snapshot MaybeGetUncached(
+    const Header&,
     ID3D11DeviceContext4*,
     ID3D11Fence*,
     const LayerTextures&,
@@ -0,0 +1,121 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// A reference SHM transport using POSIX shared memory and CPU pixel
+// buffers, so that the protocol can be tested and benchmarked without
+// Windows or a GPU.
+//
+// This mirrors `SHM.h`: a named mapping containing the `Segment`, a named
+// semaphore to serialize writers, a pixel buffer for each layer in each
+// texture slot, and a named semaphore per consumer slot in place of the
+// new-frame events. It's only built on other platforms, by `src/tests`.
+
+#include "SHMProtocol.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace OpenKneeboard::SHM::POSIX {
+
+// Premultiplied BGRA, like the shared textures
+using Pixel = uint32_t;
+
+struct Frame final {
+  Header mHeader {};
+  // `mImageWidth * mImageHeight` pixels for each layer in the header
+  std::array<std::vector<Pixel>, MaxLayers> mLayers;
+};
+
+class Writer final {
+ public:
+  Writer() = delete;
+  /** `name` must be valid for `shm_open()`, e.g. "/OpenKneeboard".
+   *
+   * Throws std::system_error if the shared memory can't be opened.
+   */
+  explicit Writer(const std::string& name);
+  ~Writer();
+
+  /** Where to render the next frame; rows are `TextureWidth` pixels apart.
+   *
+   * Requires the lock.
+   */
+  std::span<Pixel> GetNextPixels(uint8_t layerIndex);
+  /** Requires the lock; throws std::logic_error if the layers are invalid.
+   *
+   * Wakes any readers in `Reader::WaitForNewFrame()`.
+   */
+  void Update(const Config&, std::span<const LayerConfig>);
+  /// Requires the lock
+  void Detach();
+
+  uint64_t GetSessionID() const;
+
+  // "Lockable" C++ named concept: supports std::unique_lock
+  void lock();
+  bool try_lock();
+  void unlock();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> p;
+};
+
+class Reader final {
+ public:
+  Reader() = delete;
+  /// Throws std::system_error if the shared memory can't be opened
+  explicit Reader(const std::string& name);
+  ~Reader();
+
+  uint32_t GetSequenceNumber() const;
+
+  /** Copy the latest frame.
+   *
+   * Returns false if there's no feeder, or if it overtook us while we were
+   * copying; the contents of `frame` are then unspecified.
+   */
+  bool TryCopyLatest(Frame* frame) const;
+
+  /** Wait until there's a frame newer than `sequenceNumber`.
+   *
+   * Registers this reader as a consumer, like
+   * `SHM::Reader::GetNewFrameEvent()`. Returns false on timeout.
+   */
+  bool WaitForNewFrame(
+    ConsumerKind,
+    uint32_t sequenceNumber,
+    std::chrono::milliseconds timeout);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> p;
+};
+
+/// Remove the named objects; existing writers and readers keep working
+void Unlink(const std::string& name);
+
+}// namespace OpenKneeboard::SHM::POSIX
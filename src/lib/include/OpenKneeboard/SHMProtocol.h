@@ -0,0 +1,316 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// The SHM metadata protocol, without any OS or GPU dependencies.
+//
+// `SHM.h` provides the Windows implementation: a named file mapping
+// containing a `Segment`, a named mutex to serialize writers, and D3D11
+// shared textures for the pixels.
+
+#include "DamageRegion.h"
+#include "SeqLock.h"
+#include "VRConfig.h"
+#include "bitflags.h"
+
+#include <OpenKneeboard/config.h>
+
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace OpenKneeboard::SHM {
+
+enum class ConsumerKind : uint32_t {
+  SteamVR = 1 << 0,
+  OpenXR = 1 << 1,
+  OculusD3D11 = 1 << 2,
+  OculusD3D12 = 1 << 3,
+  NonVRD3D11 = 1 << 4,
+  Test = ~uint32_t {0},
+};
+
+class ConsumerPattern final {
+ public:
+  ConsumerPattern();
+  ConsumerPattern(std::underlying_type_t<ConsumerKind>(consumerKindMask));
+  ConsumerPattern(ConsumerKind kind)
+    : mKindMask(std::underlying_type_t<ConsumerKind>(kind)) {
+  }
+
+  bool Matches(ConsumerKind) const;
+
+  std::underlying_type_t<ConsumerKind> GetRawMaskForDebugging() const;
+
+  bool operator==(const ConsumerPattern&) const noexcept = default;
+
+ private:
+  std::underlying_type_t<ConsumerKind> mKindMask {0};
+};
+
+/* Placement of the non-VR overlay.
+ *
+ * This has the same members as the app's `FlatConfig`, but `FlatConfig.h`
+ * isn't included in the SHM libraries.
+ */
+struct FlatLayerConfig final {
+  enum class HorizontalAlignment : uint8_t {
+    Left,
+    Center,
+    Right,
+  };
+  enum class VerticalAlignment : uint8_t {
+    Top,
+    Middle,
+    Bottom,
+  };
+
+  uint8_t mHeightPercent = 60;
+  uint32_t mPaddingPixels = 10;
+  float mOpacity = 0.8f;
+
+  HorizontalAlignment mHorizontalAlignment = HorizontalAlignment::Right;
+  VerticalAlignment mVerticalAlignment = VerticalAlignment::Middle;
+
+  bool operator==(const FlatLayerConfig&) const noexcept = default;
+};
+static_assert(std::is_standard_layout_v<FlatLayerConfig>);
+
+struct Config final {
+  uint64_t mGlobalInputLayerID {};
+  VRRenderConfig mVR {};
+  FlatLayerConfig mFlat {};
+  ConsumerPattern mTarget {};
+
+  bool operator==(const Config&) const noexcept = default;
+};
+static_assert(std::is_standard_layout_v<Config>);
+struct LayerConfig final {
+  uint64_t mLayerID;
+  uint16_t mImageWidth, mImageHeight;// Pixels
+  VRLayerConfig mVR;
+
+  // Feeders should clear this if the texture content is unchanged since the
+  // previous frame; `Writer::Update()` will also set it if anything else in
+  // the layer or the global config changed.
+  bool mIsDirty {true};
+  // Set by `Writer::Update()`; incremented every time the layer is dirty.
+  uint32_t mGeneration {};
+  // Pixels that changed since the previous generation. `Writer::Update()`
+  // will replace this with a full region if it marked the layer as dirty,
+  // and clear it if the layer is clean.
+  DamageRegion mDamage {DamageRegion::Full()};
+
+  bool IsValid() const;
+};
+static_assert(std::is_standard_layout_v<LayerConfig>);
+
+enum class HeaderFlags : uint32_t {
+  FEEDER_ATTACHED = 1 << 0,
+};
+
+}// namespace OpenKneeboard::SHM
+
+namespace OpenKneeboard {
+template <>
+constexpr bool is_bitflags_v<SHM::HeaderFlags> = true;
+}// namespace OpenKneeboard
+
+namespace OpenKneeboard::SHM {
+
+struct Header final {
+  // Use the magic string to make sure we don't have
+  // uninitialized memory that happens to have the
+  // feeder-attached bit set
+  static constexpr std::string_view Magic {"OKBMagic"};
+  static_assert(Magic.size() == sizeof(uint64_t));
+  uint64_t mMagic = *reinterpret_cast<const uint64_t*>(Magic.data());
+
+  uint32_t mSequenceNumber = 0;
+  // Not using CreateSessionID() as the default, as readers create
+  // a local copy of the header every time they copy a new frame
+  uint64_t mSessionID {};
+  HeaderFlags mFlags;
+  Config mConfig;
+
+  uint32_t mFeederProcessID {};
+  // An OS handle in the feeder process; fixed-size so that the layout
+  // doesn't depend on the reader's bitness
+  uint64_t mFence {};
+
+  uint8_t mLayerCount = 0;
+  LayerConfig mLayers[MaxLayers];
+
+  size_t GetRenderCacheKey() const;
+  bool HaveFeeder() const;
+};
+static_assert(std::is_standard_layout_v<Header>);
+static_assert(std::is_trivially_copyable_v<Header>);
+
+/* One entry per attached consumer; written by consumers without any locks.
+ *
+ * All members must be accessed atomically.
+ */
+struct ConsumerSlot final {
+  // 0 if unused, otherwise `(processID << 32) | kind`
+  uint64_t mOwner {};
+  uint32_t mLastSequenceNumber {};
+  // `ConsumerClock`, in nanoseconds
+  uint64_t mHeartbeat {};
+  // Non-zero if the feeder should signal the consumer's new-frame event
+  uint32_t mWantsFrameEvents {};
+};
+static_assert(std::is_standard_layout_v<ConsumerSlot>);
+
+/// Must be the same in every process; on Windows, this is QPC
+using ConsumerClock = std::chrono::steady_clock;
+
+// Consumers without a heartbeat for this long are considered detached
+static constexpr std::chrono::milliseconds ConsumerTimeout {1000};
+static constexpr uint8_t MaxConsumers = 16;
+
+/* The header is published with a sequence lock instead of a mutex, so that
+ * readers in the game's render loop never wait for (or fail to acquire a
+ * lock held by) the app.
+ *
+ * Writers must be serialized by the transport, e.g. with a named mutex.
+ */
+struct Segment final {
+  SeqLock mSeqLock;
+  Header mHeader;
+  // Not protected by the SeqLock, and not reset with the header, so that
+  // consumers stay registered if the feeder restarts
+  ConsumerSlot mConsumers[MaxConsumers];
+};
+static_assert(std::is_standard_layout_v<Segment>);
+
+using LayerBits = std::bitset<MaxLayers>;
+using ConsumerBits = std::bitset<MaxConsumers>;
+
+struct ConsumerInfo final {
+  ConsumerKind mKind {};
+  uint32_t mProcessID {};
+  uint32_t mLastSequenceNumber {};
+  // How many frames the feeder has published since the consumer last
+  // acquired one
+  uint32_t mFramesBehind {};
+  // Time since the last heartbeat
+  std::chrono::nanoseconds mAge {};
+};
+
+uint64_t CreateSessionID(uint32_t processID);
+
+constexpr uint8_t GetTextureIndex(uint32_t sequenceNumber) {
+  return static_cast<uint8_t>(sequenceNumber % TextureCount);
+}
+
+///// Writer side; the caller must have serialized writers /////
+
+void ResetHeader(Segment*, uint64_t sessionID);
+
+/// Throws std::logic_error if the layers are invalid
+void PublishHeader(
+  Segment*,
+  const Config&,
+  std::span<const LayerConfig>,
+  uint32_t feederProcessID,
+  uint64_t fence);
+
+void DetachFeeder(Segment*);
+
+/// Consumers which sent a heartbeat within `ConsumerTimeout`
+std::vector<ConsumerInfo> GetConsumers(
+  const Segment&,
+  ConsumerClock::time_point now);
+/// All kinds from `GetConsumers()`, except for `ConsumerKind::Test`
+std::underlying_type_t<ConsumerKind> GetActiveConsumers(
+  const Segment&,
+  ConsumerClock::time_point now);
+/// Free the slots of consumers that exceeded `ConsumerTimeout`
+void ReapConsumers(Segment*, ConsumerClock::time_point now);
+/// Live consumers that asked to be notified of new frames
+ConsumerBits GetFrameEventConsumers(
+  const Segment&,
+  ConsumerClock::time_point now);
+
+///// Reader side; does not require any locks /////
+
+/// Returns false if the feeder kept updating while we tried to copy
+bool TryReadHeader(const Segment&, Header*);
+
+/** Register the consumer if needed, and record that it's alive.
+ *
+ * `slotHint` should be the return value from the previous call for this
+ * consumer, or `MaxConsumers` for the first call.
+ *
+ * Returns the slot index, or `MaxConsumers` if all slots are in use.
+ */
+uint8_t ConsumerHeartbeat(
+  Segment*,
+  uint8_t slotHint,
+  ConsumerKind,
+  uint32_t processID,
+  uint32_t lastSequenceNumber,
+  ConsumerClock::time_point now);
+/** Ask the feeder to signal the consumer's new-frame event after every
+ * publication.
+ *
+ * This is reset whenever the slot changes owner, so should be called after
+ * every `ConsumerHeartbeat()`.
+ */
+void RequestFrameEvents(Segment*, uint8_t slot);
+/// Free a slot returned by `ConsumerHeartbeat()`
+void DetachConsumer(
+  Segment*,
+  uint8_t slot,
+  ConsumerKind,
+  uint32_t processID);
+
+/** What a reader needs to copy to update its copy of a layer from `previous`
+ * to `next`.
+ *
+ * This is the layer's damage region if `next` is exactly one generation
+ * newer, otherwise a full region, or an empty one if it's unchanged.
+ */
+DamageRegion
+GetLayerDamage(const Header& previous, const Header& next, uint8_t layerIndex);
+
+/** Whether the feeder may have started reusing the texture slot used by
+ * `sequenceNumber`.
+ *
+ * Readers should check this before copying the textures, and skip the
+ * frame if this returns true; a torn copy can't be detected afterwards.
+ */
+bool FeederOvertookReader(const Segment&, uint32_t sequenceNumber);
+
+/** The latest sequence number, without copying the header.
+ *
+ * Consumers waiting for a new frame should compare this to the last
+ * sequence number they acquired *before* waiting on their new-frame event;
+ * as the event stays signalled until a wait consumes it, a frame published
+ * between the check and the wait won't be missed.
+ */
+uint32_t GetSequenceNumber(const Segment&);
+
+}// namespace OpenKneeboard::SHM
@@ -0,0 +1,106 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// Recording and replaying the stream of SHM header publications, without any
+// OS or GPU dependencies.
+//
+// The file is a header followed by one record per publication; the `Config`
+// is only stored when it changes. Structs are stored as-is, so recordings
+// are only readable by builds with the same struct layouts - this is
+// checked when opening the file.
+
+#include "SHMProtocol.h"
+
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace OpenKneeboard::SHM {
+
+struct RecordedFrame final {
+  // Since the first frame in the recording
+  std::chrono::nanoseconds mTime {};
+  uint64_t mSessionID {};
+  uint32_t mSequenceNumber {};
+  std::underlying_type_t<ConsumerKind> mActiveConsumers {};
+  Config mConfig {};
+  std::vector<LayerConfig> mLayers;
+  // Either empty, or one per layer
+  std::vector<uint64_t> mPixelHashes;
+};
+
+class RecordingWriter final {
+ public:
+  RecordingWriter() = delete;
+  /// `out` must be opened in binary mode, and outlive the writer
+  RecordingWriter(std::ostream& out);
+
+  /// Throws std::runtime_error if writing fails
+  void Write(const RecordedFrame&);
+
+ private:
+  std::ostream& mOut;
+  std::optional<Config> mPreviousConfig;
+};
+
+class RecordingReader final {
+ public:
+  RecordingReader() = delete;
+  /** `in` must be opened in binary mode, and outlive the reader.
+   *
+   * Throws std::runtime_error if this isn't a recording, or it's from an
+   * incompatible build.
+   */
+  RecordingReader(std::istream& in);
+
+  /** Returns nullopt at the end of the recording.
+   *
+   * Throws std::runtime_error if the recording is truncated or corrupt.
+   */
+  std::optional<RecordedFrame> Next();
+
+ private:
+  std::istream& mIn;
+  Config mConfig {};
+};
+
+/// When to publish each frame of a replay
+class ReplayScheduler final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  ReplayScheduler() = delete;
+  /** `speed` is a multiplier, e.g. 2.0 replays at double speed; 0 replays
+   * as fast as possible.
+   */
+  ReplayScheduler(Clock::time_point start, double speed);
+
+  Clock::time_point GetDueTime(const RecordedFrame&) const;
+
+ private:
+  Clock::time_point mStart;
+  double mSpeed;
+};
+
+}// namespace OpenKneeboard::SHM
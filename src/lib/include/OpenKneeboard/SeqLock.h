@@ -0,0 +1,114 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace OpenKneeboard {
+
+/** Single-writer, multiple-reader sequence lock.
+ *
+ * This is a standard-layout type so that it can be placed in
+ * shared memory; the generation is odd while a write is in progress.
+ *
+ * Writers never wait for readers; readers retry if the generation changed
+ * while they were copying the data.
+ *
+ * Multiple writers must be serialized by some other mechanism, or use
+ * `TryBeginWrite()`.
+ */
+class SeqLock final {
+ public:
+  uint32_t mGeneration {0};
+
+  void BeginWrite() noexcept {
+    auto generation = Ref();
+    // `| 1`: if a previous writer crashed mid-write, we'll still end up odd
+    generation.store(
+      (generation.load(std::memory_order_relaxed) + 1) | 1,
+      std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  /** For multiple writers: begin a write unless another is in progress.
+   *
+   * If this returns true, the caller must call `EndWrite()`.
+   */
+  bool TryBeginWrite() noexcept {
+    auto generation = Ref();
+    auto expected = generation.load(std::memory_order_relaxed);
+    if (expected & 1) {
+      return false;
+    }
+    if (!generation.compare_exchange_strong(
+          expected, expected + 1, std::memory_order_relaxed)) {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+  }
+
+  void EndWrite() noexcept {
+    auto generation = Ref();
+    generation.store(
+      generation.load(std::memory_order_relaxed) + 1,
+      std::memory_order_release);
+  }
+
+  /// Returns true if `out` contains a consistent copy of `source`
+  template <class T>
+    requires std::is_trivially_copyable_v<T>
+  bool TryRead(const T& source, T* out) const noexcept {
+    const auto before = Ref().load(std::memory_order_acquire);
+    if (before & 1) {
+      return false;
+    }
+    std::memcpy(out, &source, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return Ref().load(std::memory_order_relaxed) == before;
+  }
+
+  template <class T>
+    requires std::is_trivially_copyable_v<T>
+  bool Read(const T& source, T* out, uint32_t maxAttempts) const noexcept {
+    for (uint32_t i = 0; i < maxAttempts; ++i) {
+      if (TryRead(source, out)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint32_t GetGeneration() const noexcept {
+    return Ref().load(std::memory_order_acquire);
+  }
+
+ private:
+  std::atomic_ref<uint32_t> Ref() const noexcept {
+    return std::atomic_ref(const_cast<uint32_t&>(mGeneration));
+  }
+};
+static_assert(std::is_standard_layout_v<SeqLock>);
+static_assert(std::atomic_ref<uint32_t>::is_always_lock_free);
+
+}// namespace OpenKneeboard
@@ -0,0 +1,63 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+#include "TelemetryProtocol.h"
+
+#include <memory>
+#include <optional>
+
+namespace OpenKneeboard::Telemetry {
+
+// Readers ignore samples older than this, e.g. if the game exited
+static constexpr std::chrono::seconds MaxSampleAge {1};
+
+/// Any number of writers can be open at the same time
+class Writer final {
+ public:
+  Writer();
+  ~Writer();
+
+  operator bool() const;
+
+  /// Returns false if the mapping isn't open, or the record was dropped
+  bool Publish(const OwnshipRecord&);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> p;
+};
+
+class Reader final {
+ public:
+  Reader();
+  ~Reader();
+
+  operator bool() const;
+
+  /// nullopt if nothing has been published in the last `MaxSampleAge`
+  std::optional<Sample> MaybeGetLatest() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> p;
+};
+
+}// namespace OpenKneeboard::Telemetry
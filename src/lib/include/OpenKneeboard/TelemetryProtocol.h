@@ -0,0 +1,146 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#pragma once
+
+// A fixed-layout shared-memory channel for high-rate telemetry, such as
+// own-ship position for moving maps, without any OS dependencies.
+//
+// `GameEvent` is better for anything that changes less than a few times per
+// second; this is for data that changes every simulation frame, where only
+// the latest value matters.
+//
+// `Telemetry.h` provides the Windows implementation: a named file mapping
+// containing a `Segment`.
+
+#include "SeqLock.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace OpenKneeboard::Telemetry {
+
+// Increment this if the layout of anything in this file changes
+static constexpr uint32_t ProtocolVersion = 1;
+
+/// Must be the same in every process; on Windows, this is QPC
+using Clock = std::chrono::steady_clock;
+
+/* Fixed-size members only, so that the layout doesn't depend on the
+ * producer's bitness; for example, the DCS hook is 64-bit, but users of the
+ * C API may be 32-bit.
+ */
+struct OwnshipRecord final {
+  // Seconds since the simulation started
+  double mSimulationTime {};
+  // WGS84, in degrees
+  double mLatitude {};
+  double mLongitude {};
+  // Meters above mean sea level
+  double mAltitude {};
+  // Degrees true, clockwise from north
+  double mHeading {};
+  // Meters per second
+  double mGroundSpeed {};
+
+  bool operator==(const OwnshipRecord&) const noexcept = default;
+};
+static_assert(std::is_standard_layout_v<OwnshipRecord>);
+static_assert(std::is_trivially_copyable_v<OwnshipRecord>);
+static_assert(sizeof(OwnshipRecord) == 48);
+
+struct SlotContents final {
+  // 0 if the slot has never been written
+  uint64_t mSequenceNumber {};
+  // `Clock`, in nanoseconds
+  uint64_t mPublishedAt {};
+  OwnshipRecord mOwnship {};
+};
+static_assert(std::is_trivially_copyable_v<SlotContents>);
+
+// Aligned to cache lines so that producers writing adjacent slots don't
+// slow each other down
+struct alignas(64) Slot final {
+  SeqLock mSeqLock;
+  SlotContents mContents;
+};
+static_assert(std::is_standard_layout_v<Slot>);
+
+// Enough that a producer that stalls mid-write doesn't block the others
+static constexpr uint8_t RingSize = 16;
+
+/* A ring of records, written and read without locks.
+ *
+ * Each producer claims a sequence number by incrementing
+ * `mLastSequenceNumber`, and writes the slot for that sequence number under
+ * the slot's `SeqLock`. If another producer is still writing that slot from a
+ * previous lap, the new producer claims another sequence number instead of
+ * waiting, up to `RingSize` times.
+ *
+ * Readers start at the newest claimed slot, and walk backwards until they
+ * find a complete record.
+ */
+struct Segment final {
+  // Zero until a producer has initialized the segment
+  static constexpr std::string_view Magic {"OKBTelem"};
+  static_assert(Magic.size() == sizeof(uint64_t));
+  uint64_t mMagic {};
+  uint32_t mVersion {};
+  uint32_t mRecordSize {};
+
+  alignas(64) uint64_t mLastSequenceNumber {};
+  Slot mSlots[RingSize];
+};
+static_assert(std::is_standard_layout_v<Segment>);
+
+struct Sample final {
+  // Increases with every publication; useful to detect new data
+  uint64_t mSequenceNumber {};
+  Clock::time_point mPublishedAt {};
+  OwnshipRecord mOwnship {};
+};
+
+///// Producer side; does not require any locks /////
+
+/// Idempotent; call before the first `Publish()`
+void InitializeSegment(Segment*);
+
+/** Returns false if the record was dropped.
+ *
+ * That only happens if every slot we tried was being written by another
+ * producer, e.g. because producers crashed mid-write; the next record will
+ * usually get through, and only the latest one matters.
+ */
+bool Publish(Segment*, const OwnshipRecord&, Clock::time_point now);
+
+///// Consumer side; does not require any locks /////
+
+/// False if no compatible producer has initialized the segment
+bool IsCompatible(const Segment&);
+
+/** Copy the newest complete record.
+ *
+ * Returns false if nothing has been published, or if producers kept
+ * overwriting the slots faster than we could copy them.
+ */
+bool TryReadLatest(const Segment&, Sample*);
+
+}// namespace OpenKneeboard::Telemetry
@@ -54,6 +54,7 @@ IT(CreateEventW);
 IT(CreateFileMappingW);
 IT(CreateMutexW);
 IT(CreateWaitableTimerW);
+IT(OpenEventW);
 #undef IT
 
 ///// May return INVALID_HANDLE_VALUE /////
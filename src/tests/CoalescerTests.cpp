@@ -0,0 +1,177 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/Coalescer.h>
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+// Wake-ups are recorded instead of dispatched, so the tests decide when the
+// executor's 'thread' gets to run - like a busy UI thread
+struct ManualExecutor {
+  int mWakes {0};
+  std::shared_ptr<Executor> mExecutor {
+    Executor::Create([this](auto) { ++mWakes; })};
+
+  size_t Run() {
+    return mExecutor->Drain();
+  }
+};
+
+int Sum(int a, int b) {
+  return a + b;
+}
+
+}// namespace
+
+TEST(Coalescer, MergesBursts) {
+  ManualExecutor executor;
+  std::vector<int> received;
+  Coalescer<int> coalescer(
+    [&](int value) { received.push_back(value); },
+    executor.mExecutor,
+    &Coalescer<int>::LastValue);
+
+  coalescer.Push(1);
+  coalescer.Push(2);
+  coalescer.Push(3);
+  EXPECT_TRUE(received.empty());
+  EXPECT_EQ(executor.mWakes, 1);
+
+  executor.Run();
+  EXPECT_EQ(received, (std::vector<int> {3}));
+  EXPECT_EQ(coalescer.GetSuppressedCount(), 2);
+}
+
+TEST(Coalescer, CustomMerge) {
+  ManualExecutor executor;
+  std::vector<int> received;
+  Coalescer<int> coalescer(
+    [&](int value) { received.push_back(value); }, executor.mExecutor, &Sum);
+
+  for (int i = 1; i <= 4; ++i) {
+    coalescer.Push(i);
+  }
+  executor.Run();
+  EXPECT_EQ(received, (std::vector<int> {10}));
+}
+
+TEST(Coalescer, NewBurstAfterFlush) {
+  ManualExecutor executor;
+  std::vector<int> received;
+  Coalescer<int> coalescer(
+    [&](int value) { received.push_back(value); }, executor.mExecutor, &Sum);
+
+  coalescer.Push(1);
+  executor.Run();
+  coalescer.Push(2);
+  coalescer.Push(3);
+  executor.Run();
+  EXPECT_EQ(received, (std::vector<int> {1, 5}));
+  EXPECT_EQ(executor.mWakes, 2);
+}
+
+// Pushes from the sink, e.g. a handler that triggers another change, start
+// the next burst rather than recursing
+TEST(Coalescer, PushFromSink) {
+  ManualExecutor executor;
+  std::vector<int> received;
+  std::unique_ptr<Coalescer<int>> coalescer;
+  coalescer = std::make_unique<Coalescer<int>>(
+    [&](int value) {
+      received.push_back(value);
+      if (value < 3) {
+        coalescer->Push(value + 1);
+      }
+    },
+    executor.mExecutor,
+    &Sum);
+
+  coalescer->Push(1);
+  while (executor.Run()) {
+  }
+  EXPECT_EQ(received, (std::vector<int> {1, 2, 3}));
+}
+
+TEST(Coalescer, ExplicitFlush) {
+  ManualExecutor executor;
+  std::vector<int> received;
+  Coalescer<int> coalescer(
+    [&](int value) { received.push_back(value); }, executor.mExecutor, &Sum);
+
+  coalescer.Push(1);
+  coalescer.Push(2);
+  coalescer.Flush();
+  EXPECT_EQ(received, (std::vector<int> {3}));
+
+  // The already-posted flush has nothing left to do
+  executor.Run();
+  EXPECT_EQ(received, (std::vector<int> {3}));
+}
+
+TEST(Coalescer, DestroyedWhilePending) {
+  ManualExecutor executor;
+  int calls = 0;
+  {
+    Coalescer<int> coalescer(
+      [&](int) { ++calls; }, executor.mExecutor, &Coalescer<int>::LastValue);
+    coalescer.Push(1);
+  }
+  EXPECT_EQ(executor.Run(), 1);
+  EXPECT_EQ(calls, 0);
+}
+
+TEST(Coalescer, ConcurrentPushes) {
+  constexpr int Producers = 8;
+  constexpr int PushesPerProducer = 10000;
+
+  ManualExecutor executor;
+  int total = 0;
+  int calls = 0;
+  Coalescer<int> coalescer(
+    [&](int value) {
+      total += value;
+      ++calls;
+    },
+    executor.mExecutor,
+    &Sum);
+
+  {
+    std::vector<std::jthread> producers;
+    for (int i = 0; i < Producers; ++i) {
+      producers.emplace_back([&]() {
+        for (int j = 0; j < PushesPerProducer; ++j) {
+          coalescer.Push(1);
+        }
+      });
+    }
+  }
+  executor.Run();
+
+  // Nothing is lost, and bursts were merged
+  EXPECT_EQ(total, Producers * PushesPerProducer);
+  EXPECT_EQ(calls + coalescer.GetSuppressedCount(), total);
+  EXPECT_LT(calls, total);
+}
@@ -0,0 +1,152 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/DamageRegion.h>
+
+#include <ostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace OpenKneeboard {
+void PrintTo(const DamageRect& rect, std::ostream* os) {
+  *os << '(' << rect.mLeft << ", " << rect.mTop << ")-(" << rect.mRight
+      << ", " << rect.mBottom << ')';
+}
+}// namespace OpenKneeboard
+
+using namespace OpenKneeboard;
+
+namespace {
+
+std::vector<DamageRect> GetRects(const DamageRegion& region) {
+  const auto rects = region.GetRects();
+  return {rects.begin(), rects.end()};
+}
+
+}// namespace
+
+TEST(DamageRegion, StartsEmpty) {
+  DamageRegion region;
+  EXPECT_TRUE(region.IsEmpty());
+  EXPECT_FALSE(region.IsFull());
+  EXPECT_TRUE(region.GetRects().empty());
+}
+
+TEST(DamageRegion, IgnoresEmptyRects) {
+  DamageRegion region;
+  region.Add(DamageRect {10, 10, 10, 20});
+  region.Add(DamageRect {10, 10, 20, 5});
+  EXPECT_TRUE(region.IsEmpty());
+}
+
+TEST(DamageRegion, KeepsSeparateRects) {
+  DamageRegion region;
+  region.Add(DamageRect {0, 0, 10, 10});
+  region.Add(DamageRect {20, 20, 30, 30});
+  EXPECT_EQ(
+    GetRects(region),
+    (std::vector<DamageRect> {{0, 0, 10, 10}, {20, 20, 30, 30}}));
+  EXPECT_EQ(region.GetBounds(), (DamageRect {0, 0, 30, 30}));
+}
+
+TEST(DamageRegion, MergesOverlappingRects) {
+  DamageRegion region;
+  region.Add(DamageRect {0, 0, 10, 10});
+  region.Add(DamageRect {5, 5, 15, 15});
+  EXPECT_EQ(GetRects(region), (std::vector<DamageRect> {{0, 0, 15, 15}}));
+}
+
+TEST(DamageRegion, MergesTouchingRects) {
+  DamageRegion region;
+  region.Add(DamageRect {0, 0, 10, 10});
+  // Shares the right edge
+  region.Add(DamageRect {10, 0, 20, 10});
+  EXPECT_EQ(GetRects(region), (std::vector<DamageRect> {{0, 0, 20, 10}}));
+}
+
+TEST(DamageRegion, ContainedRectsAreNoOps) {
+  DamageRegion region;
+  region.Add(DamageRect {0, 0, 100, 100});
+  region.Add(DamageRect {10, 10, 20, 20});
+  EXPECT_EQ(GetRects(region), (std::vector<DamageRect> {{0, 0, 100, 100}}));
+}
+
+TEST(DamageRegion, RescansAfterMerging) {
+  DamageRegion region;
+  region.Add(DamageRect {20, 15, 25, 20});
+  region.Add(DamageRect {0, 0, 5, 20});
+  ASSERT_EQ(region.GetRects().size(), 2);
+
+  // Only touches the second rect, but the union with it touches the first,
+  // which was checked earlier
+  region.Add(DamageRect {5, 0, 30, 5});
+  EXPECT_EQ(GetRects(region), (std::vector<DamageRect> {{0, 0, 30, 20}}));
+}
+
+TEST(DamageRegion, OverflowsToFull) {
+  DamageRegion region;
+  for (uint16_t i = 0; i < DamageRegion::MaxRects; ++i) {
+    region.Add(DamageRect {
+      static_cast<uint16_t>(i * 10),
+      0,
+      static_cast<uint16_t>((i * 10) + 5),
+      5});
+  }
+  ASSERT_FALSE(region.IsFull());
+  ASSERT_EQ(region.GetRects().size(), DamageRegion::MaxRects);
+
+  // Merging doesn't need another slot, so doesn't overflow
+  region.Add(DamageRect {0, 0, 5, 5});
+  ASSERT_FALSE(region.IsFull());
+
+  region.Add(DamageRect {0, 100, 5, 105});
+  EXPECT_TRUE(region.IsFull());
+  EXPECT_FALSE(region.IsEmpty());
+  EXPECT_TRUE(region.GetRects().empty());
+}
+
+TEST(DamageRegion, FullAbsorbsLaterAdds) {
+  auto region = DamageRegion::Full();
+  region.Add(DamageRect {0, 0, 10, 10});
+  EXPECT_TRUE(region.IsFull());
+  EXPECT_TRUE(region.GetRects().empty());
+
+  DamageRegion other;
+  other.Add(DamageRect {0, 0, 10, 10});
+  region.Add(other);
+  EXPECT_EQ(region, DamageRegion::Full());
+
+  other.Add(DamageRegion::Full());
+  EXPECT_TRUE(other.IsFull());
+
+  region.ClipTo(5, 5);
+  EXPECT_TRUE(region.IsFull());
+
+  region.Clear();
+  EXPECT_TRUE(region.IsEmpty());
+}
+
+TEST(DamageRegion, ClipsToImage) {
+  DamageRegion region;
+  region.Add(DamageRect {90, 90, 200, 200});
+  region.Add(DamageRect {300, 0, 400, 10});
+  region.ClipTo(100, 100);
+  EXPECT_EQ(GetRects(region), (std::vector<DamageRect> {{90, 90, 100, 100}}));
+}
@@ -0,0 +1,147 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/Executor.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+
+TEST(Executor, RunsTasksInOrder) {
+  auto executor = Executor::Create([](auto) {});
+  std::vector<int> ran;
+  for (int i = 0; i < 5; ++i) {
+    executor->Post([&ran, i]() { ran.push_back(i); });
+  }
+  EXPECT_TRUE(ran.empty());
+  EXPECT_EQ(executor->Drain(), 5);
+  EXPECT_EQ(ran, (std::vector<int> {0, 1, 2, 3, 4}));
+  EXPECT_EQ(executor->Drain(), 0);
+}
+
+TEST(Executor, WakesOncePerBatch) {
+  int wakes = 0;
+  auto executor = Executor::Create([&wakes](auto) { ++wakes; });
+
+  executor->Post([]() {});
+  executor->Post([]() {});
+  executor->Post([]() {});
+  EXPECT_EQ(wakes, 1);
+
+  executor->Drain();
+  executor->Post([]() {});
+  EXPECT_EQ(wakes, 2);
+}
+
+TEST(Executor, TasksPostedByTasksWakeAgain) {
+  int wakes = 0;
+  auto executor = Executor::Create([&wakes](auto) { ++wakes; });
+  bool ranInner = false;
+  executor->Post([&]() { executor->Post([&]() { ranInner = true; }); });
+
+  executor->Drain();
+  // The inner task may or may not have run in the same batch, but if it
+  // didn't, we must have been woken again
+  if (!ranInner) {
+    EXPECT_EQ(wakes, 2);
+    executor->Drain();
+  }
+  EXPECT_TRUE(ranInner);
+}
+
+TEST(Executor, SelfRepostingTaskDoesNotLivelock) {
+  int wakes = 0;
+  auto executor = Executor::Create([&wakes](auto) { ++wakes; });
+  int runs = 0;
+  std::function<void()> task = [&]() {
+    ++runs;
+    executor->Post(task);
+  };
+  executor->Post(task);
+
+  EXPECT_EQ(executor->Drain(), 1);
+  EXPECT_EQ(runs, 1);
+  EXPECT_EQ(wakes, 2);
+  EXPECT_EQ(executor->Drain(), 1);
+  EXPECT_EQ(runs, 2);
+  EXPECT_EQ(wakes, 3);
+}
+
+TEST(Executor, WakeCallbackGetsExecutor) {
+  std::weak_ptr<Executor> woken;
+  auto executor = Executor::Create([&woken](auto it) { woken = it; });
+  executor->Post([]() {});
+  EXPECT_EQ(woken.lock(), executor);
+
+  executor.reset();
+  EXPECT_TRUE(woken.expired());
+}
+
+// Like a UI thread: sleep until woken, then drain
+TEST(Executor, ConcurrentPosts) {
+  constexpr int Producers = 8;
+  constexpr int TasksPerProducer = 10000;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool woken = false;
+  auto executor = Executor::Create([&](auto) {
+    {
+      std::unique_lock lock(mutex);
+      woken = true;
+    }
+    cv.notify_one();
+  });
+
+  // Only touched on the executor's thread
+  std::vector<int> nextIndex(Producers, 0);
+  int ran = 0;
+  bool outOfOrder = false;
+
+  std::vector<std::jthread> producers;
+  for (int producer = 0; producer < Producers; ++producer) {
+    producers.emplace_back([&, producer]() {
+      for (int i = 0; i < TasksPerProducer; ++i) {
+        executor->Post([&, producer, i]() {
+          outOfOrder |= (nextIndex.at(producer)++ != i);
+          ++ran;
+        });
+      }
+    });
+  }
+
+  while (ran < Producers * TasksPerProducer) {
+    {
+      std::unique_lock lock(mutex);
+      // If this times out, a wake-up was lost
+      ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&] {
+        return woken;
+      })) << ran;
+      woken = false;
+    }
+    executor->Drain();
+  }
+  EXPECT_FALSE(outOfOrder);
+}
@@ -0,0 +1,129 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/FrameScheduler.h>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Tests drive `BeginFrame()` with this instead of the real clock
+constexpr FrameScheduler::TimePoint Epoch {std::chrono::hours(1)};
+
+}// namespace
+
+TEST(FrameScheduler, IdlesAtMinZero) {
+  FrameScheduler scheduler(0, 100);
+  const auto source = scheduler.AddSource();
+  EXPECT_FALSE(scheduler.GetNextFrameTime());
+
+  scheduler.BeginFrame(Epoch);
+  EXPECT_FALSE(scheduler.GetNextFrameTime());
+
+  EXPECT_TRUE(scheduler.MarkDirty(source));
+  ASSERT_TRUE(scheduler.GetNextFrameTime());
+  EXPECT_TRUE(scheduler.BeginFrame(Epoch + 1s));
+  EXPECT_FALSE(scheduler.GetNextFrameTime());
+}
+
+TEST(FrameScheduler, CoalescesDirtyMarks) {
+  FrameScheduler scheduler(0, 100);
+  const auto a = scheduler.AddSource();
+  const auto b = scheduler.AddSource();
+  scheduler.BeginFrame(Epoch);
+
+  EXPECT_TRUE(scheduler.MarkDirty(a));
+  const auto next = scheduler.GetNextFrameTime();
+  EXPECT_FALSE(scheduler.MarkDirty(a));
+  EXPECT_FALSE(scheduler.MarkDirty(b));
+  EXPECT_EQ(scheduler.GetNextFrameTime(), next);
+
+  EXPECT_TRUE(scheduler.BeginFrame(Epoch + 1s));
+  EXPECT_FALSE(scheduler.GetNextFrameTime());
+  EXPECT_FALSE(scheduler.BeginFrame(Epoch + 2s));
+}
+
+TEST(FrameScheduler, SpacesFramesByMaxRate) {
+  FrameScheduler scheduler(0, 100);
+  const auto source = scheduler.AddSource();
+  scheduler.BeginFrame(Epoch);
+
+  scheduler.MarkDirty(source);
+  const auto next = scheduler.GetNextFrameTime();
+  ASSERT_TRUE(next);
+  EXPECT_GE(*next - Epoch, 9ms);
+  EXPECT_LE(*next - Epoch, 11ms);
+
+  // Long after the last frame, dirty sources are due immediately
+  scheduler.BeginFrame(Epoch + 1s);
+  scheduler.MarkDirty(source);
+  EXPECT_EQ(scheduler.GetNextFrameTime(), Epoch + 1s + (*next - Epoch));
+}
+
+TEST(FrameScheduler, MinRateSchedulesIdleFrames) {
+  FrameScheduler scheduler(1, 100);
+  const auto source = scheduler.AddSource();
+  scheduler.BeginFrame(Epoch);
+
+  const auto idle = scheduler.GetNextFrameTime();
+  ASSERT_TRUE(idle);
+  EXPECT_EQ(*idle, Epoch + 1s);
+  EXPECT_FALSE(scheduler.BeginFrame(*idle));
+  EXPECT_EQ(scheduler.GetNextFrameTime(), Epoch + 2s);
+
+  // Dirty sources are sooner than the next idle frame
+  EXPECT_TRUE(scheduler.MarkDirty(source));
+  EXPECT_LT(*scheduler.GetNextFrameTime(), Epoch + 2s);
+  EXPECT_TRUE(scheduler.BeginFrame(*scheduler.GetNextFrameTime()));
+}
+
+TEST(FrameScheduler, CapsPerSourceRate) {
+  FrameScheduler scheduler(0, 100);
+  const auto capped = scheduler.AddSource(10);
+  const auto uncapped = scheduler.AddSource();
+  scheduler.BeginFrame(Epoch);
+
+  scheduler.MarkDirty(capped);
+  EXPECT_TRUE(scheduler.BeginFrame(Epoch + 1s));
+
+  // Dirty again straight away; not due until 100ms after it was serviced
+  EXPECT_TRUE(scheduler.MarkDirty(capped));
+  const auto next = scheduler.GetNextFrameTime();
+  ASSERT_TRUE(next);
+  EXPECT_GE(*next - (Epoch + 1s), 99ms);
+  EXPECT_LE(*next - (Epoch + 1s), 101ms);
+
+  // Other sources aren't held back by the cap, and don't service it early
+  EXPECT_TRUE(scheduler.MarkDirty(uncapped));
+  EXPECT_LT(*scheduler.GetNextFrameTime(), *next);
+  EXPECT_TRUE(scheduler.BeginFrame(Epoch + 1s + 20ms));
+  EXPECT_EQ(scheduler.GetNextFrameTime(), next);
+  EXPECT_FALSE(scheduler.BeginFrame(Epoch + 1s + 50ms));
+  EXPECT_TRUE(scheduler.BeginFrame(*next));
+  EXPECT_FALSE(scheduler.GetNextFrameTime());
+}
+
+TEST(FrameScheduler, RejectsInvalidRates) {
+  EXPECT_THROW(FrameScheduler(0, 0), std::logic_error);
+  EXPECT_THROW(FrameScheduler(-1, 60), std::logic_error);
+  EXPECT_THROW(FrameScheduler(90, 60), std::logic_error);
+}
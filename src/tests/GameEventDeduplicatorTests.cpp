@@ -0,0 +1,93 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/DCSWorld.h>
+#include <OpenKneeboard/GameEventDeduplicator.h>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+using DCS = DCSWorld;
+
+TEST(GameEventDeduplicator, IsDeduplicated) {
+  EXPECT_TRUE(GameEventDeduplicator::IsDeduplicated(DCS::EVT_AIRCRAFT));
+  EXPECT_TRUE(GameEventDeduplicator::IsDeduplicated(DCS::EVT_MISSION_TIME));
+  EXPECT_TRUE(GameEventDeduplicator::IsDeduplicated(DCS::EVT_INSTALL_PATH));
+
+  // Opt-outs
+  EXPECT_FALSE(GameEventDeduplicator::IsDeduplicated(DCS::EVT_MESSAGE));
+  EXPECT_FALSE(
+    GameEventDeduplicator::IsDeduplicated(DCS::EVT_SIMULATION_START));
+
+  // API events
+  EXPECT_FALSE(
+    GameEventDeduplicator::IsDeduplicated(GameEvent::EVT_SET_TAB_BY_ID));
+  EXPECT_FALSE(
+    GameEventDeduplicator::IsDeduplicated(GameEvent::EVT_REMOTE_USER_ACTION));
+}
+
+TEST(GameEventDeduplicator, DropsUnchangedRepeats) {
+  GameEventDeduplicator dedup;
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_AIRCRAFT, "A-10C"}));
+  EXPECT_FALSE(dedup.ShouldDeliver({DCS::EVT_AIRCRAFT, "A-10C"}));
+  EXPECT_FALSE(dedup.ShouldDeliver({DCS::EVT_AIRCRAFT, "A-10C"}));
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_AIRCRAFT, "F-16C_50"}));
+  // Changing back is a change
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_AIRCRAFT, "A-10C"}));
+
+  const auto stats = dedup.GetStatistics();
+  EXPECT_EQ(stats.mDelivered, 3);
+  EXPECT_EQ(stats.mSuppressed, 2);
+}
+
+TEST(GameEventDeduplicator, NamesAreIndependent) {
+  GameEventDeduplicator dedup;
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_AIRCRAFT, "Caucasus"}));
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_TERRAIN, "Caucasus"}));
+  EXPECT_FALSE(dedup.ShouldDeliver({DCS::EVT_AIRCRAFT, "Caucasus"}));
+  EXPECT_FALSE(dedup.ShouldDeliver({DCS::EVT_TERRAIN, "Caucasus"}));
+}
+
+TEST(GameEventDeduplicator, AlwaysDeliversOptOuts) {
+  GameEventDeduplicator dedup;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_MESSAGE, "hello"}));
+    EXPECT_TRUE(
+      dedup.ShouldDeliver({GameEvent::EVT_REMOTE_USER_ACTION, "NEXT_PAGE"}));
+  }
+  EXPECT_EQ(dedup.GetStatistics().mSuppressed, 0);
+}
+
+TEST(GameEventDeduplicator, SimulationStartResets) {
+  GameEventDeduplicator dedup;
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_MISSION, "a.miz"}));
+  EXPECT_FALSE(dedup.ShouldDeliver({DCS::EVT_MISSION, "a.miz"}));
+  // Restarting the same mission must reload it
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_SIMULATION_START, "{}"}));
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_MISSION, "a.miz"}));
+  EXPECT_FALSE(dedup.ShouldDeliver({DCS::EVT_MISSION, "a.miz"}));
+}
+
+TEST(GameEventDeduplicator, Reset) {
+  GameEventDeduplicator dedup;
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_TERRAIN, "Syria"}));
+  dedup.Reset();
+  EXPECT_TRUE(dedup.ShouldDeliver({DCS::EVT_TERRAIN, "Syria"}));
+  EXPECT_FALSE(dedup.ShouldDeliver({DCS::EVT_TERRAIN, "Syria"}));
+}
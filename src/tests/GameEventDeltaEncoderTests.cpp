@@ -0,0 +1,116 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventDeltaEncoder.h>
+
+#include <ostream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+namespace OpenKneeboard {
+// Found by ADL; otherwise `operator bool()` would be compared
+static bool operator==(const GameEvent& a, const GameEvent& b) {
+  return a.name == b.name && a.value == b.value;
+}
+void PrintTo(const GameEvent& event, std::ostream* os) {
+  *os << event.name << '=' << event.value;
+}
+}// namespace OpenKneeboard
+
+using namespace OpenKneeboard;
+using Events = std::vector<GameEvent>;
+
+TEST(GameEventDeltaEncoder, RejectsZeroInterval) {
+  EXPECT_THROW(GameEventDeltaEncoder(0), std::logic_error);
+}
+
+TEST(GameEventDeltaEncoder, FirstUpdateIsAKeyframe) {
+  GameEventDeltaEncoder encoder(20);
+  const Events state {{"a", "1"}, {"b", "2"}};
+  EXPECT_EQ(encoder.Update(state), state);
+  EXPECT_EQ(encoder.GetStatistics().mKeyframes, 1);
+}
+
+TEST(GameEventDeltaEncoder, OnlySendsChanges) {
+  GameEventDeltaEncoder encoder(20);
+  encoder.Update(Events {{"a", "1"}, {"b", "2"}, {"c", "3"}});
+
+  EXPECT_EQ(
+    encoder.Update(Events {{"a", "1"}, {"b", "changed"}, {"c", "3"}}),
+    (Events {{"b", "changed"}}));
+  EXPECT_TRUE(
+    encoder.Update(Events {{"a", "1"}, {"b", "changed"}, {"c", "3"}})
+      .empty());
+
+  const auto stats = encoder.GetStatistics();
+  EXPECT_EQ(stats.mUpdates, 3);
+  EXPECT_EQ(stats.mKeyframes, 1);
+  EXPECT_EQ(stats.mSent, 4);
+  EXPECT_EQ(stats.mSkipped, 5);
+}
+
+TEST(GameEventDeltaEncoder, NewNamesAreSent) {
+  GameEventDeltaEncoder encoder(20);
+  encoder.Update(Events {{"a", "1"}});
+  EXPECT_EQ(
+    encoder.Update(Events {{"a", "1"}, {"b", "2"}}), (Events {{"b", "2"}}));
+}
+
+TEST(GameEventDeltaEncoder, KeyframeInterval) {
+  GameEventDeltaEncoder encoder(3);
+  const Events state {{"a", "1"}};
+  std::vector<size_t> sent;
+  for (int i = 0; i < 7; ++i) {
+    sent.push_back(encoder.Update(state).size());
+  }
+  EXPECT_EQ(sent, (std::vector<size_t> {1, 0, 0, 1, 0, 0, 1}));
+  EXPECT_EQ(encoder.GetStatistics().mKeyframes, 3);
+}
+
+TEST(GameEventDeltaEncoder, ForceKeyframe) {
+  GameEventDeltaEncoder encoder(20);
+  const Events state {{"a", "1"}, {"b", "2"}};
+  encoder.Update(state);
+  EXPECT_TRUE(encoder.Update(state).empty());
+
+  encoder.ForceKeyframe();
+  EXPECT_EQ(encoder.Update(state), state);
+  // ... and the interval restarts from there
+  EXPECT_TRUE(encoder.Update(state).empty());
+}
+
+TEST(GameEventDeltaEncoder, MissingNamesAreForgotten) {
+  GameEventDeltaEncoder encoder(20);
+  encoder.Update(Events {{"a", "1"}, {"b", "2"}});
+  EXPECT_TRUE(encoder.Update(Events {{"a", "1"}}).empty());
+  // `b` came back with the same value, but the app may have missed that it
+  // went away, so it's sent again
+  EXPECT_EQ(
+    encoder.Update(Events {{"a", "1"}, {"b", "2"}}), (Events {{"b", "2"}}));
+}
+
+TEST(GameEventDeltaEncoder, PreservesOrder) {
+  GameEventDeltaEncoder encoder(20);
+  const Events state {{"c", "3"}, {"a", "1"}, {"b", "2"}};
+  EXPECT_EQ(encoder.Update(state), state);
+  EXPECT_EQ(
+    encoder.Update(Events {{"c", "x"}, {"a", "1"}, {"b", "y"}}),
+    (Events {{"c", "x"}, {"b", "y"}}));
+}
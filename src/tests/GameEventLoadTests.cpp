@@ -0,0 +1,266 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEvent.h>
+#include <OpenKneeboard/GameEventLoadGenerator.h>
+#include <OpenKneeboard/GameEventUnixSocket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Clock = GameEventLoadGenerator::Clock;
+
+std::string_view AsStringView(const std::vector<std::byte>& bytes) {
+  return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+int64_t ToMicroseconds(Clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+    .count();
+}
+
+class GameEventUnixSocket : public ::testing::Test {
+ protected:
+  const std::string mPath {(std::filesystem::temp_directory_path()
+                            / std::format(
+                              "OpenKneeboard-Test-{}-{}.sock",
+                              getpid(),
+                              ::testing::UnitTest::GetInstance()
+                                ->current_test_info()
+                                ->name()))
+                             .string()};
+
+  ~GameEventUnixSocket() override {
+    std::remove(mPath.c_str());
+  }
+};
+
+}// namespace
+
+TEST(GameEventLoadGenerator, RejectsInvalidProfiles) {
+  EXPECT_THROW(
+    GameEventLoadGenerator({.mEventsPerSecond = 0}), std::logic_error);
+  EXPECT_THROW(GameEventLoadGenerator({.mBurstSize = 0}), std::logic_error);
+  EXPECT_THROW(
+    GameEventLoadGenerator({.mMinPayloadBytes = 128, .mMaxPayloadBytes = 64}),
+    std::logic_error);
+  EXPECT_NO_THROW(GameEventLoadGenerator(GameEventLoadProfile {}));
+}
+
+TEST(GameEventLoadGenerator, BurstsAreEvenlySpaced) {
+  GameEventLoadGenerator generator({
+    .mEventsPerSecond = 1000,
+    .mBurstSize = 10,
+    .mDuration = std::chrono::milliseconds(100),
+  });
+
+  for (int i = 0; i < 10; ++i) {
+    const auto burst = generator.NextBurst();
+    ASSERT_TRUE(burst) << "burst " << i;
+    EXPECT_EQ(burst->mSize, 10);
+    EXPECT_EQ(
+      std::chrono::round<std::chrono::microseconds>(burst->mDueAt),
+      std::chrono::milliseconds(i * 10));
+  }
+  EXPECT_FALSE(generator.NextBurst());
+}
+
+TEST(GameEventLoadGenerator, PayloadSizesAreWithinProfile) {
+  using enum GameEventLoadProfile::PayloadDistribution;
+  for (const auto distribution: {Uniform, LogUniform}) {
+    GameEventLoadGenerator generator({
+      .mMinPayloadBytes = 100,
+      .mMaxPayloadBytes = 4096,
+      .mPayloadDistribution = distribution,
+    });
+    for (int i = 0; i < 1000; ++i) {
+      const auto event = generator.CreateEvent(Clock::now());
+      EXPECT_EQ(event.name, GameEventLoadGenerator::EventName);
+      EXPECT_GE(event.value.size(), 100);
+      EXPECT_LE(event.value.size(), 4096);
+    }
+    EXPECT_EQ(generator.GetCreatedCount(), 1000);
+  }
+
+  // Smaller payloads are padded to fit the sequence number and timestamp
+  GameEventLoadGenerator tiny({.mMinPayloadBytes = 1, .mMaxPayloadBytes = 1});
+  EXPECT_EQ(tiny.CreateEvent(Clock::now()).value.size(), 48);
+}
+
+TEST(GameEventDeliveryStats, InOrderDelivery) {
+  GameEventLoadGenerator generator(GameEventLoadProfile {});
+  GameEventDeliveryStats stats;
+  const auto sentAt = Clock::now();
+  for (int i = 1; i <= 100; ++i) {
+    ASSERT_TRUE(stats.Record(
+      generator.CreateEvent(sentAt), sentAt + std::chrono::microseconds(i)));
+  }
+  EXPECT_EQ(stats.GetReceivedCount(), 100);
+
+  const auto summary = stats.Summarize(generator.GetCreatedCount());
+  EXPECT_EQ(summary.mSent, 100);
+  EXPECT_EQ(summary.mReceived, 100);
+  EXPECT_EQ(summary.mDropped, 0);
+  EXPECT_EQ(summary.mDuplicates, 0);
+  EXPECT_EQ(summary.mOutOfOrder, 0);
+  EXPECT_EQ(summary.mP50, std::chrono::microseconds(51));
+  EXPECT_EQ(summary.mP90, std::chrono::microseconds(91));
+  EXPECT_EQ(summary.mP99, std::chrono::microseconds(100));
+  EXPECT_EQ(summary.mMax, std::chrono::microseconds(100));
+}
+
+TEST(GameEventDeliveryStats, CountsDropsDuplicatesAndReordering) {
+  GameEventLoadGenerator generator(GameEventLoadProfile {});
+  const auto now = Clock::now();
+  std::vector<GameEvent> events;
+  for (int i = 0; i < 5; ++i) {
+    events.push_back(generator.CreateEvent(now));
+  }
+
+  GameEventDeliveryStats stats;
+  // 1 is dropped, 3 arrives before 2, and 0 is delivered twice
+  for (const auto i: {0, 3, 2, 0, 4}) {
+    ASSERT_TRUE(stats.Record(events.at(i), now));
+  }
+  const auto summary = stats.Summarize(generator.GetCreatedCount());
+  EXPECT_EQ(summary.mSent, 5);
+  EXPECT_EQ(summary.mReceived, 4);
+  EXPECT_EQ(summary.mDropped, 1);
+  EXPECT_EQ(summary.mDuplicates, 1);
+  EXPECT_EQ(summary.mOutOfOrder, 1);
+}
+
+TEST(GameEventDeliveryStats, IgnoresOtherEvents) {
+  GameEventDeliveryStats stats;
+  EXPECT_FALSE(stats.Record({"com.example/Other", "0 0 "}, Clock::now()));
+  EXPECT_FALSE(stats.Record(
+    {GameEventLoadGenerator::EventName, "not a sequence"}, Clock::now()));
+  EXPECT_EQ(stats.GetReceivedCount(), 0);
+  EXPECT_EQ(stats.Summarize(0).mReceived, 0);
+}
+
+TEST_F(GameEventUnixSocket, SendFailsWithoutReceiver) {
+  UnixSocketGameEventSender sender(mPath);
+  const GameEvent event {"com.example/Test", "value"};
+  EXPECT_FALSE(sender.Send(event.Serialize()));
+}
+
+TEST_F(GameEventUnixSocket, RoundTrip) {
+  UnixSocketGameEventReceiver receiver(mPath);
+  UnixSocketGameEventSender sender(mPath);
+
+  const GameEvent first {"com.example/First", "1"};
+  // Larger than a single `recv()`, so it's reassembled from several reads
+  const GameEvent second {"com.example/Second", std::string(100000, 'x')};
+  ASSERT_TRUE(sender.Send(first.Serialize()));
+  ASSERT_TRUE(sender.Send(second.Serialize()));
+
+  for (const auto& expected: {first, second}) {
+    const auto packet = receiver.Receive(std::chrono::seconds(5));
+    ASSERT_TRUE(packet);
+    const auto event = GameEvent::Unserialize(AsStringView(*packet));
+    EXPECT_EQ(event.name, expected.name);
+    EXPECT_EQ(event.value, expected.value);
+  }
+  EXPECT_FALSE(receiver.Receive(std::chrono::milliseconds(10)));
+}
+
+// Pushes a generated load through the socket at full rate, while receiving
+// on this thread
+TEST_F(GameEventUnixSocket, DeliversGeneratedLoadInOrder) {
+  UnixSocketGameEventReceiver receiver(mPath);
+
+  GameEventLoadGenerator generator({
+    .mEventsPerSecond = 20000,
+    .mBurstSize = 20,
+    .mMinPayloadBytes = 64,
+    .mMaxPayloadBytes = 8192,
+    .mPayloadDistribution
+    = GameEventLoadProfile::PayloadDistribution::LogUniform,
+    .mDuration = std::chrono::milliseconds(250),
+  });
+
+  std::atomic_bool senderFinished {false};
+  uint64_t sendFailures {0};
+  std::jthread senderThread([&]() {
+    UnixSocketGameEventSender sender(mPath);
+    const auto start = Clock::now();
+    while (const auto burst = generator.NextBurst()) {
+      std::this_thread::sleep_until(start + burst->mDueAt);
+      for (size_t i = 0; i < burst->mSize; ++i) {
+        if (!sender.Send(generator.CreateEvent(Clock::now()).Serialize())) {
+          ++sendFailures;
+        }
+      }
+    }
+    senderFinished.store(true);
+  });
+
+  GameEventDeliveryStats stats;
+  std::vector<GameEvent> events;
+  while (true) {
+    const auto packet = receiver.Receive(std::chrono::milliseconds(100));
+    if (!packet) {
+      if (senderFinished.load()) {
+        break;
+      }
+      continue;
+    }
+    const auto receivedAt = Clock::now();
+    events.clear();
+    ASSERT_TRUE(GameEvent::UnserializeAll(AsStringView(*packet), &events));
+    for (const auto& event: events) {
+      EXPECT_TRUE(stats.Record(event, receivedAt));
+    }
+  }
+  senderThread.join();
+
+  EXPECT_EQ(sendFailures, 0);
+  const auto summary = stats.Summarize(generator.GetCreatedCount());
+  EXPECT_EQ(summary.mSent, 5000);
+  EXPECT_EQ(summary.mReceived, summary.mSent);
+  EXPECT_EQ(summary.mDropped, 0);
+  EXPECT_EQ(summary.mDuplicates, 0);
+  EXPECT_EQ(summary.mOutOfOrder, 0);
+  EXPECT_LE(summary.mP50, summary.mP90);
+  EXPECT_LE(summary.mP90, summary.mP99);
+  EXPECT_LE(summary.mP99, summary.mP999);
+  EXPECT_LE(summary.mP999, summary.mMax);
+
+  RecordProperty("P50US", ToMicroseconds(summary.mP50));
+  RecordProperty("P90US", ToMicroseconds(summary.mP90));
+  RecordProperty("P99US", ToMicroseconds(summary.mP99));
+  RecordProperty("P999US", ToMicroseconds(summary.mP999));
+  RecordProperty("MaxUS", ToMicroseconds(summary.mMax));
+}
@@ -0,0 +1,318 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEvent.h>
+
+#include <nlohmann/json.hpp>
+
+#include <cstring>
+#include <format>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+
+namespace OpenKneeboard {
+// Found by ADL; otherwise `operator bool()` would be compared
+static bool operator==(const GameEvent& a, const GameEvent& b) {
+  return a.name == b.name && a.value == b.value;
+}
+void PrintTo(const GameEvent& event, std::ostream* os) {
+  *os << event.name << '=' << event.value;
+}
+}// namespace OpenKneeboard
+
+namespace {
+
+// `PacketHeader` offsets
+constexpr size_t HeaderSize = 16;
+constexpr size_t FlagsOffset = 5;
+constexpr size_t NameIDOffset = 6;
+constexpr size_t ValueSizeOffset = 12;
+
+std::string AsString(const std::vector<std::byte>& bytes) {
+  return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+// As sent by older versions and third-party senders
+std::string SerializeV1(const GameEvent& event) {
+  return std::format(
+    "{:08x}!{}!{:08x}!{}!",
+    event.name.size(),
+    event.name,
+    event.value.size(),
+    event.value);
+}
+
+template <class T>
+void Poke(std::string* packet, size_t offset, T value) {
+  memcpy(packet->data() + offset, &value, sizeof(value));
+}
+
+template <class T>
+T Peek(const std::string& packet, size_t offset) {
+  T ret;
+  memcpy(&ret, packet.data() + offset, sizeof(ret));
+  return ret;
+}
+
+// Append to the value of a packed multi-event
+void AppendToValue(std::string* packet, std::string_view extra) {
+  *packet += extra;
+  Poke<uint32_t>(
+    packet,
+    ValueSizeOffset,
+    Peek<uint32_t>(*packet, ValueSizeOffset) + extra.size());
+}
+
+const GameEvent Custom {"com.example/Custom", "some value"};
+const GameEvent Interned {"dcs/Mission", R"({"path": "C:\\foo.miz"})"};
+
+}// namespace
+
+TEST(GameEventProtocol, AcceptsV1) {
+  const auto packet = SerializeV1(Custom);
+  const auto view = GameEventView::Parse(packet);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(view->name, Custom.name);
+  EXPECT_EQ(view->value, Custom.value);
+  EXPECT_FALSE(view->isPacked);
+  EXPECT_EQ(GameEvent::Unserialize(packet), Custom);
+
+  // The separators are only framing; lengths decide
+  const GameEvent awkward {"a!b", "!!\0x!"};
+  EXPECT_EQ(GameEvent::Unserialize(SerializeV1(awkward)), awkward);
+}
+
+TEST(GameEventProtocol, RejectsInvalidV1) {
+  EXPECT_FALSE(GameEventView::Parse(""));
+  EXPECT_FALSE(GameEventView::Parse("garbage"));
+  // Lengths don't match the contents
+  EXPECT_FALSE(GameEventView::Parse("00000004!abc!00000001!x!"));
+  EXPECT_FALSE(GameEventView::Parse("00000003!abc!00000002!x!"));
+  EXPECT_FALSE(GameEventView::Parse(SerializeV1(Custom) + "!"));
+  // Names are required, and lengths must be hex
+  EXPECT_FALSE(GameEventView::Parse("00000000!!00000001!x!"));
+  EXPECT_FALSE(GameEventView::Parse("0000000z!a!00000001!x!"));
+  EXPECT_FALSE(GameEventView::Parse("00000001!a!0000001 !x!"));
+  EXPECT_FALSE(GameEvent::Unserialize("00000003!abc!00000002!x!"));
+}
+
+TEST(GameEventProtocol, V2RoundTrip) {
+  for (const auto& event: {
+         Custom,
+         Interned,
+         GameEvent {"x", ""},
+         GameEvent {"binary", std::string {"a\0b\xff!", 5}},
+       }) {
+    const auto packet = AsString(event.Serialize());
+    EXPECT_EQ(packet.front(), '\0');
+    const auto view = GameEventView::Parse(packet);
+    ASSERT_TRUE(view) << event.name;
+    EXPECT_EQ(view->name, event.name);
+    EXPECT_EQ(view->value, event.value);
+    EXPECT_FALSE(view->isPacked);
+    // Views, not copies
+    EXPECT_EQ(view->value.data() + view->value.size(), &*packet.end());
+    EXPECT_EQ(GameEvent::Unserialize(packet), event);
+  }
+}
+
+TEST(GameEventProtocol, InternsKnownNames) {
+  const auto interned = AsString(Interned.Serialize());
+  EXPECT_EQ(interned.size(), HeaderSize + Interned.value.size());
+  EXPECT_EQ(GameEvent::Unserialize(interned), Interned);
+
+  const auto custom = AsString(Custom.Serialize());
+  EXPECT_EQ(
+    custom.size(), HeaderSize + Custom.name.size() + Custom.value.size());
+
+  // Interned IDs are only valid if they're in the table...
+  auto invalid = interned;
+  Poke<uint16_t>(&invalid, NameIDOffset, 0xffff);
+  EXPECT_FALSE(GameEventView::Parse(invalid));
+  // ... and the packet doesn't also have a name
+  invalid = custom;
+  Poke<uint8_t>(&invalid, FlagsOffset, 1);
+  EXPECT_FALSE(GameEventView::Parse(invalid));
+}
+
+TEST(GameEventProtocol, PackedMultiEvents) {
+  const std::vector<GameEvent> events {Custom, Interned, {"x", ""}};
+  const auto packet = AsString(GameEvent::SerializePacked(events));
+
+  const auto view = GameEventView::Parse(packet);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(view->name, GameEvent::EVT_MULTI_EVENT);
+  EXPECT_TRUE(view->isPacked);
+
+  auto remaining = view->value;
+  std::vector<GameEvent> parsed;
+  while (const auto inner = GameEventView::ParseNext(&remaining)) {
+    parsed.push_back(inner->ToGameEvent());
+  }
+  EXPECT_TRUE(remaining.empty());
+  EXPECT_EQ(parsed, events);
+
+  // Existing consumers see a JSON multi-event
+  const auto multi = GameEvent::Unserialize(packet);
+  EXPECT_EQ(multi.name, GameEvent::EVT_MULTI_EVENT);
+  EXPECT_EQ(
+    nlohmann::json::parse(multi.value),
+    nlohmann::json::parse(
+      R"([["com.example/Custom", "some value"],)"
+      R"( ["dcs/Mission", "{\"path\": \"C:\\\\foo.miz\"}"], ["x", ""]])"));
+
+  // Appends to existing events
+  std::vector<GameEvent> all {{"before", "1"}};
+  ASSERT_TRUE(GameEvent::UnserializeAll(packet, &all));
+  ASSERT_EQ(all.size(), 4);
+  EXPECT_EQ(all.front().name, "before");
+  EXPECT_EQ(std::vector(all.begin() + 1, all.end()), events);
+}
+
+TEST(GameEventProtocol, UnserializeAllExpandsJSONMultiEvents) {
+  const GameEvent multi {
+    GameEvent::EVT_MULTI_EVENT,
+    R"([["a", "1"], ["b", "2"]])",
+  };
+  std::vector<GameEvent> events;
+  ASSERT_TRUE(GameEvent::UnserializeAll(AsString(multi.Serialize()), &events));
+  EXPECT_EQ(events, (std::vector<GameEvent> {{"a", "1"}, {"b", "2"}}));
+
+  ASSERT_TRUE(GameEvent::UnserializeAll(SerializeV1(Custom), &events));
+  EXPECT_EQ(events.back(), Custom);
+
+  for (const auto invalid: {
+         R"([["a", "1"], [2]])",
+         R"([["a", "1"], ["", "2"]])",
+         R"([["a", "1"], ["b"]])",
+         R"({"a": "1"})",
+       }) {
+    const GameEvent multi {GameEvent::EVT_MULTI_EVENT, invalid};
+    EXPECT_FALSE(
+      GameEvent::UnserializeAll(AsString(multi.Serialize()), &events))
+      << invalid;
+    EXPECT_EQ(events.size(), 3);
+  }
+}
+
+TEST(GameEventProtocol, RejectsInvalidPackedEvents) {
+  const std::vector<GameEvent> events {Custom, Interned};
+  const auto valid = AsString(GameEvent::SerializePacked(events));
+  const std::vector<GameEvent> before {{"before", "1"}};
+
+  const auto expectRejected = [&](const std::string& packet) {
+    auto parsed = before;
+    EXPECT_FALSE(GameEvent::UnserializeAll(packet, &parsed));
+    // Not even the valid events before the problem
+    EXPECT_EQ(parsed, before);
+    EXPECT_FALSE(GameEvent::Unserialize(packet));
+  };
+
+  // Bad magic in the second inner packet
+  auto packet = valid;
+  packet.at(HeaderSize + Custom.Serialize().size() + 1) = 'X';
+  expectRejected(packet);
+
+  // Trailing bytes that aren't a packet
+  packet = valid;
+  AppendToValue(&packet, "abc");
+  expectRejected(packet);
+
+  // Nested packing
+  packet = valid;
+  AppendToValue(&packet, AsString(GameEvent::SerializePacked(events)));
+  expectRejected(packet);
+}
+
+TEST(GameEventProtocol, RejectsTruncatedPackets) {
+  for (const auto& packet: {
+         SerializeV1(Custom),
+         AsString(Custom.Serialize()),
+         AsString(Interned.Serialize()),
+         AsString(GameEvent::SerializePacked({{Custom, Interned}})),
+       }) {
+    for (size_t size = 0; size < packet.size(); ++size) {
+      const auto truncated = packet.substr(0, size);
+      EXPECT_FALSE(GameEventView::Parse(truncated)) << size;
+      std::vector<GameEvent> events;
+      EXPECT_FALSE(GameEvent::UnserializeAll(truncated, &events)) << size;
+      EXPECT_TRUE(events.empty());
+    }
+    // ... or with trailing data
+    EXPECT_FALSE(GameEventView::Parse(packet + '\0'));
+  }
+}
+
+// Anything is allowed to be rejected, but nothing may crash, throw, or
+// half-succeed
+TEST(GameEventProtocol, SurvivesMutatedPackets) {
+  const std::vector<std::string> seeds {
+    SerializeV1(Custom),
+    AsString(Custom.Serialize()),
+    AsString(Interned.Serialize()),
+    AsString(GameEvent::SerializePacked({{Custom, Interned, {"x", ""}}})),
+    AsString(GameEvent {GameEvent::EVT_MULTI_EVENT, R"([["a", "1"]])"}
+               .Serialize()),
+  };
+
+  std::mt19937 rng(1234);
+  const auto random = [&rng](size_t max) {
+    return std::uniform_int_distribution<size_t>(0, max)(rng);
+  };
+  const std::vector<GameEvent> before {{"before", "1"}};
+  size_t accepted = 0;
+  for (int i = 0; i < 20000; ++i) {
+    auto packet = seeds.at(random(seeds.size() - 1));
+    for (size_t j = 0, count = random(4) + 1; j < count; ++j) {
+      const auto offset = random(packet.size() - 1);
+      switch (random(2)) {
+        case 0:
+          packet.at(offset) = static_cast<char>(random(255));
+          break;
+        case 1:
+          packet.at(offset) ^= static_cast<char>(1 << random(7));
+          break;
+        case 2:
+          packet.resize(offset + 1);
+          break;
+      }
+    }
+
+    if (const auto view = GameEventView::Parse(packet)) {
+      EXPECT_FALSE(view->name.empty());
+    }
+    auto events = before;
+    ASSERT_NO_THROW({
+      if (GameEvent::UnserializeAll(packet, &events)) {
+        ++accepted;
+        EXPECT_GT(events.size(), before.size());
+      } else {
+        EXPECT_EQ(events, before);
+      }
+    });
+  }
+  // Mostly single-byte changes to values, so plenty are still valid
+  EXPECT_GT(accepted, 0);
+}
@@ -0,0 +1,137 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventRecording.h>
+
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+namespace OpenKneeboard {
+// Found by ADL; otherwise `operator bool()` would be compared
+static bool operator==(const GameEvent& a, const GameEvent& b) {
+  return a.name == b.name && a.value == b.value;
+}
+void PrintTo(const GameEvent& event, std::ostream* os) {
+  *os << event.name << '=' << event.value;
+}
+}// namespace OpenKneeboard
+
+using namespace OpenKneeboard;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::string Record(const std::vector<RecordedGameEventBatch>& batches) {
+  std::ostringstream out(std::ios::binary);
+  GameEventRecordingWriter writer(out);
+  for (const auto& batch: batches) {
+    writer.Write(batch);
+  }
+  return out.str();
+}
+
+}// namespace
+
+TEST(GameEventRecording, RoundTripsBatches) {
+  const std::vector<RecordedGameEventBatch> batches {
+    {0ms, {{"a", "1"}}},
+    {5ms, {{"b", "2"}, {"c", ""}, {"", "3"}}},
+    {7ms, {{"binary", std::string {"\0\xff", 2}}}},
+  };
+  std::istringstream in(Record(batches), std::ios::binary);
+  GameEventRecordingReader reader(in);
+
+  for (const auto& expected: batches) {
+    const auto batch = reader.Next();
+    ASSERT_TRUE(batch.has_value());
+    EXPECT_EQ(batch->mTime, expected.mTime);
+    EXPECT_EQ(batch->mEvents, expected.mEvents);
+  }
+  EXPECT_FALSE(reader.Next().has_value());
+}
+
+TEST(GameEventRecording, EmptyRecording) {
+  std::istringstream in(Record({}), std::ios::binary);
+  GameEventRecordingReader reader(in);
+  EXPECT_FALSE(reader.Next().has_value());
+}
+
+TEST(GameEventRecording, RejectsOtherFiles) {
+  std::istringstream empty(std::string {}, std::ios::binary);
+  EXPECT_THROW(GameEventRecordingReader {empty}, std::runtime_error);
+
+  auto bytes = Record({});
+  bytes[0] = 'X';
+  std::istringstream badMagic(bytes, std::ios::binary);
+  EXPECT_THROW(GameEventRecordingReader {badMagic}, std::runtime_error);
+
+  bytes = Record({});
+  bytes[8] = 1;
+  std::istringstream badVersion(bytes, std::ios::binary);
+  EXPECT_THROW(GameEventRecordingReader {badVersion}, std::runtime_error);
+}
+
+TEST(GameEventRecording, ThrowsOnTruncation) {
+  const auto header = Record({});
+  const auto full = Record({{1ms, {{"name", "value"}, {"other", "value"}}}});
+
+  for (auto size = header.size() + 1; size < full.size(); ++size) {
+    std::istringstream in(full.substr(0, size), std::ios::binary);
+    GameEventRecordingReader reader(in);
+    EXPECT_THROW(reader.Next(), std::runtime_error) << "size " << size;
+  }
+}
+
+// Used by gameevent-replay-benchmark; this catches format changes that would
+// need it to be re-recorded
+TEST(GameEventRecording, ReadsCheckedInRecording) {
+  std::ifstream file(
+    OPENKNEEBOARD_TEST_DATA_DIR "/dcs-flight.okgevents", std::ios::binary);
+  ASSERT_TRUE(file);
+  GameEventRecordingReader reader(file);
+
+  size_t batches = 0;
+  std::chrono::nanoseconds last {};
+  while (const auto batch = reader.Next()) {
+    ++batches;
+    EXPECT_GE(batch->mTime, last);
+    last = batch->mTime;
+    EXPECT_FALSE(batch->mEvents.empty());
+    for (const auto& event: batch->mEvents) {
+      EXPECT_TRUE(event.name.starts_with("dcs/")) << event.name;
+    }
+  }
+  EXPECT_GT(batches, 100);
+}
+
+TEST(GameEventReplayScheduler, ScalesTime) {
+  const GameEventReplayScheduler::Clock::time_point start {};
+  const RecordedGameEventBatch batch {.mTime = 100ms};
+
+  EXPECT_EQ(
+    GameEventReplayScheduler(start, 1).GetDueTime(batch), start + 100ms);
+  EXPECT_EQ(
+    GameEventReplayScheduler(start, 2).GetDueTime(batch), start + 50ms);
+  EXPECT_EQ(GameEventReplayScheduler(start, 0).GetDueTime(batch), start);
+  EXPECT_THROW(GameEventReplayScheduler(start, -1), std::logic_error);
+}
@@ -0,0 +1,202 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/GameEventSendQueue.h>
+
+#include <format>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+bool IsStateEvent(std::string_view name) {
+  return name.starts_with("state/");
+}
+
+std::vector<GameEvent> Unpack(std::span<const std::byte> packet) {
+  std::vector<GameEvent> events;
+  EXPECT_TRUE(GameEvent::UnserializeAll(
+    {reinterpret_cast<const char*>(packet.data()), packet.size()}, &events));
+  return events;
+}
+
+std::vector<GameEvent> PopAll(GameEventSendQueue& queue) {
+  std::vector<GameEvent> events;
+  queue.Flush([&](std::span<const std::byte> packet) {
+    std::ranges::copy(Unpack(packet), std::back_inserter(events));
+  });
+  return events;
+}
+
+}// namespace
+
+namespace OpenKneeboard {
+// Found by ADL; otherwise `operator bool()` would be compared
+static bool operator==(const GameEvent& a, const GameEvent& b) {
+  return a.name == b.name && a.value == b.value;
+}
+void PrintTo(const GameEvent& event, std::ostream* os) {
+  *os << event.name << '=' << event.value;
+}
+}// namespace OpenKneeboard
+
+TEST(GameEventSendQueue, RejectsZeroSizes) {
+  EXPECT_THROW(GameEventSendQueue(0, 1, &IsStateEvent), std::logic_error);
+  EXPECT_THROW(GameEventSendQueue(1, 0, &IsStateEvent), std::logic_error);
+}
+
+TEST(GameEventSendQueue, Empty) {
+  GameEventSendQueue queue(16, 4, &IsStateEvent);
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_TRUE(queue.PopPacket().empty());
+
+  int packets = 0;
+  queue.Flush([&](auto) { ++packets; });
+  EXPECT_EQ(packets, 0);
+}
+
+TEST(GameEventSendQueue, SingleEventIsNotPacked) {
+  GameEventSendQueue queue(16, 4, &IsStateEvent);
+  const GameEvent event {"foo", "bar"};
+  EXPECT_TRUE(queue.Push(event));
+  EXPECT_FALSE(queue.IsEmpty());
+
+  EXPECT_EQ(queue.PopPacket(), event.Serialize());
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(GameEventSendQueue, BatchesInOrder) {
+  GameEventSendQueue queue(16, 4, &IsStateEvent);
+  std::vector<GameEvent> sent;
+  for (int i = 0; i < 10; ++i) {
+    sent.push_back({"event", std::to_string(i)});
+    queue.Push(sent.back());
+  }
+
+  std::vector<size_t> packetSizes;
+  std::vector<GameEvent> received;
+  queue.Flush([&](std::span<const std::byte> packet) {
+    const auto events = Unpack(packet);
+    packetSizes.push_back(events.size());
+    std::ranges::copy(events, std::back_inserter(received));
+  });
+
+  EXPECT_EQ(packetSizes, (std::vector<size_t> {4, 4, 2}));
+  EXPECT_EQ(received, sent);
+  EXPECT_EQ(queue.GetStatistics().mPackets, 3);
+}
+
+TEST(GameEventSendQueue, DropsWhenFull) {
+  GameEventSendQueue queue(2, 4, &IsStateEvent);
+  EXPECT_TRUE(queue.Push({"a", "1"}));
+  EXPECT_TRUE(queue.Push({"b", "2"}));
+  EXPECT_FALSE(queue.Push({"c", "3"}));
+  // A state event with nothing queued to replace is dropped too
+  EXPECT_FALSE(queue.Push({"state/x", "4"}));
+
+  const auto stats = queue.GetStatistics();
+  EXPECT_EQ(stats.mQueued, 2);
+  EXPECT_EQ(stats.mDropped, 2);
+  EXPECT_EQ(PopAll(queue), (std::vector<GameEvent> {{"a", "1"}, {"b", "2"}}));
+}
+
+TEST(GameEventSendQueue, MergesStateEventsWhenFull) {
+  GameEventSendQueue queue(3, 4, &IsStateEvent);
+  queue.Push({"state/x", "1"});
+  queue.Push({"other", "2"});
+  queue.Push({"state/y", "3"});
+  EXPECT_TRUE(queue.Push({"state/x", "4"}));
+
+  EXPECT_EQ(queue.GetStatistics().mMerged, 1);
+  // The new value takes the old one's place
+  EXPECT_EQ(
+    PopAll(queue),
+    (std::vector<GameEvent> {
+      {"state/x", "4"},
+      {"other", "2"},
+      {"state/y", "3"},
+    }));
+}
+
+TEST(GameEventSendQueue, StateEventsAreNotMergedUntilFull) {
+  GameEventSendQueue queue(16, 4, &IsStateEvent);
+  queue.Push({"state/x", "1"});
+  queue.Push({"state/x", "2"});
+  EXPECT_EQ(
+    PopAll(queue),
+    (std::vector<GameEvent> {{"state/x", "1"}, {"state/x", "2"}}));
+}
+
+// Pool threads and explicit flushes can overlap; packets must still arrive
+// in the order they were queued
+TEST(GameEventSendQueue, ConcurrentFlushesKeepOrder) {
+  constexpr int Producers = 4;
+  constexpr int EventsPerProducer = 5000;
+  constexpr int Flushers = 4;
+
+  GameEventSendQueue queue(
+    Producers * EventsPerProducer, 8, &IsStateEvent);
+  std::mutex receivedMutex;
+  std::vector<GameEvent> received;
+  const auto send = [&](std::span<const std::byte> packet) {
+    auto events = Unpack(packet);
+    std::unique_lock lock(receivedMutex);
+    std::ranges::move(events, std::back_inserter(received));
+  };
+
+  std::atomic_bool producing {true};
+  {
+    std::vector<std::jthread> flushers;
+    for (int i = 0; i < Flushers; ++i) {
+      flushers.emplace_back([&]() {
+        while (producing.load()) {
+          queue.Flush(send);
+        }
+      });
+    }
+    {
+      std::vector<std::jthread> producers;
+      for (int i = 0; i < Producers; ++i) {
+        producers.emplace_back([&queue, i]() {
+          for (int j = 0; j < EventsPerProducer; ++j) {
+            ASSERT_TRUE(queue.Push({std::format("{}", i), std::to_string(j)}));
+          }
+        });
+      }
+    }
+    producing.store(false);
+  }
+  queue.Flush(send);
+
+  ASSERT_EQ(received.size(), Producers * EventsPerProducer);
+  std::vector<int> next(Producers, 0);
+  for (const auto& event: received) {
+    const auto producer = std::stoi(event.name);
+    ASSERT_EQ(std::stoi(event.value), next.at(producer)++)
+      << "from producer " << producer;
+  }
+}
@@ -0,0 +1,128 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/LRUCache.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+
+using Cache = LRUCache<int, std::string>;
+
+TEST(LRUCache, FindsInsertedEntries) {
+  Cache cache(10);
+  EXPECT_EQ(cache.Find(1), nullptr);
+  EXPECT_TRUE(cache.Insert(1, "one", 3).empty());
+  ASSERT_NE(cache.Find(1), nullptr);
+  EXPECT_EQ(*cache.Find(1), "one");
+
+  // Replacing an entry replaces its cost too
+  EXPECT_TRUE(cache.Insert(1, "uno", 5).empty());
+  EXPECT_EQ(*cache.Find(1), "uno");
+  const auto stats = cache.GetStatistics();
+  EXPECT_EQ(stats.mEntryCount, 1);
+  EXPECT_EQ(stats.mTotalCost, 5);
+}
+
+TEST(LRUCache, EvictsLeastRecentlyUsedFirst) {
+  Cache cache(10);
+  cache.Insert(1, "one", 3);
+  cache.Insert(2, "two", 3);
+  cache.Insert(3, "three", 3);
+  // 1 is now the most recently used, so 2 goes first
+  ASSERT_NE(cache.Find(1), nullptr);
+
+  EXPECT_EQ(cache.Insert(4, "four", 3), (std::vector<int> {2}));
+  EXPECT_EQ(cache.Find(2), nullptr);
+
+  EXPECT_EQ(cache.Insert(5, "five", 6), (std::vector<int> {3, 1}));
+  EXPECT_NE(cache.Find(4), nullptr);
+  EXPECT_NE(cache.Find(5), nullptr);
+  EXPECT_EQ(cache.GetStatistics().mTotalCost, 9);
+}
+
+TEST(LRUCache, DoesNotStoreEntriesOverBudget) {
+  Cache cache(10);
+  cache.Insert(1, "one", 4);
+  EXPECT_TRUE(cache.Insert(2, "two", 11).empty());
+  EXPECT_EQ(cache.Find(2), nullptr);
+  // ... and doesn't evict anything for them
+  EXPECT_NE(cache.Find(1), nullptr);
+
+  // Replacing with an oversized value removes the old one
+  EXPECT_TRUE(cache.Insert(1, "uno", 11).empty());
+  EXPECT_EQ(cache.Find(1), nullptr);
+  EXPECT_EQ(cache.GetStatistics().mTotalCost, 0);
+}
+
+TEST(LRUCache, ShrinkingBudgetEvicts) {
+  Cache cache(10);
+  cache.Insert(1, "one", 3);
+  cache.Insert(2, "two", 3);
+  cache.Insert(3, "three", 3);
+  EXPECT_TRUE(cache.SetBudget(20).empty());
+  EXPECT_EQ(cache.SetBudget(4), (std::vector<int> {1, 2}));
+  EXPECT_EQ(cache.GetBudget(), 4);
+  EXPECT_NE(cache.Find(3), nullptr);
+  EXPECT_EQ(cache.GetStatistics().mEvictions, 2);
+}
+
+TEST(LRUCache, CountsHitsMissesAndEvictions) {
+  Cache cache(5);
+  cache.Find(1);
+  cache.Insert(1, "one", 3);
+  cache.Find(1);
+  cache.Find(1);
+  cache.Insert(2, "two", 3);
+  cache.Find(1);
+
+  const auto stats = cache.GetStatistics();
+  EXPECT_EQ(stats.mHits, 2);
+  EXPECT_EQ(stats.mMisses, 2);
+  EXPECT_EQ(stats.mEvictions, 1);
+  EXPECT_EQ(stats.mEntryCount, 1);
+  EXPECT_EQ(stats.mTotalCost, 3);
+}
+
+TEST(LRUCache, EraseIsNotEviction) {
+  Cache cache(10);
+  for (int i = 0; i < 5; ++i) {
+    cache.Insert(i, std::to_string(i), 2);
+  }
+  cache.Erase(0);
+  cache.EraseIf([](int key) { return key % 2 == 1; });
+
+  EXPECT_EQ(cache.Find(0), nullptr);
+  EXPECT_EQ(cache.Find(1), nullptr);
+  EXPECT_NE(cache.Find(2), nullptr);
+  EXPECT_EQ(cache.Find(3), nullptr);
+  EXPECT_NE(cache.Find(4), nullptr);
+
+  const auto stats = cache.GetStatistics();
+  EXPECT_EQ(stats.mEvictions, 0);
+  EXPECT_EQ(stats.mEntryCount, 2);
+  EXPECT_EQ(stats.mTotalCost, 4);
+
+  cache.Clear();
+  EXPECT_EQ(cache.GetStatistics().mEntryCount, 0);
+  EXPECT_EQ(cache.GetStatistics().mTotalCost, 0);
+  EXPECT_EQ(cache.GetStatistics().mEvictions, 0);
+}
@@ -0,0 +1,105 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/MPSCQueue.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+
+TEST(MPSCQueue, EmptyQueue) {
+  MPSCQueue<int> queue;
+  EXPECT_FALSE(queue.TryPop());
+}
+
+TEST(MPSCQueue, FIFO) {
+  MPSCQueue<int> queue;
+  for (int i = 0; i < 10; ++i) {
+    queue.Push(i);
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(queue.TryPop(), i);
+  }
+  EXPECT_FALSE(queue.TryPop());
+
+  // Still usable after being drained
+  queue.Push(123);
+  EXPECT_EQ(queue.TryPop(), 123);
+}
+
+TEST(MPSCQueue, MoveOnly) {
+  MPSCQueue<std::unique_ptr<int>> queue;
+  queue.Push(std::make_unique<int>(123));
+  const auto value = queue.TryPop();
+  ASSERT_TRUE(value);
+  EXPECT_EQ(**value, 123);
+}
+
+TEST(MPSCQueue, ValuesAreReleased) {
+  auto value = std::make_shared<int>(123);
+  {
+    MPSCQueue<std::shared_ptr<int>> queue;
+    queue.Push(value);
+    queue.Push(value);
+    EXPECT_EQ(value.use_count(), 3);
+
+    // Popped values must not stay alive in the new stub node
+    queue.TryPop();
+    EXPECT_EQ(value.use_count(), 2);
+  }
+  EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(MPSCQueue, ConcurrentProducers) {
+  constexpr int Producers = 8;
+  constexpr int ValuesPerProducer = 20000;
+
+  struct Value {
+    int mProducer {};
+    int mIndex {};
+  };
+  MPSCQueue<Value> queue;
+
+  std::vector<std::jthread> producers;
+  for (int producer = 0; producer < Producers; ++producer) {
+    producers.emplace_back([&queue, producer]() {
+      for (int i = 0; i < ValuesPerProducer; ++i) {
+        queue.Push({producer, i});
+      }
+    });
+  }
+
+  // Each producer's values must arrive in the order they were pushed
+  std::vector<int> nextIndex(Producers, 0);
+  int received = 0;
+  while (received < Producers * ValuesPerProducer) {
+    const auto value = queue.TryPop();
+    if (!value) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(value->mIndex, nextIndex.at(value->mProducer)++);
+    ++received;
+  }
+  EXPECT_FALSE(queue.TryPop());
+}
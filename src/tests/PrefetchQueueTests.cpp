@@ -0,0 +1,200 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PrefetchQueue.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+constexpr size_t CacheBudget = 800;
+
+// Stands in for a tab view and the page cache, and renders requests the way
+// `PagePrefetcher` does
+struct MockPageSource {
+  std::vector<PrefetchQueue::PageID> mPages {10, 11, 12, 13, 14, 15};
+  std::unordered_map<PrefetchQueue::PageID, size_t> mCosts;
+  std::unordered_set<PrefetchQueue::PageID> mCached;
+  std::vector<PrefetchQueue::PageID> mRendered;
+
+  void Show(PrefetchQueue& queue, PrefetchQueue::OwnerID owner, size_t index) {
+    mCached.insert(mPages.at(index));
+    queue.SetCurrentPage(owner, mPages, mPages.at(index));
+  }
+
+  void Prefetch(PrefetchQueue& queue) {
+    while (const auto request = queue.Pop()) {
+      const auto cost
+        = mCosts.contains(request->mPage) ? mCosts.at(request->mPage) : 10;
+      if (!PrefetchQueue::IsWorthPrefetching(cost, CacheBudget)) {
+        continue;
+      }
+      mRendered.push_back(request->mPage);
+      mCached.insert(request->mPage);
+    }
+  }
+
+  void Evict(PrefetchQueue& queue, PrefetchQueue::PageID page) {
+    mCached.erase(page);
+    queue.Forget(page);
+  }
+};
+
+std::vector<PrefetchQueue::PageID> Drain(PrefetchQueue& queue) {
+  std::vector<PrefetchQueue::PageID> ret;
+  while (const auto request = queue.Pop()) {
+    ret.push_back(request->mPage);
+  }
+  return ret;
+}
+
+using Pages = std::vector<PrefetchQueue::PageID>;
+
+}// namespace
+
+TEST(PrefetchQueue, QueuesNextPagesFirst) {
+  PrefetchQueue queue(2);
+  MockPageSource source;
+  source.Show(queue, 1, 2);
+  EXPECT_EQ(Drain(queue), (Pages {13, 11, 14, 10}));
+
+  // At the end, only earlier pages
+  PrefetchQueue other(2);
+  source.Show(other, 1, 5);
+  EXPECT_EQ(Drain(other), (Pages {14, 13}));
+}
+
+TEST(PrefetchQueue, DoesNotRequeueDonePages) {
+  PrefetchQueue queue(1);
+  MockPageSource source;
+  source.Show(queue, 1, 2);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {13, 11}));
+
+  // 12 and 13 are done, so only 14
+  source.Show(queue, 1, 3);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {13, 11, 14}));
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(PrefetchQueue, DropsWorkWhenCurrentPageChanges) {
+  PrefetchQueue queue(2);
+  MockPageSource source;
+  source.Show(queue, 1, 0);
+  ASSERT_FALSE(queue.IsEmpty());
+
+  // The user jumped before anything was prefetched; 11 and 12 are no longer
+  // near the current page
+  source.Show(queue, 1, 5);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {14, 13}));
+
+  // Unchanged current page: nothing new
+  source.Show(queue, 1, 5);
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(PrefetchQueue, SkipsPagesOverAnEighthOfTheBudget) {
+  EXPECT_TRUE(PrefetchQueue::IsWorthPrefetching(CacheBudget / 8, CacheBudget));
+  EXPECT_FALSE(
+    PrefetchQueue::IsWorthPrefetching((CacheBudget / 8) + 1, CacheBudget));
+
+  PrefetchQueue queue(1);
+  MockPageSource source;
+  source.mCosts[13] = CacheBudget / 4;
+  source.Show(queue, 1, 2);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {11}));
+  EXPECT_FALSE(source.mCached.contains(13));
+}
+
+TEST(PrefetchQueue, InvalidateResetsAfterContentChanges) {
+  PrefetchQueue queue(1);
+  MockPageSource source;
+  source.Show(queue, 1, 2);
+  source.Prefetch(queue);
+
+  // Like `evContentChangedEvent`: the cached pages are stale, so the
+  // neighbors of the (same) current page are prefetched again
+  queue.Invalidate(1);
+  source.mCached.clear();
+  source.Show(queue, 1, 2);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {13, 11, 13, 11}));
+}
+
+TEST(PrefetchQueue, ForgetRequeuesEvictedPages) {
+  PrefetchQueue queue(1);
+  MockPageSource source;
+  source.Show(queue, 1, 2);
+  source.Prefetch(queue);
+  source.Show(queue, 1, 3);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {13, 11, 14}));
+
+  source.Evict(queue, 12);
+  source.Evict(queue, 14);
+  // Nothing is queued until the current page changes...
+  EXPECT_TRUE(queue.IsEmpty());
+  // ... then evicted neighbors are rendered again, but not ones that are
+  // still cached
+  source.Show(queue, 1, 4);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {13, 11, 14, 15}));
+  source.Show(queue, 1, 3);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {13, 11, 14, 15, 12}));
+}
+
+TEST(PrefetchQueue, ForgetKeepsCurrentPage) {
+  PrefetchQueue queue(1);
+  MockPageSource source;
+  source.Show(queue, 1, 2);
+  source.Prefetch(queue);
+
+  // The current page is being shown, so it'll be cached anyway
+  source.Evict(queue, 12);
+  source.Show(queue, 1, 1);
+  source.Prefetch(queue);
+  EXPECT_EQ(source.mRendered, (Pages {13, 11, 10}));
+}
+
+TEST(PrefetchQueue, AlternatesBetweenOwners) {
+  PrefetchQueue queue(1);
+  MockPageSource source;
+  source.Show(queue, 1, 1);
+  source.Show(queue, 2, 4);
+
+  std::vector<PrefetchQueue::OwnerID> owners;
+  while (const auto request = queue.Pop()) {
+    owners.push_back(request->mOwner);
+  }
+  EXPECT_EQ(owners, (std::vector<PrefetchQueue::OwnerID> {1, 2, 1, 2}));
+
+  source.Show(queue, 2, 0);
+  queue.Remove(2);
+  EXPECT_TRUE(queue.IsEmpty());
+}
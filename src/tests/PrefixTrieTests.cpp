@@ -0,0 +1,201 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/PrefixTrie.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+using Visited = std::vector<std::pair<std::string, int>>;
+
+Visited PrefixesOf(PrefixTrie<int>& trie, std::string_view key) {
+  Visited ret;
+  trie.ForEachPrefixOf(key, [&](std::string_view prefix, int& value) {
+    ret.emplace_back(prefix, value);
+  });
+  return ret;
+}
+
+}// namespace
+
+TEST(PrefixTrie, Empty) {
+  PrefixTrie<int> trie;
+  EXPECT_EQ(trie.GetSize(), 0);
+  EXPECT_EQ(trie.Find(""), nullptr);
+  EXPECT_EQ(trie.Find("foo"), nullptr);
+  EXPECT_TRUE(PrefixesOf(trie, "foo").empty());
+  EXPECT_FALSE(trie.Erase("foo"));
+}
+
+TEST(PrefixTrie, GetOrCreate) {
+  PrefixTrie<int> trie;
+  auto& value = trie.GetOrCreate("dcs/Aircraft");
+  EXPECT_EQ(value, 0);
+  value = 42;
+  EXPECT_EQ(trie.GetSize(), 1);
+
+  EXPECT_EQ(&trie.GetOrCreate("dcs/Aircraft"), &value);
+  EXPECT_EQ(trie.GetSize(), 1);
+  EXPECT_EQ(trie.GetOrCreate("dcs/Aircraft"), 42);
+}
+
+TEST(PrefixTrie, FindIsExact) {
+  PrefixTrie<int> trie;
+  trie.GetOrCreate("dcs/Aircraft") = 1;
+
+  ASSERT_NE(trie.Find("dcs/Aircraft"), nullptr);
+  EXPECT_EQ(*trie.Find("dcs/Aircraft"), 1);
+  // Nodes on the way to a value aren't values themselves
+  EXPECT_EQ(trie.Find("dcs/"), nullptr);
+  EXPECT_EQ(trie.Find(""), nullptr);
+  EXPECT_EQ(trie.Find("dcs/AircraftX"), nullptr);
+}
+
+TEST(PrefixTrie, EmptyKey) {
+  PrefixTrie<int> trie;
+  trie.GetOrCreate("") = 1;
+  EXPECT_EQ(trie.GetSize(), 1);
+  ASSERT_NE(trie.Find(""), nullptr);
+  EXPECT_EQ(PrefixesOf(trie, ""), (Visited {{"", 1}}));
+  EXPECT_EQ(PrefixesOf(trie, "anything"), (Visited {{"", 1}}));
+}
+
+TEST(PrefixTrie, ForEachPrefixOf) {
+  PrefixTrie<int> trie;
+  trie.GetOrCreate("dcs/Aircraft") = 3;
+  trie.GetOrCreate("") = 1;
+  trie.GetOrCreate("dcs/") = 2;
+  trie.GetOrCreate("dcs/Terrain") = 4;
+  trie.GetOrCreate("dcs/AircraftType") = 5;
+
+  // Shortest first, and including the key itself
+  EXPECT_EQ(
+    PrefixesOf(trie, "dcs/Aircraft"),
+    (Visited {{"", 1}, {"dcs/", 2}, {"dcs/Aircraft", 3}}));
+  EXPECT_EQ(
+    PrefixesOf(trie, "dcs/AircraftType"),
+    (Visited {
+      {"", 1},
+      {"dcs/", 2},
+      {"dcs/Aircraft", 3},
+      {"dcs/AircraftType", 5},
+    }));
+  // Siblings and longer keys aren't prefixes
+  EXPECT_EQ(
+    PrefixesOf(trie, "dcs/Terrain"),
+    (Visited {{"", 1}, {"dcs/", 2}, {"dcs/Terrain", 4}}));
+  EXPECT_EQ(PrefixesOf(trie, "dcs/Air"), (Visited {{"", 1}, {"dcs/", 2}}));
+  EXPECT_EQ(PrefixesOf(trie, "dc"), (Visited {{"", 1}}));
+  EXPECT_EQ(PrefixesOf(trie, "SetTabByID"), (Visited {{"", 1}}));
+}
+
+TEST(PrefixTrie, ValuesAreMutableThroughVisitor) {
+  PrefixTrie<int> trie;
+  trie.GetOrCreate("a");
+  trie.GetOrCreate("ab");
+  trie.ForEachPrefixOf("abc", [](std::string_view, int& value) { ++value; });
+  EXPECT_EQ(*trie.Find("a"), 1);
+  EXPECT_EQ(*trie.Find("ab"), 1);
+}
+
+TEST(PrefixTrie, Erase) {
+  PrefixTrie<int> trie;
+  trie.GetOrCreate("dcs/") = 1;
+  trie.GetOrCreate("dcs/Aircraft") = 2;
+  trie.GetOrCreate("dcs/Terrain") = 3;
+
+  // Not values
+  EXPECT_FALSE(trie.Erase("dcs"));
+  EXPECT_FALSE(trie.Erase("dcs/Air"));
+  EXPECT_FALSE(trie.Erase("dcs/AircraftX"));
+  EXPECT_EQ(trie.GetSize(), 3);
+
+  EXPECT_TRUE(trie.Erase("dcs/Aircraft"));
+  EXPECT_FALSE(trie.Erase("dcs/Aircraft"));
+  EXPECT_EQ(trie.GetSize(), 2);
+  EXPECT_EQ(trie.Find("dcs/Aircraft"), nullptr);
+  EXPECT_EQ(PrefixesOf(trie, "dcs/Aircraft"), (Visited {{"dcs/", 1}}));
+
+  // Erasing a prefix leaves longer keys alone
+  EXPECT_TRUE(trie.Erase("dcs/"));
+  EXPECT_EQ(trie.GetSize(), 1);
+  EXPECT_EQ(PrefixesOf(trie, "dcs/Terrain"), (Visited {{"dcs/Terrain", 3}}));
+
+  // ... and re-creating gives a fresh value
+  EXPECT_EQ(trie.GetOrCreate("dcs/Aircraft"), 0);
+}
+
+// Compare against brute force, with keys from a small alphabet so that
+// there are lots of shared prefixes
+TEST(PrefixTrie, MatchesBruteForce) {
+  std::mt19937 random(1234);
+  const auto randomKey = [&]() {
+    std::uniform_int_distribution<size_t> length(0, 6);
+    std::uniform_int_distribution<int> letter('a', 'c');
+    std::string ret(length(random), '\0');
+    for (auto& c: ret) {
+      c = static_cast<char>(letter(random));
+    }
+    return ret;
+  };
+
+  PrefixTrie<int> trie;
+  std::map<std::string, int> expected;
+  std::uniform_int_distribution<int> action(0, 3);
+  for (int i = 0; i < 5000; ++i) {
+    const auto key = randomKey();
+    switch (action(random)) {
+      case 0:
+        EXPECT_EQ(trie.Erase(key), expected.erase(key) == 1);
+        break;
+      case 1: {
+        const auto it = expected.find(key);
+        const auto found = trie.Find(key);
+        ASSERT_EQ(found != nullptr, it != expected.end()) << key;
+        if (found) {
+          EXPECT_EQ(*found, it->second);
+        }
+        break;
+      }
+      default:
+        trie.GetOrCreate(key) = i;
+        expected[key] = i;
+        break;
+    }
+    ASSERT_EQ(trie.GetSize(), expected.size());
+
+    const auto probe = randomKey();
+    Visited expectedPrefixes;
+    for (size_t length = 0; length <= probe.size(); ++length) {
+      const auto prefix = probe.substr(0, length);
+      if (const auto it = expected.find(prefix); it != expected.end()) {
+        expectedPrefixes.emplace_back(prefix, it->second);
+      }
+    }
+    ASSERT_EQ(PrefixesOf(trie, probe), expectedPrefixes) << probe;
+  }
+}
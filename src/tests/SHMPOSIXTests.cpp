@@ -0,0 +1,306 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/SHMPOSIX.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <mutex>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+using namespace OpenKneeboard;
+using namespace OpenKneeboard::SHM;
+
+namespace {
+
+class SHMPOSIX : public ::testing::Test {
+ protected:
+  const std::string mName {std::format(
+    "/OpenKneeboard-Test-{}-{}",
+    getpid(),
+    ::testing::UnitTest::GetInstance()->current_test_info()->name())};
+
+  ~SHMPOSIX() override {
+    POSIX::Unlink(mName);
+  }
+};
+
+LayerConfig CreateLayer(uint64_t layerID, uint16_t width, uint16_t height) {
+  return {
+    .mLayerID = layerID,
+    .mImageWidth = width,
+    .mImageHeight = height,
+  };
+}
+
+void Fill(
+  POSIX::Writer& writer,
+  uint8_t layerIndex,
+  const LayerConfig& layer,
+  POSIX::Pixel value) {
+  const auto pixels = writer.GetNextPixels(layerIndex);
+  for (uint16_t y = 0; y < layer.mImageHeight; ++y) {
+    std::fill_n(
+      pixels.begin() + (y * TextureWidth), layer.mImageWidth, value + y);
+  }
+}
+
+}// namespace
+
+TEST_F(SHMPOSIX, NoFeeder) {
+  POSIX::Writer writer(mName);
+  POSIX::Reader reader(mName);
+  POSIX::Frame frame;
+  EXPECT_FALSE(reader.TryCopyLatest(&frame));
+}
+
+TEST_F(SHMPOSIX, RoundTrip) {
+  POSIX::Writer writer(mName);
+  POSIX::Reader reader(mName);
+
+  const LayerConfig layers[] {
+    CreateLayer(1, 64, 32),
+    CreateLayer(2, 16, 128),
+  };
+  {
+    std::unique_lock lock(writer);
+    Fill(writer, 0, layers[0], 0x10000);
+    Fill(writer, 1, layers[1], 0x20000);
+    writer.Update({}, layers);
+  }
+  EXPECT_EQ(reader.GetSequenceNumber(), 1);
+
+  POSIX::Frame frame;
+  ASSERT_TRUE(reader.TryCopyLatest(&frame));
+  EXPECT_EQ(frame.mHeader.mSessionID, writer.GetSessionID());
+  EXPECT_EQ(frame.mHeader.mSequenceNumber, 1);
+  ASSERT_EQ(frame.mHeader.mLayerCount, 2);
+  EXPECT_EQ(frame.mHeader.mFeederProcessID, getpid());
+
+  for (uint8_t i = 0; i < 2; ++i) {
+    const auto& layer = layers[i];
+    const auto& pixels = frame.mLayers[i];
+    ASSERT_EQ(pixels.size(), layer.mImageWidth * layer.mImageHeight);
+    const POSIX::Pixel base = 0x10000 * (i + 1);
+    for (uint16_t y = 0; y < layer.mImageHeight; ++y) {
+      const auto row = pixels.begin() + (y * layer.mImageWidth);
+      EXPECT_TRUE(std::all_of(row, row + layer.mImageWidth, [=](auto pixel) {
+        return pixel == base + y;
+      })) << "layer " << int {i} << ", row " << y;
+    }
+  }
+}
+
+TEST_F(SHMPOSIX, SlotsRotate) {
+  POSIX::Writer writer(mName);
+  POSIX::Reader reader(mName);
+  const auto layer = CreateLayer(1, 8, 8);
+
+  for (POSIX::Pixel i = 1; i <= TextureCount * 2; ++i) {
+    {
+      std::unique_lock lock(writer);
+      Fill(writer, 0, layer, i << 8);
+      writer.Update({}, {&layer, 1});
+    }
+    POSIX::Frame frame;
+    ASSERT_TRUE(reader.TryCopyLatest(&frame));
+    EXPECT_EQ(frame.mLayers[0].front(), i << 8);
+    EXPECT_EQ(frame.mLayers[0].back(), (i << 8) + 7);
+  }
+}
+
+TEST_F(SHMPOSIX, Detach) {
+  POSIX::Writer writer(mName);
+  POSIX::Reader reader(mName);
+  const auto layer = CreateLayer(1, 8, 8);
+  {
+    std::unique_lock lock(writer);
+    writer.Update({}, {&layer, 1});
+  }
+  POSIX::Frame frame;
+  EXPECT_TRUE(reader.TryCopyLatest(&frame));
+
+  {
+    std::unique_lock lock(writer);
+    writer.Detach();
+  }
+  EXPECT_FALSE(reader.TryCopyLatest(&frame));
+}
+
+TEST_F(SHMPOSIX, NewWriterResetsSession) {
+  const auto layer = CreateLayer(1, 8, 8);
+  POSIX::Reader reader(mName);
+  uint64_t firstSession {};
+  {
+    POSIX::Writer writer(mName);
+    firstSession = writer.GetSessionID();
+    std::unique_lock lock(writer);
+    writer.Update({}, {&layer, 1});
+  }
+
+  POSIX::Writer writer(mName);
+  EXPECT_NE(writer.GetSessionID(), firstSession);
+  POSIX::Frame frame;
+  EXPECT_FALSE(reader.TryCopyLatest(&frame));
+}
+
+TEST_F(SHMPOSIX, WritersAreSerialized) {
+  POSIX::Writer a(mName);
+  POSIX::Writer b(mName);
+
+  std::unique_lock lock(a);
+  EXPECT_FALSE(b.try_lock());
+  lock.unlock();
+  EXPECT_TRUE(b.try_lock());
+  b.unlock();
+}
+
+TEST_F(SHMPOSIX, ConcurrentCopiesAreConsistent) {
+  POSIX::Writer writer(mName);
+  const auto layer = CreateLayer(1, 256, 256);
+  constexpr uint32_t Frames = 2000;
+
+  std::jthread feeder([&]() {
+    for (POSIX::Pixel i = 1; i <= Frames; ++i) {
+      std::unique_lock lock(writer);
+      // Every pixel in a frame has the same value; a reader that sees a mix
+      // has copied a slot while it was being rewritten
+      std::ranges::fill(
+        writer.GetNextPixels(0).first(layer.mImageHeight * TextureWidth), i);
+      writer.Update({}, {&layer, 1});
+    }
+  });
+
+  POSIX::Reader reader(mName);
+  POSIX::Frame frame;
+  uint32_t copied = 0;
+  while (reader.GetSequenceNumber() < Frames) {
+    if (!reader.TryCopyLatest(&frame)) {
+      continue;
+    }
+    ++copied;
+    const auto& pixels = frame.mLayers[0];
+    ASSERT_EQ(pixels.size(), 256 * 256);
+    ASSERT_TRUE(std::ranges::all_of(
+      pixels, [first = pixels.front()](auto it) { return it == first; }));
+  }
+  EXPECT_GT(copied, 0);
+}
+
+TEST_F(SHMPOSIX, WaitForNewFrameTimesOut) {
+  POSIX::Writer writer(mName);
+  POSIX::Reader reader(mName);
+
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(reader.WaitForNewFrame(
+    ConsumerKind::Test,
+    reader.GetSequenceNumber(),
+    std::chrono::milliseconds(50)));
+  EXPECT_GE(
+    std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+}
+
+TEST_F(SHMPOSIX, WaitForNewFrameSeesEarlierFrames) {
+  POSIX::Writer writer(mName);
+  POSIX::Reader reader(mName);
+  const auto layer = CreateLayer(1, 8, 8);
+  {
+    std::unique_lock lock(writer);
+    writer.Update({}, {&layer, 1});
+  }
+  // Published before we registered, so there was nobody to signal
+  EXPECT_TRUE(reader.WaitForNewFrame(
+    ConsumerKind::Test, 0, std::chrono::milliseconds::zero()));
+}
+
+TEST_F(SHMPOSIX, WaitForNewFrameWakesOnUpdate) {
+  POSIX::Writer writer(mName);
+  POSIX::Reader reader(mName);
+  const auto layer = CreateLayer(1, 8, 8);
+
+  // Register, so that the writer knows to signal us
+  reader.WaitForNewFrame(
+    ConsumerKind::Test, 0, std::chrono::milliseconds::zero());
+
+  std::chrono::steady_clock::time_point publishedAt {};
+  std::jthread feeder([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::unique_lock lock(writer);
+    publishedAt = std::chrono::steady_clock::now();
+    writer.Update({}, {&layer, 1});
+  });
+
+  ASSERT_TRUE(
+    reader.WaitForNewFrame(ConsumerKind::Test, 0, std::chrono::seconds(5)));
+  const auto wokeAt = std::chrono::steady_clock::now();
+  feeder.join();
+  const auto latency = wokeAt - publishedAt;
+  // Very generous, for busy CI machines; a lost wake-up would be the full
+  // timeout
+  EXPECT_LT(latency, std::chrono::seconds(1));
+  RecordProperty(
+    "WakeLatencyUS",
+    std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+}
+
+// Each frame is only published after the reader saw the previous one, so
+// every frame needs a wake-up; a lost one shows up as a timeout
+TEST_F(SHMPOSIX, NoLostWakeups) {
+  POSIX::Writer writer(mName);
+  POSIX::Reader reader(mName);
+  const auto layer = CreateLayer(1, 8, 8);
+  constexpr uint32_t Frames = 2000;
+
+  std::atomic_uint32_t seen {};
+  std::jthread feeder([&](std::stop_token stop) {
+    for (uint32_t i = 1; i <= Frames && !stop.stop_requested(); ++i) {
+      {
+        std::unique_lock lock(writer);
+        writer.Update({}, {&layer, 1});
+      }
+      while (seen.load() < i && !stop.stop_requested()) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  constexpr std::chrono::seconds Timeout {2};
+  uint32_t sequenceNumber = 0;
+  std::chrono::steady_clock::duration maxWait {};
+  while (sequenceNumber < Frames) {
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(
+      reader.WaitForNewFrame(ConsumerKind::Test, sequenceNumber, Timeout))
+      << "after frame " << sequenceNumber;
+    const auto waited = std::chrono::steady_clock::now() - start;
+    // If we were never woken, we'd still see the frame after the timeout
+    ASSERT_LT(waited, Timeout) << "after frame " << sequenceNumber;
+    maxWait = std::max(maxWait, waited);
+    sequenceNumber = reader.GetSequenceNumber();
+    seen.store(sequenceNumber);
+  }
+  RecordProperty(
+    "MaxWaitUS",
+    std::chrono::duration_cast<std::chrono::microseconds>(maxWait).count());
+}
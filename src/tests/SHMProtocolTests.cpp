@@ -0,0 +1,392 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/SHMProtocol.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+using namespace OpenKneeboard::SHM;
+
+namespace {
+
+constexpr uint32_t FeederProcessID = 123;
+constexpr uint32_t ConsumerProcessID = 456;
+
+auto CreateSegment() {
+  auto segment = std::make_unique<Segment>();
+  ResetHeader(segment.get(), CreateSessionID(FeederProcessID));
+  return segment;
+}
+
+LayerConfig CreateLayer(uint64_t layerID) {
+  return {
+    .mLayerID = layerID,
+    .mImageWidth = 1024,
+    .mImageHeight = 768,
+  };
+}
+
+Header ReadHeader(const Segment& segment) {
+  Header header;
+  EXPECT_TRUE(TryReadHeader(segment, &header));
+  return header;
+}
+
+}// namespace
+
+TEST(SHMProtocol, ResetHeaderHasNoFeeder) {
+  const auto segment = CreateSegment();
+  const auto header = ReadHeader(*segment);
+  EXPECT_FALSE(header.HaveFeeder());
+  EXPECT_EQ(header.mSequenceNumber, 0);
+  EXPECT_EQ(header.mLayerCount, 0);
+  EXPECT_EQ(header.mSessionID >> 32, FeederProcessID);
+}
+
+TEST(SHMProtocol, PublishHeader) {
+  const auto segment = CreateSegment();
+  const LayerConfig layers[] {CreateLayer(1), CreateLayer(2)};
+  PublishHeader(segment.get(), {}, layers, FeederProcessID, 42);
+
+  const auto header = ReadHeader(*segment);
+  EXPECT_TRUE(header.HaveFeeder());
+  EXPECT_EQ(header.mSequenceNumber, 1);
+  EXPECT_EQ(GetSequenceNumber(*segment), 1);
+  EXPECT_EQ(header.mLayerCount, 2);
+  EXPECT_EQ(header.mLayers[0].mLayerID, 1);
+  EXPECT_EQ(header.mLayers[1].mLayerID, 2);
+  EXPECT_EQ(header.mFeederProcessID, FeederProcessID);
+  EXPECT_EQ(header.mFence, 42);
+}
+
+TEST(SHMProtocol, PublishHeaderRejectsInvalidLayers) {
+  const auto segment = CreateSegment();
+
+  std::vector<LayerConfig> tooMany(MaxLayers + 1, CreateLayer(1));
+  EXPECT_THROW(
+    PublishHeader(segment.get(), {}, tooMany, FeederProcessID, 0),
+    std::logic_error);
+
+  auto empty = CreateLayer(1);
+  empty.mImageWidth = 0;
+  EXPECT_THROW(
+    PublishHeader(segment.get(), {}, {&empty, 1}, FeederProcessID, 0),
+    std::logic_error);
+
+  EXPECT_EQ(GetSequenceNumber(*segment), 0);
+}
+
+TEST(SHMProtocol, DetachFeeder) {
+  const auto segment = CreateSegment();
+  const auto layer = CreateLayer(1);
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  DetachFeeder(segment.get());
+
+  const auto header = ReadHeader(*segment);
+  EXPECT_FALSE(header.HaveFeeder());
+  // Readers can still tell what they last saw
+  EXPECT_EQ(header.mSequenceNumber, 1);
+}
+
+TEST(SHMProtocol, LayerGenerations) {
+  const auto segment = CreateSegment();
+  auto layer = CreateLayer(1);
+
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  const auto first = ReadHeader(*segment);
+  EXPECT_TRUE(first.mLayers[0].mDamage.IsFull());
+
+  layer.mIsDirty = false;
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  const auto clean = ReadHeader(*segment);
+  EXPECT_EQ(clean.mLayers[0].mGeneration, first.mLayers[0].mGeneration);
+  EXPECT_TRUE(clean.mLayers[0].mDamage.IsEmpty());
+  EXPECT_TRUE(GetLayerDamage(first, clean, 0).IsEmpty());
+
+  layer.mIsDirty = true;
+  layer.mDamage = {};
+  layer.mDamage.Add(DamageRect {10, 10, 20, 20});
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  const auto dirty = ReadHeader(*segment);
+  EXPECT_EQ(dirty.mLayers[0].mGeneration, clean.mLayers[0].mGeneration + 1);
+  const auto damage = GetLayerDamage(clean, dirty, 0);
+  ASSERT_EQ(damage.GetRects().size(), 1);
+  EXPECT_EQ(damage.GetRects()[0], (DamageRect {10, 10, 20, 20}));
+
+  // Clean publications don't start a new generation...
+  EXPECT_EQ(GetLayerDamage(first, dirty, 0), damage);
+
+  // ... but readers that missed a dirty one need to copy everything
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  EXPECT_TRUE(GetLayerDamage(clean, ReadHeader(*segment), 0).IsFull());
+}
+
+TEST(SHMProtocol, ChangesForceFullRepaint) {
+  const auto segment = CreateSegment();
+  auto layer = CreateLayer(1);
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  const auto before = ReadHeader(*segment);
+
+  // A clean layer is still repainted if the config changes...
+  layer.mIsDirty = false;
+  const Config config {.mGlobalInputLayerID = 1};
+  PublishHeader(segment.get(), config, {&layer, 1}, FeederProcessID, 0);
+  const auto configChanged = ReadHeader(*segment);
+  EXPECT_EQ(
+    configChanged.mLayers[0].mGeneration, before.mLayers[0].mGeneration + 1);
+  EXPECT_TRUE(configChanged.mLayers[0].mDamage.IsFull());
+
+  // ... or if the size changes
+  layer.mImageWidth /= 2;
+  PublishHeader(segment.get(), config, {&layer, 1}, FeederProcessID, 0);
+  EXPECT_TRUE(ReadHeader(*segment).mLayers[0].mDamage.IsFull());
+}
+
+TEST(SHMProtocol, DamageIsClippedToTheImage) {
+  const auto segment = CreateSegment();
+  auto layer = CreateLayer(1);
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+
+  layer.mDamage = {};
+  layer.mDamage.Add(DamageRect {1000, 700, 2000, 2000});
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  const auto header = ReadHeader(*segment);
+  const auto rects = header.mLayers[0].mDamage.GetRects();
+  ASSERT_EQ(rects.size(), 1);
+  EXPECT_EQ(rects[0], (DamageRect {1000, 700, 1024, 768}));
+}
+
+TEST(SHMProtocol, GetLayerDamageAcrossSessions) {
+  const auto a = CreateSegment();
+  const auto b = CreateSegment();
+  const auto layer = CreateLayer(1);
+  PublishHeader(a.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  PublishHeader(b.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  EXPECT_TRUE(GetLayerDamage(ReadHeader(*a), ReadHeader(*b), 0).IsFull());
+}
+
+TEST(SHMProtocol, TextureRotation) {
+  for (uint32_t i = 0; i < TextureCount * 3; ++i) {
+    EXPECT_EQ(GetTextureIndex(i), i % TextureCount);
+  }
+}
+
+TEST(SHMProtocol, FeederOvertookReader) {
+  const auto segment = CreateSegment();
+  const auto layer = CreateLayer(1);
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  const auto acquired = GetSequenceNumber(*segment);
+
+  // Each publication uses the next texture slot; we're safe until the
+  // feeder is about to reuse ours
+  for (uint32_t i = 1; i < TextureCount - 1; ++i) {
+    PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+    EXPECT_FALSE(FeederOvertookReader(*segment, acquired)) << i;
+  }
+  PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, 0);
+  EXPECT_EQ(
+    GetTextureIndex(GetSequenceNumber(*segment) + 1),
+    GetTextureIndex(acquired));
+  EXPECT_TRUE(FeederOvertookReader(*segment, acquired));
+}
+
+TEST(SHMProtocol, ConsumerRegistry) {
+  const auto segment = CreateSegment();
+  const ConsumerClock::time_point now {std::chrono::seconds(100)};
+
+  const auto slot = ConsumerHeartbeat(
+    segment.get(),
+    MaxConsumers,
+    ConsumerKind::OpenXR,
+    ConsumerProcessID,
+    0,
+    now);
+  ASSERT_LT(slot, MaxConsumers);
+  EXPECT_EQ(
+    ConsumerHeartbeat(
+      segment.get(), slot, ConsumerKind::OpenXR, ConsumerProcessID, 0, now),
+    slot);
+  // Same kind, different process
+  EXPECT_NE(
+    ConsumerHeartbeat(
+      segment.get(), slot, ConsumerKind::OpenXR, ConsumerProcessID + 1, 0, now),
+    slot);
+
+  const auto consumers = GetConsumers(*segment, now);
+  ASSERT_EQ(consumers.size(), 2);
+  EXPECT_EQ(consumers[0].mKind, ConsumerKind::OpenXR);
+  EXPECT_EQ(consumers[0].mProcessID, ConsumerProcessID);
+
+  EXPECT_EQ(
+    GetActiveConsumers(*segment, now),
+    static_cast<std::underlying_type_t<ConsumerKind>>(ConsumerKind::OpenXR));
+
+  DetachConsumer(segment.get(), slot, ConsumerKind::OpenXR, ConsumerProcessID);
+  EXPECT_EQ(GetConsumers(*segment, now).size(), 1);
+}
+
+TEST(SHMProtocol, TestConsumersAreNotActive) {
+  const auto segment = CreateSegment();
+  const ConsumerClock::time_point now {std::chrono::seconds(100)};
+  ConsumerHeartbeat(
+    segment.get(), MaxConsumers, ConsumerKind::Test, ConsumerProcessID, 0, now);
+  EXPECT_EQ(GetConsumers(*segment, now).size(), 1);
+  EXPECT_EQ(GetActiveConsumers(*segment, now), 0);
+}
+
+TEST(SHMProtocol, ConsumersExpire) {
+  const auto segment = CreateSegment();
+  const ConsumerClock::time_point start {std::chrono::seconds(100)};
+  const auto slot = ConsumerHeartbeat(
+    segment.get(),
+    MaxConsumers,
+    ConsumerKind::SteamVR,
+    ConsumerProcessID,
+    0,
+    start);
+
+  const auto later = start + ConsumerTimeout + std::chrono::milliseconds(1);
+  EXPECT_TRUE(GetConsumers(*segment, later).empty());
+
+  // Expired slots can be reused by other consumers...
+  EXPECT_EQ(
+    ConsumerHeartbeat(
+      segment.get(),
+      MaxConsumers,
+      ConsumerKind::OculusD3D11,
+      ConsumerProcessID + 1,
+      0,
+      later),
+    slot);
+  // ... and a detach from the previous owner doesn't free it
+  DetachConsumer(segment.get(), slot, ConsumerKind::SteamVR, ConsumerProcessID);
+  EXPECT_EQ(GetConsumers(*segment, later).size(), 1);
+}
+
+TEST(SHMProtocol, ReapConsumers) {
+  const auto segment = CreateSegment();
+  const ConsumerClock::time_point start {std::chrono::seconds(100)};
+  ConsumerHeartbeat(
+    segment.get(),
+    MaxConsumers,
+    ConsumerKind::SteamVR,
+    ConsumerProcessID,
+    0,
+    start);
+  const auto later = start + ConsumerTimeout * 2;
+  ReapConsumers(segment.get(), later);
+  for (const auto& slot: segment->mConsumers) {
+    EXPECT_EQ(slot.mOwner, 0);
+  }
+}
+
+TEST(SHMProtocol, ConsumerSlotsAreLimited) {
+  const auto segment = CreateSegment();
+  const ConsumerClock::time_point now {std::chrono::seconds(100)};
+  for (uint32_t i = 0; i < MaxConsumers; ++i) {
+    EXPECT_LT(
+      ConsumerHeartbeat(
+        segment.get(), MaxConsumers, ConsumerKind::Test, i + 1, 0, now),
+      MaxConsumers);
+  }
+  EXPECT_EQ(
+    ConsumerHeartbeat(
+      segment.get(), MaxConsumers, ConsumerKind::Test, 1000, 0, now),
+    MaxConsumers);
+}
+
+TEST(SHMProtocol, FrameEventsResetWithNewOwner) {
+  const auto segment = CreateSegment();
+  const ConsumerClock::time_point start {std::chrono::seconds(100)};
+  const auto slot = ConsumerHeartbeat(
+    segment.get(),
+    MaxConsumers,
+    ConsumerKind::SteamVR,
+    ConsumerProcessID,
+    0,
+    start);
+  RequestFrameEvents(segment.get(), slot);
+  EXPECT_TRUE(GetFrameEventConsumers(*segment, start).test(slot));
+
+  const auto later = start + ConsumerTimeout * 2;
+  EXPECT_FALSE(GetFrameEventConsumers(*segment, later).test(slot));
+  ASSERT_EQ(
+    ConsumerHeartbeat(
+      segment.get(),
+      MaxConsumers,
+      ConsumerKind::OpenXR,
+      ConsumerProcessID + 1,
+      0,
+      later),
+    slot);
+  EXPECT_FALSE(GetFrameEventConsumers(*segment, later).test(slot));
+}
+
+// The header is published under a sequence lock; readers must never see a
+// mix of two publications
+TEST(SHMProtocol, ConcurrentReadsAreConsistent) {
+  const auto segment = CreateSegment();
+  constexpr uint32_t Publications = 100000;
+  std::atomic_bool done {false};
+
+  std::thread writer([&]() {
+    for (uint32_t i = 1; i <= Publications; ++i) {
+      const auto layer = CreateLayer(i);
+      PublishHeader(segment.get(), {}, {&layer, 1}, FeederProcessID, i);
+    }
+    done = true;
+  });
+
+  std::vector<std::thread> readers;
+  std::atomic_uint64_t inconsistent {0};
+  std::atomic_uint64_t reads {0};
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      while (!done) {
+        Header header;
+        if (!TryReadHeader(*segment, &header)) {
+          continue;
+        }
+        ++reads;
+        if (header.mLayerCount == 0) {
+          continue;
+        }
+        if (
+          header.mLayers[0].mLayerID != header.mSequenceNumber
+          || header.mFence != header.mSequenceNumber) {
+          ++inconsistent;
+        }
+      }
+    });
+  }
+
+  writer.join();
+  for (auto& reader: readers) {
+    reader.join();
+  }
+  EXPECT_EQ(inconsistent, 0);
+  EXPECT_EQ(GetSequenceNumber(*segment), Publications);
+}
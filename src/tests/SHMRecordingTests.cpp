@@ -0,0 +1,206 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/SHMRecording.h>
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard;
+using namespace OpenKneeboard::SHM;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::string Record(const std::vector<RecordedFrame>& frames) {
+  std::ostringstream out(std::ios::binary);
+  RecordingWriter writer(out);
+  for (const auto& frame: frames) {
+    writer.Write(frame);
+  }
+  return out.str();
+}
+
+Config CreateConfig(uint64_t inputLayerID) {
+  return {.mGlobalInputLayerID = inputLayerID};
+}
+
+LayerConfig CreateLayer(uint64_t layerID, uint32_t generation) {
+  LayerConfig ret {
+    .mLayerID = layerID,
+    .mImageWidth = 256,
+    .mImageHeight = 128,
+    .mGeneration = generation,
+  };
+  ret.mDamage = {};
+  ret.mDamage.Add(DamageRect {1, 2, 3, 4});
+  return ret;
+}
+
+void ExpectSameLayers(
+  const std::vector<LayerConfig>& actual,
+  const std::vector<LayerConfig>& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i].mLayerID, expected[i].mLayerID);
+    EXPECT_EQ(actual[i].mImageWidth, expected[i].mImageWidth);
+    EXPECT_EQ(actual[i].mImageHeight, expected[i].mImageHeight);
+    EXPECT_EQ(actual[i].mIsDirty, expected[i].mIsDirty);
+    EXPECT_EQ(actual[i].mGeneration, expected[i].mGeneration);
+    EXPECT_EQ(actual[i].mDamage, expected[i].mDamage);
+  }
+}
+
+// Offsets of the layout checks in the file header
+constexpr size_t VersionOffset = 8;
+constexpr size_t ConfigSizeOffset = 12;
+constexpr size_t LayerConfigSizeOffset = 16;
+constexpr size_t MaxLayersOffset = 20;
+
+void Poke(std::string* bytes, size_t offset, uint32_t value) {
+  std::memcpy(bytes->data() + offset, &value, sizeof(value));
+}
+
+}// namespace
+
+TEST(SHMRecording, RoundTrip) {
+  const std::vector<RecordedFrame> frames {
+    {
+      .mTime = 0ms,
+      .mSessionID = 123,
+      .mSequenceNumber = 1,
+      .mActiveConsumers = 4,
+      .mConfig = CreateConfig(1),
+      .mLayers = {CreateLayer(1, 1)},
+    },
+    {
+      .mTime = 11ms,
+      .mSessionID = 123,
+      .mSequenceNumber = 2,
+      .mConfig = CreateConfig(1),
+      .mLayers = {CreateLayer(1, 2), CreateLayer(2, 1)},
+      .mPixelHashes = {0xabcd, 0x1234},
+    },
+    {
+      .mTime = 22ms,
+      .mSessionID = 456,
+      .mSequenceNumber = 1,
+      .mConfig = CreateConfig(2),
+    },
+  };
+  std::istringstream in(Record(frames), std::ios::binary);
+  RecordingReader reader(in);
+
+  for (const auto& expected: frames) {
+    const auto frame = reader.Next();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(frame->mTime, expected.mTime);
+    EXPECT_EQ(frame->mSessionID, expected.mSessionID);
+    EXPECT_EQ(frame->mSequenceNumber, expected.mSequenceNumber);
+    EXPECT_EQ(frame->mActiveConsumers, expected.mActiveConsumers);
+    EXPECT_EQ(frame->mConfig, expected.mConfig);
+    ExpectSameLayers(frame->mLayers, expected.mLayers);
+    EXPECT_EQ(frame->mPixelHashes, expected.mPixelHashes);
+  }
+  EXPECT_FALSE(reader.Next().has_value());
+}
+
+TEST(SHMRecording, ConfigIsOnlyWrittenWhenChanged) {
+  const RecordedFrame a {.mConfig = CreateConfig(1)};
+  const RecordedFrame b {.mConfig = CreateConfig(2)};
+
+  const auto unchanged = Record({a, a});
+  const auto changed = Record({a, b});
+  EXPECT_EQ(changed.size() - unchanged.size(), sizeof(Config));
+
+  // Frames without a stored config still get the previous one
+  std::istringstream in(Record({a, a, b, b}), std::ios::binary);
+  RecordingReader reader(in);
+  for (const auto& expected: {a, a, b, b}) {
+    const auto frame = reader.Next();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(frame->mConfig, expected.mConfig);
+  }
+}
+
+TEST(SHMRecording, RejectsMismatchedPixelHashes) {
+  std::ostringstream out(std::ios::binary);
+  RecordingWriter writer(out);
+  EXPECT_THROW(
+    writer.Write({
+      .mLayers = {CreateLayer(1, 1), CreateLayer(2, 1)},
+      .mPixelHashes = {1},
+    }),
+    std::logic_error);
+}
+
+TEST(SHMRecording, RejectsOtherFiles) {
+  std::istringstream empty(std::string {}, std::ios::binary);
+  EXPECT_THROW(RecordingReader {empty}, std::runtime_error);
+
+  auto bytes = Record({});
+  bytes[0] = 'X';
+  std::istringstream badMagic(bytes, std::ios::binary);
+  EXPECT_THROW(RecordingReader {badMagic}, std::runtime_error);
+}
+
+TEST(SHMRecording, RejectsOtherVersionsAndLayouts) {
+  for (const auto offset:
+       {VersionOffset,
+        ConfigSizeOffset,
+        LayerConfigSizeOffset,
+        MaxLayersOffset}) {
+    auto bytes = Record({});
+    uint32_t value {};
+    std::memcpy(&value, bytes.data() + offset, sizeof(value));
+    Poke(&bytes, offset, value + 1);
+
+    std::istringstream in(bytes, std::ios::binary);
+    EXPECT_THROW(RecordingReader {in}, std::runtime_error)
+      << "offset " << offset;
+  }
+}
+
+TEST(SHMRecording, ThrowsOnTruncation) {
+  const auto header = Record({});
+  const auto full = Record({{
+    .mConfig = CreateConfig(1),
+    .mLayers = {CreateLayer(1, 1)},
+    .mPixelHashes = {1},
+  }});
+
+  for (auto size = header.size() + 1; size < full.size(); ++size) {
+    std::istringstream in(full.substr(0, size), std::ios::binary);
+    RecordingReader reader(in);
+    EXPECT_THROW(reader.Next(), std::runtime_error) << "size " << size;
+  }
+}
+
+TEST(SHMReplayScheduler, ScalesTime) {
+  const ReplayScheduler::Clock::time_point start {};
+  const RecordedFrame frame {.mTime = 100ms};
+
+  EXPECT_EQ(ReplayScheduler(start, 1).GetDueTime(frame), start + 100ms);
+  EXPECT_EQ(ReplayScheduler(start, 2).GetDueTime(frame), start + 50ms);
+  EXPECT_EQ(ReplayScheduler(start, 0).GetDueTime(frame), start);
+  EXPECT_THROW(ReplayScheduler(start, -1), std::logic_error);
+}
@@ -0,0 +1,172 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+#include <OpenKneeboard/TelemetryProtocol.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace OpenKneeboard::Telemetry;
+
+namespace {
+
+std::unique_ptr<Segment> CreateSegment() {
+  auto segment = std::make_unique<Segment>();
+  InitializeSegment(segment.get());
+  return segment;
+}
+
+OwnshipRecord MakeRecord(double value) {
+  return {
+    .mSimulationTime = value,
+    .mLatitude = value,
+    .mLongitude = value,
+    .mAltitude = value,
+    .mHeading = value,
+    .mGroundSpeed = value,
+  };
+}
+
+}// namespace
+
+TEST(TelemetryProtocol, NothingPublished) {
+  const auto segment = CreateSegment();
+  EXPECT_TRUE(IsCompatible(*segment));
+  Sample sample;
+  EXPECT_FALSE(TryReadLatest(*segment, &sample));
+}
+
+TEST(TelemetryProtocol, UninitializedIsIncompatible) {
+  Segment segment;
+  EXPECT_FALSE(IsCompatible(segment));
+
+  InitializeSegment(&segment);
+  segment.mVersion = ProtocolVersion + 1;
+  EXPECT_FALSE(IsCompatible(segment));
+}
+
+TEST(TelemetryProtocol, ReadsLatest) {
+  const auto segment = CreateSegment();
+  const Clock::time_point now {std::chrono::seconds(123)};
+
+  for (int i = 1; i <= RingSize * 3; ++i) {
+    ASSERT_TRUE(Publish(segment.get(), MakeRecord(i), now));
+    Sample sample;
+    ASSERT_TRUE(TryReadLatest(*segment, &sample));
+    EXPECT_EQ(sample.mSequenceNumber, i);
+    EXPECT_EQ(sample.mPublishedAt, now);
+    EXPECT_EQ(sample.mOwnship, MakeRecord(i));
+  }
+}
+
+TEST(TelemetryProtocol, SkipsSlotsBeingWritten) {
+  const auto segment = CreateSegment();
+  ASSERT_TRUE(Publish(segment.get(), MakeRecord(1), {}));
+
+  // A stalled producer holding the next slot
+  segment->mSlots[2 % RingSize].mSeqLock.BeginWrite();
+  ASSERT_TRUE(Publish(segment.get(), MakeRecord(2), {}));
+
+  Sample sample;
+  ASSERT_TRUE(TryReadLatest(*segment, &sample));
+  EXPECT_EQ(sample.mSequenceNumber, 3);
+  EXPECT_EQ(sample.mOwnship, MakeRecord(2));
+}
+
+TEST(TelemetryProtocol, DropsInsteadOfSpinningIfAllSlotsAreLocked) {
+  const auto segment = CreateSegment();
+  ASSERT_TRUE(Publish(segment.get(), MakeRecord(1), {}));
+
+  // e.g. producers that crashed mid-write
+  for (auto& slot: segment->mSlots) {
+    slot.mSeqLock.BeginWrite();
+  }
+  EXPECT_FALSE(Publish(segment.get(), MakeRecord(2), {}));
+  EXPECT_FALSE(Publish(segment.get(), MakeRecord(3), {}));
+
+  segment->mSlots[0].mSeqLock.EndWrite();
+  // Walk until we reach the unlocked slot
+  bool published = false;
+  for (int i = 0; i < RingSize && !published; ++i) {
+    published = Publish(segment.get(), MakeRecord(4), {});
+  }
+  EXPECT_TRUE(published);
+  Sample sample;
+  ASSERT_TRUE(TryReadLatest(*segment, &sample));
+  EXPECT_EQ(sample.mOwnship, MakeRecord(4));
+}
+
+// Every field of every record has the same value, so a torn read shows up
+// as a record with mixed values
+TEST(TelemetryProtocol, ConcurrentProducersAndReaders) {
+  const auto segment = CreateSegment();
+  constexpr int ProducerCount = 3;
+  constexpr int ReaderCount = 3;
+  constexpr int RecordsPerProducer = 100000;
+
+  std::atomic_bool producing {true};
+  std::atomic_uint64_t tornReads {};
+  std::atomic_uint64_t dropped {};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < ReaderCount; ++i) {
+    readers.emplace_back([&]() {
+      while (producing) {
+        Sample sample;
+        if (!TryReadLatest(*segment, &sample)) {
+          continue;
+        }
+        const auto value = sample.mOwnship.mSimulationTime;
+        if (sample.mOwnship != MakeRecord(value)) {
+          ++tornReads;
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < ProducerCount; ++i) {
+    producers.emplace_back([&, i]() {
+      for (int j = 0; j < RecordsPerProducer; ++j) {
+        const auto value = (i * RecordsPerProducer) + j;
+        if (!Publish(segment.get(), MakeRecord(value), {})) {
+          ++dropped;
+        }
+      }
+    });
+  }
+  for (auto& producer: producers) {
+    producer.join();
+  }
+  producing = false;
+  for (auto& reader: readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(tornReads, 0);
+  // Producers never crash here, so they should never find every slot locked
+  EXPECT_EQ(dropped, 0);
+  Sample sample;
+  ASSERT_TRUE(TryReadLatest(*segment, &sample));
+  EXPECT_GE(sample.mSequenceNumber, ProducerCount * RecordsPerProducer);
+}
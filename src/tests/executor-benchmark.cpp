@@ -0,0 +1,133 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+// Throughput and post-to-run latency of `Executor`, with several threads
+// posting to one executor thread that sleeps until woken - like posting
+// game events or tab updates to the UI thread.
+//
+// Usage: executor-benchmark [PRODUCERS [TASKS_PER_PRODUCER [BURST]]]
+//
+// Each producer posts BURST tasks back-to-back, then pauses briefly, so that
+// both batching and wake-ups are exercised.
+
+#include <OpenKneeboard/Executor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+  const auto arg = [=](int index, int fallback) {
+    return (argc > index) ? std::atoi(argv[index]) : fallback;
+  };
+  const auto producerCount = arg(1, 4);
+  const auto tasksPerProducer = arg(2, 250000);
+  const auto burst = arg(3, 64);
+  if (producerCount < 1 || tasksPerProducer < 1 || burst < 1) {
+    std::cerr << "Usage: executor-benchmark [PRODUCERS [TASKS_PER_PRODUCER "
+                 "[BURST]]]\n";
+    return EXIT_FAILURE;
+  }
+  const auto total = static_cast<size_t>(producerCount) * tasksPerProducer;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool woken = false;
+  size_t wakes = 0;
+  auto executor = Executor::Create([&](auto) {
+    {
+      std::unique_lock lock(mutex);
+      woken = true;
+    }
+    cv.notify_one();
+  });
+
+  // Only touched on the executor's thread
+  std::vector<Clock::duration> latencies;
+  latencies.reserve(total);
+  size_t batches = 0;
+
+  const auto start = Clock::now();
+  {
+    std::vector<std::jthread> producers;
+    for (int i = 0; i < producerCount; ++i) {
+      producers.emplace_back([&]() {
+        for (int i = 0; i < tasksPerProducer; ++i) {
+          executor->Post([&latencies, postedAt = Clock::now()]() {
+            latencies.push_back(Clock::now() - postedAt);
+          });
+          if ((i % burst) == burst - 1) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+          }
+        }
+      });
+    }
+
+    while (latencies.size() < total) {
+      {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [&] { return woken; });
+        woken = false;
+        ++wakes;
+      }
+      if (executor->Drain()) {
+        ++batches;
+      }
+    }
+  }
+  const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+  std::ranges::sort(latencies);
+  const auto percentile = [&](double p) {
+    const auto index = std::min<size_t>(
+      latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+    return std::chrono::duration<double, std::micro>(latencies.at(index))
+      .count();
+  };
+
+  std::cout << std::format(
+    "{} producer(s), {} tasks, bursts of {}\n"
+    "throughput: {:.0f} tasks/s; {} wake-ups, {} batches, {:.1f} tasks/batch\n"
+    "latency: p50={:.1f}us p90={:.1f}us p99={:.1f}us p99.9={:.1f}us "
+    "max={:.1f}us\n",
+    producerCount,
+    total,
+    burst,
+    total / elapsed.count(),
+    wakes,
+    batches,
+    static_cast<double>(total) / std::max<size_t>(batches, 1),
+    percentile(0.5),
+    percentile(0.9),
+    percentile(0.99),
+    percentile(0.999),
+    percentile(1.0));
+
+  return EXIT_SUCCESS;
+}
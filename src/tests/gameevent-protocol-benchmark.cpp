@@ -0,0 +1,191 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+// Serializing and parsing game events with the legacy v1 text format,
+// compared to the binary v2 format.
+//
+// Usage: gameevent-protocol-benchmark [EVENTS [VALUE_SIZE [BATCH]]]
+//
+// Single events use a mix of interned (DCS) and custom names; multi-events
+// are BATCH events, as a JSON multi-event for v1, and packed for v2.
+
+#include <OpenKneeboard/GameEvent.h>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::string SerializeV1(const GameEvent& event) {
+  return std::format(
+    "{:08x}!{}!{:08x}!{}!",
+    event.name.size(),
+    event.name,
+    event.value.size(),
+    event.value);
+}
+
+std::string SerializeV2(const GameEvent& event) {
+  const auto bytes = event.Serialize();
+  return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+  const auto arg = [=](int index, int fallback) {
+    return (argc > index) ? std::atoi(argv[index]) : fallback;
+  };
+  const auto eventCount = arg(1, 200000);
+  const auto valueSize = arg(2, 200);
+  const auto batchSize = arg(3, 16);
+  if (eventCount < 1 || valueSize < 0 || batchSize < 1) {
+    std::cerr << "Usage: gameevent-protocol-benchmark [EVENTS [VALUE_SIZE "
+                 "[BATCH]]]\n";
+    return EXIT_FAILURE;
+  }
+
+  const std::vector<std::string> names {
+    "dcs/SelfData",
+    "dcs/MissionTime",
+    "com.example/CustomEvent",
+  };
+  std::vector<GameEvent> events;
+  events.reserve(eventCount);
+  for (int i = 0; i < eventCount; ++i) {
+    events.push_back({
+      names.at(i % names.size()),
+      std::string(valueSize, static_cast<char>('a' + (i % 26))),
+    });
+  }
+
+  // Keeps the work from being optimized out, and checks that both formats
+  // see the same events
+  size_t checksum = 0;
+  const auto run = [&](const char* label, size_t count, auto&& func) {
+    checksum = 0;
+    const auto start = Clock::now();
+    func();
+    const auto elapsed = Clock::now() - start;
+    std::cout << std::format(
+      "{:<28} {:>8.1f}ms {:>8.1f}ns/event\n",
+      label,
+      std::chrono::duration<double, std::milli>(elapsed).count(),
+      std::chrono::duration<double, std::nano>(elapsed).count() / count);
+    return checksum;
+  };
+
+  std::cout << std::format(
+    "{} events, {}-byte values, batches of {}\n",
+    eventCount,
+    valueSize,
+    batchSize);
+
+  std::vector<std::string> v1;
+  std::vector<std::string> v2;
+  v1.reserve(eventCount);
+  v2.reserve(eventCount);
+  run("v1 serialize", eventCount, [&]() {
+    for (const auto& event: events) {
+      v1.push_back(SerializeV1(event));
+    }
+  });
+  run("v2 serialize", eventCount, [&]() {
+    for (const auto& event: events) {
+      v2.push_back(SerializeV2(event));
+    }
+  });
+
+  const auto parseInPlace = [&](const std::vector<std::string>& packets) {
+    return [&]() {
+      for (const auto& packet: packets) {
+        checksum += GameEventView::Parse(packet)->value.size();
+      }
+    };
+  };
+  const auto v1Parse = run("v1 parse", eventCount, parseInPlace(v1));
+  const auto v2Parse = run("v2 parse", eventCount, parseInPlace(v2));
+
+  const auto unserialize = [&](const std::vector<std::string>& packets) {
+    return [&]() {
+      for (const auto& packet: packets) {
+        checksum += GameEvent::Unserialize(packet).value.size();
+      }
+    };
+  };
+  const auto v1Copy = run("v1 parse and copy", eventCount, unserialize(v1));
+  const auto v2Copy = run("v2 parse and copy", eventCount, unserialize(v2));
+
+  // Multi-events, as `GameEventSendQueue` sends them
+  std::vector<std::string> jsonMulti;
+  std::vector<std::string> packedMulti;
+  for (size_t i = 0; i < events.size(); i += batchSize) {
+    const std::span batch(
+      events.begin() + i,
+      std::min<size_t>(events.size(), i + batchSize) - i);
+    auto json = nlohmann::json::array();
+    for (const auto& event: batch) {
+      json.push_back({event.name, event.value});
+    }
+    jsonMulti.push_back(
+      SerializeV1({GameEvent::EVT_MULTI_EVENT, json.dump()}));
+    const auto packed = GameEvent::SerializePacked(batch);
+    packedMulti.push_back(
+      {reinterpret_cast<const char*>(packed.data()), packed.size()});
+  }
+
+  const auto unserializeAll = [&](const std::vector<std::string>& packets) {
+    return [&]() {
+      std::vector<GameEvent> parsed;
+      for (const auto& packet: packets) {
+        parsed.clear();
+        GameEvent::UnserializeAll(packet, &parsed);
+        for (const auto& event: parsed) {
+          checksum += event.value.size();
+        }
+      }
+    };
+  };
+  const auto v1Multi
+    = run("v1 JSON multi-events", eventCount, unserializeAll(jsonMulti));
+  const auto v2Multi
+    = run("v2 packed multi-events", eventCount, unserializeAll(packedMulti));
+
+  const auto expected = static_cast<size_t>(eventCount) * valueSize;
+  for (const auto it: {v1Parse, v2Parse, v1Copy, v2Copy, v1Multi, v2Multi}) {
+    if (it != expected) {
+      std::cerr << "Formats parsed different events\n";
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+// libFuzzer target for parsing game event packets, which can come from any
+// process that can open the mailslot.
+//
+// Built with `-DWITH_FUZZERS=ON`, which requires Clang; e.g.
+//   build/src/tests/gameevent-protocol-fuzzer -max_total_time=60
+//
+// Beyond not crashing, this checks that accepted packets round-trip, and
+// that rejected packets don't add events.
+
+#include <OpenKneeboard/GameEvent.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <string_view>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  const std::string_view packet {reinterpret_cast<const char*>(data), size};
+
+  if (const auto view = GameEventView::Parse(packet)) {
+    if (view->name.empty()) {
+      abort();
+    }
+    if (!view->isPacked) {
+      const auto event = view->ToGameEvent();
+      const auto reserialized = event.Serialize();
+      const auto reparsed = GameEvent::Unserialize(
+        {reinterpret_cast<const char*>(reserialized.data()),
+         reserialized.size()});
+      if (reparsed.name != event.name || reparsed.value != event.value) {
+        abort();
+      }
+    }
+  }
+
+  std::vector<GameEvent> events {{"before", "1"}};
+  if (!GameEvent::UnserializeAll(packet, &events)) {
+    if (events.size() != 1) {
+      abort();
+    }
+    return 0;
+  }
+  if (events.size() < 2) {
+    abort();
+  }
+  const auto packed = GameEvent::SerializePacked(
+    std::span {events}.subspan(1));
+  std::vector<GameEvent> repacked;
+  if (!GameEvent::UnserializeAll(
+        {reinterpret_cast<const char*>(packed.data()), packed.size()},
+        &repacked)) {
+    abort();
+  }
+  if (repacked.size() != events.size() - 1) {
+    abort();
+  }
+  return 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+// Replays a recording of received game events through the app's parsing and
+// deduplication: `GameEvent::UnserializeAll()` then `GameEventDeduplicator`,
+// as `GameEventServer` does.
+//
+// Then, the delivered events are dispatched to TABS tabs, each subscribed to
+// the paths plus the events its type handles and parsing their values; this
+// compares:
+// - the old dispatch: every listener compares every event's name, then
+//   parses the value itself
+// - the current dispatch: each event is interned as an `InternedGameEvent`,
+//   routed by `GameEventID`, and parsed at most once, using the cached
+//   `ParsedValue()` and `GetJSON()`
+//
+// Usage: gameevent-replay-benchmark [RECORDING [REPEATS [TABS]]]
+//
+// The default recording is `data/dcs-flight.okgevents`: three minutes of a
+// DCS flight, with the hook's half-second state updates and periodic full
+// resends. Each recorded batch is sent as one packed multi-event, as
+// `GameEventSendQueue` does; the replay is as fast as possible, rather than
+// at the recorded times.
+
+#include <OpenKneeboard/GameEventDeduplicator.h>
+#include <OpenKneeboard/GameEventRecording.h>
+#include <OpenKneeboard/InternedGameEvent.h>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Like `DCSWorld::MissionTimeEvent`, which the clock and footer use
+struct MissionTimeEvent {
+  static constexpr auto ID {"dcs/MissionTime"};
+  double currentTime {};
+};
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(MissionTimeEvent, currentTime)
+
+// Names each tab type subscribes to, other than the two paths; as in
+// gameevent-routing-benchmark
+const std::vector<std::vector<std::string_view>> TabTypes {
+  {"dcs/Aircraft"},
+  {"dcs/Mission", "dcs/SelfData", "dcs/Origin"},
+  {"dcs/Mission", "dcs/Aircraft"},
+  {"dcs/SimulationStart", "dcs/Message", "dcs/MissionTime"},
+  {"dcs/Terrain", "dcs/MissionTime"},
+};
+
+// Values that listeners parse as JSON, rather than using as strings
+bool IsJSON(std::string_view name) {
+  return name == "dcs/SelfData" || name == "dcs/Origin"
+    || name == "dcs/Message" || name == "dcs/SimulationStart";
+}
+
+struct Subscription {
+  std::string mName;
+  // Stands in for the tab's work; incremented, so that the parse is used
+  double* mSink {nullptr};
+};
+
+}// namespace
+
+int main(int argc, char** argv) {
+  const std::string path = (argc > 1)
+    ? argv[1]
+    : OPENKNEEBOARD_TEST_DATA_DIR "/dcs-flight.okgevents";
+  const auto repeats = (argc > 2) ? std::atoi(argv[2]) : 200;
+  const auto tabCount = (argc > 3) ? std::atoi(argv[3]) : 20;
+  if (repeats < 1 || tabCount < 0) {
+    std::cerr
+      << "Usage: gameevent-replay-benchmark [RECORDING [REPEATS [TABS]]]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> packets;
+  size_t recordedEvents = 0;
+  try {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      std::cerr << std::format("Failed to open {}\n", path);
+      return EXIT_FAILURE;
+    }
+    GameEventRecordingReader reader(file);
+    while (const auto batch = reader.Next()) {
+      const auto packet = GameEvent::SerializePacked(batch->mEvents);
+      packets.emplace_back(
+        reinterpret_cast<const char*>(packet.data()), packet.size());
+      recordedEvents += batch->mEvents.size();
+    }
+  } catch (const std::exception& e) {
+    std::cerr << std::format("Failed to read {}: {}\n", path, e.what());
+    return EXIT_FAILURE;
+  }
+
+  GameEventDeduplicator deduplicator;
+  std::vector<GameEvent> events;
+  size_t parsed = 0;
+  size_t delivered = 0;
+  size_t invalid = 0;
+  // One pass's worth, for dispatching
+  std::vector<GameEvent> deliveredEvents;
+
+  const auto start = Clock::now();
+  for (int i = 0; i < repeats; ++i) {
+    // As if the game restarted, so that every repeat has the same work
+    deduplicator.Reset();
+    for (const auto& packet: packets) {
+      events.clear();
+      if (!GameEvent::UnserializeAll(packet, &events)) {
+        ++invalid;
+        continue;
+      }
+      parsed += events.size();
+      for (auto& event: events) {
+        if (deduplicator.ShouldDeliver(event)) {
+          ++delivered;
+          if (i == 0) {
+            deliveredEvents.push_back(std::move(event));
+          }
+        }
+      }
+    }
+  }
+  const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+  const auto stats = deduplicator.GetStatistics();
+  std::cout << std::format(
+    "{}: {} packets, {} events, replayed {} times\n"
+    "throughput: {:.0f} packets/s, {:.0f} events/s ({:.1f}ns/event)\n"
+    "delivered {} ({:.1f}%), suppressed {} as unchanged\n",
+    path,
+    packets.size(),
+    recordedEvents,
+    repeats,
+    (packets.size() * repeats) / elapsed.count(),
+    parsed / elapsed.count(),
+    (elapsed.count() * 1e9) / std::max<size_t>(parsed, 1),
+    delivered,
+    (100.0 * delivered) / std::max<size_t>(parsed, 1),
+    stats.mSuppressed);
+
+  if (invalid || parsed != recordedEvents * repeats) {
+    std::cerr << std::format("{} packets failed to parse\n", invalid);
+    return EXIT_FAILURE;
+  }
+
+  double sink = 0;
+  std::vector<Subscription> subscriptions;
+  for (int i = 0; i < tabCount; ++i) {
+    subscriptions.push_back({"dcs/InstallPath", &sink});
+    subscriptions.push_back({"dcs/SavedGamesPath", &sink});
+    for (const auto name: TabTypes.at(i % TabTypes.size())) {
+      subscriptions.push_back({std::string {name}, &sink});
+    }
+  }
+
+  // Parsing dominates, so fewer repeats are enough
+  const auto dispatchRepeats = std::max(1, repeats / 20);
+  size_t handled = 0;
+  const auto run = [&](const char* label, auto&& dispatch) {
+    handled = 0;
+    sink = 0;
+    const auto start = Clock::now();
+    for (int i = 0; i < dispatchRepeats; ++i) {
+      for (const auto& event: deliveredEvents) {
+        dispatch(event);
+      }
+    }
+    const auto elapsed = Clock::now() - start;
+    std::cout << std::format(
+      "{:<20} {:>8.1f}ms {:>8.1f}ns/event ({} handled)\n",
+      label,
+      std::chrono::duration<double, std::milli>(elapsed).count(),
+      std::chrono::duration<double, std::nano>(elapsed).count()
+        / (deliveredEvents.size() * dispatchRepeats),
+      handled);
+    return std::pair {handled, sink};
+  };
+
+  std::cout << std::format(
+    "dispatching {} delivered events {} times to {} tabs ({} "
+    "subscriptions)\n",
+    deliveredEvents.size(),
+    dispatchRepeats,
+    tabCount,
+    subscriptions.size());
+
+  // Before `GameEventDispatcher`, every tab saw every event as a
+  // `GameEvent`, and parsed the value itself
+  const auto old = run("Old dispatch", [&](const GameEvent& event) {
+    for (const auto& it: subscriptions) {
+      if (event.name != it.mName) {
+        continue;
+      }
+      ++handled;
+      if (event.name == MissionTimeEvent::ID) {
+        *it.mSink += event.ParsedValue<MissionTimeEvent>().currentTime;
+      } else if (IsJSON(event.name)) {
+        *it.mSink += nlohmann::json::parse(event.value).size();
+      } else {
+        *it.mSink += event.value.size();
+      }
+    }
+  });
+
+  // The dispatcher's routes, indexed by `GameEventID::GetIndex()`
+  std::vector<std::unique_ptr<std::vector<const Subscription*>>> routes;
+  const auto current = run("Current dispatch", [&](const GameEvent& event) {
+    // `GameEventServer` moves the event in; copying here keeps the input
+    // the same for every repeat
+    const auto shared = std::make_shared<const InternedGameEvent>(event);
+    const auto index = shared->GetID().GetIndex();
+    if (index >= routes.size()) {
+      routes.resize(index + 1);
+    }
+    auto& route = routes.at(index);
+    if (!route) {
+      route = std::make_unique<std::vector<const Subscription*>>();
+      for (const auto& it: subscriptions) {
+        if (it.mName == shared->GetID().GetName()) {
+          route->push_back(&it);
+        }
+      }
+    }
+
+    const auto name = shared->GetID().GetName();
+    for (const auto it: *route) {
+      ++handled;
+      if (name == MissionTimeEvent::ID) {
+        *it->mSink += shared->ParsedValue<MissionTimeEvent>().currentTime;
+      } else if (IsJSON(name)) {
+        *it->mSink += shared->GetJSON().size();
+      } else {
+        *it->mSink += shared->GetValue().size();
+      }
+    }
+  });
+
+  if (old != current) {
+    std::cerr << "Dispatchers handled different events\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+// Routing game events to the tabs that want them, as `GameEventDispatcher`
+// does, compared to broadcasting every event to every listener.
+//
+// Usage: gameevent-routing-benchmark [TABS [EVENTS]]
+//
+// The tabs are a mix of the DCS tab types - each subscribes to the install
+// and saved games paths, plus the events its type handles - and there's also
+// one listener for every event, like the troubleshooting log. The event
+// stream is weighted like DCS's periodic state updates.
+
+#include <OpenKneeboard/PrefixTrie.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::string_view InstallPath {"dcs/InstallPath"};
+constexpr std::string_view SavedGamesPath {"dcs/SavedGamesPath"};
+
+// Names each tab type subscribes to, other than the two paths
+const std::vector<std::vector<std::string_view>> TabTypes {
+  {"dcs/Aircraft"},
+  {"dcs/Mission", "dcs/SelfData", "dcs/Origin"},
+  {"dcs/Mission", "dcs/Aircraft"},
+  {"dcs/SimulationStart", "dcs/Message"},
+  {"dcs/Terrain"},
+};
+
+// Name, and relative frequency
+const std::vector<std::pair<std::string_view, int>> EventMix {
+  {"dcs/MissionTime", 20},
+  {"dcs/SelfData", 20},
+  {"dcs/Message", 5},
+  {"dcs/Aircraft", 1},
+  {"dcs/Terrain", 1},
+  {"dcs/Mission", 1},
+  {"dcs/Origin", 1},
+  {InstallPath, 1},
+  {SavedGamesPath, 1},
+  {"RemoteUserAction", 2},
+  {"SetTabByID", 1},
+};
+
+using Listener = std::function<void(std::string_view name)>;
+
+struct Subscription {
+  std::string mName;
+  bool mIsPrefix {false};
+  Listener mListener;
+};
+
+}// namespace
+
+int main(int argc, char** argv) {
+  const auto arg = [=](int index, int fallback) {
+    return (argc > index) ? std::atoi(argv[index]) : fallback;
+  };
+  const auto tabCount = arg(1, 200);
+  const auto eventCount = arg(2, 200000);
+  if (tabCount < 0 || eventCount < 1) {
+    std::cerr << "Usage: gameevent-routing-benchmark [TABS [EVENTS]]\n";
+    return EXIT_FAILURE;
+  }
+
+  uint64_t delivered = 0;
+  const Listener listener = [&](std::string_view) { ++delivered; };
+
+  std::vector<Subscription> subscriptions;
+  subscriptions.push_back({"", true, listener});
+  for (int i = 0; i < tabCount; ++i) {
+    subscriptions.push_back({std::string {InstallPath}, false, listener});
+    subscriptions.push_back({std::string {SavedGamesPath}, false, listener});
+    for (const auto name: TabTypes.at(i % TabTypes.size())) {
+      subscriptions.push_back({std::string {name}, false, listener});
+    }
+  }
+
+  std::vector<std::string_view> events;
+  {
+    std::vector<int> weights;
+    for (const auto& [name, weight]: EventMix) {
+      weights.push_back(weight);
+    }
+    std::mt19937 random(1234);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    events.reserve(eventCount);
+    for (int i = 0; i < eventCount; ++i) {
+      events.push_back(EventMix.at(pick(random)).first);
+    }
+  }
+
+  const auto run = [&](const char* label, auto&& dispatch) {
+    delivered = 0;
+    const auto start = Clock::now();
+    for (const auto name: events) {
+      dispatch(name);
+    }
+    const auto elapsed = Clock::now() - start;
+    std::cout << std::format(
+      "{:<24} {:>8.1f}ms {:>8.1f}ns/event ({} deliveries)\n",
+      label,
+      std::chrono::duration<double, std::milli>(elapsed).count(),
+      std::chrono::duration<double, std::nano>(elapsed).count() / eventCount,
+      delivered);
+    return delivered;
+  };
+
+  std::cout << std::format(
+    "{} tabs, {} subscriptions, {} events\n",
+    tabCount,
+    subscriptions.size(),
+    eventCount);
+
+  // Before routing, every listener checked every event's name
+  const auto broadcast = run("Broadcast", [&](std::string_view name) {
+    for (const auto& it: subscriptions) {
+      if (it.mIsPrefix ? name.starts_with(it.mName) : name == it.mName) {
+        it.mListener(name);
+      }
+    }
+  });
+
+  struct Listeners {
+    std::vector<const Listener*> mExact;
+    std::vector<const Listener*> mPrefix;
+  };
+  PrefixTrie<Listeners> trie;
+  for (const auto& it: subscriptions) {
+    auto& listeners = trie.GetOrCreate(it.mName);
+    (it.mIsPrefix ? listeners.mPrefix : listeners.mExact)
+      .push_back(&it.mListener);
+  }
+
+  const auto resolve = [&](std::string_view name) {
+    std::vector<const Listener*> route;
+    trie.ForEachPrefixOf(name, [&](std::string_view prefix, Listeners& it) {
+      std::ranges::copy(it.mPrefix, std::back_inserter(route));
+      if (prefix.size() == name.size()) {
+        std::ranges::copy(it.mExact, std::back_inserter(route));
+      }
+    });
+    return route;
+  };
+
+  const auto uncached = run("Trie walk per event", [&](std::string_view name) {
+    for (const auto it: resolve(name)) {
+      (*it)(name);
+    }
+  });
+
+  // What the dispatcher does: resolve each name once; names are interned to
+  // dense IDs there, which this map stands in for
+  std::unordered_map<std::string_view, std::vector<const Listener*>> routes;
+  const auto cached = run("Cached routes", [&](std::string_view name) {
+    auto it = routes.find(name);
+    if (it == routes.end()) {
+      it = routes.emplace(name, resolve(name)).first;
+    }
+    for (const auto listener: it->second) {
+      (*listener)(name);
+    }
+  });
+
+  if (broadcast != uncached || broadcast != cached) {
+    std::cerr << "Routing delivered different events to broadcasting\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+// Throughput and hit rate of `LRUCache`, with an access pattern like
+// `CachedLayer`'s: mostly flipping back and forth between nearby pages, with
+// occasional jumps, and page bitmaps of varying sizes.
+//
+// Usage: lru-cache-benchmark [PAGES [LOOKUPS [BUDGET_IN_PAGES]]]
+
+#include <OpenKneeboard/LRUCache.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace OpenKneeboard;
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+  const auto arg = [=](int index, int fallback) {
+    return (argc > index) ? std::atoi(argv[index]) : fallback;
+  };
+  const auto pageCount = arg(1, 500);
+  const auto lookupCount = arg(2, 5000000);
+  const auto budgetInPages = arg(3, 32);
+  if (pageCount < 1 || lookupCount < 1 || budgetInPages < 1) {
+    std::cerr << "Usage: lru-cache-benchmark [PAGES [LOOKUPS "
+                 "[BUDGET_IN_PAGES]]]\n";
+    return EXIT_FAILURE;
+  }
+
+  // Roughly 1-8MB bitmaps, averaging 4.5MB
+  constexpr size_t MB = 1024 * 1024;
+  std::mt19937 rng(1234);
+  std::vector<size_t> costs(pageCount);
+  for (auto& cost: costs) {
+    cost = std::uniform_int_distribution<size_t>(1 * MB, 8 * MB)(rng);
+  }
+
+  // Precomputed so that the random number generator isn't measured
+  std::vector<int> pages;
+  pages.reserve(lookupCount);
+  {
+    std::uniform_int_distribution<int> step(-2, 2);
+    std::uniform_int_distribution<int> anyPage(0, pageCount - 1);
+    std::bernoulli_distribution jump(0.01);
+    int page = 0;
+    for (int i = 0; i < lookupCount; ++i) {
+      page = jump(rng) ? anyPage(rng)
+                       : std::clamp(page + step(rng), 0, pageCount - 1);
+      pages.push_back(page);
+    }
+  }
+
+  LRUCache<int, std::shared_ptr<void>> cache(budgetInPages * (9 * MB / 2));
+  size_t evicted = 0;
+
+  const auto start = Clock::now();
+  for (const auto page: pages) {
+    if (cache.Find(page)) {
+      continue;
+    }
+    evicted += cache.Insert(page, nullptr, costs.at(page)).size();
+  }
+  const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+  const auto stats = cache.GetStatistics();
+  std::cout << std::format(
+    "{} pages, {} lookups, budget of ~{} pages ({}MB)\n"
+    "throughput: {:.0f} lookups/s\n"
+    "hit rate: {:.2f}%; {} evictions ({} returned); {} entries, {}MB\n",
+    pageCount,
+    lookupCount,
+    budgetInPages,
+    cache.GetBudget() / MB,
+    lookupCount / elapsed.count(),
+    (100.0 * stats.mHits) / (stats.mHits + stats.mMisses),
+    stats.mEvictions,
+    evicted,
+    stats.mEntryCount,
+    stats.mTotalCost / MB);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+// Publish/acquire latency of the SHM protocol with several writers and
+// readers, using the POSIX reference transport.
+//
+// Usage: shm-benchmark [WRITERS [READERS [HZ [SECONDS]]]]
+//
+// Each writer renders and publishes a 1024x1024 layer at HZ, contending for
+// the writer lock; each reader copies the latest frame at HZ, like a game's
+// render loop.
+
+#include <OpenKneeboard/SHMPOSIX.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace OpenKneeboard;
+using namespace OpenKneeboard::SHM;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Results final {
+  std::vector<Clock::duration> mLatencies;
+  uint64_t mFailures {};
+};
+
+void PrintResults(std::string_view label, Results& results) {
+  auto& latencies = results.mLatencies;
+  std::ranges::sort(latencies);
+  const auto percentile = [&](double p) {
+    if (latencies.empty()) {
+      return 0.0;
+    }
+    const auto index = std::min<size_t>(
+      latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+    return std::chrono::duration<double, std::micro>(latencies.at(index))
+      .count();
+  };
+  std::cout << std::format(
+    "{:<8} count={:<7} failed={:<6} p50={:>8.1f}us p90={:>8.1f}us "
+    "p99={:>8.1f}us p99.9={:>8.1f}us max={:>8.1f}us\n",
+    label,
+    latencies.size(),
+    results.mFailures,
+    percentile(0.5),
+    percentile(0.9),
+    percentile(0.99),
+    percentile(0.999),
+    percentile(1.0));
+}
+
+void Merge(Results* into, const Results& from) {
+  into->mLatencies.insert(
+    into->mLatencies.end(), from.mLatencies.begin(), from.mLatencies.end());
+  into->mFailures += from.mFailures;
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+  const auto arg = [=](int index, int fallback) {
+    return (argc > index) ? std::atoi(argv[index]) : fallback;
+  };
+  const auto writerCount = arg(1, 1);
+  const auto readerCount = arg(2, 4);
+  const auto hz = arg(3, 90);
+  const auto seconds = arg(4, 5);
+  if (writerCount < 1 || readerCount < 0 || hz < 1 || seconds < 1) {
+    std::cerr << "Usage: shm-benchmark [WRITERS [READERS [HZ [SECONDS]]]]\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto name = std::format("/OpenKneeboard-Benchmark-{}", getpid());
+  const auto interval = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(1.0 / hz));
+  const auto end = Clock::now() + std::chrono::seconds(seconds);
+
+  std::cout << std::format(
+    "{} writer(s), {} reader(s), {}Hz, {}s\n",
+    writerCount,
+    readerCount,
+    hz,
+    seconds);
+
+  std::vector<Results> writerResults(writerCount);
+  std::vector<Results> readerResults(readerCount);
+  {
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < writerCount; ++i) {
+      threads.emplace_back([&, i]() {
+        POSIX::Writer writer(name);
+        const LayerConfig layer {
+          .mLayerID = static_cast<uint64_t>(i + 1),
+          .mImageWidth = 1024,
+          .mImageHeight = 1024,
+        };
+        auto& results = writerResults.at(i);
+        POSIX::Pixel value = 0;
+        for (auto next = Clock::now(); next < end; next += interval) {
+          std::this_thread::sleep_until(next);
+          const auto start = Clock::now();
+          std::unique_lock lock(writer);
+          auto pixels = writer.GetNextPixels(0);
+          for (uint16_t y = 0; y < layer.mImageHeight; ++y) {
+            std::fill_n(
+              pixels.begin() + (y * TextureWidth), layer.mImageWidth, ++value);
+          }
+          writer.Update({}, {&layer, 1});
+          lock.unlock();
+          results.mLatencies.push_back(Clock::now() - start);
+        }
+      });
+    }
+
+    for (int i = 0; i < readerCount; ++i) {
+      threads.emplace_back([&, i]() {
+        POSIX::Reader reader(name);
+        POSIX::Frame frame;
+        auto& results = readerResults.at(i);
+        for (auto next = Clock::now(); next < end; next += interval) {
+          std::this_thread::sleep_until(next);
+          const auto start = Clock::now();
+          if (reader.TryCopyLatest(&frame)) {
+            results.mLatencies.push_back(Clock::now() - start);
+          } else {
+            ++results.mFailures;
+          }
+        }
+      });
+    }
+  }
+  POSIX::Unlink(name);
+
+  Results publish;
+  for (const auto& it: writerResults) {
+    Merge(&publish, it);
+  }
+  Results acquire;
+  for (const auto& it: readerResults) {
+    Merge(&acquire, it);
+  }
+  PrintResults("publish", publish);
+  PrintResults("acquire", acquire);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,418 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+// Resend a recording of received GameEvents to OpenKneeboard, so that tab
+// behavior - e.g. a slow mission load, or a flood of radio messages - can be
+// reproduced and profiled without DCS.
+//
+// Record by starting OpenKneeboard with the environment variable
+// OPENKNEEBOARD_GAME_EVENT_RECORDING set to the output file path.
+//
+// Each recorded packet is resent as a single packet. Per-tab handling times
+// are collected from the app's `DCSTab::OnGameEvent` trace events; this
+// needs a real-time ETW session, so requires running as an administrator or
+// as a member of the 'Performance Log Users' group.
+
+#include <OpenKneeboard/ConsoleLoopCondition.h>
+#include <OpenKneeboard/GameEvent.h>
+#include <OpenKneeboard/GameEventMailslot.h>
+#include <OpenKneeboard/GameEventRecording.h>
+#include <OpenKneeboard/dprint.h>
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <evntcons.h>
+#include <evntrace.h>
+#include <tdh.h>
+
+using namespace OpenKneeboard;
+
+namespace {
+
+// "OpenKneeboard.App"; see App.xaml.cpp
+constexpr GUID AppTraceProvider {
+  0xcc76597c,
+  0x1041,
+  0x5d57,
+  {0xc8, 0xab, 0x92, 0xcf, 0x94, 0x37, 0x10, 0x4a}};
+constexpr std::wstring_view TabEventName {L"DCSTab::OnGameEvent"};
+constexpr wchar_t TraceSessionName[] = L"OpenKneeboard-GameEventReplayer";
+
+struct TabTiming {
+  uint64_t mEventCount {};
+  std::chrono::nanoseconds mTotal {};
+  std::chrono::nanoseconds mMax {};
+};
+
+// Returns an empty string if the property is missing or not a string
+std::string GetStringProperty(EVENT_RECORD* record, const wchar_t* name) {
+  PROPERTY_DATA_DESCRIPTOR descriptor {
+    .PropertyName = reinterpret_cast<ULONGLONG>(name),
+    .ArrayIndex = ULONG_MAX,
+  };
+  ULONG size {};
+  if (
+    TdhGetPropertySize(record, 0, nullptr, 1, &descriptor, &size)
+    != ERROR_SUCCESS) {
+    return {};
+  }
+  std::string ret(size, '\0');
+  if (
+    TdhGetProperty(
+      record,
+      0,
+      nullptr,
+      1,
+      &descriptor,
+      size,
+      reinterpret_cast<BYTE*>(ret.data()))
+    != ERROR_SUCCESS) {
+    return {};
+  }
+  // Includes the trailing null
+  while (!ret.empty() && ret.back() == '\0') {
+    ret.pop_back();
+  }
+  return ret;
+}
+
+bool IsTabEvent(EVENT_RECORD* record) {
+  ULONG size {};
+  if (
+    TdhGetEventInformation(record, 0, nullptr, nullptr, &size)
+    != ERROR_INSUFFICIENT_BUFFER) {
+    return false;
+  }
+  std::vector<std::byte> buffer(size);
+  auto info = reinterpret_cast<TRACE_EVENT_INFO*>(buffer.data());
+  if (
+    TdhGetEventInformation(record, 0, nullptr, info, &size)
+    != ERROR_SUCCESS) {
+    return false;
+  }
+  // TDH reports the name of TraceLogging events as the task name
+  if (info->TaskNameOffset == 0) {
+    return false;
+  }
+  return reinterpret_cast<const wchar_t*>(buffer.data() + info->TaskNameOffset)
+    == TabEventName;
+}
+
+/// Collects per-tab handling times from a real-time ETW session
+class TabTimingMonitor final {
+ public:
+  TabTimingMonitor() = default;
+  ~TabTimingMonitor();
+
+  TabTimingMonitor(const TabTimingMonitor&) = delete;
+  TabTimingMonitor& operator=(const TabTimingMonitor&) = delete;
+
+  /// Returns false and prints the reason if the session can't be started
+  bool Start();
+  /// Delivers any buffered events, then stops the session
+  void Stop();
+
+  /// Only valid after `Stop()`
+  const auto& GetTimings() const {
+    return mTimings;
+  }
+  /// Handlers that started but hadn't finished by `Stop()`
+  size_t GetUnfinishedCount() const {
+    return mPending.size();
+  }
+
+ private:
+  struct GUIDLess {
+    bool operator()(const GUID& a, const GUID& b) const {
+      return std::memcmp(&a, &b, sizeof(GUID)) < 0;
+    }
+  };
+  struct PendingEvent {
+    std::string mTab;
+    int64_t mStartedAt {};
+  };
+
+  std::vector<std::byte> mProperties;
+  TRACEHANDLE mSession {};
+  TRACEHANDLE mTrace {INVALID_PROCESSTRACE_HANDLE};
+  std::thread mThread;
+
+  // Only accessed by `mThread` until it's joined
+  std::map<GUID, PendingEvent, GUIDLess> mPending;
+  std::map<std::string, TabTiming> mTimings;
+
+  EVENT_TRACE_PROPERTIES* ResetProperties();
+  static void WINAPI OnEventRecord(EVENT_RECORD*);
+  void OnEvent(EVENT_RECORD*);
+};
+
+TabTimingMonitor::~TabTimingMonitor() {
+  this->Stop();
+}
+
+EVENT_TRACE_PROPERTIES* TabTimingMonitor::ResetProperties() {
+  mProperties.assign(
+    sizeof(EVENT_TRACE_PROPERTIES) + sizeof(TraceSessionName), {});
+  auto props = reinterpret_cast<EVENT_TRACE_PROPERTIES*>(mProperties.data());
+  props->Wnode.BufferSize = static_cast<ULONG>(mProperties.size());
+  props->Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+  // QueryPerformanceCounter
+  props->Wnode.ClientContext = 1;
+  props->LogFileMode = EVENT_TRACE_REAL_TIME_MODE;
+  props->LoggerNameOffset = sizeof(EVENT_TRACE_PROPERTIES);
+  return props;
+}
+
+bool TabTimingMonitor::Start() {
+  auto error = StartTraceW(&mSession, TraceSessionName, ResetProperties());
+  if (error == ERROR_ALREADY_EXISTS) {
+    // Left behind by a previous run that didn't exit cleanly
+    ControlTraceW(
+      0, TraceSessionName, ResetProperties(), EVENT_TRACE_CONTROL_STOP);
+    error = StartTraceW(&mSession, TraceSessionName, ResetProperties());
+  }
+  if (error == ERROR_ACCESS_DENIED) {
+    fprintf(
+      stderr,
+      "Per-tab timings need an administrator or 'Performance Log Users' "
+      "member; replaying without them.\n");
+    mSession = {};
+    return false;
+  }
+  if (error != ERROR_SUCCESS) {
+    fprintf(stderr, "Failed to start trace session: %lu\n", error);
+    mSession = {};
+    return false;
+  }
+
+  error = EnableTraceEx2(
+    mSession,
+    &AppTraceProvider,
+    EVENT_CONTROL_CODE_ENABLE_PROVIDER,
+    TRACE_LEVEL_VERBOSE,
+    0,
+    0,
+    0,
+    nullptr);
+  if (error != ERROR_SUCCESS) {
+    fprintf(stderr, "Failed to enable app trace provider: %lu\n", error);
+    this->Stop();
+    return false;
+  }
+
+  EVENT_TRACE_LOGFILEW logFile {};
+  logFile.LoggerName = const_cast<wchar_t*>(TraceSessionName);
+  logFile.ProcessTraceMode
+    = PROCESS_TRACE_MODE_REAL_TIME | PROCESS_TRACE_MODE_EVENT_RECORD;
+  logFile.EventRecordCallback = &TabTimingMonitor::OnEventRecord;
+  logFile.Context = this;
+  mTrace = OpenTraceW(&logFile);
+  if (mTrace == INVALID_PROCESSTRACE_HANDLE) {
+    fprintf(stderr, "Failed to open trace session: %lu\n", GetLastError());
+    this->Stop();
+    return false;
+  }
+
+  mThread = std::thread {
+    [this]() { ProcessTrace(&mTrace, 1, nullptr, nullptr); }};
+  return true;
+}
+
+void TabTimingMonitor::Stop() {
+  if (mSession) {
+    // `ProcessTrace()` returns once it has delivered the remaining events
+    ControlTraceW(
+      mSession, nullptr, ResetProperties(), EVENT_TRACE_CONTROL_STOP);
+    mSession = {};
+  }
+  if (mThread.joinable()) {
+    mThread.join();
+  }
+  if (mTrace != INVALID_PROCESSTRACE_HANDLE) {
+    CloseTrace(mTrace);
+    mTrace = INVALID_PROCESSTRACE_HANDLE;
+  }
+}
+
+void WINAPI TabTimingMonitor::OnEventRecord(EVENT_RECORD* record) {
+  static_cast<TabTimingMonitor*>(record->UserContext)->OnEvent(record);
+}
+
+void TabTimingMonitor::OnEvent(EVENT_RECORD* record) {
+  const auto& header = record->EventHeader;
+  if (header.ProviderId != AppTraceProvider) {
+    return;
+  }
+  const auto opcode = header.EventDescriptor.Opcode;
+  if (opcode != WINEVENT_OPCODE_START && opcode != WINEVENT_OPCODE_STOP) {
+    return;
+  }
+  if (!IsTabEvent(record)) {
+    return;
+  }
+
+  if (opcode == WINEVENT_OPCODE_START) {
+    mPending[header.ActivityId] = {
+      .mTab = GetStringProperty(record, L"Tab"),
+      .mStartedAt = header.TimeStamp.QuadPart,
+    };
+    return;
+  }
+
+  auto it = mPending.find(header.ActivityId);
+  if (it == mPending.end()) {
+    // Started before the session
+    return;
+  }
+  // Timestamps are FILETIMEs, i.e. 100ns units
+  const std::chrono::nanoseconds duration {
+    (header.TimeStamp.QuadPart - it->second.mStartedAt) * 100};
+  auto& timing = mTimings[it->second.mTab];
+  ++timing.mEventCount;
+  timing.mTotal += duration;
+  timing.mMax = std::max(timing.mMax, duration);
+  mPending.erase(it);
+}
+
+void PrintTabTimings(const TabTimingMonitor& monitor) {
+  std::vector<std::pair<std::string, TabTiming>> timings {
+    monitor.GetTimings().begin(), monitor.GetTimings().end()};
+  if (timings.empty()) {
+    printf(
+      "No tab handled any events; is OpenKneeboard running, with DCS tabs?\n");
+    return;
+  }
+  std::ranges::sort(timings, [](const auto& a, const auto& b) {
+    return a.second.mTotal > b.second.mTotal;
+  });
+
+  using Millis = std::chrono::duration<double, std::milli>;
+  printf(
+    "\n%-32s %10s %12s %12s %12s\n",
+    "Tab",
+    "Events",
+    "Total (ms)",
+    "Mean (ms)",
+    "Max (ms)");
+  for (const auto& [tab, timing]: timings) {
+    printf(
+      "%-32s %10llu %12.3f %12.3f %12.3f\n",
+      tab.c_str(),
+      timing.mEventCount,
+      Millis(timing.mTotal).count(),
+      Millis(timing.mTotal).count() / timing.mEventCount,
+      Millis(timing.mMax).count());
+  }
+  if (const auto unfinished = monitor.GetUnfinishedCount()) {
+    printf("%zu handlers had not finished when timing stopped.\n", unfinished);
+  }
+}
+
+}// namespace
+
+int wmain(int argc, wchar_t** argv) {
+  DPrintSettings::Set({
+    .prefix = "gameevent-replayer",
+    .consoleOutput = DPrintSettings::ConsoleOutputMode::ALWAYS,
+  });
+
+  if (argc < 2 || argc > 3) {
+    fprintf(
+      stderr,
+      "Usage: %S INPUT_FILE [SPEED]\n\n"
+      "SPEED defaults to 1.0; use 0 to replay as fast as possible.\n",
+      argv[0]);
+    return 1;
+  }
+
+  const double speed = (argc == 3) ? std::stod(argv[2]) : 1.0;
+
+  std::ifstream file(argv[1], std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "Failed to open %S\n", argv[1]);
+    return 1;
+  }
+  GameEventRecordingReader recording(file);
+
+  TabTimingMonitor tabTimings;
+  const bool haveTabTimings = tabTimings.Start();
+
+  printf("Replaying %S at %.2fx - hit Ctrl-C to exit.\n", argv[1], speed);
+
+  ConsoleLoopCondition cliLoop;
+  MailslotGameEventSender sender;
+  const GameEventReplayScheduler scheduler(
+    std::chrono::steady_clock::now(), speed);
+  uint64_t packetCount {};
+  uint64_t eventCount {};
+  uint64_t failedPacketCount {};
+  std::chrono::steady_clock::duration maxLateness {};
+
+  while (const auto batch = recording.Next()) {
+    const auto dueAt = scheduler.GetDueTime(*batch);
+    const auto now = std::chrono::steady_clock::now();
+    if (dueAt > now) {
+      if (!cliLoop.Sleep(dueAt - now)) {
+        break;
+      }
+    } else {
+      maxLateness = std::max(maxLateness, now - dueAt);
+    }
+
+    const auto packet = (batch->mEvents.size() == 1)
+      ? batch->mEvents.front().Serialize()
+      : GameEvent::SerializePacked(batch->mEvents);
+    if (!sender.Send(packet)) {
+      ++failedPacketCount;
+    }
+    ++packetCount;
+    eventCount += batch->mEvents.size();
+  }
+
+  printf(
+    "Replayed %llu events in %llu packets; worst lateness was %.3fms.\n",
+    eventCount,
+    packetCount,
+    std::chrono::duration<double, std::milli>(maxLateness).count());
+  if (failedPacketCount) {
+    printf(
+      "%llu packets could not be sent; is OpenKneeboard running?\n",
+      failedPacketCount);
+  }
+
+  if (haveTabTimings) {
+    // Let the app finish handling the last packets
+    cliLoop.Sleep(std::chrono::seconds(2));
+    tabTimings.Stop();
+    PrintTabTimings(tabTimings);
+  }
+  return 0;
+}
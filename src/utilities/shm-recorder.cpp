@@ -0,0 +1,102 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+// Record every SHM header publication to a file, for `shm-replayer`.
+//
+// This doesn't register as a consumer, so the app won't render for it: run
+// it alongside a real consumer.
+
+#include <OpenKneeboard/ConsoleLoopCondition.h>
+#include <OpenKneeboard/SHM.h>
+#include <OpenKneeboard/SHMRecording.h>
+#include <OpenKneeboard/dprint.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+
+using namespace OpenKneeboard;
+
+int wmain(int argc, wchar_t** argv) {
+  DPrintSettings::Set({
+    .prefix = "shm-recorder",
+    .consoleOutput = DPrintSettings::ConsoleOutputMode::ALWAYS,
+  });
+
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %S OUTPUT_FILE\n", argv[0]);
+    return 1;
+  }
+
+  std::ofstream file(argv[1], std::ios::binary | std::ios::trunc);
+  if (!file) {
+    fprintf(stderr, "Failed to open %S\n", argv[1]);
+    return 1;
+  }
+  SHM::RecordingWriter recording(file);
+
+  SHM::Reader shm;
+  ConsoleLoopCondition cliLoop;
+
+  printf("Recording SHM to %S - hit Ctrl-C to exit.\n", argv[1]);
+
+  std::optional<std::chrono::steady_clock::time_point> firstFrameAt;
+  uint64_t sessionID {};
+  uint32_t sequenceNumber {};
+  uint64_t frameCount {};
+
+  // Polling rather than using the new-frame event, as that would register
+  // us as a consumer
+  do {
+    if (shm.GetFrameCountForMetricsOnly() == sequenceNumber) {
+      continue;
+    }
+    SHM::Header header;
+    if (!shm.TryGetHeader(&header)) {
+      continue;
+    }
+    if (
+      header.mSessionID == sessionID
+      && header.mSequenceNumber == sequenceNumber) {
+      continue;
+    }
+    sessionID = header.mSessionID;
+    sequenceNumber = header.mSequenceNumber;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!firstFrameAt) {
+      firstFrameAt = now;
+    }
+
+    recording.Write({
+      .mTime = now - *firstFrameAt,
+      .mSessionID = header.mSessionID,
+      .mSequenceNumber = header.mSequenceNumber,
+      .mActiveConsumers = shm.GetActiveConsumers(),
+      .mConfig = header.mConfig,
+      .mLayers = {header.mLayers, header.mLayers + header.mLayerCount},
+    });
+    ++frameCount;
+  } while (cliLoop.Sleep(std::chrono::milliseconds(1)));
+
+  printf("Recorded %llu frames.\n", frameCount);
+  return 0;
+}
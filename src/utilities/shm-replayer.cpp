@@ -0,0 +1,178 @@
+/*
+ * OpenKneeboard
+ *
+ * Copyright (C) 2023 Fred Emmott <fred@fredemmott.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+// Republish a recording from `shm-recorder` through the SHM writer, so that
+// consumer behavior can be reproduced and benchmarked without the app.
+//
+// Pixels aren't recorded; each layer is filled with a color that changes
+// with the layer's generation.
+//
+// Do not run this at the same time as OpenKneeboard.
+
+#include <OpenKneeboard/ConsoleLoopCondition.h>
+#include <OpenKneeboard/SHM.h>
+#include <OpenKneeboard/SHMRecording.h>
+#include <OpenKneeboard/config.h>
+#include <OpenKneeboard/dprint.h>
+
+#include <shims/winrt/base.h>
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <d3d11_4.h>
+#include <dxgi1_2.h>
+
+using namespace OpenKneeboard;
+
+struct SharedTextureResources {
+  winrt::com_ptr<ID3D11Texture2D> mTexture;
+  winrt::com_ptr<ID3D11RenderTargetView> mTextureRTV;
+  winrt::handle mSharedHandle;
+};
+
+int wmain(int argc, wchar_t** argv) {
+  DPrintSettings::Set({
+    .prefix = "shm-replayer",
+    .consoleOutput = DPrintSettings::ConsoleOutputMode::ALWAYS,
+  });
+
+  if (argc < 2 || argc > 3) {
+    fprintf(
+      stderr,
+      "Usage: %S INPUT_FILE [SPEED]\n\n"
+      "SPEED defaults to 1.0; use 0 to replay as fast as possible.\n",
+      argv[0]);
+    return 1;
+  }
+
+  const double speed = (argc == 3) ? std::stod(argv[2]) : 1.0;
+
+  std::ifstream file(argv[1], std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "Failed to open %S\n", argv[1]);
+    return 1;
+  }
+  SHM::RecordingReader recording(file);
+
+  winrt::com_ptr<ID3D11Device> device;
+  UINT d3dFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+#ifdef DEBUG
+  d3dFlags |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+  auto d3dLevel = D3D_FEATURE_LEVEL_11_1;
+  winrt::com_ptr<ID3D11DeviceContext> ctx;
+  winrt::check_hresult(D3D11CreateDevice(
+    nullptr,
+    D3D_DRIVER_TYPE_HARDWARE,
+    nullptr,
+    d3dFlags,
+    &d3dLevel,
+    1,
+    D3D11_SDK_VERSION,
+    device.put(),
+    nullptr,
+    ctx.put()));
+  auto ctx4 = ctx.as<ID3D11DeviceContext4>();
+
+  SHM::Writer shm;
+
+  std::array<std::array<SharedTextureResources, TextureCount>, MaxLayers>
+    resources;
+  for (uint8_t layerIndex = 0; layerIndex < MaxLayers; ++layerIndex) {
+    for (uint8_t bufferIndex = 0; bufferIndex < TextureCount; ++bufferIndex) {
+      auto& it = resources.at(layerIndex).at(bufferIndex);
+      it.mTexture = SHM::CreateCompatibleTexture(
+        device.get(),
+        SHM::DEFAULT_D3D11_BIND_FLAGS,
+        D3D11_RESOURCE_MISC_SHARED_NTHANDLE | D3D11_RESOURCE_MISC_SHARED);
+      winrt::check_hresult(device->CreateRenderTargetView(
+        it.mTexture.get(), nullptr, it.mTextureRTV.put()));
+      const auto textureName
+        = SHM::SharedTextureName(shm.GetSessionID(), layerIndex, bufferIndex);
+      winrt::check_hresult(it.mTexture.as<IDXGIResource1>()->CreateSharedHandle(
+        nullptr,
+        DXGI_SHARED_RESOURCE_READ,
+        textureName.c_str(),
+        it.mSharedHandle.put()));
+    }
+  }
+
+  winrt::com_ptr<ID3D11Fence> fence;
+  winrt::check_hresult(device.as<ID3D11Device5>()->CreateFence(
+    0, D3D11_FENCE_FLAG_SHARED, IID_PPV_ARGS(fence.put())));
+  winrt::handle fenceHandle;
+  winrt::check_hresult(fence->CreateSharedHandle(
+    nullptr, DXGI_SHARED_RESOURCE_READ, nullptr, fenceHandle.put()));
+
+  const FLOAT colors[][4] = {
+    {1.0f, 0.0f, 0.0f, 1.0f},// red
+    {0.0f, 1.0f, 0.0f, 1.0f},// green
+    {0.0f, 0.0f, 1.0f, 1.0f},// blue
+    {1.0f, 0.0f, 1.0f, 0.5f},// translucent magenta
+  };
+
+  printf("Replaying %S at %.2fx - hit Ctrl-C to exit.\n", argv[1], speed);
+
+  ConsoleLoopCondition cliLoop;
+  const SHM::ReplayScheduler scheduler(
+    std::chrono::steady_clock::now(), speed);
+  uint64_t frameCount {};
+  std::chrono::steady_clock::duration maxLateness {};
+
+  while (const auto frame = recording.Next()) {
+    const auto dueAt = scheduler.GetDueTime(*frame);
+    const auto now = std::chrono::steady_clock::now();
+    if (dueAt > now) {
+      if (!cliLoop.Sleep(dueAt - now)) {
+        break;
+      }
+    } else {
+      maxLateness = std::max(maxLateness, now - dueAt);
+    }
+
+    const std::unique_lock shmLock(shm);
+    const auto bufferIndex = shm.GetNextTextureIndex();
+    for (uint8_t i = 0; i < frame->mLayers.size(); ++i) {
+      const auto& layer = frame->mLayers.at(i);
+      ctx->ClearRenderTargetView(
+        resources.at(i).at(bufferIndex).mTextureRTV.get(),
+        colors[(layer.mGeneration + i) % std::size(colors)]);
+    }
+    winrt::check_hresult(
+      ctx4->Signal(fence.get(), shm.GetNextSequenceNumber()));
+    ctx->Flush();
+
+    shm.Update(frame->mConfig, frame->mLayers, fenceHandle.get());
+    ++frameCount;
+  }
+
+  printf(
+    "Replayed %llu frames; worst lateness was %.3fms.\n",
+    frameCount,
+    std::chrono::duration<double, std::milli>(maxLateness).count());
+  return 0;
+}
@@ -17,18 +17,206 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
  * USA.
  */
+
+// Without arguments, send DCS-like events to OpenKneeboard every second.
+//
+// With `load`, send synthetic events through a private mailslot or Unix
+// socket instead, and report delivery latency and drops; OpenKneeboard
+// doesn't need to be running.
+
 #include <OpenKneeboard/ConsoleLoopCondition.h>
 #include <OpenKneeboard/DCSWorld.h>
 #include <OpenKneeboard/GameEvent.h>
+#include <OpenKneeboard/GameEventLoadGenerator.h>
+#include <OpenKneeboard/GameEventMailslot.h>
+#include <OpenKneeboard/GameEventUnixSocket.h>
+#include <OpenKneeboard/config.h>
 #include <Windows.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <format>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
 
 using namespace OpenKneeboard;
 using DCS = OpenKneeboard::DCSWorld;
 
-int main() {
+namespace {
+
+enum class Transport {
+  Mailslot,
+  UnixSocket,
+};
+
+struct LoadTestOptions {
+  GameEventLoadProfile mProfile;
+  Transport mTransport {Transport::Mailslot};
+  bool mSynchronous {false};
+};
+
+void PrintUsage(const char* argv0) {
+  fprintf(
+    stderr,
+    "Usage: %s [load [OPTIONS]]\n\n"
+    "Load test options:\n"
+    "  --rate N              events per second (default 1000)\n"
+    "  --burst N             events sent back-to-back (default 1)\n"
+    "  --payload MIN[-MAX]   payload bytes (default 64)\n"
+    "  --log-uniform         mostly small payloads, rather than uniform\n"
+    "  --duration SECONDS    (default 10)\n"
+    "  --transport mailslot|unix\n"
+    "  --sync                use Send() instead of SendAsync()\n",
+    argv0);
+}
+
+std::optional<LoadTestOptions> ParseLoadTestOptions(int argc, char** argv) {
+  LoadTestOptions ret;
+  auto& profile = ret.mProfile;
+  for (int i = 2; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (arg == "--log-uniform") {
+      profile.mPayloadDistribution
+        = GameEventLoadProfile::PayloadDistribution::LogUniform;
+      continue;
+    }
+    if (arg == "--sync") {
+      ret.mSynchronous = true;
+      continue;
+    }
+
+    if (i + 1 == argc) {
+      return std::nullopt;
+    }
+    const std::string value {argv[++i]};
+    if (arg == "--rate") {
+      profile.mEventsPerSecond = std::stod(value);
+    } else if (arg == "--burst") {
+      profile.mBurstSize = std::stoull(value);
+    } else if (arg == "--payload") {
+      const auto dash = value.find('-');
+      profile.mMinPayloadBytes = std::stoull(value.substr(0, dash));
+      profile.mMaxPayloadBytes = (dash == std::string::npos)
+        ? profile.mMinPayloadBytes
+        : std::stoull(value.substr(dash + 1));
+    } else if (arg == "--duration") {
+      profile.mDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(std::stod(value)));
+    } else if (arg == "--transport" && value == "mailslot") {
+      ret.mTransport = Transport::Mailslot;
+    } else if (arg == "--transport" && value == "unix") {
+      ret.mTransport = Transport::UnixSocket;
+    } else {
+      return std::nullopt;
+    }
+  }
+  return ret;
+}
+
+int RunLoadTest(const LoadTestOptions& options) {
+  using Clock = GameEventLoadGenerator::Clock;
+
+  const auto pid = GetCurrentProcessId();
+  std::unique_ptr<IGameEventReceiver> receiver;
+  switch (options.mTransport) {
+    case Transport::Mailslot: {
+      const auto path
+        = std::format(L"\\\\.\\mailslot\\{}.loadtest.{}", ProjectNameW, pid);
+      receiver = std::make_unique<MailslotGameEventReceiver>(path);
+      GameEvent::SetSender(std::make_shared<MailslotGameEventSender>(path));
+      break;
+    }
+    case Transport::UnixSocket: {
+      const auto fileName
+        = std::format("{}-loadtest-{}.sock", ProjectNameA, pid);
+      const auto path
+        = to_utf8(std::filesystem::temp_directory_path() / fileName);
+      receiver = std::make_unique<UnixSocketGameEventReceiver>(path);
+      GameEvent::SetSender(std::make_shared<UnixSocketGameEventSender>(path));
+      break;
+    }
+  }
+
+  GameEventDeliveryStats stats;
+  std::atomic<uint64_t> receivedCount {0};
+  std::jthread receiverThread([&](std::stop_token stop) {
+    std::vector<GameEvent> events;
+    while (!stop.stop_requested()) {
+      const auto packet = receiver->Receive(std::chrono::milliseconds(100));
+      if (!packet) {
+        continue;
+      }
+      const auto receivedAt = Clock::now();
+      events.clear();
+      GameEvent::UnserializeAll(
+        {reinterpret_cast<const char*>(packet->data()), packet->size()},
+        &events);
+      for (const auto& event: events) {
+        stats.Record(event, receivedAt);
+      }
+      receivedCount.store(stats.GetReceivedCount());
+    }
+  });
+
+  printf("Load testing - hit Ctrl-C to stop early.\n");
+  GameEventLoadGenerator generator(options.mProfile);
+  ConsoleLoopCondition cliLoop;
+  const auto start = Clock::now();
+  while (const auto burst = generator.NextBurst()) {
+    const auto dueAt = start + burst->mDueAt;
+    const auto now = Clock::now();
+    if (dueAt > now && !cliLoop.Sleep(dueAt - now)) {
+      break;
+    }
+    for (size_t i = 0; i < burst->mSize; ++i) {
+      const auto event = generator.CreateEvent(Clock::now());
+      if (options.mSynchronous) {
+        event.Send();
+      } else {
+        event.SendAsync();
+      }
+    }
+  }
+  GameEvent::FlushAsyncSends();
+
+  const auto sent = generator.GetCreatedCount();
+  const auto sentAt = Clock::now();
+  while (receivedCount.load() < sent
+         && Clock::now() - sentAt < std::chrono::seconds(2)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  receiverThread.request_stop();
+  receiverThread.join();
+  GameEvent::SetSender(nullptr);
+
+  const auto summary = stats.Summarize(sent);
+  const auto us = [](Clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+  };
+  printf(
+    "Sent %llu, received %llu, dropped %llu, duplicated %llu, "
+    "out of order %llu\n"
+    "Latency: p50 %.1fus, p90 %.1fus, p99 %.1fus, p99.9 %.1fus, "
+    "max %.1fus\n",
+    summary.mSent,
+    summary.mReceived,
+    summary.mDropped,
+    summary.mDuplicates,
+    summary.mOutOfOrder,
+    us(summary.mP50),
+    us(summary.mP90),
+    us(summary.mP99),
+    us(summary.mP999),
+    us(summary.mMax));
+  return summary.mDropped ? 2 : 0;
+}
+
+int RunFeeder() {
   printf("Feeding GameEvents to OpenKneeboard - hit Ctrl-C to exit.\n");
   ConsoleLoopCondition cliLoop;
   const auto pid = GetCurrentProcessId();
@@ -61,3 +249,25 @@ int main() {
   printf("Exit requested, cleaning up.\n");
   return 0;
 }
+
+}// namespace
+
+int main(int argc, char** argv) {
+  if (argc == 1) {
+    return RunFeeder();
+  }
+
+  std::optional<LoadTestOptions> options;
+  try {
+    if (std::string_view {argv[1]} == "load") {
+      options = ParseLoadTestOptions(argc, argv);
+    }
+  } catch (const std::exception&) {
+    // e.g. std::invalid_argument from std::stoull()
+  }
+  if (!options) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  return RunLoadTest(*options);
+}
@@ -114,7 +114,6 @@ class TestViewerWindow final {
       NULL,
       instance,
       nullptr);
-    SetTimer(mHwnd, /* id = */ 1, 1000 / 60, nullptr);
 
     mDXR = DXResources::Create();
     mDXR.mD2DDeviceContext->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
@@ -144,6 +143,10 @@ class TestViewerWindow final {
     return mHwnd;
   }
 
+  HANDLE GetNewFrameEvent() {
+    return mSHM.GetNewFrameEvent(SHM::ConsumerKind::Test);
+  }
+
   void CheckForUpdate() {
     if (!mSHM) {
       if (mFirstDetached) {
@@ -488,9 +491,6 @@ LRESULT CALLBACK TestViewerWindow::WindowProc(
     case WM_PAINT:
       gInstance->OnPaint();
       return 0;
-    case WM_TIMER:
-      gInstance->CheckForUpdate();
-      return 0;
     case WM_SIZE:
       gInstance->OnResize({
         .width = LOWORD(lParam),
@@ -522,11 +522,27 @@ int WINAPI wWinMain(
   TestViewerWindow window(hInstance);
   ShowWindow(window.GetHWND(), nCmdShow);
 
+  // Wake up for new frames instead of polling; still wake up occasionally
+  // in case we're out of consumer slots, and to send heartbeats well within
+  // the timeout so that we stay registered
+  constexpr auto timeoutMS
+    = static_cast<DWORD>((SHM::ConsumerTimeout / 4).count());
   MSG msg = {};
-  while (GetMessage(&msg, NULL, 0, 0) > 0) {
-    TranslateMessage(&msg);
-    DispatchMessage(&msg);
+  while (true) {
+    const auto frameEvent = window.GetNewFrameEvent();
+    const DWORD handleCount = frameEvent ? 1 : 0;
+    const auto result = MsgWaitForMultipleObjects(
+      handleCount, &frameEvent, FALSE, timeoutMS, QS_ALLINPUT);
+    if (result == WAIT_OBJECT_0 + handleCount) {
+      while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+        if (msg.message == WM_QUIT) {
+          return 0;
+        }
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+      }
+      continue;
+    }
+    window.CheckForUpdate();
   }
-
-  return 0;
 }
@@ -14,8 +14,10 @@ set(
   Rpcrt4
   Shell32
   Shlwapi
+  Tdh
   User32
   WindowsApp
+  Ws2_32
 )
 
 foreach(LIBRARY ${SYSTEM_LIBRARIES})